@@ -1,2 +1,5 @@
 "C:\VulkanSDK\1.4.321.1\Bin\glslc.exe" "D:\VulkanTutorial\Content\VertexShader.vert" -o "D:\VulkanTutorial\Content\VertexShader.vert.spv"
-"C:\VulkanSDK\1.4.321.1\Bin\glslc.exe" "D:\VulkanTutorial\Content\PixelShader.frag" -o "D:\VulkanTutorial\Content\PixelShader.frag.spv"
\ No newline at end of file
+"C:\VulkanSDK\1.4.321.1\Bin\glslc.exe" "D:\VulkanTutorial\Content\PixelShader.frag" -o "D:\VulkanTutorial\Content\PixelShader.frag.spv"
+"C:\VulkanSDK\1.4.321.1\Bin\glslc.exe" "D:\VulkanTutorial\Content\VertexShaderInstanced.vert" -o "D:\VulkanTutorial\Content\VertexShaderInstanced.vert.spv"
+"C:\VulkanSDK\1.4.321.1\Bin\glslc.exe" "D:\VulkanTutorial\Content\CullObjects.comp" -o "D:\VulkanTutorial\Content\CullObjects.comp.spv"
+"C:\VulkanSDK\1.4.321.1\Bin\glslc.exe" "D:\VulkanTutorial\Content\CullClusters.comp" -o "D:\VulkanTutorial\Content\CullClusters.comp.spv"
\ No newline at end of file
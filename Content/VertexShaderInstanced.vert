@@ -0,0 +1,71 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+// Compact vertex formats store the normal octahedral encoded in xy, see VertexQuantizer::EncodeOctahedral
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+// Per instance, matches Mesh::InstanceData
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo 
+{
+    mat4 projectionViewMatrix;
+    vec3 directionToLight;
+    // Read instead of the specialization constants by the UNIFORM_LIGHTING variant
+    uint lightingModel;
+    float ambient;
+} ubo;
+
+// Specialization constants, see BasicRenderSystem::ShaderVariant. Branches on them are resolved when the pipeline is
+// created.
+const uint LIGHTING_UNLIT = 0;
+const uint LIGHTING_LAMBERT = 1;
+const uint LIGHTING_HALF_LAMBERT = 2;
+
+layout(constant_id = 0) const uint LIGHTING_MODEL = 1;
+layout(constant_id = 1) const float AMBIENT = 0.02;
+layout(constant_id = 2) const bool OCTAHEDRAL_NORMALS = false;
+layout(constant_id = 3) const bool UNIFORM_LIGHTING = false;
+
+vec3 DecodeNormal(vec2 encoded)
+{
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+float LightIntensity(vec3 normalWorldSpace)
+{
+    uint lightingModel = UNIFORM_LIGHTING ? ubo.lightingModel : LIGHTING_MODEL;
+    float ambient = UNIFORM_LIGHTING ? ubo.ambient : AMBIENT;
+
+    float nDotL = dot(normalWorldSpace, ubo.directionToLight);
+
+    if (lightingModel == LIGHTING_UNLIT)
+        return 1.0;
+
+    if (lightingModel == LIGHTING_HALF_LAMBERT)
+    {
+        float wrapped = nDotL * 0.5 + 0.5;
+        return ambient + wrapped * wrapped;
+    }
+
+    return ambient + max(nDotL, 0.0);
+}
+
+void main()
+{
+    vec3 objectNormal = OCTAHEDRAL_NORMALS ? DecodeNormal(normal.xy) : normal;
+
+    gl_Position = ubo.projectionViewMatrix * instanceModelMatrix * vec4(position.xyz, 1.0);
+
+    vec3 normalWorldSpace = normalize(mat3(instanceNormalMatrix) * objectNormal);
+
+    fragColor = LightIntensity(normalWorldSpace) * color;
+}
\ No newline at end of file
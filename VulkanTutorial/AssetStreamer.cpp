@@ -0,0 +1,278 @@
+#include "AssetStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <limits>
+
+namespace VulkanTutorial
+{
+	AssetStreamer::AssetStreamer(EngineDevice& Device, std::shared_ptr<Mesh> Placeholder, VkDeviceSize ResidencyBudget, uint32_t IoThreadCount, VkDeviceSize UploadBytesPerUpdate)
+		: m_Device(Device)
+		, m_Placeholder(std::move(Placeholder))
+		, m_ResidencyBudget(ResidencyBudget)
+		, m_UploadBytesPerUpdate(UploadBytesPerUpdate)
+		, m_IoThreads(std::max(IoThreadCount, 1u))
+	{
+
+	}
+
+	AssetStreamer::~AssetStreamer()
+	{
+		// Loads in progress finish, queued ones find nothing left to read
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Pending.clear();
+	}
+
+	AssetStreamer::AssetId AssetStreamer::RegisterMesh(const std::string& FilePath)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		Asset NewAsset;
+		NewAsset.FilePath = FilePath;
+		m_Assets.push_back(std::move(NewAsset));
+
+		return (AssetId)m_Assets.size() - 1;
+	}
+
+	void AssetStreamer::AddInstance(AssetId Id, const glm::vec4& Sphere)
+	{
+		m_Assets[Id].Instances.push_back(Sphere);
+	}
+
+	const std::shared_ptr<Mesh>& AssetStreamer::GetMesh(AssetId Id) const
+	{
+		const Asset& Entry = m_Assets[Id];
+		return Entry.State == AssetState::Resident ? Entry.ResidentMesh : m_Placeholder;
+	}
+
+	void AssetStreamer::Update(const glm::vec3& CameraPosition, float StreamRadius)
+	{
+		m_UpdateIndex++;
+		m_ChangedAssets.clear();
+
+		uint32_t NewRequestCount = 0;
+
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+
+			for (Asset& Entry : m_Assets)
+			{
+				// Distance to the nearest point of the nearest instance
+				Entry.Distance = std::numeric_limits<float>::max();
+				for (const glm::vec4& Sphere : Entry.Instances)
+					Entry.Distance = std::min(Entry.Distance, std::max(glm::length(glm::vec3(Sphere) - CameraPosition) - Sphere.w, 0.0f));
+
+				const bool Needed = Entry.Distance <= StreamRadius;
+				if (Needed)
+					Entry.LastNeededUpdate = m_UpdateIndex;
+
+				if (Needed && Entry.State == AssetState::Unloaded)
+				{
+					Entry.State = AssetState::Queued;
+					m_Pending.push_back((AssetId)(&Entry - m_Assets.data()));
+					NewRequestCount++;
+				}
+				else if (!Needed && Entry.State == AssetState::Queued && !Entry.Loading)
+				{
+					Entry.State = AssetState::Unloaded;
+				}
+			}
+
+			// The camera moved, so the order did too
+			m_Pending.erase(std::remove_if(m_Pending.begin(), m_Pending.end(), [this](AssetId Id) { return m_Assets[Id].State != AssetState::Queued; }), m_Pending.end());
+			std::sort(m_Pending.begin(), m_Pending.end(), [this](AssetId A, AssetId B) { return m_Assets[A].Distance > m_Assets[B].Distance; });
+
+			for (DecodedMesh& Completed : m_Completed)
+			{
+				m_Assets[Completed.Asset].State = AssetState::Decoded;
+				m_Assets[Completed.Asset].Loading = false;
+				m_Decoded.push_back(std::move(Completed));
+			}
+
+			m_Completed.clear();
+		}
+
+		// Every task reads whichever asset is closest when it starts, so tasks never wait behind distant requests
+		for (uint32_t i = 0; i < NewRequestCount; i++)
+			m_IoThreads.Submit([this]() { LoadNext(); });
+
+		std::sort(m_Decoded.begin(), m_Decoded.end(), [this](const DecodedMesh& A, const DecodedMesh& B) { return m_Assets[A.Asset].Distance < m_Assets[B.Asset].Distance; });
+
+		const GeometryPool& Pool = m_Device.GetGeometryPool();
+		VkDeviceSize UploadedBytes = 0;
+		size_t KeptCount = 0;
+
+		for (size_t i = 0; i < m_Decoded.size(); i++)
+		{
+			DecodedMesh& Decoded = m_Decoded[i];
+			Asset& Entry = m_Assets[Decoded.Asset];
+
+			if (!Decoded.Error.empty())
+			{
+				std::cout << "Failed to stream " << Entry.FilePath << " : " << Decoded.Error << std::endl;
+				Entry.State = AssetState::Failed;
+				m_Totals.FailureCount++;
+				continue;
+			}
+
+			// Moved out of range while it was read, it is requested again when needed
+			if (Entry.LastNeededUpdate != m_UpdateIndex)
+			{
+				Entry.State = AssetState::Unloaded;
+				continue;
+			}
+
+			const uint32_t VertexCount = Decoded.Cache ? Decoded.Cache->GetVertexCount() : (uint32_t)Decoded.Builder->Vertices.size();
+			const uint32_t IndexCount = Decoded.Cache ? Decoded.Cache->GetIndexCount() : (uint32_t)Decoded.Builder->Indices.size();
+			const VkDeviceSize Bytes = Mesh::EstimateGeometryBytes(Pool, VertexCount, IndexCount);
+
+			// At least one mesh per Update so a mesh above the upload budget still streams
+			const bool WithinUploadBudget = UploadedBytes == 0 || UploadedBytes + Bytes <= m_UploadBytesPerUpdate;
+			if (!WithinUploadBudget || !MakeRoom(Bytes))
+			{
+				m_Decoded[KeptCount++] = std::move(Decoded);
+				continue;
+			}
+
+			Entry.ResidentMesh = Decoded.Cache ? std::make_shared<Mesh>(m_Device, *Decoded.Cache) : std::make_shared<Mesh>(m_Device, *Decoded.Builder);
+			Entry.Bytes = Bytes;
+			Entry.State = AssetState::Uploading;
+
+			m_ResidentBytes += Bytes;
+			UploadedBytes += Bytes;
+			m_Totals.LoadCount++;
+			m_Totals.UploadedBytes += Bytes;
+		}
+
+		m_Decoded.resize(KeptCount);
+
+		for (AssetId Id = 0; Id < (AssetId)m_Assets.size(); Id++)
+		{
+			Asset& Entry = m_Assets[Id];
+			if (Entry.State == AssetState::Uploading && Entry.ResidentMesh->IsReady())
+			{
+				Entry.State = AssetState::Resident;
+				m_ChangedAssets.push_back(Id);
+			}
+		}
+	}
+
+	bool AssetStreamer::MakeRoom(VkDeviceSize Bytes)
+	{
+		if (Bytes > m_ResidencyBudget)
+			return false;
+
+		if (m_ResidentBytes + Bytes <= m_ResidencyBudget)
+			return true;
+
+		// Meshes still uploading are needed, they were requested recently
+		std::vector<AssetId> Candidates;
+		for (AssetId Id = 0; Id < (AssetId)m_Assets.size(); Id++)
+		{
+			const Asset& Entry = m_Assets[Id];
+			if (Entry.State == AssetState::Resident && Entry.LastNeededUpdate != m_UpdateIndex)
+				Candidates.push_back(Id);
+		}
+
+		std::sort(Candidates.begin(), Candidates.end(), [this](AssetId A, AssetId B) { return m_Assets[A].LastNeededUpdate < m_Assets[B].LastNeededUpdate; });
+
+		VkDeviceSize FreeableBytes = m_ResidencyBudget - m_ResidentBytes;
+		size_t EvictCount = 0;
+		while (FreeableBytes < Bytes && EvictCount < Candidates.size())
+			FreeableBytes += m_Assets[Candidates[EvictCount++]].Bytes;
+
+		// Evicting without making enough room would only throw away meshes
+		if (FreeableBytes < Bytes)
+			return false;
+
+		for (size_t i = 0; i < EvictCount; i++)
+			Evict(Candidates[i]);
+
+		return true;
+	}
+
+	void AssetStreamer::Evict(AssetId Id)
+	{
+		Asset& Entry = m_Assets[Id];
+
+		// Objects still hold the mesh until they pick up the change, its geometry is freed once no frame draws it
+		Entry.ResidentMesh.reset();
+		Entry.State = AssetState::Unloaded;
+
+		m_ResidentBytes -= Entry.Bytes;
+		Entry.Bytes = 0;
+
+		m_Totals.EvictionCount++;
+		m_ChangedAssets.push_back(Id);
+	}
+
+	void AssetStreamer::LoadNext()
+	{
+		AssetId Id;
+		std::string FilePath;
+
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			if (m_Pending.empty())
+				return;
+
+			Id = m_Pending.back();
+			m_Pending.pop_back();
+
+			m_Assets[Id].Loading = true;
+			FilePath = m_Assets[Id].FilePath;
+		}
+
+		DecodedMesh Decoded = Decode(Id, FilePath);
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Completed.push_back(std::move(Decoded));
+	}
+
+	AssetStreamer::DecodedMesh AssetStreamer::Decode(AssetId Id, const std::string& FilePath)
+	{
+		DecodedMesh Decoded;
+		Decoded.Asset = Id;
+
+		try
+		{
+			Decoded.Cache = MeshCache::Open(FilePath);
+			if (Decoded.Cache)
+				return Decoded;
+
+			Decoded.Builder = std::make_unique<Mesh::Builder>();
+			Decoded.Builder->LoadOptimizedModel(FilePath);
+
+			if (Decoded.Builder->Vertices.size() < 3)
+				throw std::runtime_error("no triangles");
+
+			MeshCache::Write(FilePath, *Decoded.Builder);
+		}
+		catch (const std::exception& e)
+		{
+			Decoded.Cache.reset();
+			Decoded.Builder.reset();
+			Decoded.Error = e.what();
+		}
+
+		return Decoded;
+	}
+
+	AssetStreamer::Stats AssetStreamer::GetStats() const
+	{
+		Stats Result = m_Totals;
+		Result.AssetCount = (uint32_t)m_Assets.size();
+		Result.ResidentBytes = m_ResidentBytes;
+		Result.DecodedCount = (uint32_t)m_Decoded.size();
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		for (const Asset& Entry : m_Assets)
+		{
+			Result.ResidentCount += Entry.State == AssetState::Resident || Entry.State == AssetState::Uploading ? 1 : 0;
+			Result.QueuedCount += Entry.State == AssetState::Queued ? 1 : 0;
+		}
+
+		return Result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#ifndef __AssetStreamer_h__
+#define __AssetStreamer_h__
+
+#include "EngineDevice.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Loads meshes in the background as the camera approaches them. I/O threads read and decode the closest requested
+	// assets first, the submitting thread turns decoded meshes into GPU meshes within an upload budget per Update so
+	// frames do not spike. Resident meshes are evicted least recently needed first to stay within a byte budget.
+	// Until an asset is resident GetMesh returns the placeholder.
+	class AssetStreamer
+	{
+	public:
+
+		using AssetId = uint32_t;
+
+		static constexpr uint32_t DEFAULT_IO_THREAD_COUNT = 2;
+		static constexpr VkDeviceSize DEFAULT_UPLOAD_BYTES_PER_UPDATE = 4 * 1024 * 1024;
+
+		struct Stats
+		{
+			uint32_t AssetCount = 0;
+			uint32_t ResidentCount = 0;
+			// Waiting for or being read by an I/O thread
+			uint32_t QueuedCount = 0;
+			// Decoded and waiting for upload budget or residency budget
+			uint32_t DecodedCount = 0;
+			VkDeviceSize ResidentBytes = 0;
+
+			// Totals since creation
+			uint32_t LoadCount = 0;
+			uint32_t EvictionCount = 0;
+			uint32_t FailureCount = 0;
+			VkDeviceSize UploadedBytes = 0;
+		};
+
+		// ResidencyBudget bounds the geometry bytes of all resident meshes. A single asset larger than the budget is
+		// never loaded.
+		AssetStreamer(EngineDevice& Device, std::shared_ptr<Mesh> Placeholder, VkDeviceSize ResidencyBudget
+			, uint32_t IoThreadCount = DEFAULT_IO_THREAD_COUNT, VkDeviceSize UploadBytesPerUpdate = DEFAULT_UPLOAD_BYTES_PER_UPDATE);
+		virtual ~AssetStreamer();
+
+		AssetStreamer(const AssetStreamer&) = delete;
+		AssetStreamer& operator = (const AssetStreamer&) = delete;
+
+		AssetStreamer(AssetStreamer&&) = delete;
+		AssetStreamer& operator = (AssetStreamer&&) = delete;
+
+		// Nothing is read until an Update finds an instance of the asset within the stream radius
+		AssetId RegisterMesh(const std::string& FilePath);
+
+		// World space bounding sphere of one object drawing the asset, center in xyz and radius in w
+		void AddInstance(AssetId Asset, const glm::vec4& Sphere);
+
+		// Requests assets with an instance within StreamRadius of the camera, closest first, and drops requests that
+		// moved out of it. Uploads decoded meshes, evicts when over budget and publishes meshes whose upload has
+		// completed. Call once per frame on the thread that submits frames.
+		void Update(const glm::vec3& CameraPosition, float StreamRadius);
+
+		// The resident mesh or the placeholder
+		const std::shared_ptr<Mesh>& GetMesh(AssetId Asset) const;
+		bool IsResident(AssetId Asset) const { return m_Assets[Asset].State == AssetState::Resident; }
+
+		// Assets whose GetMesh changed during the last Update, objects drawing them have to be updated
+		const std::vector<AssetId>& GetChangedAssets() const { return m_ChangedAssets; }
+
+		Stats GetStats() const;
+
+	private:
+
+		// Only the submitting thread changes the state, so Update, GetMesh and IsResident read it without m_Mutex
+		enum class AssetState
+		{
+			Unloaded,
+			// Requested, waiting in m_Pending or read by an I/O thread
+			Queued,
+			// In m_Decoded
+			Decoded,
+			// GPU mesh created, its upload is in flight
+			Uploading,
+			Resident,
+			// Decoding threw, the asset keeps its placeholder
+			Failed,
+		};
+
+		struct Asset
+		{
+			std::string FilePath;
+			std::vector<glm::vec4> Instances;
+			AssetState State = AssetState::Unloaded;
+			// Taken from m_Pending by an I/O thread and not yet moved to m_Decoded, guarded by m_Mutex
+			bool Loading = false;
+			// Distance from the camera to the nearest instance at the last Update
+			float Distance = 0.0f;
+			// Last Update that found the asset within the stream radius
+			uint64_t LastNeededUpdate = 0;
+			std::shared_ptr<Mesh> ResidentMesh;
+			VkDeviceSize Bytes = 0;
+		};
+
+		// Output of an I/O thread, either a mapped cache or a freshly built mesh
+		struct DecodedMesh
+		{
+			AssetId Asset = 0;
+			std::unique_ptr<MeshCache> Cache;
+			std::unique_ptr<Mesh::Builder> Builder;
+			std::string Error;
+		};
+
+		// Runs on an I/O thread, reads the closest queued asset if any is left
+		void LoadNext();
+		static DecodedMesh Decode(AssetId Asset, const std::string& FilePath);
+
+		// Evicts resident assets not needed by this Update, least recently needed first, until Bytes more fit the
+		// budget. Returns false when they can not.
+		bool MakeRoom(VkDeviceSize Bytes);
+		void Evict(AssetId Id);
+
+		EngineDevice& m_Device;
+		std::shared_ptr<Mesh> m_Placeholder;
+		VkDeviceSize m_ResidencyBudget;
+		VkDeviceSize m_UploadBytesPerUpdate;
+
+		std::vector<Asset> m_Assets;
+		uint64_t m_UpdateIndex = 0;
+		VkDeviceSize m_ResidentBytes = 0;
+		std::vector<AssetId> m_ChangedAssets;
+		std::vector<DecodedMesh> m_Decoded;
+		Stats m_Totals;
+
+		// Guards the Loading flags, m_Pending, m_Completed and FilePath of new assets
+		mutable std::mutex m_Mutex;
+		// Sorted farthest first, I/O threads take from the back
+		std::vector<AssetId> m_Pending;
+		std::vector<DecodedMesh> m_Completed;
+
+		// Declared last so its threads are joined before anything they use is destroyed
+		ThreadPool m_IoThreads;
+	};
+}
+
+#endif //__AssetStreamer_h__
\ No newline at end of file
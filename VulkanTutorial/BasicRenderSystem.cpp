@@ -1,7 +1,18 @@
 #include "BasicRenderSystem.h"
 
+#include "PipelineLibrary.h"
+#include "ThreadPool.h"
+#include "EngineSwapChain.h"
+
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <numeric>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -14,8 +25,45 @@ namespace VulkanTutorial
 		glm::mat4 normalMatrix = glm::mat2(1.0f);
 	};
 
+	// The copy is recorded by the upload manager's next Flush, the buffer may not be used before it completed
+	static std::unique_ptr<Buffer> CreateDeviceLocalBuffer(EngineDevice& Device, const void* Data, VkDeviceSize InstanceSize, uint32_t InstanceCount, VkBufferUsageFlags Usage)
+	{
+		auto DeviceBuffer = std::make_unique<Buffer>(Device, InstanceSize, InstanceCount
+			, Usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		Device.GetUploadManager().UploadToBuffer(DeviceBuffer->GetBuffer(), Data, InstanceSize * InstanceCount);
+
+		return DeviceBuffer;
+	}
+
+	// Renderer::BeginFrame waits for a frame slot before reusing it, after this many PrepareFrame calls every frame that
+	// could have used a replaced pipeline has completed
+	static constexpr uint64_t PIPELINE_RELEASE_DELAY_FRAMES = EngineSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+
+	// Null when the compilation failed, which is reported and leaves the previous pipeline in use
+	static std::shared_ptr<RenderPipeline> GetCompiledPipeline(const PipelineHandle& Handle)
+	{
+		try
+		{
+			return Handle.Get();
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "Pipeline compilation failed : " << e.what() << std::endl;
+			return nullptr;
+		}
+	}
+
+	// Positions of meshes in a compact vertex format are relative to their bounds
+	static glm::mat4 GetDrawModelMatrix(const TransformComponent& Transform, const Mesh& DrawMesh)
+	{
+		return DrawMesh.IsQuantized() ? Transform.Mat4() * DrawMesh.GetDequantizeMatrix() : Transform.Mat4();
+	}
+
 	BasicRenderSystem::BasicRenderSystem(EngineDevice& Device, VkRenderPass RenderPass, VkDescriptorSetLayout GlobalSetLayout)
 		: m_EngineDevice(Device)
+		, m_RenderPass(RenderPass)
 	{
 		CreatePipelineLayout(GlobalSetLayout);
 		CreatePipeline(RenderPass);
@@ -23,7 +71,16 @@ namespace VulkanTutorial
 
 	BasicRenderSystem::~BasicRenderSystem()
 	{
-		vkDestroyPipelineLayout(m_EngineDevice.Device(), m_PipelineLayout, nullptr);
+		for (auto& Recorders : m_SecondaryRecorders)
+		{
+			// Destroying a pool frees its command buffers
+			for (SecondaryRecorder& Recorder : Recorders)
+				vkDestroyCommandPool(m_EngineDevice.Device(), Recorder.CommandPool, nullptr);
+		}
+
+		// The upload manager still copies into the rebuilt scene's buffers
+		if (m_IndirectSceneUploading)
+			m_EngineDevice.GetUploadManager().Wait(m_IndirectScenes[1 - m_DrawnScene].UploadTicket);
 	}
 
 	void BasicRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout GlobalSetLayout)
@@ -35,57 +92,1049 @@ namespace VulkanTutorial
 
 		std::vector<VkDescriptorSetLayout> DescriptorSetLayouts{ GlobalSetLayout };
 
-		VkPipelineLayoutCreateInfo PipelineLayoutInfo;
-		PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		PipelineLayoutInfo.setLayoutCount = (uint32_t)DescriptorSetLayouts.size();
-		PipelineLayoutInfo.pSetLayouts = DescriptorSetLayouts.data();
-		PipelineLayoutInfo.pushConstantRangeCount = 1;
-		PipelineLayoutInfo.pPushConstantRanges = &PushConstantRange;
-		PipelineLayoutInfo.pNext = nullptr;
-		PipelineLayoutInfo.flags = 0;
-		if (vkCreatePipelineLayout(m_EngineDevice.Device(), &PipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create pipeline layout!");
+		// Shared with every render system on the same global set layout, so they share pipelines too
+		m_PipelineLayout = m_EngineDevice.GetPipelineLibrary().GetPipelineLayout(DescriptorSetLayouts, { PushConstantRange });
+	}
+
+	void BasicRenderSystem::GetPipelineSlotConfig(uint32_t Slot, PipelineConfigInfo& PipelineConfig, std::string& VertProgram, std::string& FragProgram) const
+	{
+		const bool Instanced = Slot == INSTANCED_PIPELINE_SLOT || Slot == CLUSTER_PIPELINE_SLOT;
+
+		RenderPipeline::DefaultPipelineConfigInfo(PipelineConfig);
+		PipelineConfig.RenderPass = m_RenderPass;
+		PipelineConfig.PipelineLayout = m_PipelineLayout;
+
+		// Every mesh lives in the geometry pool, so its vertex format decides the input layout and shader variant
+		const VertexFormat Format = m_EngineDevice.GetGeometryPool().GetVertexFormat();
+		PipelineConfig.BindingDescriptions = Mesh::Vertex::GetBindingDescriptions(Instanced, Format);
+		PipelineConfig.AttributeDescriptions = Mesh::Vertex::GetAttributeDescriptions(Instanced, Format);
+
+		VertProgram = Instanced ? "./../../Content/VertexShaderInstanced.vert.spv" : "./../../Content/VertexShader.vert.spv";
+		FragProgram = "./../../Content/PixelShader.frag.spv";
+
+		// The uniform variant ignores the lighting constants, leaving them out keeps its pipelines when they change
+		if (!m_ShaderVariant.UniformLighting)
+		{
+			PipelineConfig.SetSpecializationConstant(LIGHTING_MODEL_CONSTANT, (uint32_t)m_ShaderVariant.Lighting);
+			PipelineConfig.SetSpecializationConstant(AMBIENT_CONSTANT, m_ShaderVariant.Ambient);
+		}
+		PipelineConfig.SetSpecializationConstant(OCTAHEDRAL_NORMALS_CONSTANT, (VkBool32)(VertexQuantizer::HasOctahedralNormals(Format) ? VK_TRUE : VK_FALSE));
+		PipelineConfig.SetSpecializationConstant(UNIFORM_LIGHTING_CONSTANT, (VkBool32)(m_ShaderVariant.UniformLighting ? VK_TRUE : VK_FALSE));
+
+		if (Slot == CLUSTER_PIPELINE_SLOT)
+		{
+			// Meshes wind counter clockwise around their outward normals, which stays counter clockwise in framebuffer
+			// space with the y down projection. Cluster culling already dropped most back faces, the rest go here.
+			PipelineConfig.RasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+			PipelineConfig.RasterizationInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		}
+		else if (Slot >= FIRST_MATERIAL_PIPELINE_SLOT)
+		{
+			const MaterialState& State = m_Materials[Slot - FIRST_MATERIAL_PIPELINE_SLOT].State;
+			PipelineConfig.RasterizationInfo.cullMode = State.CullMode;
+			PipelineConfig.RasterizationInfo.frontFace = State.FrontFace;
+			PipelineConfig.RasterizationInfo.depthBiasEnable = State.DepthBias != 0.0f ? VK_TRUE : VK_FALSE;
+			PipelineConfig.RasterizationInfo.depthBiasConstantFactor = State.DepthBias;
+		}
+	}
+
+	std::shared_ptr<RenderPipeline>& BasicRenderSystem::GetPipelineSlot(uint32_t Slot)
+	{
+		switch (Slot)
+		{
+		case PER_OBJECT_PIPELINE_SLOT: return m_RenderPipeline;
+		case INSTANCED_PIPELINE_SLOT: return m_InstancedRenderPipeline;
+		case CLUSTER_PIPELINE_SLOT: return m_ClusterRenderPipeline;
+		}
+
+		return m_Materials[Slot - FIRST_MATERIAL_PIPELINE_SLOT].Pipeline;
 	}
 
 	void BasicRenderSystem::CreatePipeline(VkRenderPass RenderPass)
 	{
 		assert(m_PipelineLayout != nullptr && "Can not create pipeline before pipeline layout");
+		assert(RenderPass == m_RenderPass);
 
 		PipelineConfigInfo PipelineConfig;
-		RenderPipeline::DefaultPipelineConfigInfo(PipelineConfig);
-		PipelineConfig.RenderPass = RenderPass;
-		PipelineConfig.PipelineLayout = m_PipelineLayout;
+		std::string VertProgram;
+		std::string FragProgram;
+
+		// Identical configurations come back from the library instead of being compiled again
+		for (uint32_t Slot = 0; Slot < FIRST_MATERIAL_PIPELINE_SLOT; Slot++)
+		{
+			GetPipelineSlotConfig(Slot, PipelineConfig, VertProgram, FragProgram);
+			GetPipelineSlot(Slot) = m_EngineDevice.GetPipelineLibrary().GetPipeline(PipelineConfig, VertProgram, FragProgram);
+		}
+	}
+
+	uint32_t BasicRenderSystem::AddMaterial(const MaterialState& State, bool Synchronous)
+	{
+		Material NewMaterial;
+		NewMaterial.State = State;
+		m_Materials.push_back(std::move(NewMaterial));
+
+		PipelineConfigInfo PipelineConfig;
+		std::string VertProgram;
+		std::string FragProgram;
+		GetPipelineSlotConfig(FIRST_MATERIAL_PIPELINE_SLOT + (uint32_t)m_Materials.size() - 1, PipelineConfig, VertProgram, FragProgram);
+
+		PipelineLibrary& Library = m_EngineDevice.GetPipelineLibrary();
+		Material& Entry = m_Materials.back();
+
+		if (Synchronous)
+		{
+			Entry.Pipeline = Library.GetPipeline(PipelineConfig, VertProgram, FragProgram);
+		}
+		else
+		{
+			Entry.PendingPipeline = Library.RequestPipeline(PipelineConfig, VertProgram, FragProgram);
+			m_PendingMaterialCount++;
+		}
+
+		return (uint32_t)m_Materials.size();
+	}
+
+	uint32_t BasicRenderSystem::ReloadShaders(const std::vector<std::string>& ChangedFiles)
+	{
+		auto IsChanged = [&ChangedFiles](const std::string& Program)
+		{
+			const std::filesystem::path FileName = std::filesystem::path(Program).filename();
+			return std::any_of(ChangedFiles.begin(), ChangedFiles.end(), [&FileName](const std::string& File) { return std::filesystem::path(File).filename() == FileName; });
+		};
+
+		PipelineConfigInfo PipelineConfig;
+		std::string VertProgram;
+		std::string FragProgram;
+
+		uint32_t ReloadCount = 0;
+		const uint32_t SlotCount = FIRST_MATERIAL_PIPELINE_SLOT + (uint32_t)m_Materials.size();
+		for (uint32_t Slot = 0; Slot < SlotCount; Slot++)
+		{
+			GetPipelineSlotConfig(Slot, PipelineConfig, VertProgram, FragProgram);
+			if (!IsChanged(VertProgram) && !IsChanged(FragProgram))
+				continue;
+
+			// Shader modules are keyed by content, so the new SPIR-V always makes a new pipeline
+			RebuildPipeline(Slot, false);
+			ReloadCount++;
+		}
 
-		// If render pass compatible do nothing else
-		m_RenderPipeline = std::make_unique<RenderPipeline>(m_EngineDevice, PipelineConfig, "./../../Content/VertexShader.vert.spv", "./../../Content/PixelShader.frag.spv");
+		return ReloadCount;
+	}
+
+	void BasicRenderSystem::SetShaderVariant(const ShaderVariant& Variant, bool Synchronous)
+	{
+		const bool Specialized = !Variant.UniformLighting;
+		const bool PipelinesChange = Variant.UniformLighting != m_ShaderVariant.UniformLighting
+			|| (Specialized && (Variant.Lighting != m_ShaderVariant.Lighting || Variant.Ambient != m_ShaderVariant.Ambient));
+
+		m_ShaderVariant = Variant;
+		if (!PipelinesChange)
+			return;
+
+		// Variants seen before come back from the library while any render system still holds them
+		const uint32_t SlotCount = FIRST_MATERIAL_PIPELINE_SLOT + (uint32_t)m_Materials.size();
+		for (uint32_t Slot = 0; Slot < SlotCount; Slot++)
+			RebuildPipeline(Slot, Synchronous);
+	}
+
+	void BasicRenderSystem::RebuildPipeline(uint32_t Slot, bool Synchronous)
+	{
+		PipelineConfigInfo PipelineConfig;
+		std::string VertProgram;
+		std::string FragProgram;
+		GetPipelineSlotConfig(Slot, PipelineConfig, VertProgram, FragProgram);
+
+		PipelineLibrary& Library = m_EngineDevice.GetPipelineLibrary();
+		Material* SlotMaterial = Slot >= FIRST_MATERIAL_PIPELINE_SLOT ? &m_Materials[Slot - FIRST_MATERIAL_PIPELINE_SLOT] : nullptr;
+
+		// A newer build of the slot supersedes one still compiling
+		m_PendingReloads.erase(std::remove_if(m_PendingReloads.begin(), m_PendingReloads.end(), [Slot](const PendingReload& Reload) { return Reload.Slot == Slot; })
+			, m_PendingReloads.end());
+
+		if (Synchronous)
+		{
+			std::shared_ptr<RenderPipeline> Pipeline = Library.GetPipeline(PipelineConfig, VertProgram, FragProgram);
+
+			if (SlotMaterial && SlotMaterial->PendingPipeline.IsValid())
+			{
+				SlotMaterial->PendingPipeline = PipelineHandle();
+				m_PendingMaterialCount--;
+			}
+
+			// Frames in flight may still use the replaced pipeline
+			std::shared_ptr<RenderPipeline>& Target = GetPipelineSlot(Slot);
+			if (Target)
+				m_RetiredPipelines.push_back({ std::move(Target), m_PreparedFrameCount + PIPELINE_RELEASE_DELAY_FRAMES });
+			Target = std::move(Pipeline);
+			return;
+		}
+
+		PipelineHandle Pipeline = Library.RequestPipeline(PipelineConfig, VertProgram, FragProgram);
+
+		// A material still compiling could otherwise finish after its rebuild and overwrite it
+		if (SlotMaterial && SlotMaterial->PendingPipeline.IsValid())
+			SlotMaterial->PendingPipeline = std::move(Pipeline);
+		else
+			m_PendingReloads.push_back({ Slot, std::move(Pipeline) });
+	}
+
+	void BasicRenderSystem::UpdatePipelines()
+	{
+		m_PreparedFrameCount++;
+
+		m_RetiredPipelines.erase(std::remove_if(m_RetiredPipelines.begin(), m_RetiredPipelines.end(), [this](const RetiredPipeline& Retired)
+		{
+			return Retired.ReleaseFrame <= m_PreparedFrameCount;
+		}), m_RetiredPipelines.end());
+
+		for (auto It = m_PendingReloads.begin(); It != m_PendingReloads.end();)
+		{
+			if (!It->Pipeline.IsReady())
+			{
+				++It;
+				continue;
+			}
+
+			// Frames recorded with the replaced pipeline may still be executing
+			if (std::shared_ptr<RenderPipeline> Pipeline = GetCompiledPipeline(It->Pipeline))
+			{
+				std::shared_ptr<RenderPipeline>& Target = GetPipelineSlot(It->Slot);
+				m_RetiredPipelines.push_back({ std::move(Target), m_PreparedFrameCount + PIPELINE_RELEASE_DELAY_FRAMES });
+				Target = std::move(Pipeline);
+			}
+
+			It = m_PendingReloads.erase(It);
+		}
+
+		if (m_PendingMaterialCount == 0)
+			return;
+
+		for (Material& Entry : m_Materials)
+		{
+			if (!Entry.PendingPipeline.IsReady())
+				continue;
+
+			Entry.Pipeline = GetCompiledPipeline(Entry.PendingPipeline);
+			Entry.PendingPipeline = PipelineHandle();
+			m_PendingMaterialCount--;
+		}
+	}
+
+	RenderPipeline& BasicRenderSystem::GetMaterialPipeline(uint32_t MaterialIndex) const
+	{
+		if (MaterialIndex == 0 || MaterialIndex > m_Materials.size() || !m_Materials[MaterialIndex - 1].Pipeline)
+			return *m_RenderPipeline;
+
+		return *m_Materials[MaterialIndex - 1].Pipeline;
+	}
+
+	Buffer& BasicRenderSystem::GetInstanceBuffer(int FrameIndex, uint32_t InstanceCount)
+	{
+		if (FrameIndex >= (int)m_InstanceBuffers.size())
+			m_InstanceBuffers.resize(FrameIndex + 1);
+
+		std::unique_ptr<Buffer>& InstanceBuffer = m_InstanceBuffers[FrameIndex];
+		if (!InstanceBuffer || InstanceBuffer->GetInstanceCount() < InstanceCount)
+		{
+			// Grow geometrically so a slowly growing scene does not reallocate every frame
+			uint32_t Capacity = 1024;
+			while (Capacity < InstanceCount)
+				Capacity *= 2;
+
+			InstanceBuffer = std::make_unique<Buffer>(m_EngineDevice, sizeof(Mesh::InstanceData), Capacity
+				, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+				, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+			InstanceBuffer->Map();
+		}
+
+		return *InstanceBuffer;
+	}
+
+	void BasicRenderSystem::SetRenderMode(RenderMode Mode)
+	{
+		// Per object commands address their instance through firstInstance
+		if (Mode == RenderMode::Indirect && !m_EngineDevice.EnabledFeatures().drawIndirectFirstInstance)
+		{
+			std::cout << "Indirect rendering needs drawIndirectFirstInstance, using instanced rendering" << std::endl;
+			Mode = RenderMode::Instanced;
+		}
+
+		m_RenderMode = Mode;
+	}
+
+	void BasicRenderSystem::SetRecordThreadCount(uint32_t Count)
+	{
+		m_RecordThreadCount = std::clamp<uint32_t>(Count, 1, GetMaxRecordThreadCount());
+	}
+
+	uint32_t BasicRenderSystem::GetMaxRecordThreadCount()
+	{
+		// ParallelFor also runs ranges on the calling thread
+		return ThreadPool::Shared().GetThreadCount() + 1;
+	}
+
+	VkSubpassContents BasicRenderSystem::GetSubpassContents() const
+	{
+		return m_RenderMode == RenderMode::PerObject && m_RecordThreadCount > 1 ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+	}
+
+	const char* BasicRenderSystem::GetRenderModeName(RenderMode Mode)
+	{
+		switch (Mode)
+		{
+		case RenderMode::PerObject: return "Per object";
+		case RenderMode::Instanced: return "Instanced";
+		case RenderMode::Indirect: return "Indirect";
+		}
+
+		return "Unknown";
+	}
+
+	const char* BasicRenderSystem::GetLightingModelName(LightingModel Model)
+	{
+		switch (Model)
+		{
+		case LightingModel::Unlit: return "Unlit";
+		case LightingModel::Lambert: return "Lambert";
+		case LightingModel::HalfLambert: return "Half Lambert";
+		}
+
+		return "Unknown";
+	}
+
+	void BasicRenderSystem::PrepareFrame(FrameInfo& Info, std::vector<GameObject>& GameObjects)
+	{
+		m_GpuCullingRecorded = false;
+		m_ClusterCullingRecorded = false;
+
+		UpdatePipelines();
+		UpdateIndirectScene(GameObjects);
+
+		if (m_RenderMode != RenderMode::Indirect || !m_GpuCullingEnabled)
+			return;
+
+		// A scene built before the culling was enabled is drawn unculled until its replacement is uploaded
+		IndirectScene& Scene = m_IndirectScenes[m_DrawnScene];
+		const Frustum ViewFrustum = Frustum::FromMatrix(Info.Cam.GetProjectionMatrix() * Info.Cam.GetViewMatrix());
+
+		if (m_ClusterCullingEnabled && Scene.Clusters)
+		{
+			Scene.Clusters->Cull(Info.CommandBuffer, Info.FrameIndex, ViewFrustum, Info.Cam.GetPosition(), Info.Cam.GetForward(), Info.Cam.IsPerspective());
+			m_ClusterCullingRecorded = true;
+			m_GpuCullingRecorded = true;
+		}
+		else if (!m_ClusterCullingEnabled && Scene.Culling)
+		{
+			Scene.Culling->Cull(Info.CommandBuffer, Info.FrameIndex, ViewFrustum, GetLodParameters(Info));
+			m_GpuCullingRecorded = true;
+		}
+	}
+
+	void BasicRenderSystem::UpdateIndirectScene(const std::vector<GameObject>& GameObjects)
+	{
+		UploadManager& Uploads = m_EngineDevice.GetUploadManager();
+		IndirectScene& Spare = m_IndirectScenes[1 - m_DrawnScene];
+
+		if (!m_IndirectSceneUploading && Spare.ReleaseFrame <= m_PreparedFrameCount)
+		{
+			// No frame in flight reads the replaced scene any more, streaming may have evicted its meshes since
+			Spare.InstanceBuffer.reset();
+			Spare.CommandBuffer.reset();
+			Spare.Meshes.clear();
+			Spare.Built = false;
+
+			const IndirectScene& Drawn = m_IndirectScenes[m_DrawnScene];
+			const bool CullerMissing = m_GpuCullingEnabled && (m_ClusterCullingEnabled ? !Drawn.Clusters : !Drawn.Culling);
+			const bool SceneChanged = !m_IndirectSceneValid || m_IndirectSceneObjects != GameObjects.data() || m_IndirectSceneObjectCount != GameObjects.size();
+
+			if (m_RenderMode == RenderMode::Indirect && (SceneChanged || CullerMissing))
+			{
+				BuildIndirectScene(Spare, GameObjects);
+				Spare.UploadTicket = Uploads.Flush();
+				m_IndirectSceneUploading = true;
+
+				// Until the first scene is uploaded there is nothing to draw instead
+				if (!Drawn.Built)
+					Uploads.Wait(Spare.UploadTicket);
+			}
+		}
+
+		// Batches complete in order, so the scene's uploads completing means those of every mesh it draws did too
+		if (m_IndirectSceneUploading && Uploads.IsComplete(Spare.UploadTicket))
+		{
+			m_IndirectScenes[m_DrawnScene].ReleaseFrame = m_PreparedFrameCount + PIPELINE_RELEASE_DELAY_FRAMES;
+			m_DrawnScene = 1 - m_DrawnScene;
+			m_IndirectSceneUploading = false;
+		}
 	}
 
 	void BasicRenderSystem::RenderGameObject(FrameInfo& Info, std::vector<GameObject>& GameObjects)
 	{
-		m_RenderPipeline->Bind(Info.CommandBuffer);
+		auto StartTime = std::chrono::high_resolution_clock::now();
+
+		m_Stats = RenderStats{};
+		m_Stats.ObjectCount = (uint32_t)GameObjects.size();
+
+		// Nothing but vkCmdExecuteCommands may be recorded into the primary inside a secondary render pass
+		const bool RecordSecondary = GetSubpassContents() == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+
+		if (!RecordSecondary)
+		{
+			vkCmdBindDescriptorSets(Info.CommandBuffer
+				, VK_PIPELINE_BIND_POINT_GRAPHICS
+				, m_PipelineLayout
+				, 0, 1
+				, &Info.GlobalDescriptorSet
+				, 0
+				, nullptr);
+		}
+
+		const IndirectScene& DrawnScene = m_IndirectScenes[m_DrawnScene];
+
+		if (m_RenderMode == RenderMode::Indirect)
+		{
+			RenderIndirect(Info, GameObjects);
+			if (m_ClusterCullingRecorded)
+				m_Stats.TriangleCount = DrawnScene.Clusters->GetStats().TriangleCount;
+			else
+				m_Stats.TriangleCount = m_GpuCullingRecorded ? DrawnScene.Culling->GetStats().TriangleCount : DrawnScene.TriangleCount;
+		}
+		else
+		{
+			BuildDrawList(Info, GameObjects);
+			SelectLods(Info, GameObjects);
+
+			if (m_RenderMode == RenderMode::Instanced)
+				RenderInstanced(Info, GameObjects);
+			else if (RecordSecondary)
+				RenderPerObjectSecondary(Info, GameObjects);
+			else
+				RenderPerObject(Info, GameObjects);
+		}
+
+		if (DrawnScene.Culling)
+		{
+			m_Stats.CullTestedCount = DrawnScene.Culling->GetStats().TestedCount;
+			m_Stats.CullVisibleCount = DrawnScene.Culling->GetStats().VisibleCount;
+		}
+
+		if (DrawnScene.Clusters)
+		{
+			m_Stats.ClusterTestedCount = DrawnScene.Clusters->GetStats().TestedCount;
+			m_Stats.ClusterVisibleCount = DrawnScene.Clusters->GetStats().VisibleCount;
+			m_Stats.ClusterBackfacingCount = DrawnScene.Clusters->GetStats().BackfacingCount;
+		}
+
+		auto EndTime = std::chrono::high_resolution_clock::now();
+		m_Stats.RecordTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count();
+	}
+
+	void BasicRenderSystem::BuildDrawList(FrameInfo& Info, const std::vector<GameObject>& GameObjects)
+	{
+		// Objects whose mesh is still uploading are skipped until it is ready
+		if (!m_CpuCullingEnabled)
+		{
+			m_DrawList.clear();
+			for (size_t i = 0; i < GameObjects.size(); i++)
+			{
+				const std::shared_ptr<Mesh>& ObjMesh = GameObjects[i].GetMesh();
+				if (ObjMesh && ObjMesh->IsReady())
+					m_DrawList.push_back((uint32_t)i);
+			}
+
+			m_Stats.CpuVisibleCount = (uint32_t)m_DrawList.size();
+			return;
+		}
+
+		m_DrawList.resize(GameObjects.size());
+
+		m_CullSpheres.Resize(GameObjects.size());
+		for (size_t i = 0; i < GameObjects.size(); i++)
+		{
+			const std::shared_ptr<Mesh>& ObjMesh = GameObjects[i].GetMesh();
+			if (!ObjMesh || !ObjMesh->IsReady())
+			{
+				// Never passes the plane test
+				m_CullSpheres.Set(i, glm::vec3(0.0f), -std::numeric_limits<float>::infinity());
+				continue;
+			}
+
+			const TransformComponent& Transform = GameObjects[i].GetTransform();
+			const Mesh::BoundingSphere& Sphere = ObjMesh->GetBoundingSphere();
+			const glm::vec3 Scale = glm::abs(Transform.Scale);
+
+			m_CullSpheres.Set(i, glm::vec3(Transform.Mat4() * glm::vec4(Sphere.Center, 1.0f)), Sphere.Radius * glm::max(Scale.x, glm::max(Scale.y, Scale.z)));
+		}
+
+		const Frustum ViewFrustum = Frustum::FromMatrix(Info.Cam.GetProjectionMatrix() * Info.Cam.GetViewMatrix());
+		const uint32_t VisibleCount = FrustumCulling::CullSpheres(ViewFrustum, m_CullSpheres, m_DrawList.data());
+
+		m_DrawList.resize(VisibleCount);
+		m_Stats.CpuVisibleCount = VisibleCount;
+	}
+
+	GpuCulling::LodParameters BasicRenderSystem::GetLodParameters(const FrameInfo& Info) const
+	{
+		GpuCulling::LodParameters Lod;
+		if (!m_LodSelectionEnabled || m_LodPixelError <= 0.0f)
+			return Lod;
+
+		// The projection maps a unit at distance one to [1][1] half viewport heights, for both projections
+		Lod.CameraPosition = Info.Cam.GetPosition();
+		Lod.ErrorScale = glm::abs(Info.Cam.GetProjectionMatrix()[1][1]) * (float)Info.Extent.height * 0.5f / m_LodPixelError;
+		Lod.Perspective = Info.Cam.IsPerspective();
+		return Lod;
+	}
+
+	void BasicRenderSystem::SelectLods(FrameInfo& Info, const std::vector<GameObject>& GameObjects)
+	{
+		const GpuCulling::LodParameters Lod = GetLodParameters(Info);
+
+		m_DrawLods.resize(m_DrawList.size());
+		m_Stats.TriangleCount = 0;
+
+		for (size_t i = 0; i < m_DrawList.size(); i++)
+		{
+			const GameObject& Obj = GameObjects[m_DrawList[i]];
+			const Mesh& ObjMesh = *Obj.GetMesh();
+
+			uint32_t LodIndex = 0;
+			if (Lod.ErrorScale > 0.0f && ObjMesh.GetLodCount() > 1)
+			{
+				const TransformComponent& Transform = Obj.GetTransform();
+				const Mesh::BoundingSphere& Sphere = ObjMesh.GetBoundingSphere();
+				const glm::vec3 Scale = glm::abs(Transform.Scale);
+				const float MaxScale = glm::max(Scale.x, glm::max(Scale.y, Scale.z));
+
+				// Same test as CullObjects.comp, a camera inside the sphere keeps full detail
+				float Distance = 1.0f;
+				if (Lod.Perspective)
+				{
+					const glm::vec3 Center = glm::vec3(Transform.Mat4() * glm::vec4(Sphere.Center, 1.0f));
+					Distance = glm::length(Center - Lod.CameraPosition) - Sphere.Radius * MaxScale;
+				}
+
+				// ErrorScale already divides by the pixel error, so errors are compared against one
+				if (Distance > 0.0f)
+					LodIndex = ObjMesh.SelectLod(Lod.ErrorScale * MaxScale / Distance, 1.0f);
+			}
+
+			m_DrawLods[i] = LodIndex;
+			m_Stats.TriangleCount += ObjMesh.GetTriangleCount(LodIndex);
+		}
+	}
+
+	void BasicRenderSystem::RenderPerObject(FrameInfo& Info, std::vector<GameObject>& GameObjects)
+	{
+		m_Stats.DrawCallCount += RecordPerObject(Info.CommandBuffer, GameObjects, 0, m_DrawList.size(), m_Stats.BindCallCount);
+	}
+
+	void BasicRenderSystem::RenderPerObjectSecondary(FrameInfo& Info, std::vector<GameObject>& GameObjects)
+	{
+		const size_t DrawCount = m_DrawList.size();
+		if (DrawCount == 0)
+			return;
+
+		const size_t MaxRecorders = (DrawCount + MIN_DRAWS_PER_RECORDER - 1) / MIN_DRAWS_PER_RECORDER;
+		const uint32_t RecorderCount = (uint32_t)std::min<size_t>(m_RecordThreadCount, MaxRecorders);
+		const size_t GrainSize = (DrawCount + RecorderCount - 1) / RecorderCount;
+		const uint32_t RangeCount = (uint32_t)((DrawCount + GrainSize - 1) / GrainSize);
+
+		std::vector<SecondaryRecorder>& Recorders = GetSecondaryRecorders(Info.FrameIndex, RangeCount);
+		std::atomic<uint32_t> DrawCallCount{ 0 };
+		std::atomic<uint32_t> BindCallCount{ 0 };
+
+		VkCommandBufferInheritanceInfo InheritanceInfo{};
+		InheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		InheritanceInfo.renderPass = m_RenderPass;
+		InheritanceInfo.subpass = 0;
+		InheritanceInfo.framebuffer = Info.Framebuffer;
+
+		VkViewport Viewport;
+		Viewport.x = 0.0f;
+		Viewport.y = 0.0f;
+		Viewport.width = (float)Info.Extent.width;
+		Viewport.height = (float)Info.Extent.height;
+		Viewport.minDepth = 0.0f;
+		Viewport.maxDepth = 1.0f;
+
+		const VkRect2D Scissor{ {0, 0}, Info.Extent };
+
+		// Each range owns one recorder, so no pool is ever touched by two threads at once
+		ThreadPool::Shared().ParallelFor(DrawCount, GrainSize, [&](size_t Begin, size_t End)
+		{
+			SecondaryRecorder& Recorder = Recorders[Begin / GrainSize];
+
+			// The frame slot's fence was waited on in Renderer::BeginFrame
+			vkResetCommandPool(m_EngineDevice.Device(), Recorder.CommandPool, 0);
+
+			VkCommandBufferBeginInfo BeginInfo{};
+			BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			BeginInfo.pInheritanceInfo = &InheritanceInfo;
+
+			if (vkBeginCommandBuffer(Recorder.CommandBuffer, &BeginInfo) != VK_SUCCESS)
+				throw std::runtime_error("Failed to begin secondary command buffer");
 
-		vkCmdBindDescriptorSets(Info.CommandBuffer
-			, VK_PIPELINE_BIND_POINT_GRAPHICS
-			, m_PipelineLayout
-			, 0, 1
-			, &Info.GlobalDescriptorSet
-			, 0
-			, nullptr);
+			vkCmdSetViewport(Recorder.CommandBuffer, 0, 1, &Viewport);
+			vkCmdSetScissor(Recorder.CommandBuffer, 0, 1, &Scissor);
+			vkCmdBindDescriptorSets(Recorder.CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &Info.GlobalDescriptorSet, 0, nullptr);
 
-		for (auto& Obj : GameObjects)
+			uint32_t RangeBindCount = 0;
+			DrawCallCount += RecordPerObject(Recorder.CommandBuffer, GameObjects, Begin, End, RangeBindCount);
+			BindCallCount += RangeBindCount;
+
+			if (vkEndCommandBuffer(Recorder.CommandBuffer) != VK_SUCCESS)
+				throw std::runtime_error("Failed to record secondary command buffer");
+		});
+
+		m_SecondaryCommandBuffers.resize(RangeCount);
+		for (uint32_t i = 0; i < RangeCount; i++)
+			m_SecondaryCommandBuffers[i] = Recorders[i].CommandBuffer;
+
+		vkCmdExecuteCommands(Info.CommandBuffer, RangeCount, m_SecondaryCommandBuffers.data());
+
+		m_Stats.DrawCallCount += DrawCallCount.load();
+		m_Stats.BindCallCount += BindCallCount.load();
+	}
+
+	uint32_t BasicRenderSystem::RecordPerObject(VkCommandBuffer CommandBuffer, std::vector<GameObject>& GameObjects, size_t Begin, size_t End, uint32_t& BindCallCount)
+	{
+		// Every mesh lives in the geometry pool, only a change of index type needs another bind
+		VkIndexType BoundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+		RenderPipeline* BoundPipeline = nullptr;
+
+		for (size_t i = Begin; i < End; i++)
 		{
+			GameObject& Obj = GameObjects[m_DrawList[i]];
+
+			RenderPipeline& ObjectPipeline = GetMaterialPipeline(Obj.GetMaterial());
+			if (&ObjectPipeline != BoundPipeline)
+			{
+				ObjectPipeline.Bind(CommandBuffer);
+				BoundPipeline = &ObjectPipeline;
+			}
+
 			SimplePushConstantData Push;
 
-			auto ModelMatrix = Obj.GetTransform().Mat4();
+			auto ModelMatrix = GetDrawModelMatrix(Obj.GetTransform(), *Obj.GetMesh());
 
 			Push.normalMatrix = Obj.GetTransform().NormalMatrix();
 			Push.modelMatrix = ModelMatrix;
 
-			vkCmdPushConstants(Info.CommandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
+			vkCmdPushConstants(CommandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
 				, 0, sizeof(SimplePushConstantData), &Push);
 
-			Obj.GetMesh()->Bind(Info.CommandBuffer);
-			Obj.GetMesh()->Draw(Info.CommandBuffer);
+			BindCallCount += BindGeometry(CommandBuffer, *Obj.GetMesh(), BoundIndexType);
+
+			Obj.GetMesh()->Draw(CommandBuffer, 1, 0, m_DrawLods[i]);
+		}
+
+		return (uint32_t)(End - Begin);
+	}
+
+	uint32_t BasicRenderSystem::BindGeometry(VkCommandBuffer CommandBuffer, Mesh& DrawMesh, VkIndexType& BoundIndexType)
+	{
+		if (m_BindPerDraw)
+		{
+			DrawMesh.Bind(CommandBuffer);
+			return 1;
+		}
+
+		if (DrawMesh.GetIndexType() == BoundIndexType)
+			return 0;
+
+		GeometryPool& Pool = m_EngineDevice.GetGeometryPool();
+		if (BoundIndexType == VK_INDEX_TYPE_MAX_ENUM)
+			Pool.Bind(CommandBuffer, DrawMesh.GetIndexType());
+		else
+			Pool.BindIndexBuffer(CommandBuffer, DrawMesh.GetIndexType());
+
+		BoundIndexType = DrawMesh.GetIndexType();
+		return 1;
+	}
+
+	std::vector<BasicRenderSystem::SecondaryRecorder>& BasicRenderSystem::GetSecondaryRecorders(int FrameIndex, uint32_t Count)
+	{
+		if (FrameIndex >= (int)m_SecondaryRecorders.size())
+			m_SecondaryRecorders.resize(FrameIndex + 1);
+
+		std::vector<SecondaryRecorder>& Recorders = m_SecondaryRecorders[FrameIndex];
+		while (Recorders.size() < Count)
+		{
+			SecondaryRecorder Recorder;
+			Recorder.CommandPool = m_EngineDevice.CreateGraphicsCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+			VkCommandBufferAllocateInfo AllocInfo{};
+			AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			AllocInfo.commandPool = Recorder.CommandPool;
+			AllocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(m_EngineDevice.Device(), &AllocInfo, &Recorder.CommandBuffer) != VK_SUCCESS)
+			{
+				vkDestroyCommandPool(m_EngineDevice.Device(), Recorder.CommandPool, nullptr);
+				throw std::runtime_error("Failed to allocate secondary command buffer");
+			}
+
+			Recorders.push_back(Recorder);
+		}
+
+		return Recorders;
+	}
+
+	uint32_t BasicRenderSystem::GroupByMesh(const std::vector<GameObject>& GameObjects, const std::vector<uint32_t>& ObjectIndices, const std::vector<uint32_t>* ObjectLods)
+	{
+		m_BatchLookup.clear();
+		m_Batches.clear();
+		m_ObjectBatches.resize(ObjectIndices.size());
+
+		// Group objects by mesh and level, batches keep the order in which they first appear
+		for (size_t i = 0; i < ObjectIndices.size(); i++)
+		{
+			Mesh* ObjMesh = GameObjects[ObjectIndices[i]].GetMesh().get();
+			if (ObjMesh == nullptr)
+			{
+				m_ObjectBatches[i] = UINT32_MAX;
+				continue;
+			}
+
+			const uint32_t Lod = ObjectLods ? (*ObjectLods)[i] : 0;
+
+			auto Result = m_BatchLookup.try_emplace(BatchKey{ ObjMesh, Lod }, (uint32_t)m_Batches.size());
+			if (Result.second)
+				m_Batches.push_back({ ObjMesh, Lod, 0, 0 });
+
+			m_ObjectBatches[i] = Result.first->second;
+			m_Batches[Result.first->second].InstanceCount++;
+		}
+
+		// Grouped by index type, so the indirect commands of each type form one range
+		uint32_t InstanceCount = 0;
+		for (VkIndexType IndexType : INDIRECT_INDEX_TYPES)
+		{
+			for (InstanceBatch& Batch : m_Batches)
+			{
+				if (Batch.BatchMesh->GetIndexType() != IndexType)
+					continue;
+
+				Batch.FirstInstance = InstanceCount;
+				InstanceCount += Batch.InstanceCount;
+				Batch.InstanceCount = 0;
+			}
+		}
+
+		return InstanceCount;
+	}
+
+	void BasicRenderSystem::RenderInstanced(FrameInfo& Info, std::vector<GameObject>& GameObjects)
+	{
+		const uint32_t InstanceCount = GroupByMesh(GameObjects, m_DrawList, &m_DrawLods);
+		if (InstanceCount == 0)
+			return;
+
+		Buffer& InstanceBuffer = GetInstanceBuffer(Info.FrameIndex, InstanceCount);
+		Mesh::InstanceData* Instances = (Mesh::InstanceData*)InstanceBuffer.GetMappedMemory();
+
+		for (size_t i = 0; i < m_DrawList.size(); i++)
+		{
+			if (m_ObjectBatches[i] == UINT32_MAX)
+				continue;
+
+			InstanceBatch& Batch = m_Batches[m_ObjectBatches[i]];
+			Mesh::InstanceData& Instance = Instances[Batch.FirstInstance + Batch.InstanceCount++];
+
+			const TransformComponent& Transform = GameObjects[m_DrawList[i]].GetTransform();
+			Instance.modelMatrix = GetDrawModelMatrix(Transform, *Batch.BatchMesh);
+			Instance.normalMatrix = Transform.NormalMatrix();
+		}
+
+		m_InstancedRenderPipeline->Bind(Info.CommandBuffer);
+
+		VkBuffer Buffers[] = { InstanceBuffer.GetBuffer() };
+		VkDeviceSize Offsets[] = { 0 };
+		vkCmdBindVertexBuffers(Info.CommandBuffer, Mesh::InstanceData::INSTANCE_BINDING, 1, Buffers, Offsets);
+
+		// One pass per index type, so the index buffer is switched at most once
+		VkIndexType BoundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+		for (VkIndexType IndexType : INDIRECT_INDEX_TYPES)
+		{
+			for (const InstanceBatch& Batch : m_Batches)
+			{
+				if (Batch.BatchMesh->GetIndexType() != IndexType)
+					continue;
+
+				m_Stats.BindCallCount += BindGeometry(Info.CommandBuffer, *Batch.BatchMesh, BoundIndexType);
+
+				Batch.BatchMesh->Draw(Info.CommandBuffer, Batch.InstanceCount, Batch.FirstInstance, Batch.Lod);
+
+				m_Stats.DrawCallCount++;
+			}
+		}
+	}
+
+	void BasicRenderSystem::BuildIndirectScene(IndirectScene& Scene, const std::vector<GameObject>& GameObjects)
+	{
+		// The whole scene goes in, culling happens on the GPU
+		std::vector<uint32_t> ObjectIndices(GameObjects.size());
+		std::iota(ObjectIndices.begin(), ObjectIndices.end(), 0);
+
+		const uint32_t InstanceCount = GroupByMesh(GameObjects, ObjectIndices);
+
+		// Batches appear in the order of their first object
+		Scene.Meshes.clear();
+		for (size_t i = 0; i < GameObjects.size(); i++)
+		{
+			if (m_ObjectBatches[i] == Scene.Meshes.size())
+				Scene.Meshes.push_back(GameObjects[i].GetMesh());
+		}
+
+		std::vector<Mesh::InstanceData> Instances(InstanceCount);
+		std::vector<VkDrawIndexedIndirectCommand> Commands(InstanceCount);
+		std::vector<uint32_t> ObjectSlots(GameObjects.size());
+
+		for (size_t i = 0; i < GameObjects.size(); i++)
+		{
+			if (m_ObjectBatches[i] == UINT32_MAX)
+				continue;
+
+			InstanceBatch& Batch = m_Batches[m_ObjectBatches[i]];
+			const uint32_t Slot = Batch.FirstInstance + Batch.InstanceCount++;
+			ObjectSlots[i] = Slot;
+
+			const TransformComponent& Transform = GameObjects[i].GetTransform();
+			Instances[Slot].modelMatrix = GetDrawModelMatrix(Transform, *Batch.BatchMesh);
+			Instances[Slot].normalMatrix = Transform.NormalMatrix();
+
+			// Meshes without indices get an empty command, it draws nothing
+			VkDrawIndexedIndirectCommand& Command = Commands[Slot];
+			Command.indexCount = Batch.BatchMesh->GetIndexCount();
+			Command.instanceCount = 1;
+			Command.firstIndex = Batch.BatchMesh->GetFirstIndex();
+			Command.vertexOffset = Batch.BatchMesh->GetVertexOffset();
+			Command.firstInstance = Slot;
+		}
+
+		for (IndirectRange& Range : Scene.Ranges)
+			Range = IndirectRange{};
+
+		for (const InstanceBatch& Batch : m_Batches)
+			Scene.Ranges[GetIndirectRangeIndex(Batch.BatchMesh->GetIndexType())].CommandCount += Batch.InstanceCount;
+
+		Scene.Ranges[1].CommandBase = Scene.Ranges[0].CommandCount;
+
+		// Levels of every mesh once, batches hold one mesh each since the scene is grouped at full detail. Errors are
+		// stored relative to the mesh's bounding sphere so the culling shader can scale them with the object's.
+		std::vector<GpuCulling::CullLod> CullLods;
+		std::vector<uint32_t> BatchLodBases(m_Batches.size());
+
+		for (size_t i = 0; i < m_Batches.size(); i++)
+		{
+			const Mesh& BatchMesh = *m_Batches[i].BatchMesh;
+			const float Radius = BatchMesh.GetBoundingSphere().Radius;
+
+			BatchLodBases[i] = (uint32_t)CullLods.size();
+			for (uint32_t Lod = 0; Lod < BatchMesh.GetLodCount(); Lod++)
+				CullLods.push_back({ BatchMesh.GetFirstIndex(Lod), BatchMesh.GetIndexCount(Lod), Radius > 0.0f ? BatchMesh.GetLod(Lod).Error / Radius : 0.0f, 0 });
+		}
+
+		// Meshlets of every mesh once, bounds in mesh space and first indices inside the geometry pool. Meshes built
+		// without meshlets become one cluster covering their full detail level that is never back facing.
+		std::vector<ClusterCulling::ClusterMeshlet> ClusterMeshlets;
+		std::vector<uint32_t> BatchMeshletBases(m_Batches.size());
+
+		for (size_t i = 0; i < m_Batches.size(); i++)
+		{
+			const Mesh& BatchMesh = *m_Batches[i].BatchMesh;
+			BatchMeshletBases[i] = (uint32_t)ClusterMeshlets.size();
+
+			if (BatchMesh.GetMeshlets().empty())
+			{
+				const Mesh::BoundingSphere& Sphere = BatchMesh.GetBoundingSphere();
+				ClusterMeshlets.push_back({ glm::vec4(Sphere.Center, Sphere.Radius), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), BatchMesh.GetFirstIndex(), BatchMesh.GetIndexCount(), { 0, 0 } });
+				continue;
+			}
+
+			for (const Mesh::Meshlet& Cluster : BatchMesh.GetMeshlets())
+			{
+				ClusterMeshlets.push_back({ glm::vec4(Cluster.Center, Cluster.Radius), glm::vec4(Cluster.ConeAxis, Cluster.ConeCutoff)
+					, BatchMesh.GetFirstIndex() + Cluster.FirstIndex, Cluster.IndexCount, { 0, 0 } });
+			}
+		}
+
+		for (IndirectRange& Range : Scene.ClusterRanges)
+			Range = IndirectRange{};
+
+		std::vector<ClusterCulling::ClusterObject> ClusterObjects;
+		ClusterObjects.reserve(InstanceCount);
+
+		// Culling input, world space bounding spheres of every drawable object. Meshes share the geometry pool, so
+		// survivors are compacted into one range per index type with its own draw count and drawn by one call each.
+		std::vector<GpuCulling::CullObject> CullObjects;
+		CullObjects.reserve(InstanceCount);
+		Scene.TriangleCount = 0;
+
+		for (size_t i = 0; i < GameObjects.size(); i++)
+		{
+			if (m_ObjectBatches[i] == UINT32_MAX)
+				continue;
+
+			const InstanceBatch& Batch = m_Batches[m_ObjectBatches[i]];
+			if (!Batch.BatchMesh->HasIndexBuffer())
+				continue;
+
+			const TransformComponent& Transform = GameObjects[i].GetTransform();
+			const Mesh::BoundingSphere& Sphere = Batch.BatchMesh->GetBoundingSphere();
+			const glm::vec3 Scale = glm::abs(Transform.Scale);
+
+			GpuCulling::CullObject Object{};
+			Object.Sphere = glm::vec4(glm::vec3(Transform.Mat4() * glm::vec4(Sphere.Center, 1.0f)), Sphere.Radius * glm::max(Scale.x, glm::max(Scale.y, Scale.z)));
+			Object.BatchIndex = GetIndirectRangeIndex(Batch.BatchMesh->GetIndexType());
+			Object.CommandBase = Scene.Ranges[Object.BatchIndex].CommandBase;
+			Object.InstanceSlot = ObjectSlots[i];
+			Object.LodBase = BatchLodBases[m_ObjectBatches[i]];
+			Object.LodCount = Batch.BatchMesh->GetLodCount();
+			Object.VertexOffset = Batch.BatchMesh->GetVertexOffset();
+			CullObjects.push_back(Object);
+
+			const uint32_t MeshletCount = std::max((uint32_t)Batch.BatchMesh->GetMeshlets().size(), 1u);
+
+			ClusterCulling::ClusterObject Cluster{};
+			Cluster.ModelMatrix = Transform.Mat4();
+			Cluster.Sphere = Object.Sphere;
+			Cluster.MeshletBase = BatchMeshletBases[m_ObjectBatches[i]];
+			Cluster.MeshletCount = MeshletCount;
+			Cluster.BatchIndex = Object.BatchIndex;
+			Cluster.InstanceSlot = Object.InstanceSlot;
+			Cluster.VertexOffset = Object.VertexOffset;
+			Cluster.MaxScale = glm::max(Scale.x, glm::max(Scale.y, Scale.z));
+			Cluster.ConeCulling = Transform.Scale.x > 0.0f && Transform.Scale.x == Transform.Scale.y && Transform.Scale.y == Transform.Scale.z ? 1 : 0;
+			ClusterObjects.push_back(Cluster);
+
+			Scene.ClusterRanges[Cluster.BatchIndex].CommandCount += MeshletCount;
+
+			Scene.TriangleCount += Batch.BatchMesh->GetTriangleCount();
+		}
+
+		// Each object's meshlets get a slot in its range whether they survive or not
+		Scene.ClusterRanges[1].CommandBase = Scene.ClusterRanges[0].CommandCount;
+
+		for (ClusterCulling::ClusterObject& Cluster : ClusterObjects)
+			Cluster.CommandBase = Scene.ClusterRanges[Cluster.BatchIndex].CommandBase;
+
+		if (CullObjects.size() < InstanceCount)
+			std::cout << "Indirect rendering skips " << InstanceCount - CullObjects.size() << " objects without index buffer" << std::endl;
+
+		if (InstanceCount > 0)
+		{
+			Scene.InstanceBuffer = CreateDeviceLocalBuffer(m_EngineDevice, Instances.data(), sizeof(Mesh::InstanceData), InstanceCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+			Scene.CommandBuffer = CreateDeviceLocalBuffer(m_EngineDevice, Commands.data(), sizeof(VkDrawIndexedIndirectCommand), InstanceCount, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+		}
+
+		if (CullObjects.empty())
+		{
+			for (IndirectRange& Range : Scene.Ranges)
+				Range.CommandCount = 0;
+		}
+
+		if (m_GpuCullingEnabled && m_ClusterCullingEnabled && !Scene.Clusters)
+			Scene.Clusters = std::make_unique<ClusterCulling>(m_EngineDevice);
+		else if (m_GpuCullingEnabled && !m_ClusterCullingEnabled && !Scene.Culling)
+			Scene.Culling = std::make_unique<GpuCulling>(m_EngineDevice);
+
+		if (Scene.Culling)
+			Scene.Culling->SetScene(CullObjects, CullLods, InstanceCount, INDIRECT_RANGE_COUNT);
+
+		if (Scene.Clusters)
+			Scene.Clusters->SetScene(ClusterObjects, ClusterMeshlets, Scene.ClusterRanges[0].CommandCount + Scene.ClusterRanges[1].CommandCount, INDIRECT_RANGE_COUNT);
+
+		Scene.Built = true;
+
+		m_IndirectSceneObjects = GameObjects.data();
+		m_IndirectSceneObjectCount = GameObjects.size();
+		m_IndirectSceneValid = true;
+	}
+
+	void BasicRenderSystem::RenderIndirect(FrameInfo& Info, std::vector<GameObject>& GameObjects)
+	{
+		// PrepareFrame swapped in the latest uploaded scene, changes since are picked up by a later frame
+		const IndirectScene& Scene = m_IndirectScenes[m_DrawnScene];
+		if (!Scene.Built || (Scene.Ranges[0].CommandCount == 0 && Scene.Ranges[1].CommandCount == 0))
+			return;
+
+		const bool ClusterCulled = m_ClusterCullingRecorded;
+		const IndirectRange* Ranges = ClusterCulled ? Scene.ClusterRanges : Scene.Ranges;
+
+		if (ClusterCulled)
+			m_ClusterRenderPipeline->Bind(Info.CommandBuffer);
+		else
+			m_InstancedRenderPipeline->Bind(Info.CommandBuffer);
+
+		VkBuffer Buffers[] = { Scene.InstanceBuffer->GetBuffer() };
+		VkDeviceSize Offsets[] = { 0 };
+		vkCmdBindVertexBuffers(Info.CommandBuffer, Mesh::InstanceData::INSTANCE_BINDING, 1, Buffers, Offsets);
+
+		const uint32_t Stride = sizeof(VkDrawIndexedIndirectCommand);
+		const bool MultiDrawIndirect = m_EngineDevice.EnabledFeatures().multiDrawIndirect == VK_TRUE;
+
+		// Culled commands are compacted to the front, without a GPU side count the zero filled tail is drawn as no-ops
+		const bool Culled = m_GpuCullingRecorded;
+		const bool DrawIndirectCount = Culled && m_EngineDevice.SupportsDrawIndirectCount();
+		VkBuffer DrawCommands = Scene.CommandBuffer->GetBuffer();
+		VkBuffer DrawCounts = VK_NULL_HANDLE;
+
+		if (ClusterCulled)
+		{
+			DrawCommands = Scene.Clusters->GetCommandBuffer(Info.FrameIndex);
+			DrawCounts = Scene.Clusters->GetCountBuffer(Info.FrameIndex);
+		}
+		else if (Culled)
+		{
+			DrawCommands = Scene.Culling->GetCommandBuffer(Info.FrameIndex);
+			DrawCounts = Scene.Culling->GetCountBuffer(Info.FrameIndex);
+		}
+
+		GeometryPool& Pool = m_EngineDevice.GetGeometryPool();
+		bool GeometryBound = false;
+
+		for (uint32_t RangeIndex = 0; RangeIndex < INDIRECT_RANGE_COUNT; RangeIndex++)
+		{
+			const IndirectRange& Range = Ranges[RangeIndex];
+			if (Range.CommandCount == 0)
+				continue;
+
+			if (GeometryBound)
+				Pool.BindIndexBuffer(Info.CommandBuffer, INDIRECT_INDEX_TYPES[RangeIndex]);
+			else
+				Pool.Bind(Info.CommandBuffer, INDIRECT_INDEX_TYPES[RangeIndex]);
+
+			GeometryBound = true;
+			m_Stats.BindCallCount++;
+
+			const VkDeviceSize RangeOffset = (VkDeviceSize)Range.CommandBase * Stride;
+
+			if (DrawIndirectCount)
+			{
+				const VkDeviceSize CountOffset = ClusterCulled ? ClusterCulling::GetCountOffset(RangeIndex) : GpuCulling::GetCountOffset(RangeIndex);
+				m_EngineDevice.CmdDrawIndexedIndirectCount()(Info.CommandBuffer, DrawCommands, RangeOffset
+					, DrawCounts, CountOffset, Range.CommandCount, Stride);
+				m_Stats.DrawCallCount++;
+			}
+			else if (MultiDrawIndirect)
+			{
+				vkCmdDrawIndexedIndirect(Info.CommandBuffer, DrawCommands, RangeOffset, Range.CommandCount, Stride);
+				m_Stats.DrawCallCount++;
+			}
+			else
+			{
+				for (uint32_t i = 0; i < Range.CommandCount; i++)
+				{
+					vkCmdDrawIndexedIndirect(Info.CommandBuffer, DrawCommands, RangeOffset + i * Stride, 1, Stride);
+					m_Stats.DrawCallCount++;
+				}
+			}
 		}
 	}
 }
\ No newline at end of file
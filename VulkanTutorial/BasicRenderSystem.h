@@ -2,12 +2,21 @@
 #define __BasicRenderSystem_h__
 
 #include "RenderPipeline.h"
+#include "PipelineLibrary.h"
 #include "EngineDevice.h"
 #include "GameObject.h"
 #include "Camera.h"
 #include "FrameInfo.h"
+#include "Buffer.h"
+#include "UploadManager.h"
+#include "GpuCulling.h"
+#include "ClusterCulling.h"
+#include "FrustumCulling.h"
+#include "Hash.h"
 
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 
@@ -17,6 +26,71 @@ namespace VulkanTutorial
 	{
 	public:
 
+		enum class RenderMode
+		{
+			// One push constant and draw per game object
+			PerObject,
+			// Game objects sharing a mesh are drawn with one instanced draw, transforms come from a per frame instance buffer
+			Instanced,
+			// Instance data and one VkDrawIndexedIndirectCommand per object are built once into device local buffers and
+			// submitted with a single vkCmdDrawIndexedIndirect, the frame loop does no per object work until the scene is
+			// invalidated. The rebuilt scene uploads in the background, the previous one is drawn until it is complete.
+			Indirect,
+		};
+
+		struct RenderStats
+		{
+			uint32_t ObjectCount = 0;
+			uint32_t DrawCallCount = 0;
+			// Vertex and index buffer binds
+			uint32_t BindCallCount = 0;
+			float RecordTimeMs = 0.0f;
+
+			// Objects passing CPU culling, all objects when it is disabled
+			uint32_t CpuVisibleCount = 0;
+
+			// GPU culling counters, a few frames old
+			uint32_t CullTestedCount = 0;
+			uint32_t CullVisibleCount = 0;
+
+			// Triangles of the selected levels of detail, a few frames old for GPU culled indirect frames
+			uint32_t TriangleCount = 0;
+
+			// Cluster culling counters, a few frames old
+			uint32_t ClusterTestedCount = 0;
+			uint32_t ClusterVisibleCount = 0;
+			uint32_t ClusterBackfacingCount = 0;
+		};
+
+		// Fixed function state a material changes on top of the per object pipeline
+		struct MaterialState
+		{
+			VkCullModeFlags CullMode = VK_CULL_MODE_NONE;
+			VkFrontFace FrontFace = VK_FRONT_FACE_CLOCKWISE;
+			// Constant depth bias, zero disables biasing
+			float DepthBias = 0.0f;
+		};
+
+		enum class LightingModel : uint32_t
+		{
+			Unlit,
+			Lambert,
+			// Wraps the light around the terminator, faces turned away stay above ambient
+			HalfLambert,
+		};
+
+		static constexpr uint32_t LIGHTING_MODEL_COUNT = 3;
+
+		// Specialization constants of the vertex shaders, the vertex format adds its own. Every combination is a
+		// pipeline of its own with the unused lighting branches compiled out.
+		struct ShaderVariant
+		{
+			LightingModel Lighting = LightingModel::Lambert;
+			float Ambient = 0.02f;
+			// Branches on the lighting values of GlobalUBO instead, changing those needs no new pipelines
+			bool UniformLighting = false;
+		};
+
 		BasicRenderSystem(EngineDevice& Device, VkRenderPass RenderPass, VkDescriptorSetLayout GlobalSetLayout);
 		virtual ~BasicRenderSystem();
 
@@ -26,18 +100,290 @@ namespace VulkanTutorial
 		BasicRenderSystem(BasicRenderSystem&&) = delete;
 		BasicRenderSystem& operator = (BasicRenderSystem&&) = delete;
 
+		// Records work that has to happen outside of the render pass, call between BeginFrame and BeginSwapChainRenderPass
+		void PrepareFrame(FrameInfo& Info, std::vector<GameObject>& GameObjects);
 		void RenderGameObject(FrameInfo& Info, std::vector<GameObject>& GameObjects);
 
+		// Falls back to Instanced when the device can not draw indirect with a first instance
+		void SetRenderMode(RenderMode Mode);
+		RenderMode GetRenderMode() const { return m_RenderMode; }
+
+		static const char* GetRenderModeName(RenderMode Mode);
+		static const char* GetLightingModelName(LightingModel Model);
+
+		// Indirect mode caches the scene, call after changing transforms or meshes of existing game objects.
+		// Adding or removing game objects is detected automatically.
+		void InvalidateScene() { m_IndirectSceneValid = false; }
+
+		// Frustum culls the indirect scene in a compute pass, only affects RenderMode::Indirect
+		void SetGpuCulling(bool Enable) { m_GpuCullingEnabled = Enable; }
+		bool IsGpuCullingEnabled() const { return m_GpuCullingEnabled; }
+
+		// Replaces GPU object culling with per meshlet frustum and back face culling, one indirect draw per visible
+		// meshlet. Draws full detail and rasterizes with back face culling so the result matches the unculled scene
+		// for closed meshes. Meshes without meshlets are culled as one cluster.
+		void SetClusterCulling(bool Enable) { m_ClusterCullingEnabled = Enable; }
+		bool IsClusterCullingEnabled() const { return m_ClusterCullingEnabled; }
+
+		// Frustum culls on the CPU before recording, affects RenderMode::PerObject and RenderMode::Instanced
+		void SetCpuCulling(bool Enable) { m_CpuCullingEnabled = Enable; }
+		bool IsCpuCullingEnabled() const { return m_CpuCullingEnabled; }
+
+		// Per object draws are split across this many secondary command buffers recorded on ThreadPool::Shared(),
+		// 1 records inline into the frame's primary command buffer
+		void SetRecordThreadCount(uint32_t Count);
+		uint32_t GetRecordThreadCount() const { return m_RecordThreadCount; }
+		static uint32_t GetMaxRecordThreadCount();
+
+		// Draws every object at the coarsest level of detail of its mesh whose error projects to at most the pixel
+		// error, measured from the camera to the nearest point of the object's bounding sphere. GPU culled indirect
+		// frames select on the GPU, unculled indirect frames draw full detail.
+		void SetLodSelection(bool Enable) { m_LodSelectionEnabled = Enable; }
+		bool IsLodSelectionEnabled() const { return m_LodSelectionEnabled; }
+		void SetLodPixelError(float PixelError) { m_LodPixelError = PixelError; }
+		float GetLodPixelError() const { return m_LodPixelError; }
+
+		// Rebinds geometry before every draw as meshes with buffers of their own had to, for measuring bind overhead
+		// against binding the shared GeometryPool once
+		void SetBindPerDraw(bool Enable) { m_BindPerDraw = Enable; }
+		bool IsBindPerDrawEnabled() const { return m_BindPerDraw; }
+
+		// Returns the index to pass to GameObject::SetMaterial. The material's pipeline compiles on the pipeline
+		// library's threads and objects using it draw with the default pipeline until it is ready, Synchronous
+		// compiles it before returning instead. Only RenderMode::PerObject draws materials.
+		uint32_t AddMaterial(const MaterialState& State, bool Synchronous = false);
+
+		// Materials whose objects still draw with the default pipeline
+		uint32_t GetPendingMaterialCount() const { return m_PendingMaterialCount; }
+
+		// Recreates every pipeline built from one of the SPIR-V files, compared by file name, on the pipeline library's
+		// threads. Each replaces its predecessor in the first PrepareFrame after it is ready, the predecessor is kept
+		// until the frames in flight that may use it have completed. Returns the number of pipelines recreated.
+		uint32_t ReloadShaders(const std::vector<std::string>& ChangedFiles);
+		uint32_t GetPendingReloadCount() const { return (uint32_t)m_PendingReloads.size(); }
+
+		// Recreates every pipeline with the new constants, in the background like ReloadShaders unless Synchronous.
+		// Changing only the lighting values of the uniform variant keeps the pipelines.
+		void SetShaderVariant(const ShaderVariant& Variant, bool Synchronous = false);
+		const ShaderVariant& GetShaderVariant() const { return m_ShaderVariant; }
+
+		// How the swap chain render pass has to be begun for the next RenderGameObject call
+		VkSubpassContents GetSubpassContents() const;
+
+		// Counters of the last RenderGameObject call
+		const RenderStats& GetStats() const { return m_Stats; }
+
 	private:
 
+		struct InstanceBatch
+		{
+			Mesh* BatchMesh;
+			uint32_t Lod;
+			uint32_t FirstInstance;
+			uint32_t InstanceCount;
+		};
+
+		// Objects share a batch when they draw the same level of the same mesh
+		struct BatchKey
+		{
+			Mesh* BatchMesh;
+			uint32_t Lod;
+
+			bool operator == (const BatchKey& Other) const { return BatchMesh == Other.BatchMesh && Lod == Other.Lod; }
+		};
+
+		struct BatchKeyHash
+		{
+			size_t operator()(const BatchKey& Key) const { return (size_t)HashCombine(std::hash<Mesh*>()(Key.BatchMesh), Key.Lod); }
+		};
+
+		// A recording thread's pool for one frame slot, reset as a whole before the slot is recorded again
+		struct SecondaryRecorder
+		{
+			VkCommandPool CommandPool;
+			VkCommandBuffer CommandBuffer;
+		};
+
+		// Commands of one index type in a scene's command buffer, each range is drawn with its own index buffer bound
+		struct IndirectRange
+		{
+			uint32_t CommandBase = 0;
+			// Zero when no object of this index type has an indexed mesh
+			uint32_t CommandCount = 0;
+		};
+
+		// Order of the indirect ranges, a range's position doubles as its GPU culling batch index
+		static constexpr VkIndexType INDIRECT_INDEX_TYPES[] = { VK_INDEX_TYPE_UINT32, VK_INDEX_TYPE_UINT16 };
+		static constexpr uint32_t INDIRECT_RANGE_COUNT = 2;
+		static uint32_t GetIndirectRangeIndex(VkIndexType IndexType) { return IndexType == VK_INDEX_TYPE_UINT16 ? 1 : 0; }
+
+		// One of the two indirect scenes, the drawn one is replaced by the other once a rebuild has been uploaded
+		struct IndirectScene
+		{
+			std::unique_ptr<Buffer> InstanceBuffer;
+			std::unique_ptr<Buffer> CommandBuffer;
+			// Indexed like INDIRECT_INDEX_TYPES
+			IndirectRange Ranges[INDIRECT_RANGE_COUNT];
+			// Ranges of the cluster command buffer, one command per meshlet of every object
+			IndirectRange ClusterRanges[INDIRECT_RANGE_COUNT];
+			// Full detail triangles of the scene, drawn when it is not culled
+			uint32_t TriangleCount = 0;
+			// Created the first time the scene is built with the culling enabled, so the other modes never load the
+			// culling shaders, and kept for later builds
+			std::unique_ptr<GpuCulling> Culling;
+			std::unique_ptr<ClusterCulling> Clusters;
+			// The commands point into the geometry of these, streaming may drop the game objects' references
+			std::vector<std::shared_ptr<Mesh>> Meshes;
+			UploadManager::Ticket UploadTicket = 0;
+			// Replaced scenes are kept until this many frames were prepared, see PIPELINE_RELEASE_DELAY_FRAMES
+			uint64_t ReleaseFrame = 0;
+			bool Built = false;
+		};
+
+		// Fewer draws than this per secondary command buffer cost more in submission than they save in recording
+		static constexpr size_t MIN_DRAWS_PER_RECORDER = 256;
+
+		// Graphics pipelines are numbered, material i has slot FIRST_MATERIAL_PIPELINE_SLOT + i
+		static constexpr uint32_t PER_OBJECT_PIPELINE_SLOT = 0;
+		static constexpr uint32_t INSTANCED_PIPELINE_SLOT = 1;
+		static constexpr uint32_t CLUSTER_PIPELINE_SLOT = 2;
+		static constexpr uint32_t FIRST_MATERIAL_PIPELINE_SLOT = 3;
+
+		// constant_id of the vertex shaders' specialization constants
+		static constexpr uint32_t LIGHTING_MODEL_CONSTANT = 0;
+		static constexpr uint32_t AMBIENT_CONSTANT = 1;
+		static constexpr uint32_t OCTAHEDRAL_NORMALS_CONSTANT = 2;
+		static constexpr uint32_t UNIFORM_LIGHTING_CONSTANT = 3;
+
+		struct Material
+		{
+			MaterialState State;
+			PipelineHandle PendingPipeline;
+			// Null until compiled, and for good when compilation failed
+			std::shared_ptr<RenderPipeline> Pipeline;
+		};
+
+		struct PendingReload
+		{
+			uint32_t Slot;
+			PipelineHandle Pipeline;
+		};
+
+		struct RetiredPipeline
+		{
+			std::shared_ptr<RenderPipeline> Pipeline;
+			uint64_t ReleaseFrame;
+		};
+
 		void CreatePipelineLayout(VkDescriptorSetLayout GlobalSetLayout);
 		void CreatePipeline(VkRenderPass RenderPass);
+		void GetPipelineSlotConfig(uint32_t Slot, PipelineConfigInfo& PipelineConfig, std::string& VertProgram, std::string& FragProgram) const;
+		std::shared_ptr<RenderPipeline>& GetPipelineSlot(uint32_t Slot);
+
+		// Creates the slot's pipeline again from its current configuration and shader files
+		void RebuildPipeline(uint32_t Slot, bool Synchronous);
+
+		// Picks up materials and reloads whose pipeline finished compiling. Runs before recording, recording threads
+		// only read the pipelines.
+		void UpdatePipelines();
+		RenderPipeline& GetMaterialPipeline(uint32_t MaterialIndex) const;
+
+		void RenderPerObject(FrameInfo& Info, std::vector<GameObject>& GameObjects);
+		void RenderPerObjectSecondary(FrameInfo& Info, std::vector<GameObject>& GameObjects);
+
+		// Records the draws of m_DrawList[Begin, End), returns the draw count and adds the geometry binds to BindCallCount
+		uint32_t RecordPerObject(VkCommandBuffer CommandBuffer, std::vector<GameObject>& GameObjects, size_t Begin, size_t End, uint32_t& BindCallCount);
+
+		// Binds geometry for DrawMesh unless BoundIndexType shows the bound geometry already serves it, pass
+		// VK_INDEX_TYPE_MAX_ENUM when nothing is bound yet. Returns the number of binds recorded.
+		uint32_t BindGeometry(VkCommandBuffer CommandBuffer, Mesh& DrawMesh, VkIndexType& BoundIndexType);
+
+		std::vector<SecondaryRecorder>& GetSecondaryRecorders(int FrameIndex, uint32_t Count);
+		void RenderInstanced(FrameInfo& Info, std::vector<GameObject>& GameObjects);
+		void RenderIndirect(FrameInfo& Info, std::vector<GameObject>& GameObjects);
+
+		// Fills m_DrawList with the objects to record this frame
+		void BuildDrawList(FrameInfo& Info, const std::vector<GameObject>& GameObjects);
+
+		// Fills m_DrawLods (parallel to m_DrawList) and counts the triangles they draw
+		void SelectLods(FrameInfo& Info, const std::vector<GameObject>& GameObjects);
+
+		// What SelectLods and GPU culling select levels from, a zero error scale when selection is disabled
+		GpuCulling::LodParameters GetLodParameters(const FrameInfo& Info) const;
+
+		// Fills m_Batches and m_ObjectBatches (parallel to ObjectIndices), returns the instance count. ObjectLods is
+		// parallel to ObjectIndices, null draws full detail. Instances of 32 bit indexed meshes come before those of
+		// 16 bit indexed ones. Batch instance counts are left at zero so the caller can use them as fill cursors.
+		uint32_t GroupByMesh(const std::vector<GameObject>& GameObjects, const std::vector<uint32_t>& ObjectIndices, const std::vector<uint32_t>* ObjectLods = nullptr);
+
+		// Swaps in a rebuilt scene once uploaded, releases the replaced one after the frames in flight are done with it
+		// and starts a rebuild into it when the scene was invalidated
+		void UpdateIndirectScene(const std::vector<GameObject>& GameObjects);
+		void BuildIndirectScene(IndirectScene& Scene, const std::vector<GameObject>& GameObjects);
+
+		Buffer& GetInstanceBuffer(int FrameIndex, uint32_t InstanceCount);
 
 		EngineDevice& m_EngineDevice;
 
-		std::unique_ptr<RenderPipeline> m_RenderPipeline;
+		std::shared_ptr<RenderPipeline> m_RenderPipeline;
+		std::shared_ptr<RenderPipeline> m_InstancedRenderPipeline;
+		// Instanced pipeline with back face culling, matching the cone test of cluster culling
+		std::shared_ptr<RenderPipeline> m_ClusterRenderPipeline;
+
+		// Material zero is the default pipeline and has no entry
+		std::vector<Material> m_Materials;
+		uint32_t m_PendingMaterialCount = 0;
+
+		std::vector<PendingReload> m_PendingReloads;
+		std::vector<RetiredPipeline> m_RetiredPipelines;
+		uint64_t m_PreparedFrameCount = 0;
+
+		ShaderVariant m_ShaderVariant;
 
 		VkPipelineLayout m_PipelineLayout;
+		VkRenderPass m_RenderPass;
+
+		RenderMode m_RenderMode = RenderMode::PerObject;
+		RenderStats m_Stats;
+
+		// Indexed by frame index, a buffer is only rewritten once the frame that last read it has completed
+		std::vector<std::unique_ptr<Buffer>> m_InstanceBuffers;
+
+		// Indirect scenes, rebuilt only when invalidated. The other scene is uploading while m_IndirectSceneUploading.
+		IndirectScene m_IndirectScenes[2];
+		uint32_t m_DrawnScene = 0;
+		bool m_IndirectSceneUploading = false;
+		// Describe the game objects the last build saw
+		const GameObject* m_IndirectSceneObjects = nullptr;
+		size_t m_IndirectSceneObjectCount = 0;
+		bool m_IndirectSceneValid = false;
+
+		bool m_GpuCullingEnabled = false;
+		// Set by PrepareFrame when this frame's draws were culled
+		bool m_GpuCullingRecorded = false;
+
+		bool m_ClusterCullingEnabled = false;
+		// Set by PrepareFrame when this frame's draws were culled per meshlet
+		bool m_ClusterCullingRecorded = false;
+
+		bool m_CpuCullingEnabled = false;
+		bool m_BindPerDraw = false;
+
+		bool m_LodSelectionEnabled = true;
+		float m_LodPixelError = 1.0f;
+
+		uint32_t m_RecordThreadCount = 1;
+		// Indexed by frame index, then by recorder
+		std::vector<std::vector<SecondaryRecorder>> m_SecondaryRecorders;
+		std::vector<VkCommandBuffer> m_SecondaryCommandBuffers;
+
+		// Scratch storage reused every frame
+		std::vector<uint32_t> m_DrawList;
+		std::vector<uint32_t> m_DrawLods;
+		SphereSoA m_CullSpheres;
+		std::unordered_map<BatchKey, uint32_t, BatchKeyHash> m_BatchLookup;
+		std::vector<InstanceBatch> m_Batches;
+		std::vector<uint32_t> m_ObjectBatches;
 	};
 }
 
@@ -30,12 +30,14 @@ namespace VulkanTutorial
     {
         Unmap();
         vkDestroyBuffer(m_EngineDevice.Device(), m_Buffer, nullptr);
-        vkFreeMemory(m_EngineDevice.Device(), m_Memory, nullptr);
+        m_EngineDevice.FreeMemory(m_Memory);
     }
 
     /**
      * Map a m_Memory range of this m_Buffer. If successful, m_Mapped points to the specified m_Buffer range.
      *
+     * @note Host visible memory is persistently mapped by the allocator, this only hands out a pointer into it
+     *
      * @param size (Optional) Size of the m_Memory range to Map. Pass VK_WHOLE_SIZE to Map the complete
      * m_Buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -44,22 +46,22 @@ namespace VulkanTutorial
      */
     VkResult Buffer::Map(VkDeviceSize size, VkDeviceSize offset) 
     {
-        assert(m_Buffer && m_Memory && "Called Map on m_Buffer before create");
-        return vkMapMemory(m_EngineDevice.Device(), m_Memory, offset, size, 0, &m_Mapped);
+        assert(m_Buffer && m_Memory.Memory && "Called Map on m_Buffer before create");
+        if (!m_Memory.Mapped)
+            return VK_ERROR_MEMORY_MAP_FAILED;
+
+        m_Mapped = (char*)m_Memory.Mapped + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a m_Mapped m_Memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The memory stays mapped until the allocator releases its block
      */
     void Buffer::Unmap() 
     {
-        if (m_Mapped)
-        {
-            vkUnmapMemory(m_EngineDevice.Device(), m_Memory);
-            m_Mapped = nullptr;
-        }
+        m_Mapped = nullptr;
     }
 
     /**
@@ -71,7 +73,7 @@ namespace VulkanTutorial
      * @param offset (Optional) Byte offset from beginning of m_Mapped region
      *
      */
-    void Buffer::WriteToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset) 
+    void Buffer::WriteToBuffer(const void* data, VkDeviceSize size, VkDeviceSize offset) 
     {
         assert(m_Mapped && "Cannot copy to unmapped m_Buffer");
 
@@ -100,11 +102,7 @@ namespace VulkanTutorial
      */
     VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset) 
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = m_Memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        VkMappedMemoryRange mappedRange = m_EngineDevice.GetMemoryAllocator().GetMappedRange(m_Memory, size, offset);
         return vkFlushMappedMemoryRanges(m_EngineDevice.Device(), 1, &mappedRange);
     }
 
@@ -121,11 +119,7 @@ namespace VulkanTutorial
      */
     VkResult Buffer::Invalidate(VkDeviceSize size, VkDeviceSize offset) 
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = m_Memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        VkMappedMemoryRange mappedRange = m_EngineDevice.GetMemoryAllocator().GetMappedRange(m_Memory, size, offset);
         return vkInvalidateMappedMemoryRanges(m_EngineDevice.Device(), 1, &mappedRange);
     }
 
@@ -149,7 +143,7 @@ namespace VulkanTutorial
      * @param index Used in offset GetUsageFlags
      *
      */
-    void Buffer::WriteToIndex(void* data, int index) 
+    void Buffer::WriteToIndex(const void* data, int index) 
     {
         WriteToBuffer(data, m_InstanceSize, index * m_AlignmentSize);
     }
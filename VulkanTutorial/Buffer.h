@@ -22,12 +22,12 @@ namespace VulkanTutorial
 		VkResult Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		void Unmap();
 
-		void WriteToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+		void WriteToBuffer(const void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		VkResult Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		VkDescriptorBufferInfo DescriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		VkResult Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
-		void WriteToIndex(void* data, int index);
+		void WriteToIndex(const void* data, int index);
 		VkResult FlushIndex(int index);
 		VkDescriptorBufferInfo DescriptorInfoForIndex(int index);
 		VkResult InvalidateIndex(int index);
@@ -47,7 +47,7 @@ namespace VulkanTutorial
 		EngineDevice& m_EngineDevice;
 		void* m_Mapped = nullptr;
 		VkBuffer m_Buffer = VK_NULL_HANDLE;
-		VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+		GpuAllocation m_Memory;
 
 		VkDeviceSize m_BufferSize;
 		uint32_t m_InstanceCount;
@@ -56,6 +56,8 @@ namespace VulkanTutorial
 		m_ViewMatrix[3][0] = -glm::dot(u, Pos);
 		m_ViewMatrix[3][1] = -glm::dot(v, Pos);
 		m_ViewMatrix[3][2] = -glm::dot(w, Pos);
+
+		m_Position = Pos;
 	}
 
 	void Camera::SetViewTarget(glm::vec3 Pos, glm::vec3 Target, glm::vec3 Up)
@@ -87,5 +89,7 @@ namespace VulkanTutorial
 		m_ViewMatrix[3][0] = -glm::dot(u, Pos);
 		m_ViewMatrix[3][1] = -glm::dot(v, Pos);
 		m_ViewMatrix[3][2] = -glm::dot(w, Pos);
+
+		m_Position = Pos;
 	}
 }
\ No newline at end of file
@@ -27,10 +27,17 @@ namespace VulkanTutorial
 
 		const glm::mat4& GetProjectionMatrix() const { return m_ProjectionMatrix; }
 		const glm::mat4& GetViewMatrix() const { return m_ViewMatrix; }
+		const glm::vec3& GetPosition() const { return m_Position; }
+		// Direction the camera looks in, the view space z axis
+		glm::vec3 GetForward() const { return glm::vec3(m_ViewMatrix[0][2], m_ViewMatrix[1][2], m_ViewMatrix[2][2]); }
+
+		// Orthographic projections scale the same at every distance
+		bool IsPerspective() const { return m_ProjectionMatrix[2][3] != 0.0f; }
 	private:
 
 		glm::mat4 m_ProjectionMatrix{1.0f};
 		glm::mat4 m_ViewMatrix{ 1.0f };
+		glm::vec3 m_Position{ 0.0f };
 	};
 }
 
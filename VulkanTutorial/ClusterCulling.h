@@ -0,0 +1,135 @@
+#ifndef __ClusterCulling_h__
+#define __ClusterCulling_h__
+
+#include "EngineDevice.h"
+#include "Buffer.h"
+#include "Descriptors.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Compute pass culling the meshlets of every object. One workgroup per object rejects objects outside the frustum,
+	// then tests each meshlet's bounding sphere against the frustum and its normal cone against the camera. Surviving
+	// meshlets are compacted into their batch's range of a per frame command buffer as plain indexed indirect draws,
+	// so no mesh shader support is needed.
+	class ClusterCulling
+	{
+	public:
+
+		// Matches ClusterObject in CullClusters.comp
+		struct ClusterObject
+		{
+			// Mesh space to world space, meshlet bounds are stored in mesh space
+			glm::mat4 ModelMatrix;
+			// World space center in xyz, radius in w
+			glm::vec4 Sphere;
+			// Meshlets of the object's mesh in the meshlet table
+			uint32_t MeshletBase;
+			uint32_t MeshletCount;
+			uint32_t BatchIndex;
+			// First command of the batch in the output command buffer
+			uint32_t CommandBase;
+			uint32_t InstanceSlot;
+			// Mesh position inside the geometry pool
+			int32_t VertexOffset;
+			// Largest axis scale of the model matrix, scales meshlet radii
+			float MaxScale;
+			// Normal cones only survive rotations and uniform positive scales, zero skips the back face test
+			uint32_t ConeCulling;
+		};
+
+		// Matches ClusterMeshlet in CullClusters.comp
+		struct ClusterMeshlet
+		{
+			// Mesh space center in xyz, radius in w
+			glm::vec4 Sphere;
+			// Mesh space axis in xyz, cutoff in w, a cutoff of one is never back facing
+			glm::vec4 Cone;
+			// Inside the geometry pool's index buffer
+			uint32_t FirstIndex;
+			uint32_t IndexCount;
+			uint32_t Padding[2];
+		};
+
+		struct CullStats
+		{
+			// Meshlets of objects inside the frustum
+			uint32_t TestedCount = 0;
+			uint32_t VisibleCount = 0;
+			uint32_t TriangleCount = 0;
+			// Meshlets rejected by their normal cone
+			uint32_t BackfacingCount = 0;
+		};
+
+		static constexpr uint32_t MAX_FRAMES = 8;
+
+		ClusterCulling(EngineDevice& Device);
+		virtual ~ClusterCulling();
+
+		ClusterCulling(const ClusterCulling&) = delete;
+		ClusterCulling& operator = (const ClusterCulling&) = delete;
+
+		ClusterCulling(ClusterCulling&&) = delete;
+		ClusterCulling& operator = (ClusterCulling&&) = delete;
+
+		// Uploads the objects to cull and the meshlet table they index through the device's UploadManager, Cull may
+		// only be recorded once the next Flush's ticket is complete. CommandCapacity is the size of the output command
+		// array and BatchCount the number of draw counters. No frame in flight may still use the previous scene, per
+		// frame buffers are recreated on next use.
+		void SetScene(const std::vector<ClusterObject>& Objects, const std::vector<ClusterMeshlet>& Meshlets, uint32_t CommandCapacity, uint32_t BatchCount);
+
+		// Records the counter reset, the dispatch and the barrier that makes the results visible to indirect draws.
+		// Must be recorded outside of a render pass. CameraForward is only used by orthographic projections.
+		void Cull(VkCommandBuffer CommandBuffer, int FrameIndex, const Frustum& ViewFrustum, const glm::vec3& CameraPosition, const glm::vec3& CameraForward, bool Perspective);
+
+		VkBuffer GetCommandBuffer(int FrameIndex) const { return m_Frames[FrameIndex].Commands->GetBuffer(); }
+		VkBuffer GetCountBuffer(int FrameIndex) const { return m_Frames[FrameIndex].Counters->GetBuffer(); }
+
+		// Byte offset of the draw count of a batch inside the count buffer
+		static VkDeviceSize GetCountOffset(uint32_t BatchIndex) { return (COUNTER_HEADER_SIZE + BatchIndex) * sizeof(uint32_t); }
+
+		// Counters of the most recently completed cull, they lag a few frames behind
+		const CullStats& GetStats() const { return m_Stats; }
+
+	private:
+
+		// testedCount, visibleCount, triangleCount and backfacingCount precede the per batch draw counts
+		static constexpr uint32_t COUNTER_HEADER_SIZE = 4;
+
+		struct FrameResources
+		{
+			std::unique_ptr<Buffer> Counters;
+			std::unique_ptr<Buffer> Commands;
+			std::unique_ptr<Buffer> Readback;
+			VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+			bool HasResults = false;
+		};
+
+		void CreatePipeline();
+		FrameResources& GetFrame(int FrameIndex);
+
+		EngineDevice& m_EngineDevice;
+
+		std::unique_ptr<DescriptorSetLayout> m_SetLayout;
+		std::unique_ptr<DescriptorPool> m_DescriptorPool;
+		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+		VkShaderModule m_ShaderModule = VK_NULL_HANDLE;
+
+		std::unique_ptr<Buffer> m_Objects;
+		std::unique_ptr<Buffer> m_Meshlets;
+		uint32_t m_ObjectCount = 0;
+		uint32_t m_CommandCapacity = 0;
+		uint32_t m_BatchCount = 0;
+
+		FrameResources m_Frames[MAX_FRAMES];
+		CullStats m_Stats;
+	};
+}
+
+#endif //__ClusterCulling_h__
\ No newline at end of file
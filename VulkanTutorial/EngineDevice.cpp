@@ -1,4 +1,7 @@
 #include "EngineDevice.h"
+#include "UploadManager.h"
+#include "GeometryPool.h"
+#include "PipelineLibrary.h"
 
 // std headers
 #include <cstring>
@@ -54,10 +57,41 @@ namespace VulkanTutorial
         PickPhysicalDevice();
         CreateLogicalDevice();
         CreateCommandPool();
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+        m_MemoryBackend = std::make_unique<VulkanMemoryBackend>(m_Device);
+        m_MemoryAllocator = std::make_unique<GpuMemoryAllocator>(*m_MemoryBackend, memoryProperties, m_PhysicalDeviceProperties.limits);
+
+        m_UploadManager = std::make_unique<UploadManager>(*this);
+        m_GeometryPool = std::make_unique<GeometryPool>(*this);
+
+        m_PipelineCache = std::make_unique<PipelineCache>(m_Device, m_PhysicalDeviceProperties);
+        if (m_PipelineCache->GetLoadedSize() > 0)
+            std::cout << "Pipeline cache: loaded " << m_PipelineCache->GetLoadedSize() << " bytes" << std::endl;
+        else
+            std::cout << "Pipeline cache: cold start" << std::endl;
+
+        m_PipelineLibrary = std::make_unique<PipelineLibrary>(*this);
     }
 
     EngineDevice::~EngineDevice() 
     {
+        m_PipelineLibrary.reset();
+
+        // Written on every shutdown so the next launch creates its pipelines warm
+        if (!m_PipelineCache->Save())
+            std::cout << "Failed to save pipeline cache" << std::endl;
+        m_PipelineCache.reset();
+
+        // Pending copies may still target the geometry pool buffers
+        m_UploadManager->WaitIdle();
+        m_GeometryPool.reset();
+        m_UploadManager.reset();
+        m_MemoryAllocator.reset();
+        m_MemoryBackend.reset();
+
+        vkDestroyCommandPool(m_Device, m_UploadCommandPool, nullptr);
         vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
         vkDestroyDevice(m_Device, nullptr);
 
@@ -144,6 +178,8 @@ namespace VulkanTutorial
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {indices.GraphicsFamily, indices.PresentFamily};
+        if (indices.TransferFamilyHasValue)
+            uniqueQueueFamilies.insert(indices.TransferFamily);
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) 
@@ -156,18 +192,32 @@ namespace VulkanTutorial
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+        // Optional, used by the indirect render path when present
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        // Optional extensions are enabled when present, callers check the matching query
+        std::vector<const char *> enabledExtensions = m_DeviceExtensions;
+
+        m_DrawIndirectCountSupported = IsDeviceExtensionSupported(m_PhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (m_DrawIndirectCountSupported)
+            enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(m_DeviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -184,21 +234,41 @@ namespace VulkanTutorial
         if (vkCreateDevice(m_PhysicalDevice, &createInfo, nullptr, &m_Device) != VK_SUCCESS)
             throw std::runtime_error("failed to create logical device!");
 
+        m_EnabledFeatures = deviceFeatures;
+
+        if (m_DrawIndirectCountSupported)
+            m_CmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_Device, "vkCmdDrawIndexedIndirectCountKHR");
+
         vkGetDeviceQueue(m_Device, indices.GraphicsFamily, 0, &m_GraphicsQueue);
         vkGetDeviceQueue(m_Device, indices.PresentFamily, 0, &m_PresentQueue);
+
+        m_GraphicsQueueFamily = indices.GraphicsFamily;
+        m_TransferQueueFamily = indices.TransferFamilyHasValue ? indices.TransferFamily : indices.GraphicsFamily;
+        vkGetDeviceQueue(m_Device, m_TransferQueueFamily, 0, &m_TransferQueue);
     }
 
     void EngineDevice::CreateCommandPool() 
+    {
+        m_CommandPool = CreateGraphicsCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+        // Kept apart from the frame pools so uploads never contend with or reset frame recording
+        m_UploadCommandPool = CreateGraphicsCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+
+    VkCommandPool EngineDevice::CreateGraphicsCommandPool(VkCommandPoolCreateFlags flags)
     {
         QueueFamilyIndices queueFamilyIndices = FindPhysicalQueueFamilies();
 
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.GraphicsFamily;
-        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.flags = flags;
 
-        if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS)
+        VkCommandPool commandPool;
+        if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
             throw std::runtime_error("failed to create command pool!");
+
+        return commandPool;
     }
 
     void EngineDevice::CreateSurface() 
@@ -329,6 +399,23 @@ namespace VulkanTutorial
         return requiredExtensions.empty();
     }
 
+    bool EngineDevice::IsDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto &extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, extensionName) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
     QueueFamilyIndices EngineDevice::FindQueueFamilies(VkPhysicalDevice device) 
     {
         QueueFamilyIndices indices;
@@ -345,6 +432,7 @@ namespace VulkanTutorial
             if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) 
             {
                 indices.GraphicsFamily = i;
+                indices.GraphicsTimestampValidBits = queueFamily.timestampValidBits;
                 indices.GraphicsFamilyHasValue = true;
             }
 
@@ -363,6 +451,24 @@ namespace VulkanTutorial
             i++;
         }
 
+        // Prefer a family with nothing but transfer (the DMA engines), then any non graphics family that can transfer
+        for (int pass = 0; pass < 2 && !indices.TransferFamilyHasValue; pass++)
+        {
+            for (uint32_t family = 0; family < queueFamilyCount; family++)
+            {
+                const VkQueueFlags flags = queueFamilies[family].queueFlags;
+                const bool canTransfer = (flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+                const bool isDedicated = pass == 0 ? (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0 : (flags & VK_QUEUE_GRAPHICS_BIT) == 0;
+
+                if (queueFamilies[family].queueCount > 0 && canTransfer && isDedicated)
+                {
+                    indices.TransferFamily = family;
+                    indices.TransferFamilyHasValue = true;
+                    break;
+                }
+            }
+        }
+
         return indices;
     }
 
@@ -422,7 +528,7 @@ namespace VulkanTutorial
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
-    void EngineDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties, VkBuffer &buffer, VkDeviceMemory &bufferMemory) 
+    void EngineDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties, VkBuffer &buffer, GpuAllocation &bufferMemory) 
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -432,22 +538,24 @@ namespace VulkanTutorial
         bufferInfo.flags = 0;
         bufferInfo.pNext = nullptr;
 
+        // Concurrent sharing avoids queue family ownership transfers between the upload and the first draw
+        const uint32_t queueFamilies[] = {m_GraphicsQueueFamily, m_TransferQueueFamily};
+        if (HasDedicatedTransferQueue() && (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+        {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilies;
+        }
+
         if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
             throw std::runtime_error("failed to create vertex buffer!");
 
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, memoryProperties);
-        allocInfo.pNext = nullptr;
-
-        if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+        bufferMemory = m_MemoryAllocator->Allocate(memRequirements, memoryProperties, GpuMemoryAllocator::ResourceKind::Linear);
 
-        vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
+        vkBindBufferMemory(m_Device, buffer, bufferMemory.Memory, bufferMemory.Offset);
     }
 
     VkCommandBuffer EngineDevice::BeginSingleTimeCommands() 
@@ -455,7 +563,7 @@ namespace VulkanTutorial
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = m_CommandPool;
+        allocInfo.commandPool = m_UploadCommandPool;
         allocInfo.commandBufferCount = 1;
 
         VkCommandBuffer commandBuffer;
@@ -481,7 +589,7 @@ namespace VulkanTutorial
         vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
         vkQueueWaitIdle(m_GraphicsQueue);
 
-        vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
+        vkFreeCommandBuffers(m_Device, m_UploadCommandPool, 1, &commandBuffer);
     }
 
     void EngineDevice::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) 
@@ -519,7 +627,7 @@ namespace VulkanTutorial
         EndSingleTimeCommands(commandBuffer);
     }
 
-    void EngineDevice::CreateImageWithInfo(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags memoryProperties, VkImage &image, VkDeviceMemory &imageMemory) 
+    void EngineDevice::CreateImageWithInfo(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags memoryProperties, VkImage &image, GpuAllocation &imageMemory) 
     {
         if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS) 
             throw std::runtime_error("failed to create image!");
@@ -527,15 +635,11 @@ namespace VulkanTutorial
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, memoryProperties);
-
-        if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate image memory!");
+        // Linear images follow the same granularity rules as buffers and may share their blocks
+        const GpuMemoryAllocator::ResourceKind kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? GpuMemoryAllocator::ResourceKind::Linear : GpuMemoryAllocator::ResourceKind::Optimal;
+        imageMemory = m_MemoryAllocator->Allocate(memRequirements, memoryProperties, kind);
 
-        if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS)
+        if (vkBindImageMemory(m_Device, image, imageMemory.Memory, imageMemory.Offset) != VK_SUCCESS)
             throw std::runtime_error("failed to bind image memory!");
     }
 } 
\ No newline at end of file
@@ -2,12 +2,19 @@
 #define __EngineDevice_h__
 
 #include "MyWindow.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace VulkanTutorial 
 {
+    class UploadManager;
+    class GeometryPool;
+    class PipelineLibrary;
+
     struct SwapChainSupportDetails 
     {
         VkSurfaceCapabilitiesKHR Capabilities;
@@ -19,8 +26,13 @@ namespace VulkanTutorial
     {
         uint32_t GraphicsFamily;
         uint32_t PresentFamily;
+        // Transfer only family, uploads run on the graphics queue when the device has none
+        uint32_t TransferFamily;
+        // Zero when the graphics queue can not write timestamps
+        uint32_t GraphicsTimestampValidBits = 0;
         bool GraphicsFamilyHasValue = false;
         bool PresentFamilyHasValue = false;
+        bool TransferFamilyHasValue = false;
         bool IsComplete() { return GraphicsFamilyHasValue && PresentFamilyHasValue; }
     };
 
@@ -42,26 +54,48 @@ namespace VulkanTutorial
         EngineDevice& operator = (EngineDevice &&) = delete;
 
         VkCommandPool GetCommandPool() { return m_CommandPool; }
+
+        // Pool on the graphics queue family owned by the caller, e.g. per frame pools reset with vkResetCommandPool
+        VkCommandPool CreateGraphicsCommandPool(VkCommandPoolCreateFlags flags);
         VkDevice Device() { return m_Device; }
         VkSurfaceKHR Surface() { return m_Surface; }
         VkQueue GraphicsQueue() { return m_GraphicsQueue; }
         VkQueue PresentQueue() { return m_PresentQueue; }
+        VkQueue TransferQueue() { return m_TransferQueue; }
+        uint32_t TransferQueueFamily() const { return m_TransferQueueFamily; }
+        bool HasDedicatedTransferQueue() const { return m_TransferQueue != m_GraphicsQueue; }
+
+        UploadManager& GetUploadManager() { return *m_UploadManager; }
+        GeometryPool& GetGeometryPool() { return *m_GeometryPool; }
+        GpuMemoryAllocator& GetMemoryAllocator() { return *m_MemoryAllocator; }
+
+        // Pass GetPipelineCache().GetPipelineCache() to every vkCreate*Pipelines, it is saved on destruction
+        PipelineCache& GetPipelineCache() { return *m_PipelineCache; }
+        PipelineLibrary& GetPipelineLibrary() { return *m_PipelineLibrary; }
 
         SwapChainSupportDetails GetSwapChainSupport() { return QuerySwapChainSupport(m_PhysicalDevice); }
         uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags memoryProperties);
         QueueFamilyIndices FindPhysicalQueueFamilies() { return FindQueueFamilies(m_PhysicalDevice); }
         VkFormat FindSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
-        // Buffer Helper Functions
-        void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
+        // Buffer Helper Functions, single time commands come from a dedicated upload pool. Buffers that can be a
+        // transfer destination are shared with the transfer queue family so UploadManager can fill them. Memory is
+        // sub-allocated by GetMemoryAllocator(), release it with FreeMemory after destroying the buffer or image.
+        void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties, VkBuffer &buffer, GpuAllocation &bufferMemory);
         VkCommandBuffer BeginSingleTimeCommands();
         void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
         void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
         void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
-        void CreateImageWithInfo(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags memoryProperties, VkImage &image, VkDeviceMemory &imageMemory);
+        void CreateImageWithInfo(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags memoryProperties, VkImage &image, GpuAllocation &imageMemory);
+        void FreeMemory(GpuAllocation &memory) { m_MemoryAllocator->Free(memory); }
 
         const VkPhysicalDeviceProperties& PhysicalDeviceProperties() const { return m_PhysicalDeviceProperties; }
+        const VkPhysicalDeviceFeatures& EnabledFeatures() const { return m_EnabledFeatures; }
+
+        // VK_KHR_draw_indirect_count, the function is null when the extension is not available
+        bool SupportsDrawIndirectCount() const { return m_DrawIndirectCountSupported; }
+        PFN_vkCmdDrawIndexedIndirectCountKHR CmdDrawIndexedIndirectCount() const { return m_CmdDrawIndexedIndirectCount; }
     
     private:
 
@@ -80,20 +114,35 @@ namespace VulkanTutorial
         void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
         void HasGflwRequiredInstanceExtensions();
         bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+        bool IsDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName);
         SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
 
         VkPhysicalDeviceProperties m_PhysicalDeviceProperties;
+        VkPhysicalDeviceFeatures m_EnabledFeatures = {};
+        bool m_DrawIndirectCountSupported = false;
+        PFN_vkCmdDrawIndexedIndirectCountKHR m_CmdDrawIndexedIndirectCount = nullptr;
 
         VkInstance m_VKInstance;
         VkDebugUtilsMessengerEXT m_DebugMessenger;
         VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
         MyWindow &m_Window;
         VkCommandPool m_CommandPool;
+        VkCommandPool m_UploadCommandPool;
 
         VkDevice m_Device;
         VkSurfaceKHR m_Surface;
         VkQueue m_GraphicsQueue;
         VkQueue m_PresentQueue;
+        VkQueue m_TransferQueue;
+        uint32_t m_GraphicsQueueFamily;
+        uint32_t m_TransferQueueFamily;
+
+        std::unique_ptr<VulkanMemoryBackend> m_MemoryBackend;
+        std::unique_ptr<GpuMemoryAllocator> m_MemoryAllocator;
+        std::unique_ptr<UploadManager> m_UploadManager;
+        std::unique_ptr<GeometryPool> m_GeometryPool;
+        std::unique_ptr<PipelineCache> m_PipelineCache;
+        std::unique_ptr<PipelineLibrary> m_PipelineLibrary;
 
         const std::vector<const char *> m_ValidationLayers = {"VK_LAYER_KHRONOS_validation"};
         const std::vector<const char *> m_DeviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -2,6 +2,10 @@
 #include "BasicRenderSystem.h"
 
 #include "Buffer.h"
+#include "UploadManager.h"
+#include "GeometryPool.h"
+#include "PipelineLibrary.h"
+#include "ShaderWatcher.h"
 
 #include <stdexcept>
 #include <array>
@@ -10,6 +14,10 @@
 #include <glm/gtc/constants.hpp>
 #include "KeyboardController.h"
 #include <numeric>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <string>
 
 namespace VulkanTutorial
 {
@@ -17,17 +25,47 @@ namespace VulkanTutorial
 	{
 		alignas(16) glm::mat4 projectionMatrix{ 1.0f };
 		alignas(16) glm::vec3 lightDirection = glm::normalize(glm::vec3{1.0f, -3.0f, -1.0f});
+		// Only read by the uniform lighting shader variant, the others have them specialized in
+		uint32_t lightingModel = 1;
+		float ambient = 0.02f;
 	};
 
-	EngineMain::EngineMain()
+	static void PrintFrameTimeReport(const char* Name, std::vector<float> FrameTimesMs)
 	{
-		const int ImageCount = m_Renderer.GetSwapChainImageCount();
+		if (FrameTimesMs.empty())
+			return;
+
+		std::sort(FrameTimesMs.begin(), FrameTimesMs.end());
+		auto Percentile = [&FrameTimesMs](float P) { return FrameTimesMs[std::min(FrameTimesMs.size() - 1, (size_t)(P * FrameTimesMs.size()))]; };
+
+		const float Median = Percentile(0.5f);
+		const size_t SpikeCount = FrameTimesMs.end() - std::upper_bound(FrameTimesMs.begin(), FrameTimesMs.end(), 2.0f * Median);
+
+		std::cout << Name << " : " << FrameTimesMs.size() << " frames, " << std::accumulate(FrameTimesMs.begin(), FrameTimesMs.end(), 0.0f) / FrameTimesMs.size() << " ms average, "
+			<< Median << " ms p50, " << Percentile(0.9f) << " ms p90, " << Percentile(0.99f) << " ms p99, " << Percentile(0.999f) << " ms p99.9, "
+			<< FrameTimesMs.back() << " ms max, " << SpikeCount << " frames above twice the median" << std::endl;
+	}
+
+	EngineMain::EngineMain(uint32_t StressObjectCount, StressLayout Layout, uint32_t FramesInFlight, bool UniqueMeshes, VertexFormat MeshVertexFormat, uint32_t CorridorAssetCount
+		, VkDeviceSize ResidencyBudget)
+		: m_Renderer(m_MyWindow, m_EngineDevice, FramesInFlight)
+	{
+		// Before any mesh is created, render systems pick their pipelines from it in Run
+		m_EngineDevice.GetGeometryPool().SetVertexFormat(MeshVertexFormat);
+
 		m_GlobalDescriptorPool = DescriptorPool::Builder(m_EngineDevice)
-			.SetMaxSets(ImageCount)
-			.AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, ImageCount)
+			.SetMaxSets(EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
 			.Build();
 
-		LoadGameObjects();
+		CreateAssetStreamer(ResidencyBudget);
+
+		if (StressObjectCount > 0 && Layout == StressLayout::Corridor)
+			LoadCorridorScene(StressObjectCount, CorridorAssetCount);
+		else if (StressObjectCount > 0)
+			LoadStressScene(StressObjectCount, Layout, UniqueMeshes);
+		else
+			LoadGameObjects();
 	}
 
 	EngineMain::~EngineMain()
@@ -35,16 +73,17 @@ namespace VulkanTutorial
 		
 	}
 
-	void EngineMain::Run()
+	void EngineMain::Run(const RunSettings& Settings)
 	{
 		// Find lowest common multiple
 		//auto MinOffsetAlighment = std::lcm(m_EngineDevice.PhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment
 		//	, m_EngineDevice.PhysicalDeviceProperties().limits.nonCoherentAtomSize);
 
 
-		const int ImageCount = m_Renderer.GetSwapChainImageCount();
-		std::vector<std::unique_ptr<Buffer>> UboBuffers(ImageCount);
-		for (int i = 0; i < ImageCount; i++)
+		// One uniform buffer and descriptor set per frame slot, allocated for the maximum so F can switch at runtime
+		const int FrameSlotCount = EngineSwapChain::MAX_FRAMES_IN_FLIGHT;
+		std::vector<std::unique_ptr<Buffer>> UboBuffers(FrameSlotCount);
+		for (int i = 0; i < FrameSlotCount; i++)
 		{
 			UboBuffers[i] = std::make_unique<Buffer>(m_EngineDevice, sizeof(GlobalUBO)
 				, 1
@@ -58,8 +97,8 @@ namespace VulkanTutorial
 			.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
 			.Build();
 
-		std::vector<VkDescriptorSet> GlobalDescriptorSets(ImageCount);
-		for (int i = 0; i < ImageCount; i++)
+		std::vector<VkDescriptorSet> GlobalDescriptorSets(FrameSlotCount);
+		for (int i = 0; i < FrameSlotCount; i++)
 		{
 			auto BufferInfo = UboBuffers[i]->DescriptorInfo();
 			DescriptorWriter(*GlobalDescriptorSetLayout, *m_GlobalDescriptorPool)
@@ -74,20 +113,212 @@ namespace VulkanTutorial
 		auto ViewerObject = GameObject::CreateGameObject();
 		KeyboardController CameraController;
 
+		const bool Scripted = Settings.FrameCount > 0;
+		uint32_t ScriptedFrame = 0;
+		std::vector<float> FrameTimesMs;
+		FrameTimesMs.reserve(Settings.FrameCount);
+		float RunRecordTimeMs = 0.0f;
+		uint32_t RunRecordedFrameCount = 0;
+		float RunLatencyMs = 0.0f;
+		uint32_t RunLatencyFrameCount = 0;
+
+		if (Settings.FramesInFlight > 0)
+			m_Renderer.SetFramesInFlight(Settings.FramesInFlight);
+
+		// Instanced drawing with CPU culling measures streaming alone, the indirect scene adds a background rebuild
+		// after every residency change
+		if (Settings.Flythrough && Settings.FlythroughIndirect)
+		{
+			SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::Indirect);
+			SimpleRenderSystem.SetGpuCulling(true);
+		}
+		else if (Settings.Flythrough)
+		{
+			SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::Instanced);
+			SimpleRenderSystem.SetCpuCulling(true);
+		}
+
+		// With instanced drawing the GPU rather than command recording limits large scenes
+		if (Settings.Instanced)
+			SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::Instanced);
+
+		if (Settings.RecordThreadCount > 0)
+			SimpleRenderSystem.SetRecordThreadCount(Settings.RecordThreadCount);
+
+		if (Settings.UniformLighting)
+		{
+			BasicRenderSystem::ShaderVariant Variant = SimpleRenderSystem.GetShaderVariant();
+			Variant.UniformLighting = true;
+			SimpleRenderSystem.SetShaderVariant(Variant, true);
+		}
+
+		// Specialized variants compile new pipelines, the uniform variant only writes other GlobalUBO values
+		auto CycleLightingModel = [&SimpleRenderSystem]()
+		{
+			BasicRenderSystem::ShaderVariant Variant = SimpleRenderSystem.GetShaderVariant();
+			Variant.Lighting = (BasicRenderSystem::LightingModel)(((uint32_t)Variant.Lighting + 1) % BasicRenderSystem::LIGHTING_MODEL_COUNT);
+			SimpleRenderSystem.SetShaderVariant(Variant);
+		};
+
+		// Materials are only drawn per object
+		const bool MaterialBurst = Scripted && Settings.MaterialBurstCount > 0;
+		const uint32_t MaterialBurstFrame = Settings.FrameCount / 2;
+		size_t MaterialBurstSample = 0;
+		uint32_t MaterialsReadyFrame = 0;
+		float MaterialsReadyMs = 0.0f;
+		auto MaterialBurstTime = std::chrono::high_resolution_clock::now();
+		if (MaterialBurst)
+			SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::PerObject);
+
+		// Edited shaders are recompiled and swapped in while running, scripted runs keep theirs fixed
+		std::unique_ptr<ShaderWatcher> Watcher;
+		if (!Scripted)
+			Watcher = std::make_unique<ShaderWatcher>();
+
+		bool PipelinesRebuilding = false;
+		auto PipelineRebuildTime = std::chrono::high_resolution_clock::now();
+
 		auto CurrentTime = std::chrono::high_resolution_clock::now();
 
-		while (m_MyWindow.IsOpen())
+		// Tab cycles the render path, G toggles GPU culling, C toggles CPU culling, F cycles 1 to 3 frames in flight,
+		// T doubles the per object recording threads, B toggles binding geometry per draw, L toggles level of detail
+		// selection, K toggles cluster culling, V cycles the lighting model, statistics are averaged and printed once per
+		// second
+		bool RenderModeKeyDown = false;
+		bool CullingKeyDown = false;
+		bool CpuCullingKeyDown = false;
+		bool FramesInFlightKeyDown = false;
+		bool RecordThreadsKeyDown = false;
+		bool BindPerDrawKeyDown = false;
+		bool LodKeyDown = false;
+		bool ClusterKeyDown = false;
+		bool LightingKeyDown = false;
+		auto WasKeyPressed = [this](int Key, bool& KeyDown)
+		{
+			const bool Pressed = glfwGetKey(m_MyWindow.GetGLFWwindow(), Key) == GLFW_PRESS;
+			const bool JustPressed = Pressed && !KeyDown;
+			KeyDown = Pressed;
+			return JustPressed;
+		};
+
+		float StatsTime = 0.0f;
+		float StatsRecordTimeMs = 0.0f;
+		float StatsLatencyMs = 0.0f;
+		float StatsCommandOverheadMs = 0.0f;
+		uint32_t StatsFrameCount = 0;
+		UploadManager::Stats StatsUploadStart = m_EngineDevice.GetUploadManager().GetStats();
+
+		while (m_MyWindow.IsOpen() && (!Scripted || ScriptedFrame < Settings.FrameCount))
 		{
 			glfwPollEvents();
+			m_Renderer.MarkInputSampled();
+
+			// Submits the uploads queued since the last frame, meshes become drawable once their batch completes
+			m_EngineDevice.GetUploadManager().Update();
+			m_EngineDevice.GetGeometryPool().Update();
+
+			if (WasKeyPressed(GLFW_KEY_TAB, RenderModeKeyDown))
+			{
+				switch (SimpleRenderSystem.GetRenderMode())
+				{
+				case BasicRenderSystem::RenderMode::PerObject: SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::Instanced); break;
+				case BasicRenderSystem::RenderMode::Instanced: SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::Indirect); break;
+				case BasicRenderSystem::RenderMode::Indirect: SimpleRenderSystem.SetRenderMode(BasicRenderSystem::RenderMode::PerObject); break;
+				}
+			}
+
+			if (WasKeyPressed(GLFW_KEY_G, CullingKeyDown))
+				SimpleRenderSystem.SetGpuCulling(!SimpleRenderSystem.IsGpuCullingEnabled());
+
+			if (WasKeyPressed(GLFW_KEY_C, CpuCullingKeyDown))
+				SimpleRenderSystem.SetCpuCulling(!SimpleRenderSystem.IsCpuCullingEnabled());
+
+			if (WasKeyPressed(GLFW_KEY_F, FramesInFlightKeyDown))
+				m_Renderer.SetFramesInFlight(m_Renderer.GetFramesInFlight() % EngineSwapChain::MAX_FRAMES_IN_FLIGHT + 1);
+
+			if (WasKeyPressed(GLFW_KEY_T, RecordThreadsKeyDown))
+			{
+				const uint32_t RecordThreadCount = SimpleRenderSystem.GetRecordThreadCount() * 2;
+				SimpleRenderSystem.SetRecordThreadCount(RecordThreadCount <= BasicRenderSystem::GetMaxRecordThreadCount() ? RecordThreadCount : 1);
+			}
+
+			if (WasKeyPressed(GLFW_KEY_B, BindPerDrawKeyDown))
+				SimpleRenderSystem.SetBindPerDraw(!SimpleRenderSystem.IsBindPerDrawEnabled());
+
+			if (WasKeyPressed(GLFW_KEY_L, LodKeyDown))
+				SimpleRenderSystem.SetLodSelection(!SimpleRenderSystem.IsLodSelectionEnabled());
+
+			if (WasKeyPressed(GLFW_KEY_K, ClusterKeyDown))
+				SimpleRenderSystem.SetClusterCulling(!SimpleRenderSystem.IsClusterCullingEnabled());
+
+			if (WasKeyPressed(GLFW_KEY_V, LightingKeyDown))
+			{
+				CycleLightingModel();
+				std::cout << "Lighting : " << BasicRenderSystem::GetLightingModelName(SimpleRenderSystem.GetShaderVariant().Lighting) << ", rebuilding "
+					<< SimpleRenderSystem.GetPendingReloadCount() << " pipelines" << std::endl;
+				PipelinesRebuilding = PipelinesRebuilding || SimpleRenderSystem.GetPendingReloadCount() > 0;
+				PipelineRebuildTime = std::chrono::high_resolution_clock::now();
+			}
 
 			auto NewTime = std::chrono::high_resolution_clock::now();
 			float FrameTime = std::chrono::duration<float, std::chrono::seconds::period>(NewTime - CurrentTime).count();
 			CurrentTime = NewTime;
 
+			// The first frame also measures everything before the loop
+			if (Scripted && ScriptedFrame > 0)
+				FrameTimesMs.push_back(FrameTime * 1000.0f);
+
 			FrameTime = glm::min(FrameTime, MAX_FRAME_TIME);
 
-			CameraController.MoveInPaneXZ(m_MyWindow.GetGLFWwindow(), FrameTime, ViewerObject);
-			Cam.SetViewYXZ(ViewerObject.GetTransform().Translation, ViewerObject.GetTransform().Rotation);
+			if (Scripted && Settings.LightingSwitchInterval > 0 && ScriptedFrame > 0 && ScriptedFrame % Settings.LightingSwitchInterval == 0)
+				CycleLightingModel();
+
+			if (MaterialBurst && ScriptedFrame == MaterialBurstFrame)
+			{
+				// Every material differs in fixed function state only, so each needs a pipeline of its own
+				MaterialBurstTime = std::chrono::high_resolution_clock::now();
+				MaterialBurstSample = FrameTimesMs.size();
+
+				std::vector<uint32_t> Materials;
+				for (uint32_t i = 0; i < Settings.MaterialBurstCount; i++)
+				{
+					BasicRenderSystem::MaterialState State;
+					State.CullMode = i % 2 == 0 ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+					State.FrontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+					State.DepthBias = (float)(i / 2 + 1);
+					Materials.push_back(SimpleRenderSystem.AddMaterial(State, Settings.SynchronousMaterials));
+				}
+
+				for (size_t i = 0; i < m_GameObjects.size(); i++)
+					m_GameObjects[i].SetMaterial(Materials[i % Materials.size()]);
+			}
+
+			if (Settings.Flythrough)
+			{
+				// Advances per frame rather than per second so every run streams the same sequence, the sway
+				// brings both sides of the corridor into view
+				const float Progress = (float)ScriptedFrame / Settings.FrameCount;
+				const float Sway = Progress * 12.0f;
+				Cam.SetViewDirection(glm::vec3(1.5f * std::sin(Sway), 0.0f, Progress * CORRIDOR_LENGTH), glm::vec3(0.3f * std::cos(Sway), 0.0f, 1.0f));
+			}
+			else
+			{
+				CameraController.MoveInPaneXZ(m_MyWindow.GetGLFWwindow(), FrameTime, ViewerObject);
+				Cam.SetViewYXZ(ViewerObject.GetTransform().Translation, ViewerObject.GetTransform().Rotation);
+			}
+
+			if (UpdateStreaming(Cam.GetPosition()))
+				SimpleRenderSystem.InvalidateScene();
+
+			// The rebuilt pipelines compile in the background and PrepareFrame swaps them in, no frame waits for them
+			const std::vector<std::string> ChangedShaders = Watcher ? Watcher->TakeChangedFiles() : std::vector<std::string>();
+			if (!ChangedShaders.empty())
+			{
+				const uint32_t ReloadCount = SimpleRenderSystem.ReloadShaders(ChangedShaders);
+				std::cout << "Shader reload : rebuilding " << ReloadCount << " pipelines, compiled in " << Watcher->GetStats().LastCompileMs << " ms" << std::endl;
+				PipelinesRebuilding = PipelinesRebuilding || ReloadCount > 0;
+				PipelineRebuildTime = std::chrono::high_resolution_clock::now();
+			}
 
 			const float Aspect = m_Renderer.GetAspectRatio();
 			//Cam.SetOrthographicsProjection(-Aspect, Aspect, -1, 1, -1, 1);
@@ -95,26 +326,196 @@ namespace VulkanTutorial
 
 			if (auto CommandBuffer = m_Renderer.BeginFrame())
 			{
-				const int ImageIndex = m_Renderer.GetCurrentFrame();
+				const int FrameIndex = m_Renderer.GetCurrentFrame();
 
-				FrameInfo Info{ ImageIndex, FrameTime, CommandBuffer, Cam, GlobalDescriptorSets[ImageIndex]};
+				FrameInfo Info{ FrameIndex, FrameTime, CommandBuffer, Cam, GlobalDescriptorSets[FrameIndex], m_Renderer.GetCurrentFramebuffer(), m_Renderer.GetSwapChainExtent() };
 
 				
 				GlobalUBO Ubo{};
 				Ubo.projectionMatrix = Cam.GetProjectionMatrix() * Cam.GetViewMatrix();
-				//GlobalUniformBuffer.WriteToIndex(&Ubo, ImageIndex);
-				//GlobalUniformBuffer.FlushIndex(ImageIndex);
-				UboBuffers[ImageIndex]->WriteToBuffer(&Ubo);
-				UboBuffers[ImageIndex]->Flush();
+				Ubo.lightingModel = (uint32_t)SimpleRenderSystem.GetShaderVariant().Lighting;
+				Ubo.ambient = SimpleRenderSystem.GetShaderVariant().Ambient;
+				//GlobalUniformBuffer.WriteToIndex(&Ubo, FrameIndex);
+				//GlobalUniformBuffer.FlushIndex(FrameIndex);
+				UboBuffers[FrameIndex]->WriteToBuffer(&Ubo);
+				UboBuffers[FrameIndex]->Flush();
+
+				SimpleRenderSystem.PrepareFrame(Info, m_GameObjects);
 
-				m_Renderer.BeginSwapChainRenderPass(CommandBuffer);
+				m_Renderer.BeginSwapChainRenderPass(CommandBuffer, SimpleRenderSystem.GetSubpassContents());
 				SimpleRenderSystem.RenderGameObject(Info, m_GameObjects);
 				m_Renderer.EndSwapChainRenderPass(CommandBuffer);
 				m_Renderer.EndFrame();
+
+				StatsRecordTimeMs += SimpleRenderSystem.GetStats().RecordTimeMs;
+				RunRecordTimeMs += SimpleRenderSystem.GetStats().RecordTimeMs;
+				RunRecordedFrameCount++;
+				StatsLatencyMs += m_Renderer.GetLatencyMs();
+				if (m_Renderer.GetLatencyMs() > 0.0f)
+				{
+					RunLatencyMs += m_Renderer.GetLatencyMs();
+					RunLatencyFrameCount++;
+				}
+				StatsCommandOverheadMs += m_Renderer.GetCommandOverheadMs();
+				StatsFrameCount++;
+
+				if (PipelinesRebuilding && SimpleRenderSystem.GetPendingReloadCount() == 0)
+				{
+					std::cout << "Pipelines swapped in after " << std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - PipelineRebuildTime).count()
+						<< " ms" << std::endl;
+					PipelinesRebuilding = false;
+				}
+
+				if (MaterialBurst && ScriptedFrame >= MaterialBurstFrame && MaterialsReadyFrame == 0 && SimpleRenderSystem.GetPendingMaterialCount() == 0)
+				{
+					MaterialsReadyFrame = ScriptedFrame - MaterialBurstFrame + 1;
+					MaterialsReadyMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - MaterialBurstTime).count();
+				}
+			}
+
+			StatsTime += FrameTime;
+			if (StatsTime >= 1.0f && StatsFrameCount > 0)
+			{
+				const BasicRenderSystem::RenderStats& Stats = SimpleRenderSystem.GetStats();
+
+				std::cout << BasicRenderSystem::GetRenderModeName(SimpleRenderSystem.GetRenderMode()) << " : " << Stats.ObjectCount << " objects, "
+					<< Stats.DrawCallCount << " draw calls, " << Stats.BindCallCount << " binds, " << Stats.TriangleCount << " triangles"
+					<< (SimpleRenderSystem.IsLodSelectionEnabled() ? " (LOD)" : "") << ", " << StatsRecordTimeMs / StatsFrameCount << " ms record, "
+					<< StatsCommandOverheadMs / StatsFrameCount << " ms reset/begin/end, " << SimpleRenderSystem.GetRecordThreadCount() << " record threads, "
+					<< 1000.0f * StatsTime / StatsFrameCount << " ms frame, " << StatsFrameCount / StatsTime << " fps, "
+					<< m_Renderer.GetFramesInFlight() << " frames in flight, " << StatsLatencyMs / StatsFrameCount << " ms latency" << std::endl;
+
+				if (SimpleRenderSystem.IsGpuCullingEnabled() && SimpleRenderSystem.IsClusterCullingEnabled() && SimpleRenderSystem.GetRenderMode() == BasicRenderSystem::RenderMode::Indirect)
+					std::cout << "Cluster culling : " << Stats.ClusterVisibleCount << " visible / " << Stats.ClusterTestedCount << " tested meshlets, "
+						<< Stats.ClusterBackfacingCount << " back facing" << std::endl;
+				else if (SimpleRenderSystem.IsGpuCullingEnabled() && SimpleRenderSystem.GetRenderMode() == BasicRenderSystem::RenderMode::Indirect)
+					std::cout << "GPU culling : " << Stats.CullVisibleCount << " visible / " << Stats.CullTestedCount << " tested" << std::endl;
+				else if (SimpleRenderSystem.IsCpuCullingEnabled() && SimpleRenderSystem.GetRenderMode() != BasicRenderSystem::RenderMode::Indirect)
+					std::cout << "CPU culling (" << FrustumCulling::GetInstructionSet() << ") : " << Stats.CpuVisibleCount << " visible / " << Stats.ObjectCount << " tested" << std::endl;
+
+				// Uploads are only reported while something streams in
+				const UploadManager::Stats UploadStats = m_EngineDevice.GetUploadManager().GetStats();
+				if (UploadStats.UploadCount != StatsUploadStart.UploadCount)
+				{
+					std::cout << "Uploads : " << (UploadStats.BytesUploaded - StatsUploadStart.BytesUploaded) / StatsFrameCount << " bytes/frame, "
+						<< UploadStats.RingFullStalls - StatsUploadStart.RingFullStalls << " staging ring full stalls" << std::endl;
+				}
+
+				const AssetStreamer::Stats StreamStats = m_AssetStreamer->GetStats();
+				if (StreamStats.AssetCount > 0)
+				{
+					std::cout << "Streaming : " << StreamStats.ResidentCount << " / " << StreamStats.AssetCount << " assets resident, "
+						<< StreamStats.ResidentBytes / (1024 * 1024) << " MB, " << StreamStats.QueuedCount << " queued, " << StreamStats.DecodedCount << " waiting for upload, "
+						<< StreamStats.LoadCount << " loads, " << StreamStats.EvictionCount << " evictions" << std::endl;
+				}
+
+				StatsUploadStart = UploadStats;
+				StatsTime = 0.0f;
+				StatsRecordTimeMs = 0.0f;
+				StatsLatencyMs = 0.0f;
+				StatsCommandOverheadMs = 0.0f;
+				StatsFrameCount = 0;
 			}
+
+			if (Scripted)
+				ScriptedFrame++;
 		}
 
 		vkDeviceWaitIdle(m_EngineDevice.Device());
+
+		// The descriptor sets of this run go with it, so Run can be called again
+		m_GlobalDescriptorPool->ResetPool();
+
+		if (Settings.Flythrough)
+		{
+			PrintFrameTimeReport("Flythrough", FrameTimesMs);
+
+			const AssetStreamer::Stats StreamStats = m_AssetStreamer->GetStats();
+			std::cout << "Streaming : " << StreamStats.LoadCount << " loads, " << StreamStats.EvictionCount << " evictions, " << StreamStats.FailureCount << " failures, "
+				<< StreamStats.UploadedBytes / (1024 * 1024) << " MB uploaded, " << StreamStats.ResidentCount << " / " << StreamStats.AssetCount << " assets resident at the end" << std::endl;
+		}
+		else if (Scripted)
+		{
+			PrintFrameTimeReport("Frames", FrameTimesMs);
+
+			if (Settings.RecordThreadCount > 0 && RunRecordedFrameCount > 0)
+				std::cout << "Recording : " << RunRecordTimeMs / RunRecordedFrameCount << " ms average on " << SimpleRenderSystem.GetRecordThreadCount() << " record threads" << std::endl;
+
+			if (Settings.FramesInFlight > 0 && RunLatencyFrameCount > 0 && !FrameTimesMs.empty())
+				std::cout << "Latency : " << RunLatencyMs / RunLatencyFrameCount << " ms input to present, " << 1000.0f * FrameTimesMs.size() / std::accumulate(FrameTimesMs.begin(), FrameTimesMs.end(), 0.0f)
+					<< " fps at " << m_Renderer.GetFramesInFlight() << " frames in flight" << std::endl;
+		}
+
+		if (MaterialBurst && MaterialBurstSample < FrameTimesMs.size())
+		{
+			const std::vector<float> BeforeBurst(FrameTimesMs.begin(), FrameTimesMs.begin() + MaterialBurstSample);
+			const std::vector<float> FromBurst(FrameTimesMs.begin() + MaterialBurstSample, FrameTimesMs.end());
+			PrintFrameTimeReport("Before the burst", BeforeBurst);
+			PrintFrameTimeReport("From the burst on", FromBurst);
+
+			const PipelineLibrary::Stats LibraryStats = m_EngineDevice.GetPipelineLibrary().GetStats();
+			std::cout << "Materials : " << Settings.MaterialBurstCount << (Settings.SynchronousMaterials ? " compiled on the render thread, " : " compiled in the background, ");
+			if (MaterialsReadyFrame > 0)
+				std::cout << "all drawn after " << MaterialsReadyFrame << " frames / " << MaterialsReadyMs << " ms, ";
+			else
+				std::cout << SimpleRenderSystem.GetPendingMaterialCount() << " still pending at the end, ";
+			std::cout << *std::max_element(FromBurst.begin(), FromBurst.end()) << " ms worst frame, " << LibraryStats.CreationTimeMs << " ms pipeline creation in total" << std::endl;
+		}
+	}
+
+	void EngineMain::RunPipelineBenchmark(uint32_t Repetitions)
+	{
+		auto GlobalDescriptorSetLayout = DescriptorSetLayout::Builder(m_EngineDevice)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+			.Build();
+
+		PipelineCache& Cache = m_EngineDevice.GetPipelineCache();
+
+		// Graphics pipelines of every render mode plus the culling compute pipelines, as at startup
+		auto TimeRenderSystemCreation = [&]()
+		{
+			const auto Start = std::chrono::high_resolution_clock::now();
+			BasicRenderSystem RenderSystem(m_EngineDevice, m_Renderer.GetSwapChainRenderPass(), GlobalDescriptorSetLayout->GetDescriptorSetLayout());
+			return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - Start).count();
+		};
+
+		const size_t LoadedSize = Cache.GetLoadedSize();
+		const float StartupMs = TimeRenderSystemCreation();
+
+		float ColdMs = 0.0f;
+		float WarmMs = 0.0f;
+		for (uint32_t i = 0; i < Repetitions; i++)
+		{
+			Cache.Reset();
+			ColdMs += TimeRenderSystemCreation();
+			WarmMs += TimeRenderSystemCreation();
+		}
+
+		ColdMs /= Repetitions;
+		WarmMs /= Repetitions;
+
+		std::cout << "Pipeline creation, " << Repetitions << " repetitions, " << Cache.GetDataSize() << " bytes of cache data" << std::endl;
+		std::cout << "  startup : " << StartupMs << " ms, " << (LoadedSize > 0 ? "cache loaded from disk (" + std::to_string(LoadedSize) + " bytes)" : std::string("no valid cache on disk")) << std::endl;
+		std::cout << "  cold    : " << ColdMs << " ms, empty cache" << std::endl;
+		std::cout << "  warm    : " << WarmMs << " ms, " << ColdMs / glm::max(WarmMs, 0.001f) << "x faster than cold" << std::endl;
+		std::cout << "Drivers with their own shader cache make cold creation faster than a true first launch" << std::endl;
+
+		// Render systems alive at the same time share pipelines, layouts and shader modules through the library
+		const PipelineLibrary::Stats LibraryStart = m_EngineDevice.GetPipelineLibrary().GetStats();
+		const auto SharedStart = std::chrono::high_resolution_clock::now();
+
+		std::vector<std::unique_ptr<BasicRenderSystem>> RenderSystems;
+		for (uint32_t i = 0; i < 8; i++)
+			RenderSystems.push_back(std::make_unique<BasicRenderSystem>(m_EngineDevice, m_Renderer.GetSwapChainRenderPass(), GlobalDescriptorSetLayout->GetDescriptorSetLayout()));
+
+		const float SharedMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - SharedStart).count();
+		const PipelineLibrary::Stats& LibraryStats = m_EngineDevice.GetPipelineLibrary().GetStats();
+
+		std::cout << "  shared  : " << SharedMs << " ms for " << RenderSystems.size() << " render systems, "
+			<< LibraryStats.PipelineHitCount - LibraryStart.PipelineHitCount << " / " << LibraryStats.PipelineRequestCount - LibraryStart.PipelineRequestCount << " pipeline hits, "
+			<< LibraryStats.ShaderModuleHitCount - LibraryStart.ShaderModuleHitCount << " / " << LibraryStats.ShaderModuleRequestCount - LibraryStart.ShaderModuleRequestCount << " shader module hits, "
+			<< LibraryStats.LayoutHitCount - LibraryStart.LayoutHitCount << " / " << LibraryStats.LayoutRequestCount - LibraryStart.LayoutRequestCount << " layout hits, "
+			<< LibraryStats.TimeSavedMs - LibraryStart.TimeSavedMs << " ms of pipeline creation saved" << std::endl;
 	}
 
 	std::unique_ptr<Mesh> CreateCubeModel(EngineDevice& Device, glm::vec3 Offset) {
@@ -167,6 +568,39 @@ namespace VulkanTutorial
 		return std::make_unique<Mesh>(Device, ModelBuilder);
 	}
 
+	void EngineMain::CreateAssetStreamer(VkDeviceSize ResidencyBudget)
+	{
+		m_AssetStreamer = std::make_unique<AssetStreamer>(m_EngineDevice, CreateCubeModel(m_EngineDevice, { 0.0f, 0.0f, 0.0f }), ResidencyBudget);
+	}
+
+	void EngineMain::AddStreamedObject(GameObject&& Object, AssetStreamer::AssetId Asset)
+	{
+		// Streamed meshes are assumed to fit a unit sphere around their origin, their bounds are unknown until loaded
+		const TransformComponent& Transform = Object.GetTransform();
+		const float Radius = glm::max(glm::max(Transform.Scale.x, Transform.Scale.y), Transform.Scale.z);
+		m_AssetStreamer->AddInstance(Asset, glm::vec4(Transform.Translation, Radius));
+
+		if (Asset >= m_AssetObjects.size())
+			m_AssetObjects.resize(Asset + 1);
+		m_AssetObjects[Asset].push_back((uint32_t)m_GameObjects.size());
+
+		Object.SetMesh(m_AssetStreamer->GetMesh(Asset));
+		m_GameObjects.push_back(std::move(Object));
+	}
+
+	bool EngineMain::UpdateStreaming(const glm::vec3& CameraPosition)
+	{
+		m_AssetStreamer->Update(CameraPosition, STREAM_RADIUS);
+
+		for (AssetStreamer::AssetId Asset : m_AssetStreamer->GetChangedAssets())
+		{
+			for (uint32_t ObjectIndex : m_AssetObjects[Asset])
+				m_GameObjects[ObjectIndex].SetMesh(m_AssetStreamer->GetMesh(Asset));
+		}
+
+		return !m_AssetStreamer->GetChangedAssets().empty();
+	}
+
 	void EngineMain::LoadGameObjects()
 	{
 		/*std::shared_ptr<Mesh> NewMesh = CreateCubeModel(m_EngineDevice, {0.0f, 0.0f, 0.0f});
@@ -182,9 +616,8 @@ namespace VulkanTutorial
 		m_GameObjects.push_back(std::move(Cube));
 		*/
 
-		std::shared_ptr<Mesh> NewMesh = Mesh::CreateModelFromFile(m_EngineDevice, "./../../Content/smooth_vase.obj");
+		const AssetStreamer::AssetId Vase = m_AssetStreamer->RegisterMesh("./../../Content/smooth_vase.obj");
 		auto Cube = GameObject::CreateGameObject();
-		Cube.SetMesh(NewMesh);
 
 		TransformComponent Transform;
 		Transform.Translation = { 0.0f, 0.0f, 0.5f };
@@ -192,6 +625,87 @@ namespace VulkanTutorial
 
 		Cube.SetTransform(Transform);
 
-		m_GameObjects.push_back(std::move(Cube));
+		AddStreamedObject(std::move(Cube), Vase);
+	}
+
+	void EngineMain::LoadStressScene(uint32_t ObjectCount, StressLayout Layout, bool UniqueMeshes)
+	{
+		std::shared_ptr<Mesh> SharedMesh = UniqueMeshes ? nullptr : Mesh::CreateModelFromFile(m_EngineDevice, "./../../Content/smooth_vase.obj");
+
+		// Grid: square in front of the camera. Surround: disc around the camera, most of it outside the view frustum.
+		// Depth: inside the view frustum with a density even in volume, so most objects are far away. All are kept
+		// inside the far plane.
+		const uint32_t GridSize = (uint32_t)std::ceil(std::sqrt((float)ObjectCount));
+		const float Spacing = (Layout == StressLayout::Grid ? 8.0f : 16.0f) / GridSize;
+
+		m_GameObjects.reserve(ObjectCount);
+		for (uint32_t i = 0; i < ObjectCount; i++)
+		{
+			auto StressObject = GameObject::CreateGameObject();
+
+			// Unique meshes are cubes with a slightly different pivot each, so nothing can be instanced
+			if (UniqueMeshes)
+				StressObject.SetMesh(CreateCubeModel(m_EngineDevice, glm::vec3(0.0f, (float)(i % 100) * 0.001f, 0.0f)));
+			else
+				StressObject.SetMesh(SharedMesh);
+
+			TransformComponent Transform;
+			if (Layout == StressLayout::Grid)
+			{
+				Transform.Translation = { ((float)(i % GridSize) - GridSize * 0.5f) * Spacing, 0.5f, 1.0f + (float)(i / GridSize) * Spacing };
+			}
+			else if (Layout == StressLayout::Surround)
+			{
+				// Sunflower spiral, uniform density over the disc
+				const float Angle = (float)i * 2.39996323f;
+				const float Distance = 0.5f + 8.5f * std::sqrt(((float)i + 0.5f) / ObjectCount);
+				Transform.Translation = { Distance * std::cos(Angle), 0.5f, Distance * std::sin(Angle) };
+			}
+			else
+			{
+				// Frustum slices grow with the square of their distance, cube root spacing fills them evenly. The
+				// lateral offsets follow a 2D low discrepancy sequence within the 50 degree field of view.
+				const float Depth = 0.5f + 9.0f * std::cbrt(((float)i + 0.5f) / ObjectCount);
+				const float U = std::fmod((float)i * 0.7548777f, 1.0f) * 2.0f - 1.0f;
+				const float V = std::fmod((float)i * 0.5698403f, 1.0f) * 2.0f - 1.0f;
+				Transform.Translation = { U * 0.55f * Depth, V * 0.4f * Depth, Depth };
+			}
+
+			// The vase is much narrower than the unit cube, depth layouts keep one size so only distance varies
+			if (Layout == StressLayout::Depth)
+				Transform.Scale = glm::vec3(UniqueMeshes ? 0.05f : 0.2f);
+			else
+				Transform.Scale = glm::vec3(UniqueMeshes ? Spacing * 0.5f : Spacing * 2.0f);
+
+			StressObject.SetTransform(Transform);
+
+			m_GameObjects.push_back(std::move(StressObject));
+		}
+	}
+
+	void EngineMain::LoadCorridorScene(uint32_t ObjectCount, uint32_t AssetCount)
+	{
+		// The same file is registered once per asset, each is loaded, budgeted and evicted on its own
+		AssetCount = std::max(AssetCount, 1u);
+		for (uint32_t i = 0; i < AssetCount; i++)
+			m_AssetStreamer->RegisterMesh("./../../Content/smooth_vase.obj");
+
+		m_GameObjects.reserve(ObjectCount);
+		for (uint32_t i = 0; i < ObjectCount; i++)
+		{
+			auto CorridorObject = GameObject::CreateGameObject();
+
+			// Even steps down the corridor, a low discrepancy sequence across it
+			const float Depth = CORRIDOR_LENGTH * ((float)i + 0.5f) / ObjectCount;
+			const float U = std::fmod((float)i * 0.618034f, 1.0f) * 2.0f - 1.0f;
+
+			TransformComponent Transform;
+			Transform.Translation = { U * 4.0f, 0.5f, Depth };
+			Transform.Scale = glm::vec3(0.5f);
+			CorridorObject.SetTransform(Transform);
+
+			const AssetStreamer::AssetId Asset = std::min((uint32_t)(Depth / CORRIDOR_LENGTH * AssetCount), AssetCount - 1);
+			AddStreamedObject(std::move(CorridorObject), Asset);
+		}
 	}
 }
\ No newline at end of file
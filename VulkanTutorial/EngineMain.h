@@ -3,6 +3,7 @@
 
 #include "MyWindow.h"
 #include "EngineDevice.h"
+#include "AssetStreamer.h"
 #include "Mesh.h"
 #include "Renderer.h"
 #include "Camera.h"
@@ -14,6 +15,33 @@
 
 namespace VulkanTutorial
 {
+	// How EngineMain::Run is driven, the defaults follow the keyboard until the window is closed
+	struct RunSettings
+	{
+		// Above zero runs that many frames, then prints frame time percentiles and returns
+		uint32_t FrameCount = 0;
+		// Moves the camera down the corridor over FrameCount frames instead of following the keyboard
+		bool Flythrough = false;
+		// Flies through the GPU culled indirect scene instead of drawing instanced with CPU culling
+		bool FlythroughIndirect = false;
+		// Adds that many materials half way through FrameCount and spreads them over the objects. Their pipelines
+		// compile in the background unless SynchronousMaterials is set, drawing is switched to per object.
+		uint32_t MaterialBurstCount = 0;
+		bool SynchronousMaterials = false;
+		// Starts with instanced drawing instead of per object
+		bool Instanced = false;
+		// Branches on the lighting values of GlobalUBO instead of pipelines specialized for them
+		bool UniformLighting = false;
+		// Above zero cycles the lighting model every that many frames
+		uint32_t LightingSwitchInterval = 0;
+		// Above zero records per object draws on that many threads, see BasicRenderSystem::SetRecordThreadCount.
+		// Scripted runs then also report the average record time.
+		uint32_t RecordThreadCount = 0;
+		// Above zero switches to that many frames in flight before the first frame. Scripted runs then also report the
+		// average input to present latency and frame rate.
+		uint32_t FramesInFlight = 0;
+	};
+
 	class EngineMain
 	{
 	public:
@@ -23,7 +51,29 @@ namespace VulkanTutorial
 		static constexpr int WIDTH = 800;
 		static constexpr int HEIGHT = 600;
 
-		EngineMain();
+		// Far plane plus a margin, meshes are requested before they come into view
+		static constexpr float STREAM_RADIUS = 12.0f;
+		static constexpr VkDeviceSize DEFAULT_RESIDENCY_BUDGET = 256 * 1024 * 1024;
+
+		static constexpr float CORRIDOR_LENGTH = 100.0f;
+		static constexpr uint32_t DEFAULT_CORRIDOR_ASSET_COUNT = 200;
+
+		enum class StressLayout
+		{
+			Grid,
+			Surround,
+			// Spread through the view frustum from the near to the far plane, for level of detail selection
+			Depth,
+			// Along +z for CORRIDOR_LENGTH, every slab of it draws a different streamed asset
+			Corridor,
+		};
+
+		// StressObjectCount above zero replaces the scene with that many copies of the same mesh, or with that many
+		// distinct meshes when UniqueMeshes is set. MeshVertexFormat is the layout every mesh is stored in. The corridor
+		// layout spreads CorridorAssetCount streamed assets over its objects. Streamed meshes are kept within
+		// ResidencyBudget bytes of geometry.
+		EngineMain(uint32_t StressObjectCount = 0, StressLayout Layout = StressLayout::Grid, uint32_t FramesInFlight = EngineSwapChain::DEFAULT_FRAMES_IN_FLIGHT, bool UniqueMeshes = false
+			, VertexFormat MeshVertexFormat = VertexFormat::Float32, uint32_t CorridorAssetCount = DEFAULT_CORRIDOR_ASSET_COUNT, VkDeviceSize ResidencyBudget = DEFAULT_RESIDENCY_BUDGET);
 		virtual ~EngineMain();
 
 		EngineMain(const EngineMain&) = delete;
@@ -32,10 +82,24 @@ namespace VulkanTutorial
 		EngineMain(EngineMain&&) = delete;
 		EngineMain& operator = (EngineMain&&) = delete;
 
-		void Run();
+		void Run(const RunSettings& Settings = RunSettings());
+
+		// Times creating every pipeline of the render system with the pipeline cache as loaded from disk, then
+		// averages Repetitions cold creations from an emptied cache and warm ones right after. Finally creates several
+		// render systems at once, which share their pipelines through the pipeline library.
+		void RunPipelineBenchmark(uint32_t Repetitions);
 
 	private:
 		void LoadGameObjects();
+		void LoadStressScene(uint32_t ObjectCount, StressLayout Layout, bool UniqueMeshes);
+		void LoadCorridorScene(uint32_t ObjectCount, uint32_t AssetCount);
+		void CreateAssetStreamer(VkDeviceSize ResidencyBudget);
+
+		// Registers an object drawing a streamed asset, it draws the placeholder until the asset is resident
+		void AddStreamedObject(GameObject&& Object, AssetStreamer::AssetId Asset);
+
+		// Returns true when the mesh of any game object changed
+		bool UpdateStreaming(const glm::vec3& CameraPosition);
 
 		MyWindow m_MyWindow = MyWindow("My Window", WIDTH, HEIGHT);
 		EngineDevice m_EngineDevice = EngineDevice(m_MyWindow);
@@ -43,6 +107,10 @@ namespace VulkanTutorial
 
 		std::unique_ptr<DescriptorPool> m_GlobalDescriptorPool;
 		std::vector<GameObject> m_GameObjects;
+
+		std::unique_ptr<AssetStreamer> m_AssetStreamer;
+		// Indices into m_GameObjects of the objects drawing each streamed asset
+		std::vector<std::vector<uint32_t>> m_AssetObjects;
 	};
 }
 
@@ -11,17 +11,19 @@
 
 namespace VulkanTutorial
 {
-    EngineSwapChain::EngineSwapChain(EngineDevice &deviceRef, VkExtent2D extent)
+    EngineSwapChain::EngineSwapChain(EngineDevice &deviceRef, VkExtent2D extent, uint32_t framesInFlight)
         : m_Device{deviceRef}
         , m_WindowExtent{extent} 
+        , m_FramesInFlight{framesInFlight}
     {
         Init();
     }
 
-    EngineSwapChain::EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<EngineSwapChain> Previous)
+    EngineSwapChain::EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<EngineSwapChain> Previous, uint32_t framesInFlight)
         : m_Device{ deviceRef }
         , m_WindowExtent{ extent }
         , m_OldSwapChain(Previous)
+        , m_FramesInFlight{ framesInFlight }
     {
         Init();
 
@@ -32,6 +34,9 @@ namespace VulkanTutorial
 
     void EngineSwapChain::Init()
     {
+        if (m_FramesInFlight < 1 || m_FramesInFlight > MAX_FRAMES_IN_FLIGHT)
+            throw std::runtime_error("frames in flight must be between 1 and MAX_FRAMES_IN_FLIGHT!");
+
         CreateSwapChain();
         CreateImageViews();
         CreateRenderPass();
@@ -56,7 +61,7 @@ namespace VulkanTutorial
         {
             vkDestroyImageView(m_Device.Device(), m_DepthImageViews[i], nullptr);
             vkDestroyImage(m_Device.Device(), m_DepthImages[i], nullptr);
-            vkFreeMemory(m_Device.Device(), m_DepthImageMemorys[i], nullptr);
+            m_Device.FreeMemory(m_DepthImageMemorys[i]);
         }
 
         for (auto framebuffer : m_SwapChainFramebuffers) 
@@ -64,18 +69,30 @@ namespace VulkanTutorial
 
         vkDestroyRenderPass(m_Device.Device(), m_RenderPass, nullptr);
 
-        // cleanup synchronization objects
-        for (size_t i = 0; i < ImageCount(); i++)
-        {
-            vkDestroySemaphore(m_Device.Device(), m_RenderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(m_Device.Device(), m_ImageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(m_Device.Device(), m_InFlightFences[i], nullptr);
-        }
+        DestroySyncObjects();
     }
 
-    VkResult EngineSwapChain::AcquireNextImage(uint32_t *imageIndex) 
+    void EngineSwapChain::SetFramesInFlight(uint32_t framesInFlight)
+    {
+        if (framesInFlight < 1 || framesInFlight > MAX_FRAMES_IN_FLIGHT)
+            throw std::runtime_error("frames in flight must be between 1 and MAX_FRAMES_IN_FLIGHT!");
+
+        DestroySyncObjects();
+
+        m_FramesInFlight = framesInFlight;
+        m_CurrentFrame = 0;
+
+        CreateSyncObjects();
+    }
+
+    void EngineSwapChain::WaitForCurrentFrame()
     {
         vkWaitForFences(m_Device.Device(), 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    VkResult EngineSwapChain::AcquireNextImage(uint32_t *imageIndex) 
+    {
+        WaitForCurrentFrame();
 
         //                                                                                                            must be a not signaled semaphore 
         VkResult result = vkAcquireNextImageKHR(m_Device.Device(), m_SwapChain, std::numeric_limits<uint64_t>::max(), m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, imageIndex);
@@ -102,7 +119,7 @@ namespace VulkanTutorial
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = buffers;
 
-        VkSemaphore signalSemaphores[] = {m_RenderFinishedSemaphores[m_CurrentFrame]};
+        VkSemaphore signalSemaphores[] = {m_RenderFinishedSemaphores[*imageIndex]};
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
@@ -124,7 +141,7 @@ namespace VulkanTutorial
 
         auto result = vkQueuePresentKHR(m_Device.PresentQueue(), &presentInfo);
 
-        m_CurrentFrame = (m_CurrentFrame + 1) % ImageCount();
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
 
         return result;
     }
@@ -342,10 +359,10 @@ namespace VulkanTutorial
 
     void EngineSwapChain::CreateSyncObjects() 
     {
-        m_ImageAvailableSemaphores.resize(ImageCount());
+        m_ImageAvailableSemaphores.resize(m_FramesInFlight);
+        m_InFlightFences.resize(m_FramesInFlight);
         m_RenderFinishedSemaphores.resize(ImageCount());
-        m_InFlightFences.resize(ImageCount());
-        m_ImagesInFlight.resize(ImageCount(), VK_NULL_HANDLE);
+        m_ImagesInFlight.assign(ImageCount(), VK_NULL_HANDLE);
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -354,15 +371,37 @@ namespace VulkanTutorial
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < ImageCount(); i++)
+        for (size_t i = 0; i < m_FramesInFlight; i++)
         {
             if (vkCreateSemaphore(m_Device.Device(), &semaphoreInfo, nullptr, &m_ImageAvailableSemaphores[i]) != VK_SUCCESS
-                || vkCreateSemaphore(m_Device.Device(), &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS
                 || vkCreateFence(m_Device.Device(), &fenceInfo, nullptr, &m_InFlightFences[i]) != VK_SUCCESS)
             {
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
+
+        for (size_t i = 0; i < ImageCount(); i++)
+        {
+            if (vkCreateSemaphore(m_Device.Device(), &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS)
+                throw std::runtime_error("failed to create synchronization objects for a swap chain image!");
+        }
+    }
+
+    void EngineSwapChain::DestroySyncObjects()
+    {
+        for (auto semaphore : m_ImageAvailableSemaphores)
+            vkDestroySemaphore(m_Device.Device(), semaphore, nullptr);
+
+        for (auto fence : m_InFlightFences)
+            vkDestroyFence(m_Device.Device(), fence, nullptr);
+
+        for (auto semaphore : m_RenderFinishedSemaphores)
+            vkDestroySemaphore(m_Device.Device(), semaphore, nullptr);
+
+        m_ImageAvailableSemaphores.clear();
+        m_InFlightFences.clear();
+        m_RenderFinishedSemaphores.clear();
+        m_ImagesInFlight.clear();
     }
 
     VkSurfaceFormatKHR EngineSwapChain::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) 
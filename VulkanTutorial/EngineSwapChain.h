@@ -17,8 +17,13 @@ namespace VulkanTutorial
     {
     public:
 
-        EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent);
-        EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<EngineSwapChain> Previous);
+        // Frames the CPU may record ahead of the GPU, independent of the number of swap chain images.
+        // 1 has the lowest latency, 3 hides the most CPU and GPU stalls.
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+        static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+        EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+        EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<EngineSwapChain> Previous, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
         virtual ~EngineSwapChain();
 
         EngineSwapChain(const EngineSwapChain&) = delete;
@@ -39,6 +44,9 @@ namespace VulkanTutorial
         float ExtentAspectRatio() {   return static_cast<float>(m_SwapChainExtent.width) / static_cast<float>(m_SwapChainExtent.height);  }
         VkFormat FindDepthFormat();
 
+        // Blocks until the GPU is done with the frame slot that is about to be recorded
+        void WaitForCurrentFrame();
+
         VkResult AcquireNextImage(uint32_t *imageIndex);
         VkResult SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
@@ -48,7 +56,12 @@ namespace VulkanTutorial
                 && SwapChain.m_SwapChainImageFormat == m_SwapChainImageFormat;
         }
 
+        // Frame slot in [0, GetFramesInFlight()), indexes every per frame resource
         size_t GetCurrentFrame() const { return m_CurrentFrame; }
+        uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+
+        // The device must be idle
+        void SetFramesInFlight(uint32_t framesInFlight);
 
     private:
         void Init();
@@ -58,6 +71,7 @@ namespace VulkanTutorial
         void CreateRenderPass();
         void CreateFramebuffers();
         void CreateSyncObjects();
+        void DestroySyncObjects();
 
         // Helper functions
         VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
@@ -75,7 +89,7 @@ namespace VulkanTutorial
         VkRenderPass m_RenderPass;
 
         std::vector<VkImage> m_DepthImages;
-        std::vector<VkDeviceMemory> m_DepthImageMemorys;
+        std::vector<GpuAllocation> m_DepthImageMemorys;
         std::vector<VkImageView> m_DepthImageViews;
         std::vector<VkImage> m_SwapChainImages;
         std::vector<VkImageView> m_SwapChainImageViews;
@@ -83,10 +97,15 @@ namespace VulkanTutorial
         VkSwapchainKHR m_SwapChain;
         std::shared_ptr<EngineSwapChain> m_OldSwapChain;
 
+        // Per frame slot
         std::vector<VkSemaphore> m_ImageAvailableSemaphores;
-        std::vector<VkSemaphore> m_RenderFinishedSemaphores;
         std::vector<VkFence> m_InFlightFences;
+
+        // Per swap chain image, a render finished semaphore can only be reused once its image is presented
+        std::vector<VkSemaphore> m_RenderFinishedSemaphores;
         std::vector<VkFence> m_ImagesInFlight;
+
+        uint32_t m_FramesInFlight;
         size_t m_CurrentFrame = 0;
     };
 
@@ -14,6 +14,10 @@ namespace VulkanTutorial
 		VkCommandBuffer CommandBuffer;
 		Camera& Cam;
 		VkDescriptorSet GlobalDescriptorSet;
+
+		// Needed by secondary command buffers, which inherit neither the framebuffer nor the viewport
+		VkFramebuffer Framebuffer;
+		VkExtent2D Extent;
 	};
 }
 
@@ -0,0 +1,36 @@
+#include "Frustum.h"
+
+namespace VulkanTutorial
+{
+	Frustum Frustum::FromMatrix(const glm::mat4& ProjectionView)
+	{
+		// glm is column major, Row[i] is the i-th row of the matrix
+		glm::vec4 Row[4];
+		for (int i = 0; i < 4; i++)
+			Row[i] = glm::vec4(ProjectionView[0][i], ProjectionView[1][i], ProjectionView[2][i], ProjectionView[3][i]);
+
+		Frustum Result;
+		Result.Planes[0] = Row[3] + Row[0];
+		Result.Planes[1] = Row[3] - Row[0];
+		Result.Planes[2] = Row[3] + Row[1];
+		Result.Planes[3] = Row[3] - Row[1];
+		Result.Planes[4] = Row[2];
+		Result.Planes[5] = Row[3] - Row[2];
+
+		for (glm::vec4& Plane : Result.Planes)
+			Plane /= glm::length(glm::vec3(Plane));
+
+		return Result;
+	}
+
+	bool Frustum::IntersectsSphere(const glm::vec3& Center, float Radius) const
+	{
+		for (const glm::vec4& Plane : Planes)
+		{
+			if (glm::dot(glm::vec3(Plane), Center) + Plane.w < -Radius)
+				return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
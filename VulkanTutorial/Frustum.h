@@ -0,0 +1,21 @@
+#ifndef __Frustum_h__
+#define __Frustum_h__
+
+#include <glm/glm.hpp>
+
+namespace VulkanTutorial
+{
+	struct Frustum
+	{
+		// Left, right, top, bottom, near, far. Normals point inwards and are normalized, so a point P is inside a plane
+		// when dot(Plane.xyz, P) + Plane.w >= 0 and the same expression is its signed distance.
+		glm::vec4 Planes[6];
+
+		// Extracts the planes of a projection * view matrix using the 0 to 1 clip depth range of Camera
+		static Frustum FromMatrix(const glm::mat4& ProjectionView);
+
+		bool IntersectsSphere(const glm::vec3& Center, float Radius) const;
+	};
+}
+
+#endif //__Frustum_h__
\ No newline at end of file
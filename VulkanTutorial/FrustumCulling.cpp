@@ -0,0 +1,213 @@
+#include "FrustumCulling.h"
+#include "Camera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_USE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_USE_SSE
+#endif
+
+namespace VulkanTutorial
+{
+	void SphereSoA::Resize(size_t Count)
+	{
+		CenterX.resize(Count);
+		CenterY.resize(Count);
+		CenterZ.resize(Count);
+		Radius.resize(Count);
+	}
+
+	// Appends Base + Lane for every set bit of Mask without branching, the slot past the end is overwritten but
+	// always lies inside the output since it never exceeds the index being written
+	static inline uint32_t AppendVisible(uint32_t Mask, uint32_t Base, uint32_t LaneCount, uint32_t* OutVisibleIndices, uint32_t VisibleCount)
+	{
+		for (uint32_t Lane = 0; Lane < LaneCount; Lane++)
+		{
+			OutVisibleIndices[VisibleCount] = Base + Lane;
+			VisibleCount += (Mask >> Lane) & 1;
+		}
+
+		return VisibleCount;
+	}
+
+	static uint32_t CullRangeScalar(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t Begin, uint32_t* OutVisibleIndices, uint32_t VisibleCount)
+	{
+		const uint32_t Count = (uint32_t)Spheres.Size();
+
+		for (uint32_t i = Begin; i < Count; i++)
+		{
+			uint32_t Inside = 1;
+			for (const glm::vec4& Plane : ViewFrustum.Planes)
+			{
+				const float Distance = Plane.x * Spheres.CenterX[i] + Plane.y * Spheres.CenterY[i] + Plane.z * Spheres.CenterZ[i] + Plane.w;
+				Inside &= (uint32_t)(Distance >= -Spheres.Radius[i]);
+			}
+
+			VisibleCount = AppendVisible(Inside, i, 1, OutVisibleIndices, VisibleCount);
+		}
+
+		return VisibleCount;
+	}
+
+	uint32_t FrustumCulling::CullSpheresScalar(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t* OutVisibleIndices)
+	{
+		return CullRangeScalar(ViewFrustum, Spheres, 0, OutVisibleIndices, 0);
+	}
+
+#if defined(CULLING_USE_AVX)
+
+	uint32_t FrustumCulling::CullSpheres(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t* OutVisibleIndices)
+	{
+		const uint32_t Count = (uint32_t)Spheres.Size();
+
+		__m256 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6];
+		for (int p = 0; p < 6; p++)
+		{
+			PlaneX[p] = _mm256_set1_ps(ViewFrustum.Planes[p].x);
+			PlaneY[p] = _mm256_set1_ps(ViewFrustum.Planes[p].y);
+			PlaneZ[p] = _mm256_set1_ps(ViewFrustum.Planes[p].z);
+			PlaneW[p] = _mm256_set1_ps(ViewFrustum.Planes[p].w);
+		}
+
+		uint32_t VisibleCount = 0;
+		uint32_t i = 0;
+
+		for (; i + 8 <= Count; i += 8)
+		{
+			const __m256 X = _mm256_loadu_ps(&Spheres.CenterX[i]);
+			const __m256 Y = _mm256_loadu_ps(&Spheres.CenterY[i]);
+			const __m256 Z = _mm256_loadu_ps(&Spheres.CenterZ[i]);
+			const __m256 NegRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&Spheres.Radius[i]));
+
+			__m256 Inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				const __m256 Distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(PlaneX[p], X), _mm256_mul_ps(PlaneY[p], Y)), _mm256_mul_ps(PlaneZ[p], Z)), PlaneW[p]);
+				Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(Distance, NegRadius, _CMP_GE_OQ));
+			}
+
+			VisibleCount = AppendVisible((uint32_t)_mm256_movemask_ps(Inside), i, 8, OutVisibleIndices, VisibleCount);
+		}
+
+		return CullRangeScalar(ViewFrustum, Spheres, i, OutVisibleIndices, VisibleCount);
+	}
+
+	const char* FrustumCulling::GetInstructionSet()
+	{
+		return "AVX";
+	}
+
+#elif defined(CULLING_USE_SSE)
+
+	uint32_t FrustumCulling::CullSpheres(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t* OutVisibleIndices)
+	{
+		const uint32_t Count = (uint32_t)Spheres.Size();
+
+		__m128 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6];
+		for (int p = 0; p < 6; p++)
+		{
+			PlaneX[p] = _mm_set1_ps(ViewFrustum.Planes[p].x);
+			PlaneY[p] = _mm_set1_ps(ViewFrustum.Planes[p].y);
+			PlaneZ[p] = _mm_set1_ps(ViewFrustum.Planes[p].z);
+			PlaneW[p] = _mm_set1_ps(ViewFrustum.Planes[p].w);
+		}
+
+		uint32_t VisibleCount = 0;
+		uint32_t i = 0;
+
+		for (; i + 4 <= Count; i += 4)
+		{
+			const __m128 X = _mm_loadu_ps(&Spheres.CenterX[i]);
+			const __m128 Y = _mm_loadu_ps(&Spheres.CenterY[i]);
+			const __m128 Z = _mm_loadu_ps(&Spheres.CenterZ[i]);
+			const __m128 NegRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&Spheres.Radius[i]));
+
+			__m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				const __m128 Distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(PlaneX[p], X), _mm_mul_ps(PlaneY[p], Y)), _mm_mul_ps(PlaneZ[p], Z)), PlaneW[p]);
+				Inside = _mm_and_ps(Inside, _mm_cmpge_ps(Distance, NegRadius));
+			}
+
+			VisibleCount = AppendVisible((uint32_t)_mm_movemask_ps(Inside), i, 4, OutVisibleIndices, VisibleCount);
+		}
+
+		return CullRangeScalar(ViewFrustum, Spheres, i, OutVisibleIndices, VisibleCount);
+	}
+
+	const char* FrustumCulling::GetInstructionSet()
+	{
+		return "SSE";
+	}
+
+#else
+
+	uint32_t FrustumCulling::CullSpheres(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t* OutVisibleIndices)
+	{
+		return CullSpheresScalar(ViewFrustum, Spheres, OutVisibleIndices);
+	}
+
+	const char* FrustumCulling::GetInstructionSet()
+	{
+		return "Scalar";
+	}
+
+#endif
+
+	void FrustumCulling::RunBenchmark(uint32_t ObjectCount)
+	{
+		// Spheres spread well past the far plane in every direction, so a realistic share of them is culled
+		std::mt19937 Random(1234);
+		std::uniform_real_distribution<float> Position(-20.0f, 20.0f);
+		std::uniform_real_distribution<float> Radius(0.05f, 0.5f);
+
+		SphereSoA Spheres;
+		Spheres.Resize(ObjectCount);
+		for (uint32_t i = 0; i < ObjectCount; i++)
+			Spheres.Set(i, { Position(Random), Position(Random), Position(Random) }, Radius(Random));
+
+		Camera Cam;
+		Cam.SetPerspectiveProjection(glm::radians(50.0f), 4.0f / 3.0f, 0.1f, 10.0f);
+		Cam.SetViewDirection(glm::vec3(0.0f), glm::vec3(0.5f, 0.0f, 1.0f));
+		const Frustum ViewFrustum = Frustum::FromMatrix(Cam.GetProjectionMatrix() * Cam.GetViewMatrix());
+
+		std::vector<uint32_t> VisibleIndices(ObjectCount);
+		std::vector<uint32_t> ReferenceIndices(ObjectCount);
+
+		auto Measure = [&](auto&& Cull, std::vector<uint32_t>& OutIndices, uint32_t& OutVisibleCount)
+		{
+			// Best of several runs, the first one also warms the caches
+			float BestTimeUs = 0.0f;
+			for (int Run = 0; Run < 10; Run++)
+			{
+				auto StartTime = std::chrono::high_resolution_clock::now();
+				OutVisibleCount = Cull(ViewFrustum, Spheres, OutIndices.data());
+				auto EndTime = std::chrono::high_resolution_clock::now();
+
+				const float TimeUs = std::chrono::duration<float, std::chrono::microseconds::period>(EndTime - StartTime).count();
+				BestTimeUs = Run == 0 ? TimeUs : std::min(BestTimeUs, TimeUs);
+			}
+
+			return BestTimeUs;
+		};
+
+		uint32_t VisibleCount = 0;
+		uint32_t ReferenceCount = 0;
+		const float SimdTimeUs = Measure(&FrustumCulling::CullSpheres, VisibleIndices, VisibleCount);
+		const float ScalarTimeUs = Measure(&FrustumCulling::CullSpheresScalar, ReferenceIndices, ReferenceCount);
+
+		const bool Match = VisibleCount == ReferenceCount && std::equal(VisibleIndices.begin(), VisibleIndices.begin() + VisibleCount, ReferenceIndices.begin());
+
+		std::cout << "Frustum culling " << ObjectCount << " spheres, " << VisibleCount << " visible" << std::endl;
+		std::cout << GetInstructionSet() << " : " << SimdTimeUs << " us, " << ObjectCount / SimdTimeUs << " objects/us" << std::endl;
+		std::cout << "Scalar : " << ScalarTimeUs << " us, " << ObjectCount / ScalarTimeUs << " objects/us" << std::endl;
+		std::cout << "Results " << (Match ? "match" : "DIFFER") << std::endl;
+	}
+}
\ No newline at end of file
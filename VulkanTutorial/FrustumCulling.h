@@ -0,0 +1,51 @@
+#ifndef __FrustumCulling_h__
+#define __FrustumCulling_h__
+
+#include "Frustum.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Bounding spheres stored as structure of arrays so the culling kernels can load 4 or 8 of them per instruction
+	struct SphereSoA
+	{
+		std::vector<float> CenterX;
+		std::vector<float> CenterY;
+		std::vector<float> CenterZ;
+		std::vector<float> Radius;
+
+		void Resize(size_t Count);
+		size_t Size() const { return Radius.size(); }
+
+		void Set(size_t Index, const glm::vec3& Center, float SphereRadius)
+		{
+			CenterX[Index] = Center.x;
+			CenterY[Index] = Center.y;
+			CenterZ[Index] = Center.z;
+			Radius[Index] = SphereRadius;
+		}
+	};
+
+	// CPU frustum culling for when the compute culling pass is not used
+	class FrustumCulling
+	{
+	public:
+
+		// Writes the indices of the spheres intersecting the frustum to OutVisibleIndices in increasing order and returns
+		// their count. OutVisibleIndices needs room for Spheres.Size() entries. Uses AVX when the build targets it,
+		// SSE on other x86 builds and plain C++ elsewhere.
+		static uint32_t CullSpheres(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t* OutVisibleIndices);
+
+		// Reference implementation, same results as CullSpheres
+		static uint32_t CullSpheresScalar(const Frustum& ViewFrustum, const SphereSoA& Spheres, uint32_t* OutVisibleIndices);
+
+		static const char* GetInstructionSet();
+
+		// Culls ObjectCount random spheres with both implementations and prints objects culled per microsecond
+		static void RunBenchmark(uint32_t ObjectCount);
+	};
+}
+
+#endif //__FrustumCulling_h__
\ No newline at end of file
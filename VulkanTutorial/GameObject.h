@@ -31,7 +31,11 @@ namespace VulkanTutorial
 		id_t GetId() const { return m_Id; }
 
 		void SetMesh(std::shared_ptr<Mesh> Mesh) { m_Mesh = Mesh; }
-		std::shared_ptr<Mesh> GetMesh() { return m_Mesh; }
+		const std::shared_ptr<Mesh>& GetMesh() const { return m_Mesh; }
+
+		// Index returned by BasicRenderSystem::AddMaterial, zero draws with the default pipeline
+		void SetMaterial(uint32_t Material) { m_Material = Material; }
+		uint32_t GetMaterial() const { return m_Material; }
 
 		void SetColor(const glm::vec3& Color) { m_Color = Color; }
 		const glm::vec3& GetColor() const { return m_Color; }
@@ -49,6 +53,7 @@ namespace VulkanTutorial
 
 		std::shared_ptr<Mesh> m_Mesh;
 		glm::vec3 m_Color;
+		uint32_t m_Material = 0;
 		TransformComponent m_Transform;
 	};
 }
@@ -0,0 +1,266 @@
+#include "GeometryPool.h"
+#include "EngineSwapChain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		constexpr VkBufferUsageFlags VERTEX_USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		constexpr VkBufferUsageFlags INDEX_USAGE = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+		// Renderer::BeginFrame waits for a frame slot before reusing it, after this many updates every frame that could
+		// have drawn a freed range has completed
+		constexpr uint64_t FREE_DELAY_UPDATES = EngineSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+	}
+
+	RangeAllocator::RangeAllocator(uint32_t Capacity)
+		: m_Capacity(Capacity)
+	{
+		if (Capacity > 0)
+			m_FreeRanges[0] = Capacity;
+	}
+
+	uint32_t RangeAllocator::Allocate(uint32_t Count)
+	{
+		if (Count == 0)
+			return 0;
+
+		for (auto It = m_FreeRanges.begin(); It != m_FreeRanges.end(); ++It)
+		{
+			if (It->second < Count)
+				continue;
+
+			const uint32_t Offset = It->first;
+			const uint32_t Remaining = It->second - Count;
+			m_FreeRanges.erase(It);
+
+			if (Remaining > 0)
+				m_FreeRanges[Offset + Count] = Remaining;
+
+			m_UsedCount += Count;
+			return Offset;
+		}
+
+		return INVALID_OFFSET;
+	}
+
+	void RangeAllocator::Free(uint32_t Offset, uint32_t Count)
+	{
+		if (Count == 0)
+			return;
+
+		assert(Offset + Count <= m_Capacity && "Range is outside of the allocator");
+		m_UsedCount -= Count;
+
+		auto Next = m_FreeRanges.lower_bound(Offset);
+
+		// Merge with the free range right after
+		if (Next != m_FreeRanges.end() && Next->first == Offset + Count)
+		{
+			Count += Next->second;
+			Next = m_FreeRanges.erase(Next);
+		}
+
+		// And with the one right before
+		if (Next != m_FreeRanges.begin())
+		{
+			auto Previous = std::prev(Next);
+			if (Previous->first + Previous->second == Offset)
+			{
+				Previous->second += Count;
+				return;
+			}
+		}
+
+		m_FreeRanges[Offset] = Count;
+	}
+
+	void RangeAllocator::Grow(uint32_t NewCapacity)
+	{
+		assert(NewCapacity >= m_Capacity);
+
+		const uint32_t OldCapacity = m_Capacity;
+		m_Capacity = NewCapacity;
+
+		// Counts as a free of the new tail, which also merges it with a trailing free range
+		m_UsedCount += NewCapacity - OldCapacity;
+		Free(OldCapacity, NewCapacity - OldCapacity);
+	}
+
+	GeometryPool::GeometryPool(EngineDevice& Device, VertexFormat Format, uint32_t VertexCapacity, uint32_t IndexCapacity, uint32_t Index16Capacity)
+		: m_Device(Device)
+		, m_VertexFormat(Format)
+		, m_VertexStride(VertexQuantizer::GetVertexStride(Format))
+		, m_VertexRanges(VertexCapacity)
+		, m_IndexRanges(IndexCapacity)
+		, m_Index16Ranges(Index16Capacity)
+	{
+		m_VertexBuffer = CreateBuffer(m_VertexStride, VertexCapacity, VERTEX_USAGE);
+		m_IndexBuffer = CreateBuffer(sizeof(uint32_t), IndexCapacity, INDEX_USAGE);
+		m_Index16Buffer = CreateBuffer(sizeof(uint16_t), Index16Capacity, INDEX_USAGE);
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+
+	}
+
+	std::unique_ptr<Buffer> GeometryPool::CreateBuffer(VkDeviceSize ElementSize, uint32_t Capacity, VkBufferUsageFlags Usage)
+	{
+		return std::make_unique<Buffer>(m_Device, ElementSize, Capacity, Usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void GeometryPool::Grow(std::unique_ptr<Buffer>& Target, RangeAllocator& Allocator, VkDeviceSize ElementSize, uint32_t MinCapacity, VkBufferUsageFlags Usage)
+	{
+		uint32_t Capacity = std::max(Allocator.GetCapacity(), 1u);
+		while (Capacity < MinCapacity)
+			Capacity *= 2;
+
+		std::unique_ptr<Buffer> Grown = CreateBuffer(ElementSize, Capacity, Usage);
+		m_Device.CopyBuffer(Target->GetBuffer(), Grown->GetBuffer(), Target->GetBufferSize());
+
+		Target = std::move(Grown);
+		Allocator.Grow(Capacity);
+		m_GrowCount++;
+
+		std::cout << "Geometry pool grown to " << Capacity << (Usage == VERTEX_USAGE ? " vertices" : " indices") << std::endl;
+	}
+
+	GeometryRange GeometryPool::Allocate(uint32_t VertexCount, uint32_t IndexCount, VkIndexType IndexType)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		const bool Use16 = IndexType == VK_INDEX_TYPE_UINT16;
+		std::unique_ptr<Buffer>& IndexBuffer = Use16 ? m_Index16Buffer : m_IndexBuffer;
+		RangeAllocator& IndexRanges = Use16 ? m_Index16Ranges : m_IndexRanges;
+
+		GeometryRange Range;
+		Range.VertexCount = VertexCount;
+		Range.IndexCount = IndexCount;
+		Range.IndexType = IndexType;
+		Range.FirstVertex = m_VertexRanges.Allocate(VertexCount);
+		Range.FirstIndex = IndexRanges.Allocate(IndexCount);
+
+		if (Range.FirstVertex != RangeAllocator::INVALID_OFFSET && Range.FirstIndex != RangeAllocator::INVALID_OFFSET)
+			return Range;
+
+		// Pending copies target the old buffers and drawn frames read them, both have to finish before the swap
+		m_Device.GetUploadManager().WaitIdle();
+		vkDeviceWaitIdle(m_Device.Device());
+
+		// Doubling leaves the free space at the end, large enough for the request even if it was fragmented before
+		if (Range.FirstVertex == RangeAllocator::INVALID_OFFSET)
+		{
+			Grow(m_VertexBuffer, m_VertexRanges, m_VertexStride, m_VertexRanges.GetCapacity() + VertexCount, VERTEX_USAGE);
+			Range.FirstVertex = m_VertexRanges.Allocate(VertexCount);
+		}
+
+		if (Range.FirstIndex == RangeAllocator::INVALID_OFFSET)
+		{
+			Grow(IndexBuffer, IndexRanges, GetIndexSize(IndexType), IndexRanges.GetCapacity() + IndexCount, INDEX_USAGE);
+			Range.FirstIndex = IndexRanges.Allocate(IndexCount);
+		}
+
+		assert(Range.FirstVertex != RangeAllocator::INVALID_OFFSET && Range.FirstIndex != RangeAllocator::INVALID_OFFSET);
+		return Range;
+	}
+
+	UploadManager::Ticket GeometryPool::Upload(const GeometryRange& Range, const void* Vertices, const void* Indices)
+	{
+		UploadManager& Uploads = m_Device.GetUploadManager();
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		UploadManager::Ticket Ticket = Uploads.UploadToBuffer(m_VertexBuffer->GetBuffer(), Vertices, Range.VertexCount * m_VertexStride, Range.FirstVertex * m_VertexStride);
+
+		// Batched with the vertex upload, the later ticket covers both
+		if (Range.IndexCount > 0)
+		{
+			const VkDeviceSize IndexSize = GetIndexSize(Range.IndexType);
+			Ticket = Uploads.UploadToBuffer(GetIndexBuffer(Range.IndexType), Indices, Range.IndexCount * IndexSize, Range.FirstIndex * IndexSize);
+		}
+
+		return Ticket;
+	}
+
+	void GeometryPool::Free(const GeometryRange& Range)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_PendingFrees.push_back({ Range, m_UpdateCount + FREE_DELAY_UPDATES });
+	}
+
+	void GeometryPool::Update()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		m_UpdateCount++;
+
+		auto Released = std::remove_if(m_PendingFrees.begin(), m_PendingFrees.end(), [this](const PendingFree& Pending)
+		{
+			if (Pending.ReleaseUpdate > m_UpdateCount)
+				return false;
+
+			m_VertexRanges.Free(Pending.Range.FirstVertex, Pending.Range.VertexCount);
+			RangeAllocator& IndexRanges = Pending.Range.IndexType == VK_INDEX_TYPE_UINT16 ? m_Index16Ranges : m_IndexRanges;
+			IndexRanges.Free(Pending.Range.FirstIndex, Pending.Range.IndexCount);
+			return true;
+		});
+
+		m_PendingFrees.erase(Released, m_PendingFrees.end());
+	}
+
+	void GeometryPool::SetVertexFormat(VertexFormat Format)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		if (Format == m_VertexFormat)
+			return;
+
+		// Ranges waiting in m_PendingFrees are still counted as used
+		if (m_VertexRanges.GetUsedCount() > 0)
+			throw std::runtime_error("Can not change the vertex format of a geometry pool holding vertices");
+
+		// Frames drawn before the switch may still read the old buffer
+		vkDeviceWaitIdle(m_Device.Device());
+
+		m_VertexFormat = Format;
+		m_VertexStride = VertexQuantizer::GetVertexStride(Format);
+		m_VertexBuffer = CreateBuffer(m_VertexStride, m_VertexRanges.GetCapacity(), VERTEX_USAGE);
+
+		std::cout << "Geometry pool vertex format set to " << VertexQuantizer::GetFormatName(Format) << ", " << m_VertexStride << " bytes per vertex" << std::endl;
+	}
+
+	void GeometryPool::Bind(VkCommandBuffer CommandBuffer, VkIndexType IndexType) const
+	{
+		VkBuffer Buffers[] = { m_VertexBuffer->GetBuffer() };
+		VkDeviceSize Offsets[] = { 0 };
+		vkCmdBindVertexBuffers(CommandBuffer, 0, 1, Buffers, Offsets);
+		BindIndexBuffer(CommandBuffer, IndexType);
+	}
+
+	void GeometryPool::BindIndexBuffer(VkCommandBuffer CommandBuffer, VkIndexType IndexType) const
+	{
+		vkCmdBindIndexBuffer(CommandBuffer, GetIndexBuffer(IndexType), 0, IndexType);
+	}
+
+	GeometryPool::Stats GeometryPool::GetStats() const
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		Stats Result;
+		Result.VertexCount = m_VertexRanges.GetUsedCount();
+		Result.VertexCapacity = m_VertexRanges.GetCapacity();
+		Result.IndexCount = m_IndexRanges.GetUsedCount();
+		Result.IndexCapacity = m_IndexRanges.GetCapacity();
+		Result.Index16Count = m_Index16Ranges.GetUsedCount();
+		Result.Index16Capacity = m_Index16Ranges.GetCapacity();
+		Result.FreeRangeCount = m_VertexRanges.GetFreeRangeCount() + m_IndexRanges.GetFreeRangeCount() + m_Index16Ranges.GetFreeRangeCount();
+		Result.GrowCount = m_GrowCount;
+		return Result;
+	}
+}
\ No newline at end of file
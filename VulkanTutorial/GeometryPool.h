@@ -0,0 +1,153 @@
+#ifndef __GeometryPool_h__
+#define __GeometryPool_h__
+
+#include "EngineDevice.h"
+#include "Buffer.h"
+#include "UploadManager.h"
+#include "VertexFormat.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// First fit free list over [0, Capacity) elements, neighbouring free ranges are merged on free
+	class RangeAllocator
+	{
+	public:
+
+		static constexpr uint32_t INVALID_OFFSET = ~0u;
+
+		RangeAllocator(uint32_t Capacity);
+
+		uint32_t Allocate(uint32_t Count);
+		void Free(uint32_t Offset, uint32_t Count);
+
+		// Adds [Capacity, NewCapacity) as free space
+		void Grow(uint32_t NewCapacity);
+
+		uint32_t GetCapacity() const { return m_Capacity; }
+		uint32_t GetUsedCount() const { return m_UsedCount; }
+		uint32_t GetFreeRangeCount() const { return (uint32_t)m_FreeRanges.size(); }
+
+	private:
+
+		uint32_t m_Capacity;
+		uint32_t m_UsedCount = 0;
+
+		// Offset to count
+		std::map<uint32_t, uint32_t> m_FreeRanges;
+	};
+
+	// Where a mesh lives inside the geometry pool, indices are relative to FirstVertex. FirstIndex counts elements of
+	// the index buffer matching IndexType.
+	struct GeometryRange
+	{
+		uint32_t FirstVertex = 0;
+		uint32_t VertexCount = 0;
+		uint32_t FirstIndex = 0;
+		uint32_t IndexCount = 0;
+		VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+	};
+
+	// One device local vertex buffer and one index buffer per index type shared by every mesh, so a frame binds
+	// geometry once per index type and draws address meshes through firstIndex and vertexOffset. Freed ranges are only
+	// reused once the frames that may still read them have completed. Allocate may grow the buffers, which drains the
+	// device, so allocate and free on the thread that submits frames.
+	class GeometryPool
+	{
+	public:
+
+		static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1024 * 1024;
+		// Most meshes fit 16 bit indices, the 32 bit buffer only holds the larger ones
+		static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 1024 * 1024;
+		static constexpr uint32_t DEFAULT_INDEX16_CAPACITY = 4 * 1024 * 1024;
+
+		struct Stats
+		{
+			uint32_t VertexCount = 0;
+			uint32_t VertexCapacity = 0;
+			uint32_t IndexCount = 0;
+			uint32_t IndexCapacity = 0;
+			uint32_t Index16Count = 0;
+			uint32_t Index16Capacity = 0;
+			// Holes in the vertex and index buffers, a measure of fragmentation
+			uint32_t FreeRangeCount = 0;
+			uint32_t GrowCount = 0;
+		};
+
+		GeometryPool(EngineDevice& Device, VertexFormat Format = VertexFormat::Float32, uint32_t VertexCapacity = DEFAULT_VERTEX_CAPACITY, uint32_t IndexCapacity = DEFAULT_INDEX_CAPACITY
+			, uint32_t Index16Capacity = DEFAULT_INDEX16_CAPACITY);
+		virtual ~GeometryPool();
+
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator = (const GeometryPool&) = delete;
+
+		GeometryPool(GeometryPool&&) = delete;
+		GeometryPool& operator = (GeometryPool&&) = delete;
+
+		static VkDeviceSize GetIndexSize(VkIndexType IndexType) { return IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+		GeometryRange Allocate(uint32_t VertexCount, uint32_t IndexCount, VkIndexType IndexType = VK_INDEX_TYPE_UINT32);
+
+		// Copies through the UploadManager, the range must not be drawn before the returned ticket is complete. Indices
+		// are of the range's IndexType.
+		UploadManager::Ticket Upload(const GeometryRange& Range, const void* Vertices, const void* Indices);
+
+		// The range stays reserved for the frames in flight that may still draw it
+		void Free(const GeometryRange& Range);
+
+		// Returns ranges freed enough frames ago to the free lists, call once per frame
+		void Update();
+
+		// Switches the layout of every vertex, only allowed while no vertices are allocated. Pipelines reading the pool
+		// have to be created after this.
+		void SetVertexFormat(VertexFormat Format);
+
+		// Binds the vertex buffer and the index buffer of IndexType
+		void Bind(VkCommandBuffer CommandBuffer, VkIndexType IndexType = VK_INDEX_TYPE_UINT32) const;
+		// Switches index type, the vertex buffer binding stays
+		void BindIndexBuffer(VkCommandBuffer CommandBuffer, VkIndexType IndexType) const;
+
+		VkBuffer GetVertexBuffer() const { return m_VertexBuffer->GetBuffer(); }
+		VkBuffer GetIndexBuffer(VkIndexType IndexType = VK_INDEX_TYPE_UINT32) const { return IndexType == VK_INDEX_TYPE_UINT16 ? m_Index16Buffer->GetBuffer() : m_IndexBuffer->GetBuffer(); }
+		VkDeviceSize GetVertexStride() const { return m_VertexStride; }
+		VertexFormat GetVertexFormat() const { return m_VertexFormat; }
+
+		Stats GetStats() const;
+
+	private:
+
+		struct PendingFree
+		{
+			GeometryRange Range;
+			uint64_t ReleaseUpdate;
+		};
+
+		std::unique_ptr<Buffer> CreateBuffer(VkDeviceSize ElementSize, uint32_t Capacity, VkBufferUsageFlags Usage);
+
+		// Replaces Target with a copy of at least MinCapacity elements, the device has to be drained first
+		void Grow(std::unique_ptr<Buffer>& Target, RangeAllocator& Allocator, VkDeviceSize ElementSize, uint32_t MinCapacity, VkBufferUsageFlags Usage);
+
+		EngineDevice& m_Device;
+		VertexFormat m_VertexFormat;
+		VkDeviceSize m_VertexStride;
+
+		mutable std::mutex m_Mutex;
+		std::unique_ptr<Buffer> m_VertexBuffer;
+		std::unique_ptr<Buffer> m_IndexBuffer;
+		std::unique_ptr<Buffer> m_Index16Buffer;
+		RangeAllocator m_VertexRanges;
+		RangeAllocator m_IndexRanges;
+		RangeAllocator m_Index16Ranges;
+
+		std::vector<PendingFree> m_PendingFrees;
+		uint64_t m_UpdateCount = 0;
+		uint32_t m_GrowCount = 0;
+	};
+}
+
+#endif //__GeometryPool_h__
@@ -0,0 +1,213 @@
+#include "GpuCulling.h"
+#include "RenderPipeline.h"
+#include "UploadManager.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace VulkanTutorial
+{
+	struct CullPushConstantData
+	{
+		glm::vec4 FrustumPlanes[6];
+		// Camera position in xyz, LodParameters::ErrorScale in w
+		glm::vec4 LodCamera;
+		uint32_t ObjectCount;
+		uint32_t LodPerspective;
+	};
+
+	static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+	GpuCulling::GpuCulling(EngineDevice& Device)
+		: m_EngineDevice(Device)
+	{
+		m_SetLayout = DescriptorSetLayout::Builder(m_EngineDevice)
+			.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.Build();
+
+		m_DescriptorPool = DescriptorPool::Builder(m_EngineDevice)
+			.SetMaxSets(MAX_FRAMES)
+			.AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_FRAMES * 4)
+			.Build();
+
+		CreatePipeline();
+	}
+
+	GpuCulling::~GpuCulling()
+	{
+		vkDestroyPipeline(m_EngineDevice.Device(), m_Pipeline, nullptr);
+		vkDestroyShaderModule(m_EngineDevice.Device(), m_ShaderModule, nullptr);
+		vkDestroyPipelineLayout(m_EngineDevice.Device(), m_PipelineLayout, nullptr);
+	}
+
+	void GpuCulling::CreatePipeline()
+	{
+		VkPushConstantRange PushConstantRange;
+		PushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		PushConstantRange.offset = 0;
+		PushConstantRange.size = sizeof(CullPushConstantData);
+
+		VkDescriptorSetLayout SetLayout = m_SetLayout->GetDescriptorSetLayout();
+
+		VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
+		PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		PipelineLayoutInfo.setLayoutCount = 1;
+		PipelineLayoutInfo.pSetLayouts = &SetLayout;
+		PipelineLayoutInfo.pushConstantRangeCount = 1;
+		PipelineLayoutInfo.pPushConstantRanges = &PushConstantRange;
+		if (vkCreatePipelineLayout(m_EngineDevice.Device(), &PipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create culling pipeline layout!");
+
+		std::vector<int8_t> Code = RenderPipeline::ReadRile("./../../Content/CullObjects.comp.spv");
+
+		VkShaderModuleCreateInfo ModuleInfo{};
+		ModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		ModuleInfo.codeSize = Code.size();
+		ModuleInfo.pCode = (const uint32_t*)Code.data();
+		if (vkCreateShaderModule(m_EngineDevice.Device(), &ModuleInfo, nullptr, &m_ShaderModule) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create culling shader module");
+
+		VkComputePipelineCreateInfo PipelineInfo{};
+		PipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		PipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		PipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		PipelineInfo.stage.module = m_ShaderModule;
+		PipelineInfo.stage.pName = "main";
+		PipelineInfo.layout = m_PipelineLayout;
+		PipelineInfo.basePipelineIndex = -1;
+		PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(m_EngineDevice.Device(), m_EngineDevice.GetPipelineCache().GetPipelineCache(), 1, &PipelineInfo, nullptr, &m_Pipeline) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create culling pipeline");
+	}
+
+	void GpuCulling::SetScene(const std::vector<CullObject>& Objects, const std::vector<CullLod>& Lods, uint32_t CommandCapacity, uint32_t BatchCount)
+	{
+		for (FrameResources& Frame : m_Frames)
+			Frame = FrameResources{};
+
+		m_DescriptorPool->ResetPool();
+		m_Objects.reset();
+		m_Lods.reset();
+
+		m_ObjectCount = (uint32_t)Objects.size();
+		m_CommandCapacity = CommandCapacity;
+		m_BatchCount = BatchCount;
+
+		if (m_ObjectCount == 0)
+			return;
+
+		m_Objects = std::make_unique<Buffer>(m_EngineDevice, sizeof(CullObject), m_ObjectCount
+			, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		m_EngineDevice.GetUploadManager().UploadToBuffer(m_Objects->GetBuffer(), Objects.data(), sizeof(CullObject) * Objects.size());
+
+		assert(!Lods.empty() && "Every culled object needs at least its full detail level");
+
+		m_Lods = std::make_unique<Buffer>(m_EngineDevice, sizeof(CullLod), (uint32_t)Lods.size()
+			, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		m_EngineDevice.GetUploadManager().UploadToBuffer(m_Lods->GetBuffer(), Lods.data(), sizeof(CullLod) * Lods.size());
+	}
+
+	GpuCulling::FrameResources& GpuCulling::GetFrame(int FrameIndex)
+	{
+		assert(FrameIndex >= 0 && FrameIndex < (int)MAX_FRAMES && "Frame index out of range");
+
+		FrameResources& Frame = m_Frames[FrameIndex];
+		if (Frame.Counters)
+			return Frame;
+
+		Frame.Counters = std::make_unique<Buffer>(m_EngineDevice, sizeof(uint32_t), COUNTER_HEADER_SIZE + m_BatchCount
+			, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		Frame.Commands = std::make_unique<Buffer>(m_EngineDevice, sizeof(VkDrawIndexedIndirectCommand), m_CommandCapacity
+			, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		Frame.Readback = std::make_unique<Buffer>(m_EngineDevice, sizeof(CullStats), 1
+			, VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		Frame.Readback->Map();
+
+		auto ObjectsInfo = m_Objects->DescriptorInfo();
+		auto CountersInfo = Frame.Counters->DescriptorInfo();
+		auto CommandsInfo = Frame.Commands->DescriptorInfo();
+		auto LodsInfo = m_Lods->DescriptorInfo();
+
+		DescriptorWriter(*m_SetLayout, *m_DescriptorPool)
+			.WriteBuffer(0, &ObjectsInfo)
+			.WriteBuffer(1, &CountersInfo)
+			.WriteBuffer(2, &CommandsInfo)
+			.WriteBuffer(3, &LodsInfo)
+			.Build(Frame.DescriptorSet);
+
+		return Frame;
+	}
+
+	void GpuCulling::Cull(VkCommandBuffer CommandBuffer, int FrameIndex, const Frustum& ViewFrustum, const LodParameters& Lod)
+	{
+		if (m_ObjectCount == 0)
+			return;
+
+		FrameResources& Frame = GetFrame(FrameIndex);
+
+		// The frame that last used these buffers has completed, its counters are ready
+		if (Frame.HasResults)
+			m_Stats = *(const CullStats*)Frame.Readback->GetMappedMemory();
+
+		vkCmdFillBuffer(CommandBuffer, Frame.Counters->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+		// Without a GPU side draw count every slot is drawn, slots nobody wrote stay zero and draw nothing
+		if (!m_EngineDevice.SupportsDrawIndirectCount())
+			vkCmdFillBuffer(CommandBuffer, Frame.Commands->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier ClearBarrier{};
+		ClearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		ClearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		ClearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+			, 0, 1, &ClearBarrier, 0, nullptr, 0, nullptr);
+
+		CullPushConstantData Push;
+		for (int i = 0; i < 6; i++)
+			Push.FrustumPlanes[i] = ViewFrustum.Planes[i];
+		Push.LodCamera = glm::vec4(Lod.CameraPosition, Lod.ErrorScale);
+		Push.ObjectCount = m_ObjectCount;
+		Push.LodPerspective = Lod.Perspective ? 1 : 0;
+
+		vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+		vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &Frame.DescriptorSet, 0, nullptr);
+		vkCmdPushConstants(CommandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &Push);
+		vkCmdDispatch(CommandBuffer, (m_ObjectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+		VkMemoryBarrier CullBarrier{};
+		CullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		CullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		CullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT
+			, 0, 1, &CullBarrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy StatsCopy{};
+		StatsCopy.srcOffset = 0;
+		StatsCopy.dstOffset = 0;
+		StatsCopy.size = sizeof(CullStats);
+		vkCmdCopyBuffer(CommandBuffer, Frame.Counters->GetBuffer(), Frame.Readback->GetBuffer(), 1, &StatsCopy);
+
+		VkMemoryBarrier ReadbackBarrier{};
+		ReadbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		ReadbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		ReadbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT
+			, 0, 1, &ReadbackBarrier, 0, nullptr, 0, nullptr);
+
+		Frame.HasResults = true;
+	}
+}
\ No newline at end of file
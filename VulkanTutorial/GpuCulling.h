@@ -0,0 +1,136 @@
+#ifndef __GpuCulling_h__
+#define __GpuCulling_h__
+
+#include "EngineDevice.h"
+#include "Buffer.h"
+#include "Descriptors.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Compute pass testing object bounding spheres against the camera frustum. Surviving objects of each batch are
+	// compacted into that batch's range of a per frame indirect command buffer, with one draw counter per batch.
+	// Each survivor draws the coarsest level of detail of its mesh that its distance to the camera allows.
+	class GpuCulling
+	{
+	public:
+
+		// Matches CullObject in CullObjects.comp
+		struct CullObject
+		{
+			// World space center in xyz, radius in w
+			glm::vec4 Sphere;
+			uint32_t BatchIndex;
+			// First command of the batch in the output command buffer
+			uint32_t CommandBase;
+			uint32_t InstanceSlot;
+			// Levels of the object's mesh in the LOD table
+			uint32_t LodBase;
+			uint32_t LodCount;
+			// Mesh position inside the geometry pool
+			int32_t VertexOffset;
+			// std430 rounds the struct up to the vec4 alignment
+			uint32_t Padding[2];
+		};
+
+		// Matches CullLod in CullObjects.comp
+		struct CullLod
+		{
+			// Inside the geometry pool's index buffer
+			uint32_t FirstIndex;
+			uint32_t IndexCount;
+			// Error of the level divided by the mesh's bounding sphere radius, so the world space sphere scales it
+			float RelativeError;
+			uint32_t Padding;
+		};
+
+		// Per frame level of detail selection, an ErrorScale of zero draws every object at full detail
+		struct LodParameters
+		{
+			glm::vec3 CameraPosition{ 0.0f };
+			// Pixels covered by one world unit at distance one, divided by the largest allowed error in pixels
+			float ErrorScale = 0.0f;
+			// Orthographic projections do not shrink objects with distance
+			bool Perspective = true;
+		};
+
+		struct CullStats
+		{
+			uint32_t TestedCount = 0;
+			uint32_t VisibleCount = 0;
+			// Triangles of the selected levels of visible objects
+			uint32_t TriangleCount = 0;
+		};
+
+		static constexpr uint32_t MAX_FRAMES = 8;
+
+		GpuCulling(EngineDevice& Device);
+		virtual ~GpuCulling();
+
+		GpuCulling(const GpuCulling&) = delete;
+		GpuCulling& operator = (const GpuCulling&) = delete;
+
+		GpuCulling(GpuCulling&&) = delete;
+		GpuCulling& operator = (GpuCulling&&) = delete;
+
+		// Uploads the objects to test and the LOD table they index through the device's UploadManager, Cull may only
+		// be recorded once the next Flush's ticket is complete. CommandCapacity is the size of the output command array
+		// and BatchCount the number of draw counters. No frame in flight may still use the previous scene, per frame
+		// buffers are recreated on next use.
+		void SetScene(const std::vector<CullObject>& Objects, const std::vector<CullLod>& Lods, uint32_t CommandCapacity, uint32_t BatchCount);
+
+		// Records the counter reset, the dispatch and the barrier that makes the results visible to indirect draws.
+		// Must be recorded outside of a render pass.
+		void Cull(VkCommandBuffer CommandBuffer, int FrameIndex, const Frustum& ViewFrustum, const LodParameters& Lod);
+
+		VkBuffer GetCommandBuffer(int FrameIndex) const { return m_Frames[FrameIndex].Commands->GetBuffer(); }
+		VkBuffer GetCountBuffer(int FrameIndex) const { return m_Frames[FrameIndex].Counters->GetBuffer(); }
+
+		// Byte offset of the draw count of a batch inside the count buffer
+		static VkDeviceSize GetCountOffset(uint32_t BatchIndex) { return (COUNTER_HEADER_SIZE + BatchIndex) * sizeof(uint32_t); }
+
+		// Counters of the most recently completed cull, they lag a few frames behind
+		const CullStats& GetStats() const { return m_Stats; }
+
+	private:
+
+		// testedCount, visibleCount and triangleCount precede the per batch draw counts
+		static constexpr uint32_t COUNTER_HEADER_SIZE = 3;
+
+		struct FrameResources
+		{
+			std::unique_ptr<Buffer> Counters;
+			std::unique_ptr<Buffer> Commands;
+			std::unique_ptr<Buffer> Readback;
+			VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+			bool HasResults = false;
+		};
+
+		void CreatePipeline();
+		FrameResources& GetFrame(int FrameIndex);
+
+		EngineDevice& m_EngineDevice;
+
+		std::unique_ptr<DescriptorSetLayout> m_SetLayout;
+		std::unique_ptr<DescriptorPool> m_DescriptorPool;
+		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+		VkShaderModule m_ShaderModule = VK_NULL_HANDLE;
+
+		std::unique_ptr<Buffer> m_Objects;
+		std::unique_ptr<Buffer> m_Lods;
+		uint32_t m_ObjectCount = 0;
+		uint32_t m_CommandCapacity = 0;
+		uint32_t m_BatchCount = 0;
+
+		FrameResources m_Frames[MAX_FRAMES];
+		CullStats m_Stats;
+	};
+}
+
+#endif //__GpuCulling_h__
\ No newline at end of file
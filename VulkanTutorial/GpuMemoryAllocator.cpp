@@ -0,0 +1,575 @@
+#include "GpuMemoryAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		uint32_t FloorLog2(VkDeviceSize Value)
+		{
+			uint32_t Result = 0;
+			while (Value > 1)
+			{
+				Value >>= 1;
+				Result++;
+			}
+
+			return Result;
+		}
+
+		VkDeviceSize AlignUp(VkDeviceSize Value, VkDeviceSize Alignment)
+		{
+			return (Value + Alignment - 1) / Alignment * Alignment;
+		}
+
+		// Hands out fake handles without touching a GPU, counts what would have been vkAllocateMemory calls
+		class MockMemoryBackend : public GpuMemoryBackend
+		{
+		public:
+
+			VkResult AllocateMemory(uint32_t MemoryTypeIndex, VkDeviceSize Size, VkDeviceMemory& OutMemory) override
+			{
+				OutMemory = (VkDeviceMemory)(uintptr_t)(++m_NextHandle);
+				return VK_SUCCESS;
+			}
+
+			void FreeMemory(VkDeviceMemory Memory) override {}
+			void* MapMemory(VkDeviceMemory Memory) override { return nullptr; }
+			void UnmapMemory(VkDeviceMemory Memory) override {}
+
+		private:
+
+			uint64_t m_NextHandle = 0;
+		};
+	}
+
+	BuddyAllocator::BuddyAllocator(uint32_t MinOrder, uint32_t MaxOrder)
+		: m_MinOrder(MinOrder)
+		, m_MaxOrder(MaxOrder)
+	{
+		assert(MinOrder <= MaxOrder && MaxOrder < 63);
+
+		m_FreeNodes.resize(MaxOrder + 1);
+		m_FreeNodes[MaxOrder].insert(0);
+	}
+
+	uint32_t BuddyAllocator::GetOrder(VkDeviceSize Size, VkDeviceSize Alignment) const
+	{
+		const VkDeviceSize Needed = std::max(Size, Alignment);
+
+		uint32_t Order = m_MinOrder;
+		while (Order <= m_MaxOrder && (1ull << Order) < Needed)
+			Order++;
+
+		return Order;
+	}
+
+	VkDeviceSize BuddyAllocator::GetNodeSize(VkDeviceSize Size, VkDeviceSize Alignment) const
+	{
+		return 1ull << GetOrder(Size, Alignment);
+	}
+
+	VkDeviceSize BuddyAllocator::GetAllocatedNodeSize(VkDeviceSize Offset) const
+	{
+		auto It = m_AllocatedOrders.find(Offset);
+		return It != m_AllocatedOrders.end() ? 1ull << It->second : 0;
+	}
+
+	VkDeviceSize BuddyAllocator::Allocate(VkDeviceSize Size, VkDeviceSize Alignment)
+	{
+		const uint32_t Order = GetOrder(Size, Alignment);
+		if (Order > m_MaxOrder)
+			return INVALID_OFFSET;
+
+		uint32_t FreeOrder = Order;
+		while (FreeOrder <= m_MaxOrder && m_FreeNodes[FreeOrder].empty())
+			FreeOrder++;
+
+		if (FreeOrder > m_MaxOrder)
+			return INVALID_OFFSET;
+
+		const VkDeviceSize Offset = *m_FreeNodes[FreeOrder].begin();
+		m_FreeNodes[FreeOrder].erase(m_FreeNodes[FreeOrder].begin());
+
+		// Split down to the requested order, the upper halves become free buddies
+		while (FreeOrder > Order)
+		{
+			FreeOrder--;
+			m_FreeNodes[FreeOrder].insert(Offset + (1ull << FreeOrder));
+		}
+
+		m_AllocatedOrders[Offset] = Order;
+		m_ReservedSize += 1ull << Order;
+		return Offset;
+	}
+
+	void BuddyAllocator::Free(VkDeviceSize Offset)
+	{
+		auto It = m_AllocatedOrders.find(Offset);
+		assert(It != m_AllocatedOrders.end() && "Offset was not allocated from this block");
+		if (It == m_AllocatedOrders.end())
+			return;
+
+		uint32_t Order = It->second;
+		m_AllocatedOrders.erase(It);
+		m_ReservedSize -= 1ull << Order;
+
+		// Merge with the buddy for as long as it is free
+		while (Order < m_MaxOrder)
+		{
+			auto Buddy = m_FreeNodes[Order].find(Offset ^ (1ull << Order));
+			if (Buddy == m_FreeNodes[Order].end())
+				break;
+
+			Offset = std::min(Offset, *Buddy);
+			m_FreeNodes[Order].erase(Buddy);
+			Order++;
+		}
+
+		m_FreeNodes[Order].insert(Offset);
+	}
+
+	VkDeviceSize BuddyAllocator::GetLargestFreeNode() const
+	{
+		for (uint32_t Order = m_MaxOrder + 1; Order-- > m_MinOrder;)
+		{
+			if (!m_FreeNodes[Order].empty())
+				return 1ull << Order;
+		}
+
+		return 0;
+	}
+
+	VkResult VulkanMemoryBackend::AllocateMemory(uint32_t MemoryTypeIndex, VkDeviceSize Size, VkDeviceMemory& OutMemory)
+	{
+		VkMemoryAllocateInfo AllocInfo{};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		AllocInfo.allocationSize = Size;
+		AllocInfo.memoryTypeIndex = MemoryTypeIndex;
+
+		return vkAllocateMemory(m_Device, &AllocInfo, nullptr, &OutMemory);
+	}
+
+	void VulkanMemoryBackend::FreeMemory(VkDeviceMemory Memory)
+	{
+		vkFreeMemory(m_Device, Memory, nullptr);
+	}
+
+	void* VulkanMemoryBackend::MapMemory(VkDeviceMemory Memory)
+	{
+		void* Mapped = nullptr;
+		if (vkMapMemory(m_Device, Memory, 0, VK_WHOLE_SIZE, 0, &Mapped) != VK_SUCCESS)
+			return nullptr;
+
+		return Mapped;
+	}
+
+	void VulkanMemoryBackend::UnmapMemory(VkDeviceMemory Memory)
+	{
+		vkUnmapMemory(m_Device, Memory);
+	}
+
+	GpuMemoryAllocator::GpuMemoryAllocator(GpuMemoryBackend& Backend, const VkPhysicalDeviceMemoryProperties& MemoryProperties, const VkPhysicalDeviceLimits& Limits, VkDeviceSize BlockSize)
+		: m_Backend(Backend)
+		, m_MemoryProperties(MemoryProperties)
+		, m_NonCoherentAtomSize(std::max<VkDeviceSize>(Limits.nonCoherentAtomSize, 1))
+		, m_BlockSize(1ull << FloorLog2(BlockSize))
+	{
+		// Pool index is MemoryTypeIndex * 2 + ResourceKind
+		m_Pools.resize(m_MemoryProperties.memoryTypeCount * 2);
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			const VkMemoryType& Type = m_MemoryProperties.memoryTypes[i];
+			const VkDeviceSize HeapSize = m_MemoryProperties.memoryHeaps[Type.heapIndex].size;
+
+			// Small heaps like the 256MB host visible VRAM window get smaller blocks so one block can not hog them
+			const VkDeviceSize PoolBlockSize = std::max<VkDeviceSize>(std::min(m_BlockSize, HeapSize / 8), 1ull << MIN_ORDER);
+
+			for (uint32_t Kind = 0; Kind < 2; Kind++)
+			{
+				Pool& MemoryPool = m_Pools[i * 2 + Kind];
+				MemoryPool.MemoryTypeIndex = i;
+				MemoryPool.IsHostVisible = (Type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+				MemoryPool.BlockOrder = FloorLog2(PoolBlockSize);
+			}
+		}
+	}
+
+	GpuMemoryAllocator::~GpuMemoryAllocator()
+	{
+		assert(m_AllocationCount == 0 && "GPU memory allocations outlived the allocator");
+
+		for (Pool& MemoryPool : m_Pools)
+		{
+			for (Block& MemoryBlock : MemoryPool.Blocks)
+			{
+				if (MemoryBlock.Memory == VK_NULL_HANDLE)
+					continue;
+
+				if (MemoryBlock.Mapped)
+					m_Backend.UnmapMemory(MemoryBlock.Memory);
+
+				m_Backend.FreeMemory(MemoryBlock.Memory);
+			}
+		}
+
+		for (auto& [Memory, Size] : m_DedicatedAllocations)
+			m_Backend.FreeMemory(Memory);
+	}
+
+	uint32_t GpuMemoryAllocator::FindMemoryType(uint32_t TypeFilter, VkMemoryPropertyFlags Properties, uint32_t FirstType) const
+	{
+		for (uint32_t i = FirstType; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			if ((TypeFilter & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & Properties) == Properties)
+				return i;
+		}
+
+		return ~0u;
+	}
+
+	GpuAllocation GpuMemoryAllocator::Allocate(const VkMemoryRequirements& Requirements, VkMemoryPropertyFlags Properties, ResourceKind Kind)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		uint32_t MemoryTypeIndex = FindMemoryType(Requirements.memoryTypeBits, Properties, 0);
+		if (MemoryTypeIndex == ~0u)
+			throw std::runtime_error("failed to find suitable memory type!");
+
+		// Fall back to the next matching type when a heap is exhausted
+		GpuAllocation Allocation;
+		for (; MemoryTypeIndex != ~0u; MemoryTypeIndex = FindMemoryType(Requirements.memoryTypeBits, Properties, MemoryTypeIndex + 1))
+		{
+			if (TryAllocateFromType(MemoryTypeIndex, Requirements, Kind, Allocation))
+			{
+				m_AllocationCount++;
+				m_RequestedBytes += Allocation.RequestedSize;
+				return Allocation;
+			}
+		}
+
+		throw std::runtime_error("failed to allocate gpu memory!");
+	}
+
+	bool GpuMemoryAllocator::TryAllocateFromType(uint32_t MemoryTypeIndex, const VkMemoryRequirements& Requirements, ResourceKind Kind, GpuAllocation& OutAllocation)
+	{
+		const uint32_t PoolIndex = MemoryTypeIndex * 2 + (uint32_t)Kind;
+		Pool& MemoryPool = m_Pools[PoolIndex];
+
+		// Keeping host visible ranges atom aligned means flushing one never touches a neighbour
+		const VkDeviceSize Alignment = MemoryPool.IsHostVisible ? std::max(Requirements.alignment, m_NonCoherentAtomSize) : Requirements.alignment;
+		const VkDeviceSize Size = AlignUp(Requirements.size, m_NonCoherentAtomSize);
+
+		OutAllocation.RequestedSize = Requirements.size;
+		OutAllocation.MemoryTypeIndex = MemoryTypeIndex;
+		OutAllocation.PoolIndex = PoolIndex;
+
+		// Anything over half a block would waste most of it, give it its own memory object
+		if (Size > (1ull << MemoryPool.BlockOrder) / 2)
+		{
+			VkDeviceMemory Memory;
+			if (m_Backend.AllocateMemory(MemoryTypeIndex, Size, Memory) != VK_SUCCESS)
+				return false;
+
+			m_TotalDeviceAllocations++;
+			m_DedicatedAllocations[Memory] = Size;
+
+			OutAllocation.Memory = Memory;
+			OutAllocation.Offset = 0;
+			OutAllocation.Size = Size;
+			OutAllocation.Mapped = MemoryPool.IsHostVisible ? m_Backend.MapMemory(Memory) : nullptr;
+			OutAllocation.BlockIndex = DEDICATED_BLOCK;
+			return true;
+		}
+
+		auto AllocateFromBlock = [&](uint32_t BlockIndex)
+		{
+			Block& MemoryBlock = MemoryPool.Blocks[BlockIndex];
+			if (!MemoryBlock.Allocator)
+				return false;
+
+			const VkDeviceSize Offset = MemoryBlock.Allocator->Allocate(Size, Alignment);
+			if (Offset == BuddyAllocator::INVALID_OFFSET)
+				return false;
+
+			OutAllocation.Memory = MemoryBlock.Memory;
+			OutAllocation.Offset = Offset;
+			OutAllocation.Size = MemoryBlock.Allocator->GetAllocatedNodeSize(Offset);
+			OutAllocation.Mapped = MemoryBlock.Mapped ? MemoryBlock.Mapped + Offset : nullptr;
+			OutAllocation.BlockIndex = BlockIndex;
+			return true;
+		};
+
+		for (uint32_t i = 0; i < MemoryPool.Blocks.size(); i++)
+		{
+			if (AllocateFromBlock(i))
+				return true;
+		}
+
+		uint32_t BlockIndex;
+		if (!CreateBlock(MemoryPool, BlockIndex))
+			return false;
+
+		return AllocateFromBlock(BlockIndex);
+	}
+
+	bool GpuMemoryAllocator::CreateBlock(Pool& MemoryPool, uint32_t& OutBlockIndex)
+	{
+		const VkDeviceSize BlockSize = 1ull << MemoryPool.BlockOrder;
+
+		VkDeviceMemory Memory;
+		if (m_Backend.AllocateMemory(MemoryPool.MemoryTypeIndex, BlockSize, Memory) != VK_SUCCESS)
+			return false;
+
+		m_TotalDeviceAllocations++;
+
+		auto FreeSlot = std::find_if(MemoryPool.Blocks.begin(), MemoryPool.Blocks.end(), [](const Block& MemoryBlock) { return !MemoryBlock.Allocator; });
+		if (FreeSlot == MemoryPool.Blocks.end())
+			FreeSlot = MemoryPool.Blocks.emplace(MemoryPool.Blocks.end());
+
+		FreeSlot->Memory = Memory;
+		FreeSlot->Mapped = MemoryPool.IsHostVisible ? (uint8_t*)m_Backend.MapMemory(Memory) : nullptr;
+		FreeSlot->Allocator = std::make_unique<BuddyAllocator>(std::min(MIN_ORDER, MemoryPool.BlockOrder), MemoryPool.BlockOrder);
+
+		OutBlockIndex = (uint32_t)(FreeSlot - MemoryPool.Blocks.begin());
+		return true;
+	}
+
+	void GpuMemoryAllocator::Free(GpuAllocation& Allocation)
+	{
+		if (Allocation.Memory == VK_NULL_HANDLE)
+			return;
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		if (Allocation.BlockIndex == DEDICATED_BLOCK)
+		{
+			if (Allocation.Mapped)
+				m_Backend.UnmapMemory(Allocation.Memory);
+
+			m_Backend.FreeMemory(Allocation.Memory);
+			m_DedicatedAllocations.erase(Allocation.Memory);
+		}
+		else
+		{
+			Pool& MemoryPool = m_Pools[Allocation.PoolIndex];
+			Block& MemoryBlock = MemoryPool.Blocks[Allocation.BlockIndex];
+			MemoryBlock.Allocator->Free(Allocation.Offset);
+
+			// Keep one empty block per pool around so alloc/free churn at a block boundary does not hit the driver
+			if (MemoryBlock.Allocator->IsEmpty())
+			{
+				const bool HasOtherEmptyBlock = std::any_of(MemoryPool.Blocks.begin(), MemoryPool.Blocks.end(), [&](const Block& Other)
+				{
+					return &Other != &MemoryBlock && Other.Allocator && Other.Allocator->IsEmpty();
+				});
+
+				if (HasOtherEmptyBlock)
+				{
+					if (MemoryBlock.Mapped)
+						m_Backend.UnmapMemory(MemoryBlock.Memory);
+
+					m_Backend.FreeMemory(MemoryBlock.Memory);
+					MemoryBlock = Block{};
+				}
+			}
+		}
+
+		m_AllocationCount--;
+		m_RequestedBytes -= Allocation.RequestedSize;
+		Allocation = GpuAllocation{};
+	}
+
+	VkMappedMemoryRange GpuMemoryAllocator::GetMappedRange(const GpuAllocation& Allocation, VkDeviceSize Size, VkDeviceSize Offset) const
+	{
+		const VkDeviceSize Begin = Allocation.Offset + Offset / m_NonCoherentAtomSize * m_NonCoherentAtomSize;
+		const VkDeviceSize AllocationEnd = Allocation.Offset + Allocation.Size;
+		const VkDeviceSize End = Size == VK_WHOLE_SIZE ? AllocationEnd : std::min(Allocation.Offset + AlignUp(Offset + Size, m_NonCoherentAtomSize), AllocationEnd);
+
+		VkMappedMemoryRange MappedRange{};
+		MappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		MappedRange.memory = Allocation.Memory;
+		MappedRange.offset = Begin;
+		MappedRange.size = End - Begin;
+		return MappedRange;
+	}
+
+	GpuMemoryAllocator::Stats GpuMemoryAllocator::GetStats() const
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		Stats Result;
+		Result.AllocationCount = m_AllocationCount;
+		Result.DedicatedCount = (uint32_t)m_DedicatedAllocations.size();
+		Result.TotalDeviceAllocations = m_TotalDeviceAllocations;
+		Result.RequestedBytes = m_RequestedBytes;
+
+		for (const Pool& MemoryPool : m_Pools)
+		{
+			for (const Block& MemoryBlock : MemoryPool.Blocks)
+			{
+				if (!MemoryBlock.Allocator)
+					continue;
+
+				Result.BlockCount++;
+				Result.BlockBytes += MemoryBlock.Allocator->GetCapacity();
+				Result.ReservedBytes += MemoryBlock.Allocator->GetCapacity() - MemoryBlock.Allocator->GetFreeSize();
+				Result.FreeBytes += MemoryBlock.Allocator->GetFreeSize();
+				Result.LargestFreeRange = std::max(Result.LargestFreeRange, MemoryBlock.Allocator->GetLargestFreeNode());
+			}
+		}
+
+		for (auto& [Memory, Size] : m_DedicatedAllocations)
+			Result.ReservedBytes += Size;
+
+		Result.DeviceAllocationCount = Result.BlockCount + Result.DedicatedCount;
+		return Result;
+	}
+
+	void GpuMemoryAllocator::RunBenchmark()
+	{
+		// A typical discrete GPU: VRAM, system memory in two flavours and the 256MB host visible VRAM window
+		VkPhysicalDeviceMemoryProperties MemoryProperties{};
+		MemoryProperties.memoryHeapCount = 3;
+		MemoryProperties.memoryHeaps[0] = { 8ull << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		MemoryProperties.memoryHeaps[1] = { 16ull << 30, 0 };
+		MemoryProperties.memoryHeaps[2] = { 256ull << 20, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+
+		MemoryProperties.memoryTypeCount = 4;
+		MemoryProperties.memoryTypes[0] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+		MemoryProperties.memoryTypes[1] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1 };
+		MemoryProperties.memoryTypes[2] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1 };
+		MemoryProperties.memoryTypes[3] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 2 };
+
+		VkPhysicalDeviceLimits Limits{};
+		Limits.bufferImageGranularity = 1024;
+		Limits.nonCoherentAtomSize = 64;
+
+		MockMemoryBackend Backend;
+		GpuMemoryAllocator Allocator(Backend, MemoryProperties, Limits);
+
+		// Mostly small vertex, index and uniform buffers with some textures and render targets in between
+		std::mt19937 Random(1234);
+		std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+		struct Request
+		{
+			VkMemoryRequirements Requirements;
+			VkMemoryPropertyFlags Properties;
+			ResourceKind Kind;
+		};
+
+		auto MakeRequest = [&]()
+		{
+			Request Result{};
+			const float Roll = Unit(Random);
+			if (Roll < 0.9f)
+			{
+				// 256B - 1MB log uniform buffers, a fifth of them host visible
+				Result.Requirements.size = (VkDeviceSize)std::exp2(8.0f + 12.0f * Unit(Random));
+				Result.Requirements.alignment = Unit(Random) < 0.5f ? 16 : 256;
+				Result.Requirements.memoryTypeBits = 0xF;
+				Result.Properties = Unit(Random) < 0.2f ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				Result.Kind = ResourceKind::Linear;
+			}
+			else
+			{
+				// 64KB - 4MB device local images
+				Result.Requirements.size = AlignUp((VkDeviceSize)std::exp2(16.0f + 6.0f * Unit(Random)), 64 * 1024);
+				Result.Requirements.alignment = 64 * 1024;
+				Result.Requirements.memoryTypeBits = 0x1;
+				Result.Properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				Result.Kind = ResourceKind::Optimal;
+			}
+
+			return Result;
+		};
+
+		const uint32_t LiveCount = 20000;
+		const uint32_t ChurnCount = 200000;
+
+		std::vector<Request> Requests(LiveCount + ChurnCount);
+		for (Request& Req : Requests)
+			Req = MakeRequest();
+
+		std::vector<uint32_t> FreeOrder(ChurnCount);
+		for (uint32_t& Index : FreeOrder)
+			Index = std::uniform_int_distribution<uint32_t>(0, LiveCount - 1)(Random);
+
+		auto PrintStats = [](const char* Label, const Stats& AllocatorStats)
+		{
+			std::cout << Label << " : " << AllocatorStats.AllocationCount << " allocations in " << AllocatorStats.DeviceAllocationCount << " device allocations ("
+				<< AllocatorStats.BlockCount << " blocks, " << AllocatorStats.DedicatedCount << " dedicated), "
+				<< AllocatorStats.BlockBytes / (1024 * 1024) << " MB of blocks, "
+				<< AllocatorStats.InternalFragmentation() * 100.0f << "% internal, "
+				<< AllocatorStats.ExternalFragmentation() * 100.0f << "% external fragmentation" << std::endl;
+		};
+
+		auto CheckOverlaps = [](std::vector<GpuAllocation> Allocations)
+		{
+			std::sort(Allocations.begin(), Allocations.end(), [](const GpuAllocation& A, const GpuAllocation& B)
+			{
+				return A.Memory != B.Memory ? A.Memory < B.Memory : A.Offset < B.Offset;
+			});
+
+			for (size_t i = 1; i < Allocations.size(); i++)
+			{
+				if (Allocations[i].Memory == Allocations[i - 1].Memory && Allocations[i - 1].Offset + Allocations[i - 1].Size > Allocations[i].Offset)
+					return false;
+			}
+
+			return true;
+		};
+
+		std::vector<GpuAllocation> Live(LiveCount);
+
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < LiveCount; i++)
+			Live[i] = Allocator.Allocate(Requests[i].Requirements, Requests[i].Properties, Requests[i].Kind);
+		auto EndTime = std::chrono::high_resolution_clock::now();
+
+		const float FillTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count();
+		bool Valid = CheckOverlaps(Live);
+
+		std::cout << "GPU memory allocator, " << LiveCount << " live allocations, " << ChurnCount << " free/allocate pairs" << std::endl;
+		std::cout << "Fill : " << FillTimeMs << " ms, " << LiveCount / FillTimeMs << " allocations/ms" << std::endl;
+		PrintStats("After fill", Allocator.GetStats());
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < ChurnCount; i++)
+		{
+			GpuAllocation& Slot = Live[FreeOrder[i]];
+			const Request& Req = Requests[LiveCount + i];
+
+			Allocator.Free(Slot);
+			Slot = Allocator.Allocate(Req.Requirements, Req.Properties, Req.Kind);
+		}
+		EndTime = std::chrono::high_resolution_clock::now();
+
+		const float ChurnTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count();
+		Valid = Valid && CheckOverlaps(Live);
+
+		std::cout << "Churn : " << ChurnTimeMs << " ms, " << ChurnCount / ChurnTimeMs << " free/allocate pairs/ms" << std::endl;
+		PrintStats("After churn", Allocator.GetStats());
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		for (GpuAllocation& Allocation : Live)
+			Allocator.Free(Allocation);
+		EndTime = std::chrono::high_resolution_clock::now();
+
+		const float FreeTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count();
+		const Stats FinalStats = Allocator.GetStats();
+		Valid = Valid && FinalStats.AllocationCount == 0 && FinalStats.ReservedBytes == 0;
+
+		std::cout << "Free : " << FreeTimeMs << " ms, " << LiveCount / FreeTimeMs << " frees/ms" << std::endl;
+		std::cout << "Device allocations : " << FinalStats.TotalDeviceAllocations << " total vs " << LiveCount + ChurnCount << " without sub-allocation" << std::endl;
+		std::cout << "Allocations " << (Valid ? "valid" : "OVERLAP OR LEAK") << std::endl;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#ifndef __GpuMemoryAllocator_h__
+#define __GpuMemoryAllocator_h__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Power of two sub-allocator over one block of 2^MaxOrder bytes. Every range is a node aligned to its own size,
+	// so any alignment up to the node size comes for free. Pure bookkeeping, knows nothing about Vulkan memory.
+	class BuddyAllocator
+	{
+	public:
+
+		static constexpr VkDeviceSize INVALID_OFFSET = ~0ull;
+
+		BuddyAllocator(uint32_t MinOrder, uint32_t MaxOrder);
+
+		// Returns INVALID_OFFSET when no free node is large enough
+		VkDeviceSize Allocate(VkDeviceSize Size, VkDeviceSize Alignment);
+		void Free(VkDeviceSize Offset);
+
+		// Node size Allocate would reserve for the request
+		VkDeviceSize GetNodeSize(VkDeviceSize Size, VkDeviceSize Alignment) const;
+		VkDeviceSize GetAllocatedNodeSize(VkDeviceSize Offset) const;
+
+		VkDeviceSize GetCapacity() const { return 1ull << m_MaxOrder; }
+		VkDeviceSize GetFreeSize() const { return GetCapacity() - m_ReservedSize; }
+		VkDeviceSize GetLargestFreeNode() const;
+		bool IsEmpty() const { return m_ReservedSize == 0; }
+
+	private:
+
+		uint32_t GetOrder(VkDeviceSize Size, VkDeviceSize Alignment) const;
+
+		uint32_t m_MinOrder;
+		uint32_t m_MaxOrder;
+		VkDeviceSize m_ReservedSize = 0;
+
+		// Free node offsets per order, ordered so allocations pack towards the start of the block
+		std::vector<std::set<VkDeviceSize>> m_FreeNodes;
+		std::unordered_map<VkDeviceSize, uint32_t> m_AllocatedOrders;
+	};
+
+	// Where the allocator gets its device memory from. EngineDevice uses VulkanMemoryBackend, the benchmark a mock.
+	class GpuMemoryBackend
+	{
+	public:
+
+		virtual ~GpuMemoryBackend() = default;
+
+		virtual VkResult AllocateMemory(uint32_t MemoryTypeIndex, VkDeviceSize Size, VkDeviceMemory& OutMemory) = 0;
+		virtual void FreeMemory(VkDeviceMemory Memory) = 0;
+
+		// Maps the whole allocation, null on failure
+		virtual void* MapMemory(VkDeviceMemory Memory) = 0;
+		virtual void UnmapMemory(VkDeviceMemory Memory) = 0;
+	};
+
+	class VulkanMemoryBackend : public GpuMemoryBackend
+	{
+	public:
+
+		VulkanMemoryBackend(VkDevice Device) : m_Device(Device) {}
+
+		VkResult AllocateMemory(uint32_t MemoryTypeIndex, VkDeviceSize Size, VkDeviceMemory& OutMemory) override;
+		void FreeMemory(VkDeviceMemory Memory) override;
+		void* MapMemory(VkDeviceMemory Memory) override;
+		void UnmapMemory(VkDeviceMemory Memory) override;
+
+	private:
+
+		VkDevice m_Device;
+	};
+
+	// A range of device memory handed out by GpuMemoryAllocator. Host visible memory is persistently mapped, Mapped
+	// points at Offset.
+	struct GpuAllocation
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		// Reserved size, at least the requested size and a multiple of nonCoherentAtomSize
+		VkDeviceSize Size = 0;
+		VkDeviceSize RequestedSize = 0;
+		void* Mapped = nullptr;
+		uint32_t MemoryTypeIndex = 0;
+
+		// Owning pool and block, BlockIndex is DEDICATED_BLOCK for allocations with their own VkDeviceMemory
+		uint32_t PoolIndex = 0;
+		uint32_t BlockIndex = 0;
+	};
+
+	// Sub-allocates buffers and images from large per memory type blocks instead of one vkAllocateMemory each, which
+	// keeps far below maxMemoryAllocationCount. Linear (buffer) and optimal (image) resources never share a block, so
+	// bufferImageGranularity never has to be padded for. Thread safe.
+	class GpuMemoryAllocator
+	{
+	public:
+
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+		static constexpr uint32_t MIN_ORDER = 8;
+		static constexpr uint32_t DEDICATED_BLOCK = ~0u;
+
+		enum class ResourceKind
+		{
+			Linear,
+			Optimal,
+		};
+
+		struct Stats
+		{
+			uint32_t AllocationCount = 0;
+			uint32_t BlockCount = 0;
+			uint32_t DedicatedCount = 0;
+			// Live VkDeviceMemory objects, what counts against maxMemoryAllocationCount
+			uint32_t DeviceAllocationCount = 0;
+			uint64_t TotalDeviceAllocations = 0;
+
+			VkDeviceSize BlockBytes = 0;
+			VkDeviceSize RequestedBytes = 0;
+			VkDeviceSize ReservedBytes = 0;
+			VkDeviceSize FreeBytes = 0;
+			VkDeviceSize LargestFreeRange = 0;
+
+			// Share of reserved bytes lost to power of two rounding
+			float InternalFragmentation() const { return ReservedBytes > 0 ? 1.0f - (float)RequestedBytes / (float)ReservedBytes : 0.0f; }
+			// Share of free bytes not in the largest free range
+			float ExternalFragmentation() const { return FreeBytes > 0 ? 1.0f - (float)LargestFreeRange / (float)FreeBytes : 0.0f; }
+		};
+
+		GpuMemoryAllocator(GpuMemoryBackend& Backend, const VkPhysicalDeviceMemoryProperties& MemoryProperties, const VkPhysicalDeviceLimits& Limits, VkDeviceSize BlockSize = DEFAULT_BLOCK_SIZE);
+		virtual ~GpuMemoryAllocator();
+
+		GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+		GpuMemoryAllocator& operator = (const GpuMemoryAllocator&) = delete;
+
+		GpuMemoryAllocator(GpuMemoryAllocator&&) = delete;
+		GpuMemoryAllocator& operator = (GpuMemoryAllocator&&) = delete;
+
+		// Throws when no memory type matches or the device is out of memory
+		GpuAllocation Allocate(const VkMemoryRequirements& Requirements, VkMemoryPropertyFlags Properties, ResourceKind Kind);
+		void Free(GpuAllocation& Allocation);
+
+		// Range for vkFlushMappedMemoryRanges/vkInvalidateMappedMemoryRanges relative to the allocation, rounded out
+		// to nonCoherentAtomSize. VK_WHOLE_SIZE covers the rest of the allocation.
+		VkMappedMemoryRange GetMappedRange(const GpuAllocation& Allocation, VkDeviceSize Size, VkDeviceSize Offset) const;
+
+		Stats GetStats() const;
+
+		// Allocation throughput and fragmentation against a mocked memory type table, no GPU needed
+		static void RunBenchmark();
+
+	private:
+
+		struct Block
+		{
+			VkDeviceMemory Memory = VK_NULL_HANDLE;
+			uint8_t* Mapped = nullptr;
+			std::unique_ptr<BuddyAllocator> Allocator;
+		};
+
+		// One per memory type and resource kind
+		struct Pool
+		{
+			uint32_t MemoryTypeIndex = 0;
+			bool IsHostVisible = false;
+			uint32_t BlockOrder = 0;
+			// Blocks are never moved, a freed slot is reused by the next new block
+			std::vector<Block> Blocks;
+		};
+
+		uint32_t FindMemoryType(uint32_t TypeFilter, VkMemoryPropertyFlags Properties, uint32_t FirstType) const;
+		bool TryAllocateFromType(uint32_t MemoryTypeIndex, const VkMemoryRequirements& Requirements, ResourceKind Kind, GpuAllocation& OutAllocation);
+		bool CreateBlock(Pool& MemoryPool, uint32_t& OutBlockIndex);
+
+		GpuMemoryBackend& m_Backend;
+		VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+		VkDeviceSize m_NonCoherentAtomSize;
+		VkDeviceSize m_BlockSize;
+
+		mutable std::mutex m_Mutex;
+		std::vector<Pool> m_Pools;
+		// Dedicated allocations and their sizes
+		std::map<VkDeviceMemory, VkDeviceSize> m_DedicatedAllocations;
+
+		uint32_t m_AllocationCount = 0;
+		VkDeviceSize m_RequestedBytes = 0;
+		uint64_t m_TotalDeviceAllocations = 0;
+	};
+}
+
+#endif //__GpuMemoryAllocator_h__
@@ -0,0 +1,49 @@
+#ifndef __Hash_h__
+#define __Hash_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace VulkanTutorial
+{
+	// Fast 64 bit non cryptographic hash, consumes 8 bytes per step. Used for checksums and cache keys.
+	inline uint64_t HashBytes(const void* Data, size_t Size, uint64_t Seed = 0)
+	{
+		constexpr uint64_t Multiplier = 0x9e3779b97f4a7c15ull;
+
+		uint64_t Hash = Seed ^ (Size * Multiplier);
+		const uint8_t* Bytes = (const uint8_t*)Data;
+
+		while (Size >= sizeof(uint64_t))
+		{
+			uint64_t Word;
+			memcpy(&Word, Bytes, sizeof(Word));
+
+			Word *= 0xff51afd7ed558ccdull;
+			Word ^= Word >> 32;
+
+			Hash = (Hash ^ Word) * Multiplier;
+			Hash ^= Hash >> 29;
+
+			Bytes += sizeof(uint64_t);
+			Size -= sizeof(uint64_t);
+		}
+
+		uint64_t Tail = 0;
+		if (Size > 0)
+			memcpy(&Tail, Bytes, Size);
+
+		Hash = (Hash ^ Tail) * Multiplier;
+		Hash ^= Hash >> 32;
+
+		return Hash;
+	}
+
+	inline uint64_t HashCombine(uint64_t Seed, uint64_t Value)
+	{
+		return Seed ^ (Value + 0x9e3779b97f4a7c15ull + (Seed << 6) + (Seed >> 2));
+	}
+}
+
+#endif //__Hash_h__
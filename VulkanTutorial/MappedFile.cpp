@@ -0,0 +1,107 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanTutorial
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& FilePath)
+	{
+		HANDLE File = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Failed to open file : " + FilePath);
+
+		m_FileHandle = File;
+
+		LARGE_INTEGER FileSize;
+		if (!GetFileSizeEx(File, &FileSize))
+		{
+			CloseHandle(File);
+			throw std::runtime_error("Failed to query file size : " + FilePath);
+		}
+
+		m_Size = (size_t)FileSize.QuadPart;
+
+		// Zero sized files can not be mapped, GetData() stays null
+		if (m_Size == 0)
+			return;
+
+		HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (Mapping == nullptr)
+		{
+			CloseHandle(File);
+			throw std::runtime_error("Failed to create file mapping : " + FilePath);
+		}
+
+		m_MappingHandle = Mapping;
+		m_Data = (const uint8_t*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (m_Data == nullptr)
+		{
+			CloseHandle(Mapping);
+			CloseHandle(File);
+			throw std::runtime_error("Failed to map file : " + FilePath);
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+
+		if (m_MappingHandle)
+			CloseHandle((HANDLE)m_MappingHandle);
+
+		if (m_FileHandle)
+			CloseHandle((HANDLE)m_FileHandle);
+	}
+#else
+	MappedFile::MappedFile(const std::string& FilePath)
+	{
+		m_FileDescriptor = open(FilePath.c_str(), O_RDONLY);
+		if (m_FileDescriptor < 0)
+			throw std::runtime_error("Failed to open file : " + FilePath);
+
+		struct stat FileStat;
+		if (fstat(m_FileDescriptor, &FileStat) != 0)
+		{
+			close(m_FileDescriptor);
+			throw std::runtime_error("Failed to query file size : " + FilePath);
+		}
+
+		m_Size = (size_t)FileStat.st_size;
+
+		// Zero sized files can not be mapped, GetData() stays null
+		if (m_Size == 0)
+			return;
+
+		void* Data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+		if (Data == MAP_FAILED)
+		{
+			close(m_FileDescriptor);
+			throw std::runtime_error("Failed to map file : " + FilePath);
+		}
+
+		madvise(Data, m_Size, MADV_SEQUENTIAL);
+		m_Data = (const uint8_t*)Data;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_Data)
+			munmap((void*)m_Data, m_Size);
+
+		if (m_FileDescriptor >= 0)
+			close(m_FileDescriptor);
+	}
+#endif
+}
@@ -0,0 +1,41 @@
+#ifndef __MappedFile_h__
+#define __MappedFile_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace VulkanTutorial
+{
+	// Read only memory mapping of a whole file, unmapped on destruction
+	class MappedFile
+	{
+	public:
+
+		explicit MappedFile(const std::string& FilePath);
+		virtual ~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator = (MappedFile&&) = delete;
+
+		const uint8_t* GetData() const { return m_Data; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+
+#ifdef _WIN32
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+#else
+		int m_FileDescriptor = -1;
+#endif
+	};
+}
+
+#endif //__MappedFile_h__
@@ -1,43 +1,114 @@
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ParallelObjLoader.h"
+#include "ThreadPool.h"
 #include <cassert>
 #include <cstring>
 
-#define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
 #include <iostream>
+#include <chrono>
+
+namespace std
+{
+	template<>
+	struct hash<VulkanTutorial::Mesh::Vertex>
+	{
+		size_t operator()(const VulkanTutorial::Mesh::Vertex& Vert) const
+		{
+			static_assert(sizeof(VulkanTutorial::Mesh::Vertex) % sizeof(uint32_t) == 0, "Vertex must be made of 32 bit words");
+
+			uint32_t Words[sizeof(VulkanTutorial::Mesh::Vertex) / sizeof(uint32_t)];
+			memcpy(Words, &Vert, sizeof(Words));
+
+			// 64 bit multiply-xorshift mix of every word, much cheaper than combining std::hash<float> per component
+			uint64_t Hash = 0xcbf29ce484222325ull;
+			for (uint32_t Word : Words)
+			{
+				Hash ^= Word;
+				Hash *= 0x100000001b3ull;
+				Hash ^= Hash >> 29;
+			}
+
+			return (size_t)Hash;
+		}
+	};
+}
 
 namespace VulkanTutorial
 {
+	// Coarser levels have to get below this fraction of the previous level's indices
+	static constexpr float MIN_LOD_REDUCTION = 0.85f;
+
+	bool Mesh::Vertex::operator == (const Vertex& Other) const
+	{
+		return memcmp(this, &Other, sizeof(Vertex)) == 0;
+	}
+
 	Mesh::Mesh(EngineDevice& Device, const Builder& MeshBuilder)
 		: m_Device(Device)
-		, m_HasIndexBuffer(false)
 	{
-		CreateVertexBuffer(MeshBuilder.Vertices);
-		CreateIndexBuffer(MeshBuilder.Indices);
+		SetBounds(MeshBuilder.ComputeBounds());
+		UploadGeometry(MeshBuilder.Vertices.data(), (uint32_t)MeshBuilder.Vertices.size(), MeshBuilder.Indices.data(), (uint32_t)MeshBuilder.Indices.size());
+		SetLods(MeshBuilder.Lods);
+		m_Meshlets = MeshBuilder.Meshlets;
+	}
+
+	Mesh::Mesh(EngineDevice& Device, const MeshCache& Cache)
+		: m_Device(Device)
+	{
+		SetBounds(Cache.GetBounds());
+		UploadGeometry(Cache.GetVertices(), Cache.GetVertexCount(), Cache.GetIndices(), Cache.GetIndexCount());
+		SetLods(Cache.GetLods());
+		m_Meshlets = Cache.GetMeshlets();
 	}
 
 	Mesh::~Mesh()
 	{
-		
+		// The copies into our range may still be in flight, the range itself is released once no frame draws it
+		m_Device.GetUploadManager().Wait(m_UploadTicket);
+		m_Device.GetGeometryPool().Free(m_Geometry);
 	}
 
-	void Mesh::Bind(VkCommandBuffer CommandBuffer)
+	void Mesh::SetBounds(const BoundingBox& Bounds)
 	{
-		VkBuffer Buffers[] = { m_VertexBuffer->GetBuffer()};
-		VkDeviceSize Offsets[] = { 0 };
-		vkCmdBindVertexBuffers(CommandBuffer, 0, 1, Buffers, Offsets);
+		m_Bounds = Bounds;
+		m_BoundingSphere.Center = (Bounds.Min + Bounds.Max) * 0.5f;
+		m_BoundingSphere.Radius = glm::length(Bounds.Max - Bounds.Min) * 0.5f;
+	}
+
+	void Mesh::SetLods(const std::vector<Lod>& Lods)
+	{
+		m_Lods = Lods;
+		if (m_Lods.empty())
+			m_Lods.push_back({ 0, m_Geometry.IndexCount, 0.0f });
+
+		assert(m_Lods.size() <= MAX_LOD_COUNT && "Too many levels of detail");
+	}
+
+	uint32_t Mesh::SelectLod(float PixelsPerUnit, float MaxPixelError) const
+	{
+		// Errors grow with every level
+		uint32_t LodIndex = 0;
+		while (LodIndex + 1 < GetLodCount() && m_Lods[LodIndex + 1].Error * PixelsPerUnit <= MaxPixelError)
+			LodIndex++;
+
+		return LodIndex;
+	}
 
-		if (m_HasIndexBuffer)
-			vkCmdBindIndexBuffer(CommandBuffer, m_IndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	void Mesh::Bind(VkCommandBuffer CommandBuffer)
+	{
+		m_Device.GetGeometryPool().Bind(CommandBuffer, m_Geometry.IndexType);
 	}
 
-	void Mesh::Draw(VkCommandBuffer CommandBuffer)
+	void Mesh::Draw(VkCommandBuffer CommandBuffer, uint32_t InstanceCount, uint32_t FirstInstance, uint32_t LodIndex)
 	{
-		if (m_HasIndexBuffer)
-			vkCmdDrawIndexed(CommandBuffer, m_IndexCount, 1, 0, 0, 0);
+		if (HasIndexBuffer())
+			vkCmdDrawIndexed(CommandBuffer, GetIndexCount(LodIndex), InstanceCount, GetFirstIndex(LodIndex), GetVertexOffset(), FirstInstance);
 		else
-			vkCmdDraw(CommandBuffer, m_VertexCount, 1, 0, 0);
+			vkCmdDraw(CommandBuffer, m_Geometry.VertexCount, InstanceCount, m_Geometry.FirstVertex, FirstInstance);
 	}
 
 
@@ -145,76 +216,131 @@ namespace VulkanTutorial
 		}
 	}*/
 
-void Mesh::CreateVertexBuffer(const std::vector<Vertex>& Vertices)
+	void Mesh::UploadGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount)
 	{
-		m_VertexCount = (uint32_t)Vertices.size();
-		assert(m_VertexCount >= 3 && "Vertex count should be at least 3");
+		assert(VertexCount >= 3 && "Vertex count should be at least 3");
 
-		const uint32_t VertexSize = sizeof(Vertices[0]);
+		GeometryPool& Pool = m_Device.GetGeometryPool();
+		m_Geometry = Pool.Allocate(VertexCount, IndexCount, ChooseIndexType(VertexCount));
 
-		// For vertex buffer and index buffer min offset alighment is 1
-		Buffer StagingBuffer(m_Device, VertexSize, m_VertexCount
-			, VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-			, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		// Narrowed copies only live until the upload has copied them into staging memory
+		std::vector<uint16_t> Indices16;
+		const void* IndexData = Indices;
 
-		StagingBuffer.Map();
-		StagingBuffer.WriteToBuffer((void*)Vertices.data());
+		if (m_Geometry.IndexType == VK_INDEX_TYPE_UINT16 && IndexCount > 0)
+		{
+			Indices16.assign(Indices, Indices + IndexCount);
+			IndexData = Indices16.data();
+		}
 
-		m_VertexBuffer = std::make_unique<Buffer>(m_Device, VertexSize, m_VertexCount
-			, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
-			, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		const VertexFormat Format = Pool.GetVertexFormat();
+		if (Format == VertexFormat::Float32)
+		{
+			m_UploadTicket = Pool.Upload(m_Geometry, Vertices, IndexData);
+			return;
+		}
+
+		const VertexQuantization Quantization = VertexQuantization::FromBounds(m_Bounds.Min, m_Bounds.Max);
+		m_DequantizeMatrix = Quantization.GetDequantizeMatrix();
+		m_IsQuantized = true;
 
-		m_Device.CopyBuffer(StagingBuffer.GetBuffer(), m_VertexBuffer->GetBuffer(), StagingBuffer.GetBufferSize());
+		std::vector<CompactVertex> Encoded(VertexCount);
+		ThreadPool::Shared().ParallelFor(VertexCount, 1 << 14, [&](size_t Begin, size_t End)
+			{
+				for (size_t i = Begin; i < End; i++)
+					VertexQuantizer::Encode(Format, Quantization, Vertices[i].position, Vertices[i].color, Vertices[i].normal, Vertices[i].uv, Encoded[i]);
+			});
+
+		m_UploadTicket = Pool.Upload(m_Geometry, Encoded.data(), IndexData);
 	}
 
-	void Mesh::CreateIndexBuffer(const std::vector<uint32_t>& Indices)
+	std::unique_ptr<Mesh> Mesh::CreateModelFromFile(EngineDevice& Device, const std::string& FilePath, ObjParser Parser, bool UseCache)
 	{
-		m_IndexCount = (uint32_t)Indices.size();
-
-		if (m_IndexCount > 0)
+		if (UseCache)
 		{
-			const uint32_t IndexSize = sizeof(Indices[0]);
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			std::unique_ptr<MeshCache> Cache = MeshCache::Open(FilePath);
+			auto EndTime = std::chrono::high_resolution_clock::now();
 
-			// For vertex buffer and index buffer min offset alighment is 1
-			Buffer StagingBuffer(m_Device, IndexSize, m_IndexCount
-				, VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-				, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			if (Cache)
+			{
+				std::cout << "Loaded " << FilePath << " from mesh cache in " << std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count() << " ms" << std::endl;
+				std::cout << "Vertex Count :  " << Cache->GetVertexCount() << std::endl;
+				std::cout << "Index Count :  " << Cache->GetIndexCount() << ", " << Cache->GetLods().size() << " LODs, " << Cache->GetMeshlets().size() << " meshlets" << std::endl;
 
-			StagingBuffer.Map();
-			StagingBuffer.WriteToBuffer((void*)Indices.data());
+				return std::make_unique<Mesh>(Device, *Cache);
+			}
+		}
 
-			m_IndexBuffer = std::make_unique<Buffer>(m_Device, IndexSize, m_IndexCount
-				, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
-				, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		Builder MeshBuilder{};
 
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.LoadModel(FilePath, Parser);
+		auto EndTime = std::chrono::high_resolution_clock::now();
 
-			m_Device.CopyBuffer(StagingBuffer.GetBuffer(), m_IndexBuffer->GetBuffer(), StagingBuffer.GetBufferSize());
+		// Every index is one OBJ face corner, so the index count is the vertex count before deduplication
+		const size_t TotalVertexCount = MeshBuilder.Indices.size();
+		const size_t UniqueVertexCount = MeshBuilder.Vertices.size();
 
-			m_HasIndexBuffer = true;
-		}
-	}
+		std::cout << "Loaded " << FilePath << (Parser == ObjParser::Parallel ? " (parallel parser)" : " (tinyobj parser)") << " in " << std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count() << " ms" << std::endl;
+		std::cout << "Vertex Count :  " << UniqueVertexCount << " unique / " << TotalVertexCount << " total (ratio "
+			<< (TotalVertexCount > 0 ? (float)UniqueVertexCount / (float)TotalVertexCount : 0.0f) << ")" << std::endl;
+		std::cout << "Index Count :  " << MeshBuilder.Indices.size() << std::endl;
 
-	std::unique_ptr<Mesh> Mesh::CreateModelFromFile(EngineDevice& Device, const std::string& FilePath)
-	{
-		Builder MeshBuilder{};
-		MeshBuilder.LoadModel(FilePath);
+		// Done before caching, meshes loaded from the cache are already optimized
+		const MeshOptimizer::VertexCacheStats LoadedStats = MeshOptimizer::AnalyzeVertexCache(MeshBuilder.Indices, MeshBuilder.Vertices.size());
 
-		std::cout << "Vertex Count :  " << MeshBuilder.Vertices.size() << std::endl;
+		StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.Optimize();
+		EndTime = std::chrono::high_resolution_clock::now();
+
+		const MeshOptimizer::VertexCacheStats OptimizedStats = MeshOptimizer::AnalyzeVertexCache(MeshBuilder.Indices, MeshBuilder.Vertices.size());
+
+		std::cout << "Optimized in " << std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count() << " ms, ACMR "
+			<< LoadedStats.Acmr << " -> " << OptimizedStats.Acmr << ", ATVR " << LoadedStats.Atvr << " -> " << OptimizedStats.Atvr << std::endl;
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.BuildMeshlets();
+		EndTime = std::chrono::high_resolution_clock::now();
+
+		std::cout << "Built " << MeshBuilder.Meshlets.size() << " meshlets in " << std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count()
+			<< " ms, ACMR " << MeshOptimizer::AnalyzeVertexCache(MeshBuilder.Indices, MeshBuilder.Vertices.size()).Acmr << std::endl;
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.GenerateLods();
+		EndTime = std::chrono::high_resolution_clock::now();
+
+		std::cout << "Generated " << MeshBuilder.GetLodCount() << " LODs in " << std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count() << " ms, triangles";
+		for (const Lod& Level : MeshBuilder.Lods)
+			std::cout << " " << Level.IndexCount / 3;
+		std::cout << std::endl;
+
+		if (UseCache && !MeshCache::Write(FilePath, MeshBuilder))
+			std::cout << "Failed to write mesh cache " << MeshCache::GetCachePath(FilePath) << std::endl;
 
 		return std::make_unique<Mesh>(Device, MeshBuilder);
 	}
 
-	std::vector<VkVertexInputBindingDescription> Mesh::Vertex::GetBindingDescriptions()
+	std::vector<VkVertexInputBindingDescription> Mesh::Vertex::GetBindingDescriptions(bool WithInstanceData, VertexFormat Format)
 	{
 		std::vector< VkVertexInputBindingDescription> BindingDescriptions(1);
 		BindingDescriptions[0].binding = 0;
-		BindingDescriptions[0].stride = sizeof(Vertex);
+		BindingDescriptions[0].stride = (uint32_t)VertexQuantizer::GetVertexStride(Format);
 		BindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
+		if (WithInstanceData)
+		{
+			VkVertexInputBindingDescription InstanceBinding;
+			InstanceBinding.binding = InstanceData::INSTANCE_BINDING;
+			InstanceBinding.stride = sizeof(InstanceData);
+			InstanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+			BindingDescriptions.push_back(InstanceBinding);
+		}
+
 		return BindingDescriptions;
 	}
 
-	std::vector<VkVertexInputAttributeDescription> Mesh::Vertex::GetAttributeDescriptions()
+	std::vector<VkVertexInputAttributeDescription> Mesh::Vertex::GetAttributeDescriptions(bool WithInstanceData, VertexFormat Format)
 	{
 		std::vector<VkVertexInputAttributeDescription> AttributeDescriptions(4);
 		AttributeDescriptions[0].binding = 0;
@@ -237,10 +363,37 @@ void Mesh::CreateVertexBuffer(const std::vector<Vertex>& Vertices)
 		AttributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
 		AttributeDescriptions[3].offset = offsetof(Vertex, uv);
 
+		// Same locations, the vertex shaders specialized for octahedral normals decode the normal from its xy
+		if (Format != VertexFormat::Float32)
+		{
+			AttributeDescriptions[0].format = Format == VertexFormat::Half ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R16G16B16A16_SNORM;
+			AttributeDescriptions[0].offset = offsetof(CompactVertex, Position);
+			AttributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+			AttributeDescriptions[1].offset = offsetof(CompactVertex, Color);
+			AttributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+			AttributeDescriptions[2].offset = offsetof(CompactVertex, Normal);
+			AttributeDescriptions[3].format = VK_FORMAT_R16G16_SFLOAT;
+			AttributeDescriptions[3].offset = offsetof(CompactVertex, Uv);
+		}
+
+		if (WithInstanceData)
+		{
+			// A mat4 input is fed one vec4 column per location
+			for (uint32_t Column = 0; Column < 8; Column++)
+			{
+				VkVertexInputAttributeDescription InstanceAttribute;
+				InstanceAttribute.binding = InstanceData::INSTANCE_BINDING;
+				InstanceAttribute.location = InstanceData::FIRST_LOCATION + Column;
+				InstanceAttribute.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				InstanceAttribute.offset = Column * sizeof(glm::vec4);
+				AttributeDescriptions.push_back(InstanceAttribute);
+			}
+		}
+
 		return AttributeDescriptions;
 	}
 
-	void Mesh::Builder::LoadModel(const std::string& FilePath)
+	static void LoadCornersWithTinyObj(const std::string& FilePath, std::vector<Mesh::Vertex>& OutCorners)
 	{
 		tinyobj::attrib_t Attrib;
 		std::vector<tinyobj::shape_t> Shapes;
@@ -253,14 +406,18 @@ void Mesh::CreateVertexBuffer(const std::vector<Vertex>& Vertices)
 			throw std::runtime_error(Warn + Err);
 		}
 
-		Vertices.clear();
-		Indices.clear();
+		size_t CornerCount = 0;
+		for (const auto& Shape : Shapes)
+			CornerCount += Shape.mesh.indices.size();
+
+		OutCorners.clear();
+		OutCorners.reserve(CornerCount);
 
 		for (const auto& Shape : Shapes)
 		{
 			for (const auto& Index : Shape.mesh.indices)
 			{
-				Vertex Vert{};
+				Mesh::Vertex Vert{};
 				if (Index.vertex_index >= 0) 
 				{
 					Vert.position = {
@@ -289,8 +446,182 @@ void Mesh::CreateVertexBuffer(const std::vector<Vertex>& Vertices)
 					};
 				}
 
-				Vertices.push_back(Vert);
+				OutCorners.push_back(Vert);
+			}
+		}
+	}
+
+	void Mesh::Builder::LoadModel(const std::string& FilePath, ObjParser Parser)
+	{
+		std::vector<Vertex> Corners;
+
+		if (Parser == ObjParser::Parallel && !ParallelObjLoader::LoadCorners(FilePath, Corners))
+		{
+			std::cout << "Parallel OBJ parser can not handle " << FilePath << ", falling back to tinyobj" << std::endl;
+			Parser = ObjParser::TinyObj;
+		}
+
+		if (Parser == ObjParser::TinyObj)
+			LoadCornersWithTinyObj(FilePath, Corners);
+
+		BuildIndexed(Corners);
+	}
+
+	void Mesh::Builder::LoadOptimizedModel(const std::string& FilePath, ObjParser Parser)
+	{
+		LoadModel(FilePath, Parser);
+		Optimize();
+		BuildMeshlets();
+		GenerateLods();
+	}
+
+	void Mesh::Builder::BuildIndexed(const std::vector<Vertex>& Corners)
+	{
+		Vertices.clear();
+		Lods.clear();
+		Meshlets.clear();
+		Indices.resize(Corners.size());
+
+		// Hashing runs in parallel, insertion stays serial so vertices keep first occurrence order
+		std::vector<uint32_t> Hashes(Corners.size());
+		ThreadPool::Shared().ParallelFor(Corners.size(), 1 << 16, [&](size_t Begin, size_t End)
+			{
+				const std::hash<Vertex> Hasher;
+				for (size_t i = Begin; i < End; i++)
+					Hashes[i] = (uint32_t)Hasher(Corners[i]);
+			});
+
+		// Open addressing table of vertex indices, kept at most half full
+		size_t TableSize = 1;
+		while (TableSize < Corners.size() * 2)
+			TableSize <<= 1;
+
+		const size_t TableMask = TableSize - 1;
+		std::vector<uint32_t> Table(TableSize, UINT32_MAX);
+
+		for (size_t i = 0; i < Corners.size(); i++)
+		{
+			size_t Slot = Hashes[i] & TableMask;
+			while (Table[Slot] != UINT32_MAX && !(Vertices[Table[Slot]] == Corners[i]))
+				Slot = (Slot + 1) & TableMask;
+
+			if (Table[Slot] == UINT32_MAX)
+			{
+				Table[Slot] = (uint32_t)Vertices.size();
+				Vertices.push_back(Corners[i]);
+			}
+
+			Indices[i] = Table[Slot];
+		}
+	}
+
+	void Mesh::Builder::Optimize()
+	{
+		assert(Lods.empty() && "Optimize would mix the triangles of different levels");
+		Meshlets.clear();
+
+		if (Vertices.empty())
+			return;
+
+		MeshOptimizer::OptimizeVertexCache(Indices, Vertices.size());
+		MeshOptimizer::OptimizeOverdraw(Indices, &Vertices[0].position.x, Vertices.size(), sizeof(Vertex));
+		Vertices.resize(MeshOptimizer::OptimizeVertexFetch(Vertices.data(), Vertices.size(), sizeof(Vertex), Indices));
+	}
+
+	void Mesh::Builder::BuildMeshlets(uint32_t MaxVertices, uint32_t MaxTriangles)
+	{
+		assert(Lods.empty() && "Meshlets only cover the full detail level");
+		Meshlets.clear();
+
+		if (Vertices.empty())
+			return;
+
+		const std::vector<uint32_t> TriangleCounts = MeshOptimizer::BuildMeshlets(Indices, &Vertices[0].position.x, Vertices.size(), sizeof(Vertex), MaxVertices, MaxTriangles);
+
+		// Meshlet order differs from the vertex cache order the vertices were laid out for
+		Vertices.resize(MeshOptimizer::OptimizeVertexFetch(Vertices.data(), Vertices.size(), sizeof(Vertex), Indices));
+
+		std::vector<uint32_t> VertexMeshlet(Vertices.size(), UINT32_MAX);
+		Meshlets.reserve(TriangleCounts.size());
+
+		uint32_t FirstIndex = 0;
+		for (uint32_t TriangleCount : TriangleCounts)
+		{
+			Meshlet Cluster;
+			Cluster.FirstIndex = FirstIndex;
+			Cluster.IndexCount = TriangleCount * 3;
+
+			for (uint32_t i = FirstIndex; i < FirstIndex + Cluster.IndexCount; i++)
+			{
+				if (VertexMeshlet[Indices[i]] != (uint32_t)Meshlets.size())
+				{
+					VertexMeshlet[Indices[i]] = (uint32_t)Meshlets.size();
+					Cluster.VertexCount++;
+				}
 			}
+
+			const MeshOptimizer::MeshletBounds Bounds = MeshOptimizer::ComputeMeshletBounds(&Indices[FirstIndex], Cluster.IndexCount, &Vertices[0].position.x, sizeof(Vertex));
+			Cluster.Center = glm::vec3(Bounds.Center[0], Bounds.Center[1], Bounds.Center[2]);
+			Cluster.Radius = Bounds.Radius;
+			Cluster.ConeAxis = glm::vec3(Bounds.ConeAxis[0], Bounds.ConeAxis[1], Bounds.ConeAxis[2]);
+			Cluster.ConeCutoff = Bounds.ConeCutoff;
+
+			Meshlets.push_back(Cluster);
+			FirstIndex += Cluster.IndexCount;
+		}
+	}
+
+	void Mesh::Builder::GenerateLods(uint32_t LodCount, float Reduction, float MaxRelativeError)
+	{
+		assert(LodCount >= 1 && LodCount <= MAX_LOD_COUNT && "LOD count out of range");
+
+		Lods.clear();
+		Lods.push_back({ 0, (uint32_t)Indices.size(), 0.0f });
+
+		if (Vertices.empty() || Indices.empty())
+			return;
+
+		const BoundingBox Bounds = ComputeBounds();
+		const float MaxError = MaxRelativeError * glm::length(Bounds.Max - Bounds.Min) * 0.5f;
+
+		std::vector<uint32_t> LodIndices = Indices;
+
+		while (Lods.size() < LodCount)
+		{
+			const uint32_t PreviousIndexCount = Lods.back().IndexCount;
+			const float PreviousError = Lods.back().Error;
+			if (PreviousError >= MaxError)
+				break;
+
+			// Errors of consecutive simplifications add up, which bounds the distance to the full detail surface
+			const size_t TargetIndexCount = (size_t)(PreviousIndexCount * Reduction) / 3 * 3;
+			const float Error = MeshOptimizer::Simplify(LodIndices, &Vertices[0].position.x, Vertices.size(), sizeof(Vertex), TargetIndexCount, MaxError - PreviousError);
+
+			// A level that saves little costs index memory without saving vertex work
+			if (LodIndices.empty() || LodIndices.size() > PreviousIndexCount * MIN_LOD_REDUCTION)
+				break;
+
+			std::vector<uint32_t> OptimizedIndices = LodIndices;
+			MeshOptimizer::OptimizeVertexCache(OptimizedIndices, Vertices.size());
+
+			Lods.push_back({ (uint32_t)Indices.size(), (uint32_t)OptimizedIndices.size(), PreviousError + Error });
+			Indices.insert(Indices.end(), OptimizedIndices.begin(), OptimizedIndices.end());
 		}
 	}
+
+	Mesh::BoundingBox Mesh::Builder::ComputeBounds() const
+	{
+		BoundingBox Bounds;
+		if (Vertices.empty())
+			return Bounds;
+
+		Bounds.Min = Bounds.Max = Vertices[0].position;
+		for (const Vertex& Vert : Vertices)
+		{
+			Bounds.Min = glm::min(Bounds.Min, Vert.position);
+			Bounds.Max = glm::max(Bounds.Max, Vert.position);
+		}
+
+		return Bounds;
+	}
 }
\ No newline at end of file
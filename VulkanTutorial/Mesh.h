@@ -3,6 +3,9 @@
 
 #include "EngineDevice.h"
 #include "Buffer.h"
+#include "UploadManager.h"
+#include "GeometryPool.h"
+#include "VertexFormat.h"
 #include <glm/glm.hpp>
 #include <vector>
 
@@ -10,10 +13,23 @@
 
 namespace VulkanTutorial
 {
+	class MeshCache;
+
 	class Mesh
 	{
 	public:
 
+		// Meshes up to this many vertices store 16 bit indices
+		static constexpr uint32_t MAX_16BIT_VERTEX_COUNT = 65536;
+
+		// Levels of detail a mesh can carry, including the full detail one
+		static constexpr uint32_t MAX_LOD_COUNT = 8;
+		static constexpr uint32_t DEFAULT_LOD_COUNT = 4;
+
+		// Meshlet limits, the common mesh shader sizes so the same meshlets could feed a mesh shader path later
+		static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+		static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
 		struct Vertex
 		{
 			glm::vec3 position;
@@ -21,19 +37,108 @@ namespace VulkanTutorial
 			glm::vec3 normal;
 			glm::vec2 uv;
 
-			static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
-			static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+			// Bitwise comparison, so it agrees with the hash used for deduplication
+			bool operator == (const Vertex& Other) const;
+
+			// WithInstanceData appends the per instance binding described by InstanceData, Format selects the layout of
+			// binding 0 and has to match the GeometryPool's
+			static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(bool WithInstanceData = false, VertexFormat Format = VertexFormat::Float32);
+			static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(bool WithInstanceData = false, VertexFormat Format = VertexFormat::Float32);
+		};
+
+		// Per instance attributes streamed from binding INSTANCE_BINDING, each matrix takes four locations
+		struct InstanceData
+		{
+			static constexpr uint32_t INSTANCE_BINDING = 1;
+			static constexpr uint32_t FIRST_LOCATION = 4;
+
+			glm::mat4 modelMatrix{ 1.0f };
+			glm::mat4 normalMatrix{ 1.0f };
+		};
+
+		struct BoundingBox
+		{
+			glm::vec3 Min{ 0.0f };
+			glm::vec3 Max{ 0.0f };
+		};
+
+		struct BoundingSphere
+		{
+			glm::vec3 Center{ 0.0f };
+			float Radius = 0.0f;
+		};
+
+		// One level of detail, the triangles of every level follow those of the finer levels in the mesh's indices
+		struct Lod
+		{
+			// Relative to the mesh's first index
+			uint32_t FirstIndex = 0;
+			uint32_t IndexCount = 0;
+			// Estimated distance in mesh units between this level's surface and the full detail one
+			float Error = 0.0f;
+		};
+
+		// Cluster of neighbouring full detail triangles that is culled as a whole
+		struct Meshlet
+		{
+			glm::vec3 Center{ 0.0f };
+			float Radius = 0.0f;
+			// Triangle normals lie within the cone around ConeAxis whose half angle has the sine ConeCutoff, one
+			// disables back face culling of the meshlet
+			glm::vec3 ConeAxis{ 0.0f };
+			float ConeCutoff = 1.0f;
+			// Relative to the mesh's first index, inside the full detail level
+			uint32_t FirstIndex = 0;
+			uint32_t IndexCount = 0;
+			uint32_t VertexCount = 0;
+		};
+
+		// OBJ front end used by Builder::LoadModel, both produce identical Builder contents
+		enum class ObjParser
+		{
+			TinyObj,
+			Parallel,
 		};
 
 		struct Builder
 		{
 			std::vector<Vertex> Vertices;
 			std::vector<uint32_t> Indices;
+			// Empty when Indices hold a single level
+			std::vector<Lod> Lods;
+			// Empty until BuildMeshlets, then covers every full detail triangle in order
+			std::vector<Meshlet> Meshlets;
+
+			void LoadModel(const std::string& FilePath, ObjParser Parser = ObjParser::Parallel);
+
+			// LoadModel followed by Optimize, BuildMeshlets and GenerateLods with default settings, what
+			// CreateModelFromFile does on a cache miss without the reports
+			void LoadOptimizedModel(const std::string& FilePath, ObjParser Parser = ObjParser::Parallel);
+
+			// Fills Vertices and Indices from one vertex per triangle corner, merging identical vertices in first occurrence order
+			void BuildIndexed(const std::vector<Vertex>& Corners);
+
+			// Reorders triangles for the post transform cache and then for overdraw, and vertices for fetch locality,
+			// see MeshOptimizer. Drops unreferenced vertices. Has to run before BuildMeshlets and GenerateLods.
+			void Optimize();
+
+			// Reorders the triangles into meshlets and computes their bounds, then reorders vertices for fetch again.
+			// Has to run before GenerateLods, coarser levels are drawn whole.
+			void BuildMeshlets(uint32_t MaxVertices = MAX_MESHLET_VERTICES, uint32_t MaxTriangles = MAX_MESHLET_TRIANGLES);
+
+			// Simplifies each level from the previous one down to about Reduction times its triangles and appends it
+			// to Indices, sharing the vertices. Stops before LodCount levels once the accumulated error would pass
+			// MaxRelativeError times the bounding sphere radius or a level saves too little.
+			void GenerateLods(uint32_t LodCount = DEFAULT_LOD_COUNT, float Reduction = 0.5f, float MaxRelativeError = 0.05f);
 
-			void LoadModel(const std::string& FilePath);
+			uint32_t GetLodCount() const { return Lods.empty() ? 1 : (uint32_t)Lods.size(); }
+
+			BoundingBox ComputeBounds() const;
 		};
 
 		Mesh(EngineDevice& Device, const Builder& MeshBuilder);
+		// Uploads straight from the mapped cache blobs
+		Mesh(EngineDevice& Device, const MeshCache& Cache);
 		virtual ~Mesh();
 
 		Mesh(const Mesh&) = delete;
@@ -42,24 +147,75 @@ namespace VulkanTutorial
 		Mesh(Mesh&&) = delete;
 		Mesh& operator = (Mesh&&) = delete;
 
-		static std::unique_ptr<Mesh> CreateModelFromFile(EngineDevice& Device, const std::string& FilePath);
+		// Loads from the binary mesh cache next to FilePath when it is valid, otherwise parses the OBJ and refreshes the cache
+		static std::unique_ptr<Mesh> CreateModelFromFile(EngineDevice& Device, const std::string& FilePath, ObjParser Parser = ObjParser::Parallel, bool UseCache = true);
+
+		// Vertex and index data are uploaded asynchronously, a mesh must not be drawn before it is ready
+		bool IsReady() const { return m_Device.GetUploadManager().IsComplete(m_UploadTicket); }
 
+		// Binds the device's GeometryPool with this mesh's index type, every mesh shares it so one Bind serves any number
+		// of Draw calls of meshes with the same index type
 		void Bind(VkCommandBuffer CommandBuffer);
-		void Draw(VkCommandBuffer CommandBuffer);
+		void Draw(VkCommandBuffer CommandBuffer, uint32_t InstanceCount = 1, uint32_t FirstInstance = 0, uint32_t LodIndex = 0);
+
+		const BoundingBox& GetBounds() const { return m_Bounds; }
+		// Encloses the bounding box, used for culling
+		const BoundingSphere& GetBoundingSphere() const { return m_BoundingSphere; }
+
+		bool HasIndexBuffer() const { return m_Geometry.IndexCount > 0; }
+		// Chosen from the vertex count at upload, draws have to bind the geometry pool's index buffer of this type
+		VkIndexType GetIndexType() const { return m_Geometry.IndexType; }
+		static VkIndexType ChooseIndexType(uint32_t VertexCount) { return VertexCount <= MAX_16BIT_VERTEX_COUNT ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+		uint32_t GetIndexCount(uint32_t LodIndex = 0) const { return m_Lods[LodIndex].IndexCount; }
+		uint32_t GetVertexCount() const { return m_Geometry.VertexCount; }
+		// Size of the mesh's vertices and indices inside the geometry pool
+		VkDeviceSize GetGeometryBytes() const { return EstimateGeometryBytes(m_Device.GetGeometryPool(), m_Geometry.VertexCount, m_Geometry.IndexCount); }
+		static VkDeviceSize EstimateGeometryBytes(const GeometryPool& Pool, uint32_t VertexCount, uint32_t IndexCount)
+		{
+			return Pool.GetVertexStride() * VertexCount + GeometryPool::GetIndexSize(ChooseIndexType(VertexCount)) * IndexCount;
+		}
+		uint32_t GetTriangleCount(uint32_t LodIndex = 0) const { return (HasIndexBuffer() ? GetIndexCount(LodIndex) : GetVertexCount()) / 3; }
+
+		// Position inside the geometry pool buffers, for building draw commands
+		uint32_t GetFirstIndex(uint32_t LodIndex = 0) const { return m_Geometry.FirstIndex + m_Lods[LodIndex].FirstIndex; }
+		int32_t GetVertexOffset() const { return (int32_t)m_Geometry.FirstVertex; }
+
+		// At least one, level 0 is the full detail mesh
+		uint32_t GetLodCount() const { return (uint32_t)m_Lods.size(); }
+		const Lod& GetLod(uint32_t LodIndex) const { return m_Lods[LodIndex]; }
+
+		// Coarsest level whose error stays within MaxPixelError pixels when one mesh unit covers PixelsPerUnit pixels
+		uint32_t SelectLod(float PixelsPerUnit, float MaxPixelError) const;
+
+		// Empty for meshes built without meshlets
+		const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
+
+		// Vertices in a compact pool format are stored relative to the bounds, model matrices have to be multiplied
+		// with this matrix before drawing. Identity for Float32 pools.
+		bool IsQuantized() const { return m_IsQuantized; }
+		const glm::mat4& GetDequantizeMatrix() const { return m_DequantizeMatrix; }
 
 	private:
 
-		void CreateVertexBuffer(const std::vector<Vertex>& Vertices);
-		void CreateIndexBuffer(const std::vector<uint32_t>& Indices);
+		// Encodes into the pool's vertex format and index type, the bounds have to be set first
+		void UploadGeometry(const Vertex* Vertices, uint32_t VertexCount, const uint32_t* Indices, uint32_t IndexCount);
+		void SetBounds(const BoundingBox& Bounds);
+		// An empty list is one level covering every index, the geometry has to be allocated first
+		void SetLods(const std::vector<Lod>& Lods);
 
 		EngineDevice& m_Device;
 
-		std::unique_ptr<Buffer> m_VertexBuffer;
-		uint32_t m_VertexCount;
+		GeometryRange m_Geometry;
+		std::vector<Lod> m_Lods;
+		std::vector<Meshlet> m_Meshlets;
+
+		BoundingBox m_Bounds;
+		BoundingSphere m_BoundingSphere;
+
+		bool m_IsQuantized = false;
+		glm::mat4 m_DequantizeMatrix{ 1.0f };
 
-		bool m_HasIndexBuffer;
-		std::unique_ptr<Buffer> m_IndexBuffer;
-		uint32_t m_IndexCount;
+		UploadManager::Ticket m_UploadTicket = 0;
 	};
 }
 
@@ -0,0 +1,420 @@
+#include "MeshCache.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		constexpr uint32_t MESH_CACHE_MAGIC = 0x434d5456; // "VTMC"
+		constexpr uint32_t MESH_CACHE_VERSION = 4;
+		constexpr uint32_t MAX_ATTRIBUTES = 8;
+		constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+		// Warm loads should beat parsing the source by at least this factor
+		constexpr float WARM_LOAD_TARGET_SPEEDUP = 20.0f;
+
+		struct MeshCacheAttribute
+		{
+			uint32_t Location;
+			uint32_t Format;
+			uint32_t Offset;
+		};
+
+		struct MeshCacheLod
+		{
+			uint32_t FirstIndex;
+			uint32_t IndexCount;
+			float Error;
+		};
+
+		struct MeshCacheMeshlet
+		{
+			float Center[3];
+			float Radius;
+			float ConeAxis[3];
+			float ConeCutoff;
+			uint32_t FirstIndex;
+			uint32_t IndexCount;
+			uint32_t VertexCount;
+		};
+
+		// Layout on disk: header, vertex blob, index blob, meshlet blob, each blob 16 byte aligned
+		struct MeshCacheHeader
+		{
+			uint32_t Magic;
+			uint32_t Version;
+
+			// Invalidation key of the source file
+			uint64_t SourceSize;
+			int64_t SourceModifiedTime;
+			uint64_t SourceHash;
+
+			// Vertex layout the blob was written with, compared against Mesh::Vertex on load
+			uint32_t VertexStride;
+			uint32_t AttributeCount;
+			MeshCacheAttribute Attributes[MAX_ATTRIBUTES];
+
+			uint64_t VertexCount;
+			uint64_t VertexDataOffset;
+			uint64_t IndexCount;
+			uint64_t IndexDataOffset;
+			uint64_t MeshletCount;
+			uint64_t MeshletDataOffset;
+
+			float BoundsMin[3];
+			float BoundsMax[3];
+
+			// Ranges of the index blob, a single level is stored as one entry covering every index
+			uint32_t LodCount;
+			MeshCacheLod Lods[Mesh::MAX_LOD_COUNT];
+
+			uint64_t PayloadChecksum;
+		};
+
+		struct SourceFileInfo
+		{
+			uint64_t Size = 0;
+			int64_t ModifiedTime = 0;
+		};
+
+		bool QuerySourceFile(const std::string& SourcePath, SourceFileInfo& OutInfo)
+		{
+			std::error_code Error;
+
+			OutInfo.Size = (uint64_t)std::filesystem::file_size(SourcePath, Error);
+			if (Error)
+				return false;
+
+			const auto ModifiedTime = std::filesystem::last_write_time(SourcePath, Error);
+			if (Error)
+				return false;
+
+			OutInfo.ModifiedTime = (int64_t)ModifiedTime.time_since_epoch().count();
+			return true;
+		}
+
+		uint64_t HashSourceFile(const std::string& SourcePath)
+		{
+			MappedFile Source(SourcePath);
+			return HashBytes(Source.GetData(), Source.GetSize());
+		}
+
+		void FillVertexLayout(MeshCacheHeader& Header)
+		{
+			const auto AttributeDescriptions = Mesh::Vertex::GetAttributeDescriptions();
+			assert(AttributeDescriptions.size() <= MAX_ATTRIBUTES && "Mesh cache header can not describe this many vertex attributes");
+
+			Header.VertexStride = sizeof(Mesh::Vertex);
+			Header.AttributeCount = (uint32_t)AttributeDescriptions.size();
+
+			for (uint32_t i = 0; i < Header.AttributeCount; i++)
+			{
+				Header.Attributes[i].Location = AttributeDescriptions[i].location;
+				Header.Attributes[i].Format = (uint32_t)AttributeDescriptions[i].format;
+				Header.Attributes[i].Offset = AttributeDescriptions[i].offset;
+			}
+		}
+
+		bool HasCurrentVertexLayout(const MeshCacheHeader& Header)
+		{
+			MeshCacheHeader Expected{};
+			FillVertexLayout(Expected);
+
+			return Header.VertexStride == Expected.VertexStride
+				&& Header.AttributeCount == Expected.AttributeCount
+				&& memcmp(Header.Attributes, Expected.Attributes, sizeof(MeshCacheAttribute) * Expected.AttributeCount) == 0;
+		}
+
+		uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+		{
+			return (Value + Alignment - 1) & ~(Alignment - 1);
+		}
+
+		uint64_t ComputePayloadChecksum(const void* Vertices, uint64_t VertexBytes, const void* Indices, uint64_t IndexBytes, const void* Meshlets, uint64_t MeshletBytes)
+		{
+			return HashCombine(HashCombine(HashBytes(Vertices, (size_t)VertexBytes), HashBytes(Indices, (size_t)IndexBytes)), HashBytes(Meshlets, (size_t)MeshletBytes));
+		}
+
+		void WritePadding(std::ofstream& File, uint64_t Size)
+		{
+			static const char Zeros[BLOB_ALIGNMENT] = {};
+			File.write(Zeros, (std::streamsize)Size);
+		}
+	}
+
+	MeshCache::MeshCache(std::unique_ptr<MappedFile> File)
+		: m_File(std::move(File))
+	{
+
+	}
+
+	MeshCache::~MeshCache()
+	{
+
+	}
+
+	std::string MeshCache::GetCachePath(const std::string& SourcePath)
+	{
+		return SourcePath + ".meshcache";
+	}
+
+	std::unique_ptr<MeshCache> MeshCache::Open(const std::string& SourcePath)
+	{
+		const std::string CachePath = GetCachePath(SourcePath);
+
+		SourceFileInfo Source;
+		if (!QuerySourceFile(SourcePath, Source) || !std::filesystem::exists(CachePath))
+			return nullptr;
+
+		std::unique_ptr<MappedFile> File;
+		MeshCacheHeader Header;
+
+		try
+		{
+			File = std::make_unique<MappedFile>(CachePath);
+			if (File->GetSize() < sizeof(MeshCacheHeader))
+				throw std::runtime_error("truncated header");
+
+			memcpy(&Header, File->GetData(), sizeof(Header));
+
+			if (Header.Magic != MESH_CACHE_MAGIC || Header.Version != MESH_CACHE_VERSION)
+				throw std::runtime_error("unknown format version");
+
+			if (!HasCurrentVertexLayout(Header))
+				throw std::runtime_error("built with a different vertex layout");
+
+			if (Header.SourceSize != Source.Size)
+				throw std::runtime_error("source size changed");
+
+			// A matching timestamp is trusted, a touched or copied source of the same size is compared by content
+			if (Header.SourceModifiedTime != Source.ModifiedTime && Header.SourceHash != HashSourceFile(SourcePath))
+				throw std::runtime_error("source content changed");
+
+			const uint64_t VertexBytes = Header.VertexCount * Header.VertexStride;
+			const uint64_t IndexBytes = Header.IndexCount * sizeof(uint32_t);
+			const uint64_t MeshletBytes = Header.MeshletCount * sizeof(MeshCacheMeshlet);
+
+			if (Header.VertexCount > UINT32_MAX || Header.IndexCount > UINT32_MAX || Header.MeshletCount > UINT32_MAX
+				|| Header.VertexDataOffset % BLOB_ALIGNMENT != 0 || Header.IndexDataOffset % BLOB_ALIGNMENT != 0 || Header.MeshletDataOffset % BLOB_ALIGNMENT != 0
+				|| Header.VertexDataOffset + VertexBytes > File->GetSize() || Header.IndexDataOffset + IndexBytes > File->GetSize()
+				|| Header.MeshletDataOffset + MeshletBytes > File->GetSize())
+				throw std::runtime_error("blob out of bounds");
+
+			if (Header.LodCount == 0 || Header.LodCount > Mesh::MAX_LOD_COUNT)
+				throw std::runtime_error("invalid LOD count");
+
+			for (uint32_t i = 0; i < Header.LodCount; i++)
+			{
+				if ((uint64_t)Header.Lods[i].FirstIndex + Header.Lods[i].IndexCount > Header.IndexCount)
+					throw std::runtime_error("LOD out of bounds");
+			}
+
+			const uint8_t* Data = File->GetData();
+			if (ComputePayloadChecksum(Data + Header.VertexDataOffset, VertexBytes, Data + Header.IndexDataOffset, IndexBytes
+				, Data + Header.MeshletDataOffset, MeshletBytes) != Header.PayloadChecksum)
+				throw std::runtime_error("checksum mismatch");
+
+			const MeshCacheMeshlet* Meshlets = (const MeshCacheMeshlet*)(Data + Header.MeshletDataOffset);
+			for (uint64_t i = 0; i < Header.MeshletCount; i++)
+			{
+				if ((uint64_t)Meshlets[i].FirstIndex + Meshlets[i].IndexCount > Header.Lods[0].IndexCount)
+					throw std::runtime_error("meshlet out of bounds");
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "Ignoring mesh cache " << CachePath << " : " << e.what() << std::endl;
+			return nullptr;
+		}
+
+		const uint8_t* Data = File->GetData();
+
+		std::unique_ptr<MeshCache> Cache(new MeshCache(std::move(File)));
+		Cache->m_Vertices = (const Mesh::Vertex*)(Data + Header.VertexDataOffset);
+		Cache->m_VertexCount = (uint32_t)Header.VertexCount;
+		Cache->m_Indices = (const uint32_t*)(Data + Header.IndexDataOffset);
+		Cache->m_IndexCount = (uint32_t)Header.IndexCount;
+		Cache->m_Bounds.Min = { Header.BoundsMin[0], Header.BoundsMin[1], Header.BoundsMin[2] };
+		Cache->m_Bounds.Max = { Header.BoundsMax[0], Header.BoundsMax[1], Header.BoundsMax[2] };
+
+		Cache->m_Lods.resize(Header.LodCount);
+		for (uint32_t i = 0; i < Header.LodCount; i++)
+			Cache->m_Lods[i] = { Header.Lods[i].FirstIndex, Header.Lods[i].IndexCount, Header.Lods[i].Error };
+
+		const MeshCacheMeshlet* Meshlets = (const MeshCacheMeshlet*)(Data + Header.MeshletDataOffset);
+		Cache->m_Meshlets.resize((size_t)Header.MeshletCount);
+
+		for (size_t i = 0; i < Cache->m_Meshlets.size(); i++)
+		{
+			Mesh::Meshlet& Cluster = Cache->m_Meshlets[i];
+			Cluster.Center = { Meshlets[i].Center[0], Meshlets[i].Center[1], Meshlets[i].Center[2] };
+			Cluster.Radius = Meshlets[i].Radius;
+			Cluster.ConeAxis = { Meshlets[i].ConeAxis[0], Meshlets[i].ConeAxis[1], Meshlets[i].ConeAxis[2] };
+			Cluster.ConeCutoff = Meshlets[i].ConeCutoff;
+			Cluster.FirstIndex = Meshlets[i].FirstIndex;
+			Cluster.IndexCount = Meshlets[i].IndexCount;
+			Cluster.VertexCount = Meshlets[i].VertexCount;
+		}
+
+		return Cache;
+	}
+
+	bool MeshCache::Write(const std::string& SourcePath, const Mesh::Builder& MeshBuilder)
+	{
+		SourceFileInfo Source;
+		if (!QuerySourceFile(SourcePath, Source))
+			return false;
+
+		MeshCacheHeader Header{};
+		Header.Magic = MESH_CACHE_MAGIC;
+		Header.Version = MESH_CACHE_VERSION;
+		Header.SourceSize = Source.Size;
+		Header.SourceModifiedTime = Source.ModifiedTime;
+
+		try
+		{
+			Header.SourceHash = HashSourceFile(SourcePath);
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+
+		FillVertexLayout(Header);
+
+		const uint64_t VertexBytes = MeshBuilder.Vertices.size() * sizeof(Mesh::Vertex);
+		const uint64_t IndexBytes = MeshBuilder.Indices.size() * sizeof(uint32_t);
+
+		std::vector<MeshCacheMeshlet> Meshlets(MeshBuilder.Meshlets.size());
+		for (size_t i = 0; i < Meshlets.size(); i++)
+		{
+			const Mesh::Meshlet& Cluster = MeshBuilder.Meshlets[i];
+			memcpy(Meshlets[i].Center, &Cluster.Center, sizeof(Meshlets[i].Center));
+			Meshlets[i].Radius = Cluster.Radius;
+			memcpy(Meshlets[i].ConeAxis, &Cluster.ConeAxis, sizeof(Meshlets[i].ConeAxis));
+			Meshlets[i].ConeCutoff = Cluster.ConeCutoff;
+			Meshlets[i].FirstIndex = Cluster.FirstIndex;
+			Meshlets[i].IndexCount = Cluster.IndexCount;
+			Meshlets[i].VertexCount = Cluster.VertexCount;
+		}
+
+		const uint64_t MeshletBytes = Meshlets.size() * sizeof(MeshCacheMeshlet);
+
+		Header.VertexCount = MeshBuilder.Vertices.size();
+		Header.VertexDataOffset = AlignUp(sizeof(MeshCacheHeader), BLOB_ALIGNMENT);
+		Header.IndexCount = MeshBuilder.Indices.size();
+		Header.IndexDataOffset = AlignUp(Header.VertexDataOffset + VertexBytes, BLOB_ALIGNMENT);
+		Header.MeshletCount = Meshlets.size();
+		Header.MeshletDataOffset = AlignUp(Header.IndexDataOffset + IndexBytes, BLOB_ALIGNMENT);
+
+		const Mesh::BoundingBox Bounds = MeshBuilder.ComputeBounds();
+		memcpy(Header.BoundsMin, &Bounds.Min, sizeof(Header.BoundsMin));
+		memcpy(Header.BoundsMax, &Bounds.Max, sizeof(Header.BoundsMax));
+
+		Header.LodCount = MeshBuilder.GetLodCount();
+		for (uint32_t i = 0; i < Header.LodCount; i++)
+		{
+			const Mesh::Lod Level = MeshBuilder.Lods.empty() ? Mesh::Lod{ 0, (uint32_t)MeshBuilder.Indices.size(), 0.0f } : MeshBuilder.Lods[i];
+			Header.Lods[i] = { Level.FirstIndex, Level.IndexCount, Level.Error };
+		}
+
+		Header.PayloadChecksum = ComputePayloadChecksum(MeshBuilder.Vertices.data(), VertexBytes, MeshBuilder.Indices.data(), IndexBytes, Meshlets.data(), MeshletBytes);
+
+		const std::string CachePath = GetCachePath(SourcePath);
+		// Streaming threads may write the cache of the same source at once, each writes its own temporary file
+		const std::string TempPath = CachePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+		{
+			std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+			if (!File.is_open())
+				return false;
+
+			File.write((const char*)&Header, sizeof(Header));
+			WritePadding(File, Header.VertexDataOffset - sizeof(Header));
+			File.write((const char*)MeshBuilder.Vertices.data(), (std::streamsize)VertexBytes);
+			WritePadding(File, Header.IndexDataOffset - (Header.VertexDataOffset + VertexBytes));
+			File.write((const char*)MeshBuilder.Indices.data(), (std::streamsize)IndexBytes);
+			WritePadding(File, Header.MeshletDataOffset - (Header.IndexDataOffset + IndexBytes));
+			File.write((const char*)Meshlets.data(), (std::streamsize)MeshletBytes);
+
+			if (!File.good())
+			{
+				File.close();
+				std::filesystem::remove(TempPath);
+				return false;
+			}
+		}
+
+		// Readers only ever see a complete file
+		std::error_code Error;
+		std::filesystem::rename(TempPath, CachePath, Error);
+
+		if (Error)
+		{
+			std::filesystem::remove(TempPath, Error);
+			return false;
+		}
+
+		return true;
+	}
+
+	void MeshCache::RunBenchmark(const std::string& SourcePath, uint32_t Repetitions)
+	{
+		auto Elapsed = [](std::chrono::high_resolution_clock::time_point StartTime)
+		{
+			return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - StartTime).count();
+		};
+
+		Mesh::Builder MeshBuilder;
+
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.LoadModel(SourcePath);
+		const float ParseMs = Elapsed(StartTime);
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.LoadOptimizedModel(SourcePath);
+		const float ColdMs = Elapsed(StartTime);
+
+		if (!Write(SourcePath, MeshBuilder))
+			throw std::runtime_error("Failed to write mesh cache " + GetCachePath(SourcePath));
+
+		// The copy stands in for the memcpy into the staging ring that Mesh does with the mapped blobs
+		std::vector<Mesh::Vertex> Vertices;
+		std::vector<uint32_t> Indices;
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < Repetitions; i++)
+		{
+			std::unique_ptr<MeshCache> Cache = Open(SourcePath);
+			if (!Cache)
+				throw std::runtime_error("Failed to open mesh cache " + GetCachePath(SourcePath));
+
+			Vertices.assign(Cache->GetVertices(), Cache->GetVertices() + Cache->GetVertexCount());
+			Indices.assign(Cache->GetIndices(), Cache->GetIndices() + Cache->GetIndexCount());
+		}
+		const float WarmMs = Elapsed(StartTime) / std::max(Repetitions, 1u);
+
+		const bool Identical = Vertices.size() == MeshBuilder.Vertices.size() && Indices == MeshBuilder.Indices
+			&& std::memcmp(Vertices.data(), MeshBuilder.Vertices.data(), Vertices.size() * sizeof(Mesh::Vertex)) == 0;
+
+		const float Speedup = ColdMs / std::max(WarmMs, 0.001f);
+
+		std::cout << "Mesh cache for " << SourcePath << ", " << MeshBuilder.Vertices.size() << " vertices, " << MeshBuilder.Indices.size() << " indices" << std::endl;
+		std::cout << "Cold load : " << ColdMs << " ms (" << ParseMs << " ms parsing), warm load : " << WarmMs << " ms averaged over " << Repetitions << std::endl;
+		std::cout << "Warm load is " << Speedup << "x faster (" << ParseMs / std::max(WarmMs, 0.001f) << "x against parsing alone), target above "
+			<< WARM_LOAD_TARGET_SPEEDUP << "x : " << (Speedup > WARM_LOAD_TARGET_SPEEDUP ? "met" : "MISSED")
+			<< (Identical ? "" : ", CACHED DATA DIFFERS") << std::endl;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef __MeshCache_h__
+#define __MeshCache_h__
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Binary copy of a built mesh stored next to its source file. A valid cache is memory mapped and its vertex and
+	// index blobs are handed to Mesh as is, so a warm load is a header check plus a memcpy into the staging buffers.
+	class MeshCache
+	{
+	public:
+
+		virtual ~MeshCache();
+
+		MeshCache(const MeshCache&) = delete;
+		MeshCache& operator = (const MeshCache&) = delete;
+
+		MeshCache(MeshCache&&) = delete;
+		MeshCache& operator = (MeshCache&&) = delete;
+
+		// Maps the cache of SourcePath, returns null when it is missing, corrupt, built with another vertex layout
+		// or older than the source
+		static std::unique_ptr<MeshCache> Open(const std::string& SourcePath);
+
+		// Writes the builder contents next to SourcePath, replacing any previous cache atomically
+		static bool Write(const std::string& SourcePath, const Mesh::Builder& MeshBuilder);
+
+		static std::string GetCachePath(const std::string& SourcePath);
+
+		// Times a cold load of SourcePath, parsing and building as on a cache miss, against Repetitions warm loads that
+		// map the cache written from it and copy its blobs as the upload would. Prints the ratio against the target.
+		static void RunBenchmark(const std::string& SourcePath, uint32_t Repetitions = 20);
+
+		const Mesh::Vertex* GetVertices() const { return m_Vertices; }
+		uint32_t GetVertexCount() const { return m_VertexCount; }
+		const uint32_t* GetIndices() const { return m_Indices; }
+		uint32_t GetIndexCount() const { return m_IndexCount; }
+		const Mesh::BoundingBox& GetBounds() const { return m_Bounds; }
+		const std::vector<Mesh::Lod>& GetLods() const { return m_Lods; }
+		const std::vector<Mesh::Meshlet>& GetMeshlets() const { return m_Meshlets; }
+
+	private:
+
+		MeshCache(std::unique_ptr<MappedFile> File);
+
+		std::unique_ptr<MappedFile> m_File;
+
+		const Mesh::Vertex* m_Vertices = nullptr;
+		uint32_t m_VertexCount = 0;
+		const uint32_t* m_Indices = nullptr;
+		uint32_t m_IndexCount = 0;
+		Mesh::BoundingBox m_Bounds;
+		std::vector<Mesh::Lod> m_Lods;
+		std::vector<Mesh::Meshlet> m_Meshlets;
+	};
+}
+
+#endif //__MeshCache_h__
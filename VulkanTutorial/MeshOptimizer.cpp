@@ -0,0 +1,1164 @@
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		constexpr uint32_t INVALID_VERTEX = ~0u;
+
+		constexpr size_t FETCH_LINE_SIZE = 64;
+		constexpr size_t FETCH_CACHE_LINES = 16 * 1024 / FETCH_LINE_SIZE;
+
+		// FIFO cache where an entry stays cached for CacheSize insertions. Entries are stamped on insertion, resetting
+		// only moves the clock past every stamp.
+		class FifoCache
+		{
+		public:
+
+			FifoCache(size_t EntryCount, uint32_t CacheSize)
+				: m_InsertTimes(EntryCount, 0)
+				, m_CacheSize(CacheSize)
+				, m_Timestamp(CacheSize + 1)
+			{
+			}
+
+			// Returns true on a miss
+			bool Access(size_t Entry)
+			{
+				if (m_Timestamp - m_InsertTimes[Entry] <= m_CacheSize)
+					return false;
+
+				m_InsertTimes[Entry] = m_Timestamp++;
+				return true;
+			}
+
+			uint32_t Age(size_t Entry) const { return m_Timestamp - m_InsertTimes[Entry]; }
+			uint32_t GetCacheSize() const { return m_CacheSize; }
+
+			void Reset() { m_Timestamp += m_CacheSize + 1; }
+
+		private:
+
+			std::vector<uint32_t> m_InsertTimes;
+			uint32_t m_CacheSize;
+			uint32_t m_Timestamp;
+		};
+
+		uint32_t AccessTriangle(FifoCache& Cache, const uint32_t* Triangle)
+		{
+			return (uint32_t)Cache.Access(Triangle[0]) + (uint32_t)Cache.Access(Triangle[1]) + (uint32_t)Cache.Access(Triangle[2]);
+		}
+
+		const float* GetPosition(const float* Positions, size_t PositionStride, uint32_t Index)
+		{
+			return (const float*)((const char*)Positions + Index * PositionStride);
+		}
+
+		void Cross(const float* P0, const float* P1, const float* P2, float* OutCross)
+		{
+			const float E1[3] = { P1[0] - P0[0], P1[1] - P0[1], P1[2] - P0[2] };
+			const float E2[3] = { P2[0] - P0[0], P2[1] - P0[1], P2[2] - P0[2] };
+
+			OutCross[0] = E1[1] * E2[2] - E1[2] * E2[1];
+			OutCross[1] = E1[2] * E2[0] - E1[0] * E2[2];
+			OutCross[2] = E1[0] * E2[1] - E1[1] * E2[0];
+		}
+
+		float Dot(const float* A, const float* B)
+		{
+			return A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+		}
+
+		// Leaves zero vectors as they are, returns the original length
+		float Normalize(float* Vector)
+		{
+			const float Length = std::sqrt(Dot(Vector, Vector));
+			if (Length > 0.0f)
+			{
+				for (int Axis = 0; Axis < 3; Axis++)
+					Vector[Axis] /= Length;
+			}
+
+			return Length;
+		}
+
+		// Area weighted sum of squared distances to a set of planes, x^T A x + 2 B.x + C with A symmetric
+		struct Quadric
+		{
+			double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+			double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+			double C = 0.0;
+			double Weight = 0.0;
+
+			// Plane of unit Normal through Point
+			void AddPlane(const float* Normal, const float* Point, double PlaneWeight)
+			{
+				const double D = -(Normal[0] * Point[0] + Normal[1] * Point[1] + Normal[2] * Point[2]);
+
+				A00 += PlaneWeight * Normal[0] * Normal[0];
+				A01 += PlaneWeight * Normal[0] * Normal[1];
+				A02 += PlaneWeight * Normal[0] * Normal[2];
+				A11 += PlaneWeight * Normal[1] * Normal[1];
+				A12 += PlaneWeight * Normal[1] * Normal[2];
+				A22 += PlaneWeight * Normal[2] * Normal[2];
+				B0 += PlaneWeight * D * Normal[0];
+				B1 += PlaneWeight * D * Normal[1];
+				B2 += PlaneWeight * D * Normal[2];
+				C += PlaneWeight * D * D;
+				Weight += PlaneWeight;
+			}
+
+			Quadric& operator += (const Quadric& Other)
+			{
+				A00 += Other.A00; A01 += Other.A01; A02 += Other.A02; A11 += Other.A11; A12 += Other.A12; A22 += Other.A22;
+				B0 += Other.B0; B1 += Other.B1; B2 += Other.B2;
+				C += Other.C;
+				Weight += Other.Weight;
+				return *this;
+			}
+
+			// Squared distance to the planes averaged by area, so merged quadrics stay in mesh units
+			double Evaluate(const float* Point) const
+			{
+				if (Weight <= 0.0)
+					return 0.0;
+
+				const double X = Point[0], Y = Point[1], Z = Point[2];
+				const double Result = A00 * X * X + A11 * Y * Y + A22 * Z * Z + 2.0 * (A01 * X * Y + A02 * X * Z + A12 * Y * Z)
+					+ 2.0 * (B0 * X + B1 * Y + B2 * Z) + C;
+
+				return std::max(Result, 0.0) / Weight;
+			}
+		};
+
+		struct PositionHash
+		{
+			size_t operator()(const std::array<float, 3>& Position) const
+			{
+				return (size_t)HashBytes(Position.data(), sizeof(float) * 3);
+			}
+		};
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& Indices, size_t VertexCount, uint32_t CacheSize)
+	{
+		const size_t TriangleCount = Indices.size() / 3;
+		if (TriangleCount == 0)
+			return;
+
+		// Triangles using every vertex, AdjacentTriangles[AdjacencyOffsets[v]] onwards
+		std::vector<uint32_t> AdjacencyOffsets(VertexCount + 1, 0);
+		for (uint32_t Index : Indices)
+			AdjacencyOffsets[Index + 1]++;
+
+		for (size_t i = 0; i < VertexCount; i++)
+			AdjacencyOffsets[i + 1] += AdjacencyOffsets[i];
+
+		std::vector<uint32_t> AdjacentTriangles(Indices.size());
+		{
+			std::vector<uint32_t> FillOffsets(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < Indices.size(); i++)
+				AdjacentTriangles[FillOffsets[Indices[i]]++] = (uint32_t)(i / 3);
+		}
+
+		std::vector<uint32_t> LiveTriangles(VertexCount);
+		for (size_t i = 0; i < VertexCount; i++)
+			LiveTriangles[i] = AdjacencyOffsets[i + 1] - AdjacencyOffsets[i];
+
+		FifoCache Cache(VertexCount, CacheSize);
+		std::vector<bool> Emitted(TriangleCount, false);
+
+		// Vertices of emitted triangles, most recent last, where fanning resumes after a dead end
+		std::vector<uint32_t> DeadEndStack;
+		DeadEndStack.reserve(Indices.size());
+
+		std::vector<uint32_t> Result;
+		Result.reserve(TriangleCount * 3);
+
+		size_t Cursor = 0;
+		uint32_t FanVertex = 0;
+		while (FanVertex < VertexCount && LiveTriangles[FanVertex] == 0)
+			FanVertex++;
+
+		while (FanVertex < VertexCount)
+		{
+			const size_t CandidatesBegin = DeadEndStack.size();
+
+			// Emit every remaining triangle around FanVertex
+			for (uint32_t Adjacent = AdjacencyOffsets[FanVertex]; Adjacent < AdjacencyOffsets[FanVertex + 1]; Adjacent++)
+			{
+				const uint32_t Triangle = AdjacentTriangles[Adjacent];
+				if (Emitted[Triangle])
+					continue;
+
+				for (uint32_t Corner = 0; Corner < 3; Corner++)
+				{
+					const uint32_t Vertex = Indices[Triangle * 3 + Corner];
+					Result.push_back(Vertex);
+					DeadEndStack.push_back(Vertex);
+					LiveTriangles[Vertex]--;
+					Cache.Access(Vertex);
+				}
+
+				Emitted[Triangle] = true;
+			}
+
+			// Fan next around the oldest vertex that will still be cached once all of its triangles are emitted
+			uint32_t NextVertex = INVALID_VERTEX;
+			int64_t BestPriority = -1;
+
+			for (size_t i = CandidatesBegin; i < DeadEndStack.size(); i++)
+			{
+				const uint32_t Candidate = DeadEndStack[i];
+				if (LiveTriangles[Candidate] == 0)
+					continue;
+
+				int64_t Priority = 0;
+				if (Cache.Age(Candidate) + 2 * LiveTriangles[Candidate] <= Cache.GetCacheSize())
+					Priority = Cache.Age(Candidate);
+
+				if (Priority > BestPriority)
+				{
+					BestPriority = Priority;
+					NextVertex = Candidate;
+				}
+			}
+
+			// Dead end, resume from a recently emitted vertex, or the next unfinished one in input order
+			while (NextVertex == INVALID_VERTEX && !DeadEndStack.empty())
+			{
+				const uint32_t Candidate = DeadEndStack.back();
+				DeadEndStack.pop_back();
+
+				if (LiveTriangles[Candidate] > 0)
+					NextVertex = Candidate;
+			}
+
+			while (NextVertex == INVALID_VERTEX && Cursor < VertexCount)
+			{
+				if (LiveTriangles[Cursor] > 0)
+					NextVertex = (uint32_t)Cursor;
+				else
+					Cursor++;
+			}
+
+			FanVertex = NextVertex;
+		}
+
+		Indices.swap(Result);
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& Indices, const float* Positions, size_t VertexCount, size_t PositionStride, float Threshold, uint32_t CacheSize)
+	{
+		const size_t TriangleCount = Indices.size() / 3;
+		if (TriangleCount == 0)
+			return;
+
+		FifoCache Cache(VertexCount, CacheSize);
+
+		// Triangles missing with all three vertices start over with a cold cache, reordering at them costs nothing
+		std::vector<size_t> HardBoundaries;
+		for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+		{
+			if (AccessTriangle(Cache, &Indices[Triangle * 3]) == 3)
+				HardBoundaries.push_back(Triangle);
+		}
+
+		HardBoundaries.push_back(TriangleCount);
+
+		// Within a hard cluster, cut as soon as the running ACMR gets within Threshold of the cluster's
+		std::vector<size_t> ClusterBoundaries;
+		for (size_t Hard = 0; Hard + 1 < HardBoundaries.size(); Hard++)
+		{
+			const size_t Begin = HardBoundaries[Hard];
+			const size_t End = HardBoundaries[Hard + 1];
+
+			Cache.Reset();
+			uint32_t ClusterMisses = 0;
+			for (size_t Triangle = Begin; Triangle < End; Triangle++)
+				ClusterMisses += AccessTriangle(Cache, &Indices[Triangle * 3]);
+
+			const float ClusterThreshold = Threshold * (float)ClusterMisses / (float)(End - Begin);
+
+			ClusterBoundaries.push_back(Begin);
+
+			Cache.Reset();
+			uint32_t RunningMisses = 0;
+			uint32_t RunningTriangles = 0;
+
+			for (size_t Triangle = Begin; Triangle < End; Triangle++)
+			{
+				RunningMisses += AccessTriangle(Cache, &Indices[Triangle * 3]);
+				RunningTriangles++;
+
+				if ((float)RunningMisses / (float)RunningTriangles <= ClusterThreshold && Triangle + 1 < End)
+				{
+					ClusterBoundaries.push_back(Triangle + 1);
+					Cache.Reset();
+					RunningMisses = 0;
+					RunningTriangles = 0;
+				}
+			}
+		}
+
+		ClusterBoundaries.push_back(TriangleCount);
+		const size_t ClusterCount = ClusterBoundaries.size() - 1;
+
+		float MeshCenter[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t Index : Indices)
+		{
+			const float* Position = GetPosition(Positions, PositionStride, Index);
+			for (int Axis = 0; Axis < 3; Axis++)
+				MeshCenter[Axis] += Position[Axis];
+		}
+
+		for (int Axis = 0; Axis < 3; Axis++)
+			MeshCenter[Axis] /= (float)Indices.size();
+
+		// How much a cluster faces away from the mesh center, outer surfaces occlude inner ones so they draw first
+		std::vector<float> SortKeys(ClusterCount);
+		for (size_t Cluster = 0; Cluster < ClusterCount; Cluster++)
+		{
+			float Normal[3] = { 0.0f, 0.0f, 0.0f };
+			float Center[3] = { 0.0f, 0.0f, 0.0f };
+			float Area = 0.0f;
+
+			for (size_t Triangle = ClusterBoundaries[Cluster]; Triangle < ClusterBoundaries[Cluster + 1]; Triangle++)
+			{
+				const float* P0 = GetPosition(Positions, PositionStride, Indices[Triangle * 3 + 0]);
+				const float* P1 = GetPosition(Positions, PositionStride, Indices[Triangle * 3 + 1]);
+				const float* P2 = GetPosition(Positions, PositionStride, Indices[Triangle * 3 + 2]);
+
+				const float E1[3] = { P1[0] - P0[0], P1[1] - P0[1], P1[2] - P0[2] };
+				const float E2[3] = { P2[0] - P0[0], P2[1] - P0[1], P2[2] - P0[2] };
+
+				// Twice the area in length, so the sums below are area weighted
+				const float Cross[3] = { E1[1] * E2[2] - E1[2] * E2[1], E1[2] * E2[0] - E1[0] * E2[2], E1[0] * E2[1] - E1[1] * E2[0] };
+				const float TriangleArea = std::sqrt(Cross[0] * Cross[0] + Cross[1] * Cross[1] + Cross[2] * Cross[2]);
+
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					Normal[Axis] += Cross[Axis];
+					Center[Axis] += (P0[Axis] + P1[Axis] + P2[Axis]) * (TriangleArea / 3.0f);
+				}
+
+				Area += TriangleArea;
+			}
+
+			const float NormalLength = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+			if (Area == 0.0f || NormalLength == 0.0f)
+				continue;
+
+			float Key = 0.0f;
+			for (int Axis = 0; Axis < 3; Axis++)
+				Key += (Center[Axis] / Area - MeshCenter[Axis]) * (Normal[Axis] / NormalLength);
+
+			SortKeys[Cluster] = Key;
+		}
+
+		std::vector<uint32_t> ClusterOrder(ClusterCount);
+		std::iota(ClusterOrder.begin(), ClusterOrder.end(), 0);
+		std::stable_sort(ClusterOrder.begin(), ClusterOrder.end(), [&SortKeys](uint32_t A, uint32_t B) { return SortKeys[A] > SortKeys[B]; });
+
+		std::vector<uint32_t> Result;
+		Result.reserve(Indices.size());
+
+		for (uint32_t Cluster : ClusterOrder)
+			Result.insert(Result.end(), Indices.begin() + ClusterBoundaries[Cluster] * 3, Indices.begin() + ClusterBoundaries[Cluster + 1] * 3);
+
+		Indices.swap(Result);
+	}
+
+	size_t MeshOptimizer::OptimizeVertexFetch(void* Vertices, size_t VertexCount, size_t VertexSize, std::vector<uint32_t>& Indices)
+	{
+		std::vector<uint32_t> Remap(VertexCount, INVALID_VERTEX);
+		uint32_t NewVertexCount = 0;
+
+		for (uint32_t& Index : Indices)
+		{
+			if (Remap[Index] == INVALID_VERTEX)
+				Remap[Index] = NewVertexCount++;
+
+			Index = Remap[Index];
+		}
+
+		std::vector<uint8_t> Reordered(NewVertexCount * VertexSize);
+		for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+		{
+			if (Remap[Vertex] != INVALID_VERTEX)
+				memcpy(&Reordered[Remap[Vertex] * VertexSize], (const uint8_t*)Vertices + Vertex * VertexSize, VertexSize);
+		}
+
+		if (!Reordered.empty())
+			memcpy(Vertices, Reordered.data(), Reordered.size());
+
+		return NewVertexCount;
+	}
+
+	float MeshOptimizer::Simplify(std::vector<uint32_t>& Indices, const float* Positions, size_t VertexCount, size_t PositionStride
+		, size_t TargetIndexCount, float TargetError)
+	{
+		if (Indices.size() <= TargetIndexCount)
+			return 0.0f;
+
+		std::vector<uint8_t> Locked(VertexCount, 0);
+
+		// Vertices with the same position are split by another attribute, moving one of them would tear the seam.
+		// Positions are keyed by their bits, adding zero turns -0 into +0 first.
+		std::vector<uint32_t> PositionIds(VertexCount, INVALID_VERTEX);
+		{
+			std::unordered_map<std::array<float, 3>, uint32_t, PositionHash> FirstVertexAt;
+
+			for (uint32_t Index : Indices)
+			{
+				if (PositionIds[Index] != INVALID_VERTEX)
+					continue;
+
+				const float* Position = GetPosition(Positions, PositionStride, Index);
+				const std::array<float, 3> Key = { Position[0] + 0.0f, Position[1] + 0.0f, Position[2] + 0.0f };
+
+				auto Result = FirstVertexAt.try_emplace(Key, Index);
+				PositionIds[Index] = Result.first->second;
+
+				if (!Result.second)
+				{
+					Locked[Index] = 1;
+					Locked[Result.first->second] = 1;
+				}
+			}
+		}
+
+		// An edge between positions that no triangle crosses in the opposite direction lies on an open border
+		{
+			auto EdgeKey = [&PositionIds](uint32_t From, uint32_t To) { return ((uint64_t)PositionIds[From] << 32) | PositionIds[To]; };
+
+			std::unordered_set<uint64_t> HalfEdges;
+			HalfEdges.reserve(Indices.size());
+
+			for (size_t Triangle = 0; Triangle < Indices.size(); Triangle += 3)
+			{
+				for (size_t Corner = 0; Corner < 3; Corner++)
+					HalfEdges.insert(EdgeKey(Indices[Triangle + Corner], Indices[Triangle + (Corner + 1) % 3]));
+			}
+
+			for (size_t Triangle = 0; Triangle < Indices.size(); Triangle += 3)
+			{
+				for (size_t Corner = 0; Corner < 3; Corner++)
+				{
+					const uint32_t From = Indices[Triangle + Corner];
+					const uint32_t To = Indices[Triangle + (Corner + 1) % 3];
+
+					if (HalfEdges.count(EdgeKey(To, From)) == 0)
+					{
+						Locked[From] = 1;
+						Locked[To] = 1;
+					}
+				}
+			}
+		}
+
+		std::vector<Quadric> Quadrics(VertexCount);
+		for (size_t Triangle = 0; Triangle < Indices.size(); Triangle += 3)
+		{
+			const float* P0 = GetPosition(Positions, PositionStride, Indices[Triangle + 0]);
+
+			float Normal[3];
+			Cross(P0, GetPosition(Positions, PositionStride, Indices[Triangle + 1]), GetPosition(Positions, PositionStride, Indices[Triangle + 2]), Normal);
+
+			const float Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+			if (Length == 0.0f)
+				continue;
+
+			for (int Axis = 0; Axis < 3; Axis++)
+				Normal[Axis] /= Length;
+
+			for (size_t Corner = 0; Corner < 3; Corner++)
+				Quadrics[Indices[Triangle + Corner]].AddPlane(Normal, P0, Length * 0.5);
+		}
+
+		struct Collapse
+		{
+			uint32_t From;
+			uint32_t To;
+			double Cost;
+		};
+
+		const double MaxCost = (double)TargetError * TargetError;
+		double ResultCost = 0.0;
+
+		std::vector<uint32_t> AdjacencyOffsets(VertexCount + 1);
+		std::vector<uint32_t> AdjacentTriangles;
+		std::vector<Collapse> Collapses;
+		std::vector<uint32_t> Remap(VertexCount);
+		std::vector<uint8_t> Touched(VertexCount);
+
+		// Every pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the triangles
+		while (Indices.size() > TargetIndexCount)
+		{
+			const size_t TriangleCount = Indices.size() / 3;
+
+			std::fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end(), 0);
+			for (uint32_t Index : Indices)
+				AdjacencyOffsets[Index + 1]++;
+
+			for (size_t i = 0; i < VertexCount; i++)
+				AdjacencyOffsets[i + 1] += AdjacencyOffsets[i];
+
+			AdjacentTriangles.resize(Indices.size());
+			{
+				std::vector<uint32_t> Cursors(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+				for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+				{
+					for (size_t Corner = 0; Corner < 3; Corner++)
+						AdjacentTriangles[Cursors[Indices[Triangle * 3 + Corner]]++] = (uint32_t)Triangle;
+				}
+			}
+
+			// Interior edges are shared by two triangles, the one walking them upwards adds them. Each edge collapses
+			// in its cheaper direction.
+			Collapses.clear();
+			for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+			{
+				for (size_t Corner = 0; Corner < 3; Corner++)
+				{
+					const uint32_t A = Indices[Triangle * 3 + Corner];
+					const uint32_t B = Indices[Triangle * 3 + (Corner + 1) % 3];
+
+					if (A > B || (Locked[A] && Locked[B]))
+						continue;
+
+					Quadric Merged = Quadrics[A];
+					Merged += Quadrics[B];
+
+					const double CostToB = Locked[A] ? HUGE_VAL : Merged.Evaluate(GetPosition(Positions, PositionStride, B));
+					const double CostToA = Locked[B] ? HUGE_VAL : Merged.Evaluate(GetPosition(Positions, PositionStride, A));
+
+					if (CostToB <= CostToA)
+						Collapses.push_back({ A, B, CostToB });
+					else
+						Collapses.push_back({ B, A, CostToA });
+				}
+			}
+
+			std::sort(Collapses.begin(), Collapses.end(), [](const Collapse& Left, const Collapse& Right) { return Left.Cost < Right.Cost; });
+
+			// A collapse removes about two triangles, stopping there keeps the pass from overshooting the target
+			const size_t MaxCollapses = (Indices.size() - TargetIndexCount) / 6 + 1;
+			size_t CollapseCount = 0;
+
+			std::iota(Remap.begin(), Remap.end(), 0);
+			std::fill(Touched.begin(), Touched.end(), 0);
+
+			for (const Collapse& Candidate : Collapses)
+			{
+				if (Candidate.Cost > MaxCost || CollapseCount >= MaxCollapses)
+					break;
+
+				if (Touched[Candidate.From] || Touched[Candidate.To])
+					continue;
+
+				const float* Target = GetPosition(Positions, PositionStride, Candidate.To);
+
+				// Rejected when a surviving triangle would turn by more than about 75 degrees, which includes flipping
+				bool Flips = false;
+				for (uint32_t i = AdjacencyOffsets[Candidate.From]; i < AdjacencyOffsets[Candidate.From + 1] && !Flips; i++)
+				{
+					const uint32_t* Corners = &Indices[AdjacentTriangles[i] * 3];
+					if (Corners[0] == Candidate.To || Corners[1] == Candidate.To || Corners[2] == Candidate.To)
+						continue;
+
+					const float* Before[3];
+					const float* After[3];
+					for (int Corner = 0; Corner < 3; Corner++)
+					{
+						Before[Corner] = GetPosition(Positions, PositionStride, Corners[Corner]);
+						After[Corner] = Corners[Corner] == Candidate.From ? Target : Before[Corner];
+					}
+
+					float NormalBefore[3];
+					float NormalAfter[3];
+					Cross(Before[0], Before[1], Before[2], NormalBefore);
+					Cross(After[0], After[1], After[2], NormalAfter);
+
+					const float Dot = NormalBefore[0] * NormalAfter[0] + NormalBefore[1] * NormalAfter[1] + NormalBefore[2] * NormalAfter[2];
+					const float LengthBefore = std::sqrt(NormalBefore[0] * NormalBefore[0] + NormalBefore[1] * NormalBefore[1] + NormalBefore[2] * NormalBefore[2]);
+					const float LengthAfter = std::sqrt(NormalAfter[0] * NormalAfter[0] + NormalAfter[1] * NormalAfter[1] + NormalAfter[2] * NormalAfter[2]);
+
+					Flips = Dot <= 0.25f * LengthBefore * LengthAfter;
+				}
+
+				if (Flips)
+					continue;
+
+				Remap[Candidate.From] = Candidate.To;
+				Quadrics[Candidate.To] += Quadrics[Candidate.From];
+				ResultCost = std::max(ResultCost, Candidate.Cost);
+				CollapseCount++;
+
+				// Triangles around From change, nothing they touch may collapse again before they are rebuilt
+				for (uint32_t i = AdjacencyOffsets[Candidate.From]; i < AdjacencyOffsets[Candidate.From + 1]; i++)
+				{
+					for (int Corner = 0; Corner < 3; Corner++)
+						Touched[Indices[AdjacentTriangles[i] * 3 + Corner]] = 1;
+				}
+			}
+
+			if (CollapseCount == 0)
+				break;
+
+			// Triangles that had both ends of a collapsed edge are now degenerate
+			size_t WriteOffset = 0;
+			for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+			{
+				const uint32_t A = Remap[Indices[Triangle * 3 + 0]];
+				const uint32_t B = Remap[Indices[Triangle * 3 + 1]];
+				const uint32_t C = Remap[Indices[Triangle * 3 + 2]];
+
+				if (A == B || B == C || A == C)
+					continue;
+
+				Indices[WriteOffset++] = A;
+				Indices[WriteOffset++] = B;
+				Indices[WriteOffset++] = C;
+			}
+
+			Indices.resize(WriteOffset);
+		}
+
+		return (float)std::sqrt(ResultCost);
+	}
+
+	std::vector<uint32_t> MeshOptimizer::BuildMeshlets(std::vector<uint32_t>& Indices, const float* Positions, size_t VertexCount, size_t PositionStride
+		, uint32_t MaxVertices, uint32_t MaxTriangles)
+	{
+		std::vector<uint32_t> MeshletTriangleCounts;
+
+		const size_t TriangleCount = Indices.size() / 3;
+		if (TriangleCount == 0)
+			return MeshletTriangleCounts;
+
+		std::vector<uint32_t> AdjacencyOffsets(VertexCount + 1, 0);
+		for (uint32_t Index : Indices)
+			AdjacencyOffsets[Index + 1]++;
+
+		for (size_t i = 0; i < VertexCount; i++)
+			AdjacencyOffsets[i + 1] += AdjacencyOffsets[i];
+
+		std::vector<uint32_t> AdjacentTriangles(Indices.size());
+		{
+			std::vector<uint32_t> Cursors(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+			for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+			{
+				for (size_t Corner = 0; Corner < 3; Corner++)
+					AdjacentTriangles[Cursors[Indices[Triangle * 3 + Corner]]++] = (uint32_t)Triangle;
+			}
+		}
+
+		std::vector<float> TriangleNormals(TriangleCount * 3);
+		for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+		{
+			Cross(GetPosition(Positions, PositionStride, Indices[Triangle * 3 + 0]), GetPosition(Positions, PositionStride, Indices[Triangle * 3 + 1])
+				, GetPosition(Positions, PositionStride, Indices[Triangle * 3 + 2]), &TriangleNormals[Triangle * 3]);
+			Normalize(&TriangleNormals[Triangle * 3]);
+		}
+
+		// Islands and seams leave meshlets without neighbours to grow into, they continue with the closest triangle
+		// facing the same half space among this many unused ones following the seed
+		const size_t IslandLookahead = 1024;
+
+		std::vector<uint8_t> Emitted(TriangleCount, 0);
+		// Meshlet number plus one of the meshlet that last used a vertex
+		std::vector<uint32_t> VertexMeshlet(VertexCount, 0);
+
+		std::vector<uint32_t> Result;
+		Result.reserve(Indices.size());
+
+		std::vector<uint32_t> Candidates;
+		size_t SeedCursor = 0;
+
+		while (Result.size() < Indices.size())
+		{
+			// New meshlets start from the earliest unused triangle, which keeps the incoming vertex cache order
+			while (Emitted[SeedCursor])
+				SeedCursor++;
+
+			const uint32_t MeshletNumber = (uint32_t)MeshletTriangleCounts.size() + 1;
+			uint32_t MeshletVertexCount = 0;
+			uint32_t MeshletTriangleCount = 0;
+			float NormalSum[3] = { 0.0f, 0.0f, 0.0f };
+			float CentroidSum[3] = { 0.0f, 0.0f, 0.0f };
+
+			Candidates.clear();
+
+			auto GetTriangleCentroid = [&](size_t Triangle, int Axis)
+			{
+				float Sum = 0.0f;
+				for (size_t Corner = 0; Corner < 3; Corner++)
+					Sum += GetPosition(Positions, PositionStride, Indices[Triangle * 3 + Corner])[Axis];
+
+				return Sum / 3.0f;
+			};
+
+			auto AddTriangle = [&](uint32_t Triangle)
+			{
+				Emitted[Triangle] = 1;
+				MeshletTriangleCount++;
+
+				for (size_t Corner = 0; Corner < 3; Corner++)
+				{
+					const uint32_t Vertex = Indices[Triangle * 3 + Corner];
+					Result.push_back(Vertex);
+
+					if (VertexMeshlet[Vertex] == MeshletNumber)
+						continue;
+
+					VertexMeshlet[Vertex] = MeshletNumber;
+					MeshletVertexCount++;
+
+					for (uint32_t i = AdjacencyOffsets[Vertex]; i < AdjacencyOffsets[Vertex + 1]; i++)
+					{
+						if (!Emitted[AdjacentTriangles[i]])
+							Candidates.push_back(AdjacentTriangles[i]);
+					}
+				}
+
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					NormalSum[Axis] += TriangleNormals[Triangle * 3 + Axis];
+					CentroidSum[Axis] += GetTriangleCentroid(Triangle, Axis);
+				}
+			};
+
+			AddTriangle((uint32_t)SeedCursor);
+
+			while (MeshletTriangleCount < MaxTriangles)
+			{
+				float Axis[3] = { NormalSum[0], NormalSum[1], NormalSum[2] };
+				Normalize(Axis);
+
+				// Every new vertex costs one, facing away from the meshlet's average normal costs up to one more
+				uint32_t BestTriangle = INVALID_VERTEX;
+				float BestScore = 0.0f;
+
+				for (size_t i = 0; i < Candidates.size();)
+				{
+					const uint32_t Triangle = Candidates[i];
+					if (Emitted[Triangle])
+					{
+						Candidates[i] = Candidates.back();
+						Candidates.pop_back();
+						continue;
+					}
+
+					i++;
+
+					uint32_t NewVertexCount = 0;
+					for (size_t Corner = 0; Corner < 3; Corner++)
+						NewVertexCount += VertexMeshlet[Indices[Triangle * 3 + Corner]] != MeshletNumber ? 1 : 0;
+
+					if (MeshletVertexCount + NewVertexCount > MaxVertices)
+						continue;
+
+					const float Score = (float)NewVertexCount + 0.5f * (1.0f - Dot(Axis, &TriangleNormals[Triangle * 3]));
+					if (BestTriangle == INVALID_VERTEX || Score < BestScore)
+					{
+						BestTriangle = Triangle;
+						BestScore = Score;
+					}
+				}
+
+				if (BestTriangle == INVALID_VERTEX && Candidates.empty() && MeshletVertexCount + 3 <= MaxVertices)
+				{
+					float BestDistance = 0.0f;
+					size_t Scanned = 0;
+
+					for (size_t Triangle = SeedCursor; Triangle < TriangleCount && Scanned < IslandLookahead; Triangle++)
+					{
+						if (Emitted[Triangle])
+							continue;
+
+						Scanned++;
+
+						// Would leave the meshlet without a normal cone
+						if (Dot(Axis, &TriangleNormals[Triangle * 3]) <= 0.0f)
+							continue;
+
+						float Distance = 0.0f;
+						for (int Axis = 0; Axis < 3; Axis++)
+						{
+							const float Offset = GetTriangleCentroid(Triangle, Axis) - CentroidSum[Axis] / MeshletTriangleCount;
+							Distance += Offset * Offset;
+						}
+
+						if (BestTriangle == INVALID_VERTEX || Distance < BestDistance)
+						{
+							BestTriangle = (uint32_t)Triangle;
+							BestDistance = Distance;
+						}
+					}
+				}
+
+				if (BestTriangle == INVALID_VERTEX)
+					break;
+
+				AddTriangle(BestTriangle);
+			}
+
+			MeshletTriangleCounts.push_back(MeshletTriangleCount);
+		}
+
+		Indices.swap(Result);
+		return MeshletTriangleCounts;
+	}
+
+	MeshOptimizer::MeshletBounds MeshOptimizer::ComputeMeshletBounds(const uint32_t* Indices, size_t IndexCount, const float* Positions, size_t PositionStride)
+	{
+		MeshletBounds Bounds;
+		if (IndexCount == 0)
+			return Bounds;
+
+		// Center of the bounding box, close to the minimal sphere for the compact shapes meshlets have
+		float Min[3];
+		float Max[3];
+		memcpy(Min, GetPosition(Positions, PositionStride, Indices[0]), sizeof(Min));
+		memcpy(Max, Min, sizeof(Max));
+
+		for (size_t i = 1; i < IndexCount; i++)
+		{
+			const float* Position = GetPosition(Positions, PositionStride, Indices[i]);
+			for (int Axis = 0; Axis < 3; Axis++)
+			{
+				Min[Axis] = std::min(Min[Axis], Position[Axis]);
+				Max[Axis] = std::max(Max[Axis], Position[Axis]);
+			}
+		}
+
+		for (int Axis = 0; Axis < 3; Axis++)
+			Bounds.Center[Axis] = (Min[Axis] + Max[Axis]) * 0.5f;
+
+		for (size_t i = 0; i < IndexCount; i++)
+		{
+			const float* Position = GetPosition(Positions, PositionStride, Indices[i]);
+			const float Offset[3] = { Position[0] - Bounds.Center[0], Position[1] - Bounds.Center[1], Position[2] - Bounds.Center[2] };
+			Bounds.Radius = std::max(Bounds.Radius, std::sqrt(Dot(Offset, Offset)));
+		}
+
+		std::vector<float> Normals;
+		Normals.reserve(IndexCount);
+
+		for (size_t i = 0; i + 2 < IndexCount; i += 3)
+		{
+			float Normal[3];
+			Cross(GetPosition(Positions, PositionStride, Indices[i]), GetPosition(Positions, PositionStride, Indices[i + 1]), GetPosition(Positions, PositionStride, Indices[i + 2]), Normal);
+
+			// Degenerate triangles are never rasterized, they do not widen the cone
+			if (Normalize(Normal) == 0.0f)
+				continue;
+
+			Normals.insert(Normals.end(), Normal, Normal + 3);
+			for (int Axis = 0; Axis < 3; Axis++)
+				Bounds.ConeAxis[Axis] += Normal[Axis];
+		}
+
+		if (Normalize(Bounds.ConeAxis) == 0.0f)
+			return Bounds;
+
+		float MinDot = 1.0f;
+		for (size_t i = 0; i < Normals.size(); i += 3)
+			MinDot = std::min(MinDot, Dot(Bounds.ConeAxis, &Normals[i]));
+
+		// Normals 90 degrees or more from the axis leave no view from which all triangles face away
+		Bounds.ConeCutoff = MinDot > 0.0f ? std::sqrt(1.0f - MinDot * MinDot) : 1.0f;
+		return Bounds;
+	}
+
+	bool MeshOptimizer::IsMeshletBackfacing(const MeshletBounds& Bounds, const float* CameraPosition)
+	{
+		if (Bounds.ConeCutoff >= 1.0f)
+			return false;
+
+		// Back facing from every point of the sphere when the view direction stays within 90 degrees minus the cone
+		// half angle of the axis. Points of the sphere lie within Radius of the center along the axis and are at
+		// most Radius further away.
+		const float ToCenter[3] = { Bounds.Center[0] - CameraPosition[0], Bounds.Center[1] - CameraPosition[1], Bounds.Center[2] - CameraPosition[2] };
+		const float Distance = std::sqrt(Dot(ToCenter, ToCenter));
+
+		return Dot(ToCenter, Bounds.ConeAxis) > Bounds.ConeCutoff * (Distance + Bounds.Radius) + Bounds.Radius;
+	}
+
+	MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& Indices, size_t VertexCount, uint32_t CacheSize)
+	{
+		VertexCacheStats Stats;
+		if (Indices.empty())
+			return Stats;
+
+		FifoCache Cache(VertexCount, CacheSize);
+		std::vector<bool> Referenced(VertexCount, false);
+
+		uint32_t Misses = 0;
+		uint32_t ReferencedCount = 0;
+
+		for (uint32_t Index : Indices)
+		{
+			Misses += (uint32_t)Cache.Access(Index);
+
+			if (!Referenced[Index])
+			{
+				Referenced[Index] = true;
+				ReferencedCount++;
+			}
+		}
+
+		Stats.Acmr = (float)Misses / (float)(Indices.size() / 3);
+		Stats.Atvr = (float)Misses / (float)ReferencedCount;
+		return Stats;
+	}
+
+	MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const std::vector<uint32_t>& Indices, size_t VertexCount, size_t VertexSize)
+	{
+		VertexFetchStats Stats;
+		if (Indices.empty() || VertexCount == 0)
+			return Stats;
+
+		// Attributes are only fetched for vertices the post transform cache misses
+		FifoCache VertexCache(VertexCount, DEFAULT_CACHE_SIZE);
+		FifoCache LineCache((VertexCount * VertexSize + FETCH_LINE_SIZE - 1) / FETCH_LINE_SIZE, FETCH_CACHE_LINES);
+
+		size_t FetchedBytes = 0;
+		for (uint32_t Index : Indices)
+		{
+			if (!VertexCache.Access(Index))
+				continue;
+
+			const size_t FirstLine = Index * VertexSize / FETCH_LINE_SIZE;
+			const size_t LastLine = ((size_t)Index * VertexSize + VertexSize - 1) / FETCH_LINE_SIZE;
+
+			for (size_t Line = FirstLine; Line <= LastLine; Line++)
+			{
+				if (LineCache.Access(Line))
+					FetchedBytes += FETCH_LINE_SIZE;
+			}
+		}
+
+		Stats.Overfetch = (float)FetchedBytes / (float)(VertexCount * VertexSize);
+		return Stats;
+	}
+
+	bool MeshOptimizer::HasSameTriangles(const std::vector<uint32_t>& Indices, const std::vector<uint32_t>& OtherIndices)
+	{
+		if (Indices.size() != OtherIndices.size())
+			return false;
+
+		// Rotating the smallest index first keeps the winding comparable
+		auto Normalize = [](const std::vector<uint32_t>& Source)
+		{
+			std::vector<std::array<uint32_t, 3>> Triangles(Source.size() / 3);
+			for (size_t i = 0; i < Triangles.size(); i++)
+			{
+				const uint32_t* Triangle = &Source[i * 3];
+				const size_t First = std::min_element(Triangle, Triangle + 3) - Triangle;
+				Triangles[i] = { Triangle[First], Triangle[(First + 1) % 3], Triangle[(First + 2) % 3] };
+			}
+
+			std::sort(Triangles.begin(), Triangles.end());
+			return Triangles;
+		};
+
+		return Normalize(Indices) == Normalize(OtherIndices);
+	}
+
+	void MeshOptimizer::RunBenchmark(const std::string& FilePath)
+	{
+		Mesh::Builder MeshBuilder;
+		MeshBuilder.LoadModel(FilePath);
+
+		const std::vector<uint32_t> SourceIndices = MeshBuilder.Indices;
+		std::vector<Mesh::Vertex> Vertices = MeshBuilder.Vertices;
+		std::vector<uint32_t> Indices = SourceIndices;
+
+		std::cout << "Optimizing " << FilePath << ", " << Vertices.size() << " vertices, " << Indices.size() / 3 << " triangles" << std::endl;
+
+		auto PrintStats = [](const char* Stage, const std::vector<uint32_t>& StageIndices, size_t VertexCount, float TimeMs, bool Valid)
+		{
+			const VertexCacheStats Cache16 = AnalyzeVertexCache(StageIndices, VertexCount, 16);
+			const VertexCacheStats Cache32 = AnalyzeVertexCache(StageIndices, VertexCount, 32);
+			const VertexFetchStats Fetch = AnalyzeVertexFetch(StageIndices, VertexCount, sizeof(Mesh::Vertex));
+
+			std::cout << Stage << " : ACMR " << Cache16.Acmr << " / " << Cache32.Acmr << ", ATVR " << Cache16.Atvr << " / " << Cache32.Atvr
+				<< " (16 / 32 entries), overfetch " << Fetch.Overfetch << ", " << TimeMs << " ms" << (Valid ? "" : ", TRIANGLES CHANGED") << std::endl;
+		};
+
+		auto Elapsed = [](std::chrono::high_resolution_clock::time_point StartTime)
+		{
+			return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - StartTime).count();
+		};
+
+		PrintStats("Loaded", Indices, Vertices.size(), 0.0f, true);
+
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		OptimizeVertexCache(Indices, Vertices.size());
+		float TimeMs = Elapsed(StartTime);
+		PrintStats("Vertex cache", Indices, Vertices.size(), TimeMs, HasSameTriangles(SourceIndices, Indices));
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		OptimizeOverdraw(Indices, &Vertices[0].position.x, Vertices.size(), sizeof(Mesh::Vertex));
+		TimeMs = Elapsed(StartTime);
+		PrintStats("Overdraw", Indices, Vertices.size(), TimeMs, HasSameTriangles(SourceIndices, Indices));
+
+		// Reordering a list of the original vertex numbers the same way maps the new indices back for validation
+		std::vector<uint32_t> SourceVertices(Vertices.size());
+		std::iota(SourceVertices.begin(), SourceVertices.end(), 0);
+
+		std::vector<uint32_t> ValidationIndices = Indices;
+		SourceVertices.resize(OptimizeVertexFetch(SourceVertices.data(), SourceVertices.size(), sizeof(uint32_t), ValidationIndices));
+
+		for (uint32_t& Index : ValidationIndices)
+			Index = SourceVertices[Index];
+
+		StartTime = std::chrono::high_resolution_clock::now();
+		Vertices.resize(OptimizeVertexFetch(Vertices.data(), Vertices.size(), sizeof(Mesh::Vertex), Indices));
+		TimeMs = Elapsed(StartTime);
+		PrintStats("Vertex fetch", Indices, Vertices.size(), TimeMs, HasSameTriangles(SourceIndices, ValidationIndices));
+	}
+
+	void MeshOptimizer::RunLodBenchmark(const std::string& FilePath)
+	{
+		Mesh::Builder MeshBuilder;
+		MeshBuilder.LoadModel(FilePath);
+		MeshBuilder.Optimize();
+
+		const Mesh::BoundingBox Bounds = MeshBuilder.ComputeBounds();
+		const float Radius = glm::length(Bounds.Max - Bounds.Min) * 0.5f;
+
+		std::cout << "LOD chain for " << FilePath << ", " << MeshBuilder.Vertices.size() << " vertices, bounding radius " << Radius << std::endl;
+
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.GenerateLods(Mesh::MAX_LOD_COUNT);
+		const float TimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - StartTime).count();
+
+		// Screen size in pixels of the bounding sphere's diameter at which a level's error reaches one pixel
+		for (size_t i = 0; i < MeshBuilder.Lods.size(); i++)
+		{
+			const Mesh::Lod& Level = MeshBuilder.Lods[i];
+			std::cout << "LOD " << i << " : " << Level.IndexCount / 3 << " triangles (" << 100.0f * Level.IndexCount / MeshBuilder.Lods[0].IndexCount
+				<< "%), error " << Level.Error << " (" << (Radius > 0.0f ? 100.0f * Level.Error / Radius : 0.0f) << "% of radius)";
+
+			if (Level.Error > 0.0f)
+				std::cout << ", within a pixel below " << 2.0f * Radius / Level.Error << " pixels across";
+
+			std::cout << std::endl;
+		}
+
+		std::cout << "Generated in " << TimeMs << " ms, index buffer grows by "
+			<< 100.0f * (float)(MeshBuilder.Indices.size() - MeshBuilder.Lods[0].IndexCount) / (float)MeshBuilder.Lods[0].IndexCount << "%" << std::endl;
+	}
+
+	void MeshOptimizer::RunMeshletBenchmark(const std::string& FilePath)
+	{
+		Mesh::Builder MeshBuilder;
+		MeshBuilder.LoadModel(FilePath);
+		MeshBuilder.Optimize();
+
+		const std::vector<uint32_t> SourceIndices = MeshBuilder.Indices;
+
+		// Checked before BuildMeshlets renumbers the vertices
+		std::vector<uint32_t> MeshletIndices = SourceIndices;
+		BuildMeshlets(MeshletIndices, &MeshBuilder.Vertices[0].position.x, MeshBuilder.Vertices.size(), sizeof(Mesh::Vertex), Mesh::MAX_MESHLET_VERTICES, Mesh::MAX_MESHLET_TRIANGLES);
+		const bool SameTriangles = HasSameTriangles(SourceIndices, MeshletIndices);
+
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		MeshBuilder.BuildMeshlets();
+		const float TimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - StartTime).count();
+
+		const std::vector<Mesh::Meshlet>& Meshlets = MeshBuilder.Meshlets;
+		const float* Positions = &MeshBuilder.Vertices[0].position.x;
+
+		size_t MaxVertexCount = 0;
+		size_t VertexSum = 0;
+		size_t MaxTriangleCount = 0;
+		size_t ConeCount = 0;
+
+		for (const Mesh::Meshlet& Cluster : Meshlets)
+		{
+			MaxVertexCount = std::max<size_t>(MaxVertexCount, Cluster.VertexCount);
+			MaxTriangleCount = std::max<size_t>(MaxTriangleCount, Cluster.IndexCount / 3);
+			VertexSum += Cluster.VertexCount;
+			ConeCount += Cluster.ConeCutoff < 1.0f ? 1 : 0;
+		}
+
+		std::cout << "Meshlets for " << FilePath << " : " << Meshlets.size() << " meshlets built in " << TimeMs << " ms, "
+			<< (float)SourceIndices.size() / 3.0f / Meshlets.size() << " triangles (max " << MaxTriangleCount << ") and "
+			<< (float)VertexSum / Meshlets.size() << " vertices (max " << MaxVertexCount << ") per meshlet, "
+			<< 100.0f * ConeCount / Meshlets.size() << "% with a usable normal cone"
+			<< (SameTriangles ? "" : ", TRIANGLES CHANGED") << std::endl;
+
+		const Mesh::BoundingBox Bounds = MeshBuilder.ComputeBounds();
+		const glm::vec3 Center = (Bounds.Min + Bounds.Max) * 0.5f;
+		const float Radius = glm::length(Bounds.Max - Bounds.Min) * 0.5f;
+
+		// Viewpoints on a sunflower spiral over spheres of growing distance around the mesh
+		const uint32_t ViewCount = 256;
+		for (float DistanceInRadii : { 1.5f, 4.0f, 16.0f })
+		{
+			size_t RejectedMeshlets = 0;
+			size_t RejectedTriangles = 0;
+			size_t BackfacingTriangles = 0;
+			size_t WrongRejections = 0;
+
+			for (uint32_t View = 0; View < ViewCount; View++)
+			{
+				const float Z = 1.0f - 2.0f * ((float)View + 0.5f) / ViewCount;
+				const float Ring = std::sqrt(1.0f - Z * Z);
+				const float Angle = (float)View * 2.39996323f;
+				const glm::vec3 Camera = Center + DistanceInRadii * Radius * glm::vec3(Ring * std::cos(Angle), Ring * std::sin(Angle), Z);
+
+				for (const Mesh::Meshlet& Cluster : Meshlets)
+				{
+					const uint32_t* ClusterIndices = &MeshBuilder.Indices[Cluster.FirstIndex];
+
+					size_t ClusterBackfacing = 0;
+					for (uint32_t i = 0; i < Cluster.IndexCount; i += 3)
+					{
+						float Normal[3];
+						const float* P0 = GetPosition(Positions, sizeof(Mesh::Vertex), ClusterIndices[i]);
+						Cross(P0, GetPosition(Positions, sizeof(Mesh::Vertex), ClusterIndices[i + 1]), GetPosition(Positions, sizeof(Mesh::Vertex), ClusterIndices[i + 2]), Normal);
+
+						const float ToTriangle[3] = { P0[0] - Camera.x, P0[1] - Camera.y, P0[2] - Camera.z };
+						ClusterBackfacing += Dot(Normal, ToTriangle) >= 0.0f ? 1 : 0;
+					}
+
+					BackfacingTriangles += ClusterBackfacing;
+
+					MeshletBounds ClusterBounds;
+					memcpy(ClusterBounds.Center, &Cluster.Center, sizeof(ClusterBounds.Center));
+					ClusterBounds.Radius = Cluster.Radius;
+					memcpy(ClusterBounds.ConeAxis, &Cluster.ConeAxis, sizeof(ClusterBounds.ConeAxis));
+					ClusterBounds.ConeCutoff = Cluster.ConeCutoff;
+
+					if (IsMeshletBackfacing(ClusterBounds, &Camera.x))
+					{
+						RejectedMeshlets++;
+						RejectedTriangles += Cluster.IndexCount / 3;
+						WrongRejections += ClusterBackfacing != Cluster.IndexCount / 3 ? 1 : 0;
+					}
+				}
+			}
+
+			std::cout << "At " << DistanceInRadii << " radii : " << 100.0f * RejectedMeshlets / (Meshlets.size() * ViewCount) << "% of meshlets rejected as back facing, "
+				<< 100.0f * RejectedTriangles / (SourceIndices.size() / 3 * ViewCount) << "% of triangles against " << 100.0f * BackfacingTriangles / (SourceIndices.size() / 3 * ViewCount)
+				<< "% back facing" << (WrongRejections > 0 ? ", REJECTED FRONT FACING TRIANGLES" : "") << std::endl;
+		}
+	}
+}
\ No newline at end of file
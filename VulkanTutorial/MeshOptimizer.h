@@ -0,0 +1,98 @@
+#ifndef __MeshOptimizer_h__
+#define __MeshOptimizer_h__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Reorders indexed triangle lists for the GPU, run in this order: vertex cache, overdraw, vertex fetch. Every pass
+	// keeps the same set of triangles with the same winding.
+	class MeshOptimizer
+	{
+	public:
+
+		// Entries of the FIFO post transform cache simulated by the passes and by AnalyzeVertexCache
+		static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+		// Overdraw may raise the ACMR of the vertex cache pass by this factor
+		static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+		struct VertexCacheStats
+		{
+			// Transformed vertices per triangle, between 0.5 and 3
+			float Acmr = 0.0f;
+			// Transformed vertices per referenced vertex, 1 is ideal
+			float Atvr = 0.0f;
+		};
+
+		struct VertexFetchStats
+		{
+			// Bytes read from the vertex buffer divided by its size, 1 is ideal
+			float Overfetch = 0.0f;
+		};
+
+		struct MeshletBounds
+		{
+			// Bounding sphere of the meshlet's vertices
+			float Center[3] = { 0.0f, 0.0f, 0.0f };
+			float Radius = 0.0f;
+			// Every triangle normal lies within the cone around ConeAxis whose half angle has the sine ConeCutoff. A
+			// cutoff of one means the triangles face too many ways to ever be back facing together.
+			float ConeAxis[3] = { 0.0f, 0.0f, 0.0f };
+			float ConeCutoff = 1.0f;
+		};
+
+		// Tipsify (Sander, Nehab, Barczak 2007), linear in the triangle count
+		static void OptimizeVertexCache(std::vector<uint32_t>& Indices, size_t VertexCount, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+
+		// Splits the triangle order into clusters whose ACMR stays within Threshold of the whole, then draws clusters
+		// facing away from the mesh center first so they occlude the rest. Positions are three floats every
+		// PositionStride bytes.
+		static void OptimizeOverdraw(std::vector<uint32_t>& Indices, const float* Positions, size_t VertexCount, size_t PositionStride
+			, float Threshold = DEFAULT_OVERDRAW_THRESHOLD, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+
+		// Moves vertices into the order the indices first use them and drops unreferenced ones, returns the new vertex count
+		static size_t OptimizeVertexFetch(void* Vertices, size_t VertexCount, size_t VertexSize, std::vector<uint32_t>& Indices);
+
+		// Quadric error metric edge collapse (Garland, Heckbert 1997). Collapses edges onto one of their endpoints until
+		// Indices shrinks to TargetIndexCount or no collapse stays within TargetError, a distance in mesh units.
+		// Vertices on open borders or sharing their position with another vertex, as on normal and uv seams, never
+		// move. Only indices are rewritten, returns the largest error of the collapses made.
+		static float Simplify(std::vector<uint32_t>& Indices, const float* Positions, size_t VertexCount, size_t PositionStride
+			, size_t TargetIndexCount, float TargetError);
+
+		// Reorders triangles into meshlets of at most MaxVertices distinct vertices and MaxTriangles triangles, grown
+		// greedily over shared vertices preferring triangles that add no vertex and face like the meshlet. Returns the
+		// triangle count of every meshlet in order.
+		static std::vector<uint32_t> BuildMeshlets(std::vector<uint32_t>& Indices, const float* Positions, size_t VertexCount, size_t PositionStride
+			, uint32_t MaxVertices, uint32_t MaxTriangles);
+
+		static MeshletBounds ComputeMeshletBounds(const uint32_t* Indices, size_t IndexCount, const float* Positions, size_t PositionStride);
+
+		// True when every triangle of the meshlet faces away from CameraPosition, counter clockwise triangles face
+		// the side their normal points to. Conservative, the same test as CullClusters.comp.
+		static bool IsMeshletBackfacing(const MeshletBounds& Bounds, const float* CameraPosition);
+
+		static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& Indices, size_t VertexCount, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+
+		// Simulates a 16 KB cache of 64 byte lines in front of the vertex buffer
+		static VertexFetchStats AnalyzeVertexFetch(const std::vector<uint32_t>& Indices, size_t VertexCount, size_t VertexSize);
+
+		// True when both lists hold the same triangles with the same winding, in any order
+		static bool HasSameTriangles(const std::vector<uint32_t>& Indices, const std::vector<uint32_t>& OtherIndices);
+
+		// Loads FilePath and prints ACMR, ATVR and overfetch after every pass, checking that no triangle was lost
+		static void RunBenchmark(const std::string& FilePath);
+
+		// Loads FilePath and prints triangle count, error and build time of every level of its LOD chain
+		static void RunLodBenchmark(const std::string& FilePath);
+
+		// Loads FilePath, builds its meshlets and prints their fill and the share rejected as back facing from
+		// viewpoints around the mesh, checking each rejection against the triangles
+		static void RunMeshletBenchmark(const std::string& FilePath);
+	};
+}
+
+#endif //__MeshOptimizer_h__
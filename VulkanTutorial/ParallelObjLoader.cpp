@@ -0,0 +1,627 @@
+#include "ParallelObjLoader.h"
+#include "MappedFile.h"
+
+// The implementation lives in this translation unit so the parser below can reuse tinyobj's number parsing
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		// Below this size per chunk the thread hand off costs more than the parsing
+		constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+		enum RelativeIndexFlags : uint8_t
+		{
+			RELATIVE_POSITION = 1 << 0,
+			RELATIVE_TEXCOORD = 1 << 1,
+			RELATIVE_NORMAL = 1 << 2,
+		};
+
+		// Indices are zero based, relative (negative) OBJ indices are stored against the chunk start and resolved once
+		// the attribute counts of all previous chunks are known
+		struct FaceCorner
+		{
+			int32_t Position = -1;
+			int32_t TexCoord = -1;
+			int32_t Normal = -1;
+			uint8_t RelativeFlags = 0;
+		};
+
+		struct FaceRecord
+		{
+			uint32_t FirstCorner;
+			uint32_t CornerCount;
+			uint32_t PositionCountAtLine;
+		};
+
+		struct ChunkData
+		{
+			std::vector<float> Positions;
+			std::vector<float> Normals;
+			std::vector<float> TexCoords;
+			std::vector<FaceCorner> Corners;
+			std::vector<FaceRecord> Faces;
+			size_t TriangleCornerCount = 0;
+			bool IsSupported = true;
+		};
+
+		inline bool IsBlank(char C)
+		{
+			return C == ' ' || C == '\t';
+		}
+
+		inline char Peek(const char* Token, const char* LineEnd, size_t Offset)
+		{
+			return Token + Offset < LineEnd ? Token[Offset] : '\0';
+		}
+
+		// Bounded equivalent of tinyobj::parseReal, mapped lines are not null terminated
+		float ParseReal(const char*& Token, const char* LineEnd)
+		{
+			while (Token < LineEnd && IsBlank(*Token))
+				Token++;
+
+			const char* End = Token;
+			while (End < LineEnd && !IsBlank(*End) && *End != '\r')
+				End++;
+
+			double Value = 0.0;
+			tinyobj::tryParseDouble(Token, End, &Value);
+
+			Token = End;
+			return static_cast<tinyobj::real_t>(Value);
+		}
+
+		// Bounded equivalent of atoi, saturating instead of overflowing
+		int ParseInt(const char* Token, const char* LineEnd)
+		{
+			while (Token < LineEnd && (IsBlank(*Token) || *Token == '\r' || *Token == '\v' || *Token == '\f'))
+				Token++;
+
+			bool IsNegative = false;
+			if (Token < LineEnd && (*Token == '+' || *Token == '-'))
+			{
+				IsNegative = *Token == '-';
+				Token++;
+			}
+
+			int64_t Value = 0;
+			while (Token < LineEnd && *Token >= '0' && *Token <= '9')
+			{
+				Value = std::min<int64_t>(Value * 10 + (*Token - '0'), INT_MAX);
+				Token++;
+			}
+
+			return (int)(IsNegative ? -Value : Value);
+		}
+
+		void SkipToSeparator(const char*& Token, const char* LineEnd)
+		{
+			while (Token < LineEnd && *Token != '/' && !IsBlank(*Token) && *Token != '\r')
+				Token++;
+		}
+
+		// Mirrors tinyobj's fixIndex
+		bool FixIndex(int RawIndex, size_t LocalCount, bool AllowZero, uint8_t RelativeFlag, int32_t& OutIndex, uint8_t& OutFlags)
+		{
+			if (RawIndex > 0)
+			{
+				OutIndex = RawIndex - 1;
+				return true;
+			}
+
+			if (RawIndex == 0)
+			{
+				OutIndex = -1;
+				return AllowZero;
+			}
+
+			OutIndex = (int32_t)LocalCount + RawIndex;
+			OutFlags |= RelativeFlag;
+			return true;
+		}
+
+		// Mirrors tinyobj's parseTriple: i, i/j/k, i//k, i/j
+		bool ParseTriple(const char*& Token, const char* LineEnd, const ChunkData& Chunk, FaceCorner& OutCorner)
+		{
+			const size_t PositionCount = Chunk.Positions.size() / 3;
+			const size_t NormalCount = Chunk.Normals.size() / 3;
+			const size_t TexCoordCount = Chunk.TexCoords.size() / 2;
+
+			if (!FixIndex(ParseInt(Token, LineEnd), PositionCount, false, RELATIVE_POSITION, OutCorner.Position, OutCorner.RelativeFlags))
+				return false;
+
+			SkipToSeparator(Token, LineEnd);
+			if (Peek(Token, LineEnd, 0) != '/')
+				return true;
+
+			Token++;
+
+			// i//k
+			if (Peek(Token, LineEnd, 0) == '/')
+			{
+				Token++;
+				if (!FixIndex(ParseInt(Token, LineEnd), NormalCount, true, RELATIVE_NORMAL, OutCorner.Normal, OutCorner.RelativeFlags))
+					return false;
+
+				SkipToSeparator(Token, LineEnd);
+				return true;
+			}
+
+			// i/j/k or i/j
+			if (!FixIndex(ParseInt(Token, LineEnd), TexCoordCount, true, RELATIVE_TEXCOORD, OutCorner.TexCoord, OutCorner.RelativeFlags))
+				return false;
+
+			SkipToSeparator(Token, LineEnd);
+			if (Peek(Token, LineEnd, 0) != '/')
+				return true;
+
+			Token++;
+			if (!FixIndex(ParseInt(Token, LineEnd), NormalCount, true, RELATIVE_NORMAL, OutCorner.Normal, OutCorner.RelativeFlags))
+				return false;
+
+			SkipToSeparator(Token, LineEnd);
+			return true;
+		}
+
+		void ParseLine(const char* Token, const char* LineEnd, ChunkData& Chunk)
+		{
+			while (Token < LineEnd && IsBlank(*Token))
+				Token++;
+
+			if (Token >= LineEnd || *Token == '\0' || *Token == '#')
+				return;
+
+			const char C0 = Token[0];
+			const char C1 = Peek(Token, LineEnd, 1);
+			const char C2 = Peek(Token, LineEnd, 2);
+
+			if (C0 == 'v' && IsBlank(C1))
+			{
+				Token += 2;
+				const float X = ParseReal(Token, LineEnd);
+				const float Y = ParseReal(Token, LineEnd);
+				const float Z = ParseReal(Token, LineEnd);
+				Chunk.Positions.insert(Chunk.Positions.end(), { X, Y, Z });
+				return;
+			}
+
+			if (C0 == 'v' && C1 == 'n' && IsBlank(C2))
+			{
+				Token += 3;
+				const float X = ParseReal(Token, LineEnd);
+				const float Y = ParseReal(Token, LineEnd);
+				const float Z = ParseReal(Token, LineEnd);
+				Chunk.Normals.insert(Chunk.Normals.end(), { X, Y, Z });
+				return;
+			}
+
+			if (C0 == 'v' && C1 == 't' && IsBlank(C2))
+			{
+				Token += 3;
+				const float X = ParseReal(Token, LineEnd);
+				const float Y = ParseReal(Token, LineEnd);
+				Chunk.TexCoords.insert(Chunk.TexCoords.end(), { X, Y });
+				return;
+			}
+
+			if (C0 == 'f' && IsBlank(C1))
+			{
+				Token += 2;
+				while (Token < LineEnd && IsBlank(*Token))
+					Token++;
+
+				FaceRecord Face{ (uint32_t)Chunk.Corners.size(), 0, (uint32_t)(Chunk.Positions.size() / 3) };
+
+				while (Token < LineEnd && *Token != '\r' && *Token != '\0' && *Token != '#')
+				{
+					FaceCorner Corner;
+					if (!ParseTriple(Token, LineEnd, Chunk, Corner))
+					{
+						Chunk.IsSupported = false;
+						return;
+					}
+
+					Chunk.Corners.push_back(Corner);
+					Face.CornerCount++;
+
+					while (Token < LineEnd && (IsBlank(*Token) || *Token == '\r'))
+						Token++;
+				}
+
+				// tinyobj drops faces with less than 3 corners
+				if (Face.CornerCount < 3)
+				{
+					Chunk.Corners.resize(Face.FirstCorner);
+					return;
+				}
+
+				// Larger polygons go through tinyobj's ear clipping, which is not replicated here
+				if (Face.CornerCount > 4)
+				{
+					Chunk.IsSupported = false;
+					return;
+				}
+
+				Chunk.Faces.push_back(Face);
+				Chunk.TriangleCornerCount += Face.CornerCount == 3 ? 3 : 6;
+			}
+
+			// Everything else (groups, materials, lines, points...) does not contribute to Builder output
+		}
+
+		void ParseChunk(const char* ChunkBegin, const char* ChunkEnd, const char* FileEnd, ChunkData& Chunk)
+		{
+			const char* Cursor = ChunkBegin;
+			while (Cursor < ChunkEnd)
+			{
+				const char* LineEnd = Cursor;
+				while (LineEnd < ChunkEnd && *LineEnd != '\n' && *LineEnd != '\r')
+					LineEnd++;
+
+				if (LineEnd == FileEnd)
+				{
+					// tinyobj's number parser may peek one character past the token, keep it inside valid memory
+					const std::string LastLine(Cursor, LineEnd);
+					ParseLine(LastLine.c_str(), LastLine.c_str() + LastLine.size(), Chunk);
+				}
+				else
+				{
+					ParseLine(Cursor, LineEnd, Chunk);
+				}
+
+				if (!Chunk.IsSupported)
+					return;
+
+				Cursor = LineEnd + 1;
+			}
+		}
+
+		bool ResolveIndex(int32_t Index, bool IsRelative, size_t Base, size_t Count, bool AllowMissing, int64_t& OutIndex)
+		{
+			OutIndex = IsRelative ? (int64_t)Base + Index : Index;
+
+			if (IsRelative && OutIndex < 0)
+				return false;
+
+			if (OutIndex < 0)
+				return AllowMissing;
+
+			return OutIndex < (int64_t)Count;
+		}
+
+		// Rolling terrain grid with positions, texture coordinates and normals. Cells alternate between quads and
+		// triangle pairs and every eighth row uses relative indices, so both parsers see each face form.
+		void WriteSyntheticObj(const std::string& FilePath, uint64_t TargetBytes)
+		{
+			// Roughly what one grid cell takes, its vertex's three attribute lines plus its faces
+			const uint32_t CellsPerSide = std::max((uint32_t)std::sqrt((double)TargetBytes / 160.0), 1u);
+			const uint32_t VerticesPerSide = CellsPerSide + 1;
+			const int64_t VertexCount = (int64_t)VerticesPerSide * VerticesPerSide;
+
+			std::ofstream File(FilePath, std::ios::binary | std::ios::trunc);
+			if (!File)
+				throw std::runtime_error("Failed to create " + FilePath);
+
+			std::string Text;
+			char Line[128];
+
+			auto Append = [&](int Length)
+			{
+				Text.append(Line, Length);
+				if (Text.size() >= (1 << 22))
+				{
+					File.write(Text.data(), Text.size());
+					Text.clear();
+				}
+			};
+
+			for (uint32_t z = 0; z < VerticesPerSide; z++)
+			{
+				for (uint32_t x = 0; x < VerticesPerSide; x++)
+				{
+					const float Height = 0.5f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+					const float SlopeX = 0.025f * std::cos(x * 0.05f) * std::cos(z * 0.07f);
+					const float SlopeZ = -0.035f * std::sin(x * 0.05f) * std::sin(z * 0.07f);
+					const float Length = std::sqrt(SlopeX * SlopeX + 1.0f + SlopeZ * SlopeZ);
+
+					Append(std::snprintf(Line, sizeof(Line), "v %.4f %.4f %.4f\n", x * 0.1f, Height, z * 0.1f));
+					Append(std::snprintf(Line, sizeof(Line), "vt %.4f %.4f\n", (float)x / CellsPerSide, (float)z / CellsPerSide));
+					Append(std::snprintf(Line, sizeof(Line), "vn %.4f %.4f %.4f\n", -SlopeX / Length, 1.0f / Length, -SlopeZ / Length));
+				}
+			}
+
+			for (uint32_t z = 0; z < CellsPerSide; z++)
+			{
+				// Relative indices count back from the last vertex, which is -1
+				const int64_t Base = z % 8 == 7 ? -VertexCount : 1;
+
+				for (uint32_t x = 0; x < CellsPerSide; x++)
+				{
+					const int64_t A = Base + (int64_t)z * VerticesPerSide + x;
+					const int64_t B = A + 1;
+					const int64_t C = B + VerticesPerSide;
+					const int64_t D = A + VerticesPerSide;
+
+					if ((x + z) % 2 == 0)
+					{
+						Append(std::snprintf(Line, sizeof(Line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n"
+							, (long long)A, (long long)A, (long long)A, (long long)D, (long long)D, (long long)D
+							, (long long)C, (long long)C, (long long)C, (long long)B, (long long)B, (long long)B));
+					}
+					else
+					{
+						Append(std::snprintf(Line, sizeof(Line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n"
+							, (long long)A, (long long)A, (long long)A, (long long)D, (long long)D, (long long)D, (long long)B, (long long)B, (long long)B));
+						Append(std::snprintf(Line, sizeof(Line), "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n"
+							, (long long)B, (long long)B, (long long)B, (long long)D, (long long)D, (long long)D, (long long)C, (long long)C, (long long)C));
+					}
+				}
+			}
+
+			File.write(Text.data(), Text.size());
+			if (!File)
+				throw std::runtime_error("Failed to write " + FilePath);
+		}
+
+		void BenchmarkFile(const std::string& FilePath)
+		{
+			std::cout << "Parsing " << FilePath << ", " << std::filesystem::file_size(FilePath) / (1024 * 1024) << " MB" << std::endl;
+
+			auto Load = [&](Mesh::ObjParser Parser, Mesh::Builder& MeshBuilder)
+			{
+				auto StartTime = std::chrono::high_resolution_clock::now();
+				MeshBuilder.LoadModel(FilePath, Parser);
+				return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - StartTime).count();
+			};
+
+			Mesh::Builder TinyObjBuilder;
+			const float TinyObjMs = Load(Mesh::ObjParser::TinyObj, TinyObjBuilder);
+
+			Mesh::Builder ParallelBuilder;
+			const float ParallelMs = Load(Mesh::ObjParser::Parallel, ParallelBuilder);
+
+			const bool Identical = TinyObjBuilder.Vertices.size() == ParallelBuilder.Vertices.size()
+				&& TinyObjBuilder.Indices.size() == ParallelBuilder.Indices.size()
+				&& std::memcmp(TinyObjBuilder.Vertices.data(), ParallelBuilder.Vertices.data(), TinyObjBuilder.Vertices.size() * sizeof(Mesh::Vertex)) == 0
+				&& std::memcmp(TinyObjBuilder.Indices.data(), ParallelBuilder.Indices.data(), TinyObjBuilder.Indices.size() * sizeof(uint32_t)) == 0;
+
+			// Every corner is one index, deduplication keeps the unique ones as vertices
+			const size_t UniqueVertexCount = TinyObjBuilder.Vertices.size();
+			const size_t TotalVertexCount = TinyObjBuilder.Indices.size();
+
+			std::cout << UniqueVertexCount << " unique / " << TotalVertexCount << " total vertices (ratio " << (TotalVertexCount > 0 ? (float)UniqueVertexCount / (float)TotalVertexCount : 0.0f)
+				<< "), " << TotalVertexCount / 3 << " triangles" << std::endl;
+			std::cout << "LoadModel with deduplication, tinyobj : " << TinyObjMs << " ms, parallel : " << ParallelMs << " ms (" << TinyObjMs / std::max(ParallelMs, 0.001f) << "x), "
+				<< (Identical ? "identical vertices and indices" : "VERTICES OR INDICES DIFFER") << std::endl;
+		}
+	}
+
+	bool ParallelObjLoader::LoadCorners(const std::string& FilePath, std::vector<Mesh::Vertex>& OutCorners, ThreadPool& Pool)
+	{
+		std::unique_ptr<MappedFile> File;
+
+		try
+		{
+			File = std::make_unique<MappedFile>(FilePath);
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << e.what() << ", falling back to tinyobj" << std::endl;
+			return false;
+		}
+
+		const char* FileBegin = (const char*)File->GetData();
+		const char* FileEnd = FileBegin + File->GetSize();
+
+		const char* Begin = FileBegin;
+		if (File->GetSize() >= 3 && (uint8_t)Begin[0] == 0xEF && (uint8_t)Begin[1] == 0xBB && (uint8_t)Begin[2] == 0xBF)
+			Begin += 3;
+
+		// Split into line aligned chunks, a few per thread so uneven chunks still balance
+		const size_t MaxChunkCount = (size_t)(Pool.GetThreadCount() + 1) * 4;
+		const size_t ChunkCount = std::max<size_t>(1, std::min<size_t>(MaxChunkCount, (size_t)(FileEnd - Begin) / MIN_CHUNK_SIZE));
+
+		std::vector<const char*> ChunkStarts(ChunkCount + 1);
+		ChunkStarts[0] = Begin;
+		ChunkStarts[ChunkCount] = FileEnd;
+
+		for (size_t i = 1; i < ChunkCount; i++)
+		{
+			const char* Split = std::max(Begin + (size_t)(FileEnd - Begin) * i / ChunkCount, ChunkStarts[i - 1]);
+			while (Split < FileEnd && *Split != '\n' && *Split != '\r')
+				Split++;
+
+			ChunkStarts[i] = Split < FileEnd ? Split + 1 : FileEnd;
+		}
+
+		std::vector<ChunkData> Chunks(ChunkCount);
+
+		Pool.ParallelFor(ChunkCount, 1, [&](size_t First, size_t Last)
+			{
+				for (size_t i = First; i < Last; i++)
+					ParseChunk(ChunkStarts[i], ChunkStarts[i + 1], FileEnd, Chunks[i]);
+			});
+
+		// Attribute bases and output offsets of every chunk
+		std::vector<size_t> PositionBase(ChunkCount), NormalBase(ChunkCount), TexCoordBase(ChunkCount), CornerBase(ChunkCount);
+		size_t PositionCount = 0, NormalCount = 0, TexCoordCount = 0, CornerCount = 0;
+
+		for (size_t i = 0; i < ChunkCount; i++)
+		{
+			if (!Chunks[i].IsSupported)
+				return false;
+
+			PositionBase[i] = PositionCount;
+			NormalBase[i] = NormalCount;
+			TexCoordBase[i] = TexCoordCount;
+			CornerBase[i] = CornerCount;
+
+			PositionCount += Chunks[i].Positions.size() / 3;
+			NormalCount += Chunks[i].Normals.size() / 3;
+			TexCoordCount += Chunks[i].TexCoords.size() / 2;
+			CornerCount += Chunks[i].TriangleCornerCount;
+		}
+
+		std::vector<float> Positions(PositionCount * 3), Normals(NormalCount * 3), TexCoords(TexCoordCount * 2);
+
+		Pool.ParallelFor(ChunkCount, 1, [&](size_t First, size_t Last)
+			{
+				for (size_t i = First; i < Last; i++)
+				{
+					std::copy(Chunks[i].Positions.begin(), Chunks[i].Positions.end(), Positions.begin() + PositionBase[i] * 3);
+					std::copy(Chunks[i].Normals.begin(), Chunks[i].Normals.end(), Normals.begin() + NormalBase[i] * 3);
+					std::copy(Chunks[i].TexCoords.begin(), Chunks[i].TexCoords.end(), TexCoords.begin() + TexCoordBase[i] * 2);
+
+					std::vector<float>().swap(Chunks[i].Positions);
+					std::vector<float>().swap(Chunks[i].Normals);
+					std::vector<float>().swap(Chunks[i].TexCoords);
+				}
+			});
+
+		OutCorners.resize(CornerCount);
+		std::atomic<bool> IsSupported{ true };
+
+		Pool.ParallelFor(ChunkCount, 1, [&](size_t First, size_t Last)
+			{
+				for (size_t i = First; i < Last && IsSupported; i++)
+				{
+					const ChunkData& Chunk = Chunks[i];
+					Mesh::Vertex* Output = OutCorners.data() + CornerBase[i];
+
+					for (const FaceRecord& Face : Chunk.Faces)
+					{
+						int64_t PositionIndex[4], NormalIndex[4], TexCoordIndex[4];
+
+						for (uint32_t k = 0; k < Face.CornerCount; k++)
+						{
+							const FaceCorner& Corner = Chunk.Corners[Face.FirstCorner + k];
+
+							if (!ResolveIndex(Corner.Position, Corner.RelativeFlags & RELATIVE_POSITION, PositionBase[i], PositionCount, false, PositionIndex[k])
+								|| !ResolveIndex(Corner.Normal, Corner.RelativeFlags & RELATIVE_NORMAL, NormalBase[i], NormalCount, true, NormalIndex[k])
+								|| !ResolveIndex(Corner.TexCoord, Corner.RelativeFlags & RELATIVE_TEXCOORD, TexCoordBase[i], TexCoordCount, true, TexCoordIndex[k]))
+							{
+								IsSupported = false;
+								return;
+							}
+						}
+
+						uint32_t Order[6] = { 0, 1, 2, 0, 0, 0 };
+						uint32_t OrderCount = 3;
+
+						if (Face.CornerCount == 4)
+						{
+							// tinyobj validates quads against the vertices read so far, only backward references are handled here
+							for (uint32_t k = 0; k < 4; k++)
+							{
+								if (PositionIndex[k] >= (int64_t)(PositionBase[i] + Face.PositionCountAtLine))
+								{
+									IsSupported = false;
+									return;
+								}
+							}
+
+							// Same shortest diagonal split, with the same float arithmetic, as tinyobj's exportGroupsToShape
+							const float* V0 = &Positions[PositionIndex[0] * 3];
+							const float* V1 = &Positions[PositionIndex[1] * 3];
+							const float* V2 = &Positions[PositionIndex[2] * 3];
+							const float* V3 = &Positions[PositionIndex[3] * 3];
+
+							tinyobj::real_t e02x = V2[0] - V0[0];
+							tinyobj::real_t e02y = V2[1] - V0[1];
+							tinyobj::real_t e02z = V2[2] - V0[2];
+							tinyobj::real_t e13x = V3[0] - V1[0];
+							tinyobj::real_t e13y = V3[1] - V1[1];
+							tinyobj::real_t e13z = V3[2] - V1[2];
+
+							tinyobj::real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+							tinyobj::real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+							const uint32_t SplitA[6] = { 0, 1, 2, 0, 2, 3 };
+							const uint32_t SplitB[6] = { 0, 1, 3, 1, 2, 3 };
+							memcpy(Order, sqr02 < sqr13 ? SplitA : SplitB, sizeof(Order));
+							OrderCount = 6;
+						}
+
+						for (uint32_t k = 0; k < OrderCount; k++)
+						{
+							const uint32_t CornerIndex = Order[k];
+
+							Mesh::Vertex Vert{};
+							Vert.position = {
+								Positions[3 * PositionIndex[CornerIndex] + 0],
+								Positions[3 * PositionIndex[CornerIndex] + 1],
+								Positions[3 * PositionIndex[CornerIndex] + 2]
+							};
+
+							Vert.color = { 1.0f, 1.0f, 1.0f };
+
+							if (NormalIndex[CornerIndex] >= 0)
+							{
+								Vert.normal = {
+									Normals[3 * NormalIndex[CornerIndex] + 0],
+									Normals[3 * NormalIndex[CornerIndex] + 1],
+									Normals[3 * NormalIndex[CornerIndex] + 2]
+								};
+							}
+
+							if (TexCoordIndex[CornerIndex] >= 0)
+							{
+								Vert.uv = {
+									TexCoords[2 * TexCoordIndex[CornerIndex] + 0],
+									TexCoords[2 * TexCoordIndex[CornerIndex] + 1]
+								};
+							}
+
+							*Output++ = Vert;
+						}
+					}
+				}
+			});
+
+		if (!IsSupported)
+		{
+			OutCorners.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	void ParallelObjLoader::RunBenchmark(const std::string& FilePath, uint32_t SyntheticMB)
+	{
+		BenchmarkFile(FilePath);
+
+		const std::string SyntheticPath = (std::filesystem::temp_directory_path() / "objbench_synthetic.obj").string();
+
+		auto StartTime = std::chrono::high_resolution_clock::now();
+		WriteSyntheticObj(SyntheticPath, (uint64_t)SyntheticMB * 1024 * 1024);
+		std::cout << "Generated " << SyntheticPath << " in " << std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - StartTime).count() << " s" << std::endl;
+
+		try
+		{
+			BenchmarkFile(SyntheticPath);
+		}
+		catch (...)
+		{
+			std::filesystem::remove(SyntheticPath);
+			throw;
+		}
+
+		std::filesystem::remove(SyntheticPath);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef __ParallelObjLoader_h__
+#define __ParallelObjLoader_h__
+
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Multithreaded OBJ front end in the spirit of tinyobj_loader_opt: the file is memory mapped, split into line aligned
+	// chunks which are tokenized and float parsed in parallel, then triangles are assembled in parallel per chunk.
+	// Parsing reuses tinyobj's own number parser and quad split rule so the result matches tinyobj::LoadObj exactly.
+	class ParallelObjLoader
+	{
+	public:
+
+		// Produces one vertex per triangle corner, in the same order Mesh::Builder::LoadModel walks tinyobj's shapes.
+		// Returns false when the file needs something only tinyobj handles (polygons above quads, malformed or
+		// out of range indices), the caller is expected to fall back to tinyobj in that case.
+		static bool LoadCorners(const std::string& FilePath, std::vector<Mesh::Vertex>& OutCorners, ThreadPool& Pool = ThreadPool::Shared());
+
+		// Loads FilePath and a generated OBJ of about SyntheticMB megabytes with both ObjParser front ends, prints the
+		// time of each including deduplication, the unique to total vertex ratio and whether the Builder vertices and
+		// indices are byte identical
+		static void RunBenchmark(const std::string& FilePath, uint32_t SyntheticMB = 1024);
+	};
+}
+
+#endif //__ParallelObjLoader_h__
@@ -0,0 +1,203 @@
+#include "PipelineCache.h"
+#include "Hash.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43505456; // "VTPC"
+		constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+		// Precedes the driver's data on disk. The driver's own header carries the device and UUID too, but not the
+		// driver version and nothing that detects a truncated or damaged file.
+		struct PipelineCacheFileHeader
+		{
+			uint32_t Magic;
+			uint32_t Version;
+			uint32_t VendorID;
+			uint32_t DeviceID;
+			uint32_t DriverVersion;
+			uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t DataSize;
+			uint64_t DataHash;
+		};
+
+		// Returns the driver data of a cache file written for this device, throws with the reason otherwise
+		std::vector<uint8_t> ReadCacheData(const std::string& FilePath, const VkPhysicalDeviceProperties& Properties)
+		{
+			std::ifstream File(FilePath, std::ios::ate | std::ios::binary);
+			if (!File.is_open())
+				throw std::runtime_error("can not be opened");
+
+			const size_t FileSize = (size_t)File.tellg();
+			if (FileSize < sizeof(PipelineCacheFileHeader))
+				throw std::runtime_error("truncated header");
+
+			PipelineCacheFileHeader Header;
+			File.seekg(0);
+			File.read((char*)&Header, sizeof(Header));
+
+			if (Header.Magic != PIPELINE_CACHE_MAGIC || Header.Version != PIPELINE_CACHE_VERSION)
+				throw std::runtime_error("unknown format version");
+
+			if (Header.VendorID != Properties.vendorID || Header.DeviceID != Properties.deviceID)
+				throw std::runtime_error("written for another device");
+
+			if (Header.DriverVersion != Properties.driverVersion || memcmp(Header.PipelineCacheUUID, Properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+				throw std::runtime_error("written by another driver");
+
+			if (Header.DataSize != FileSize - sizeof(Header))
+				throw std::runtime_error("truncated data");
+
+			std::vector<uint8_t> Data((size_t)Header.DataSize);
+			File.read((char*)Data.data(), (std::streamsize)Data.size());
+
+			if (!File.good() || HashBytes(Data.data(), Data.size()) != Header.DataHash)
+				throw std::runtime_error("checksum mismatch");
+
+			VkPipelineCacheHeaderVersionOne DriverHeader;
+			if (Data.size() < sizeof(DriverHeader))
+				throw std::runtime_error("truncated driver header");
+
+			memcpy(&DriverHeader, Data.data(), sizeof(DriverHeader));
+
+			if (DriverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || DriverHeader.headerSize < sizeof(DriverHeader) || DriverHeader.headerSize > Data.size()
+				|| DriverHeader.vendorID != Properties.vendorID || DriverHeader.deviceID != Properties.deviceID
+				|| memcmp(DriverHeader.pipelineCacheUUID, Properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+				throw std::runtime_error("driver header does not match the device");
+
+			return Data;
+		}
+	}
+
+	PipelineCache::PipelineCache(VkDevice Device, const VkPhysicalDeviceProperties& Properties, const std::string& FilePath)
+		: m_Device(Device)
+		, m_Properties(Properties)
+		, m_FilePath(FilePath)
+	{
+		std::vector<uint8_t> Data;
+
+		try
+		{
+			if (std::filesystem::exists(m_FilePath))
+				Data = ReadCacheData(m_FilePath, m_Properties);
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "Ignoring pipeline cache " << m_FilePath << " : " << e.what() << std::endl;
+			Data.clear();
+		}
+
+		// The driver may still refuse data that passed every check, it is dropped then
+		if (!Data.empty() && !Create(Data.data(), Data.size()))
+		{
+			std::cout << "Ignoring pipeline cache " << m_FilePath << " : rejected by the driver" << std::endl;
+			Data.clear();
+		}
+
+		if (Data.empty() && !Create(nullptr, 0))
+			throw std::runtime_error("Failed to create pipeline cache");
+
+		m_LoadedSize = Data.size();
+		m_SavedHash = HashBytes(Data.data(), Data.size());
+	}
+
+	PipelineCache::~PipelineCache()
+	{
+		vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
+	}
+
+	bool PipelineCache::Create(const void* InitialData, size_t InitialSize)
+	{
+		VkPipelineCacheCreateInfo CreateInfo{};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		CreateInfo.initialDataSize = InitialSize;
+		CreateInfo.pInitialData = InitialData;
+
+		return vkCreatePipelineCache(m_Device, &CreateInfo, nullptr, &m_PipelineCache) == VK_SUCCESS;
+	}
+
+	size_t PipelineCache::GetDataSize() const
+	{
+		size_t DataSize = 0;
+		vkGetPipelineCacheData(m_Device, m_PipelineCache, &DataSize, nullptr);
+		return DataSize;
+	}
+
+	bool PipelineCache::Save()
+	{
+		size_t DataSize = 0;
+		if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &DataSize, nullptr) != VK_SUCCESS)
+			return false;
+
+		// Pipelines created between the two calls make the second one incomplete, the next save catches up
+		std::vector<uint8_t> Data(DataSize);
+		if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &DataSize, Data.data()) != VK_SUCCESS)
+			return false;
+
+		const uint64_t DataHash = HashBytes(Data.data(), Data.size());
+		if (DataHash == m_SavedHash)
+			return true;
+
+		PipelineCacheFileHeader Header;
+		memset(&Header, 0, sizeof(Header));
+		Header.Magic = PIPELINE_CACHE_MAGIC;
+		Header.Version = PIPELINE_CACHE_VERSION;
+		Header.VendorID = m_Properties.vendorID;
+		Header.DeviceID = m_Properties.deviceID;
+		Header.DriverVersion = m_Properties.driverVersion;
+		memcpy(Header.PipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE);
+		Header.DataSize = Data.size();
+		Header.DataHash = DataHash;
+
+		const std::string TempPath = m_FilePath + ".tmp";
+
+		{
+			std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+			if (!File.is_open())
+				return false;
+
+			File.write((const char*)&Header, sizeof(Header));
+			File.write((const char*)Data.data(), (std::streamsize)Data.size());
+
+			if (!File.good())
+			{
+				File.close();
+
+				// Runs from the EngineDevice destructor, so it must not throw
+				std::error_code Error;
+				std::filesystem::remove(TempPath, Error);
+				return false;
+			}
+		}
+
+		// A crash while saving leaves the previous file intact
+		std::error_code Error;
+		std::filesystem::rename(TempPath, m_FilePath, Error);
+
+		if (Error)
+		{
+			std::filesystem::remove(TempPath, Error);
+			return false;
+		}
+
+		m_SavedHash = DataHash;
+		return true;
+	}
+
+	void PipelineCache::Reset()
+	{
+		vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
+		m_PipelineCache = VK_NULL_HANDLE;
+
+		if (!Create(nullptr, 0))
+			throw std::runtime_error("Failed to create pipeline cache");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef __PipelineCache_h__
+#define __PipelineCache_h__
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+namespace VulkanTutorial
+{
+	// VkPipelineCache shared by every pipeline of a device and kept on disk between runs. The file is only loaded when
+	// it was written by the same device and driver and its data is intact, drivers are not robust against foreign or
+	// corrupt cache data. vkCreate*Pipelines may use it from any thread, the cache synchronizes internally.
+	class PipelineCache
+	{
+	public:
+
+		static constexpr const char* DEFAULT_FILE_PATH = "./PipelineCache.bin";
+
+		// Loads FilePath if it is valid for the device, otherwise starts empty
+		PipelineCache(VkDevice Device, const VkPhysicalDeviceProperties& Properties, const std::string& FilePath = DEFAULT_FILE_PATH);
+		virtual ~PipelineCache();
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator = (const PipelineCache&) = delete;
+
+		PipelineCache(PipelineCache&&) = delete;
+		PipelineCache& operator = (PipelineCache&&) = delete;
+
+		VkPipelineCache GetPipelineCache() const { return m_PipelineCache; }
+
+		// Writes the cache contents to the file, replacing it atomically. Skipped when nothing was added since it
+		// was loaded or saved.
+		bool Save();
+
+		// Drops every cached pipeline, later pipelines are compiled from SPIR-V again. No pipeline may be in creation.
+		void Reset();
+
+		// Bytes of cache data accepted from the file at startup, zero on a cold start
+		size_t GetLoadedSize() const { return m_LoadedSize; }
+		size_t GetDataSize() const;
+
+	private:
+
+		bool Create(const void* InitialData, size_t InitialSize);
+
+		VkDevice m_Device;
+		VkPhysicalDeviceProperties m_Properties;
+		std::string m_FilePath;
+
+		VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+		size_t m_LoadedSize = 0;
+		// Hash of the data last read from or written to the file
+		uint64_t m_SavedHash = 0;
+	};
+}
+
+#endif //__PipelineCache_h__
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "PipelineLibrary.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		// Vulkan structs may carry uninitialized padding, so only fields are hashed
+		template <typename T>
+		void HashValue(uint64_t& Hash, const T& Value)
+		{
+			Hash = HashBytes(&Value, sizeof(Value), Hash);
+		}
+
+		template <typename T>
+		void HashArray(uint64_t& Hash, const T* Values, size_t Count)
+		{
+			HashValue(Hash, Count);
+			if (Count > 0)
+				Hash = HashBytes(Values, Count * sizeof(T), Hash);
+		}
+
+		void HashStencilOp(uint64_t& Hash, const VkStencilOpState& State)
+		{
+			HashValue(Hash, State.failOp);
+			HashValue(Hash, State.passOp);
+			HashValue(Hash, State.depthFailOp);
+			HashValue(Hash, State.compareOp);
+			HashValue(Hash, State.compareMask);
+			HashValue(Hash, State.writeMask);
+			HashValue(Hash, State.reference);
+		}
+	}
+
+	PipelineLibrary::PipelineLibrary(EngineDevice& Device, uint32_t CompileThreadCount)
+		: m_EngineDevice(Device)
+		, m_CompileThreads(std::make_unique<ThreadPool>(std::max(CompileThreadCount, 1u)))
+	{
+
+	}
+
+	PipelineLibrary::~PipelineLibrary()
+	{
+		// Compilations in progress still use the layouts
+		m_IsStopping = true;
+		m_CompileThreads.reset();
+
+		for (const auto& Layout : m_PipelineLayouts)
+			vkDestroyPipelineLayout(m_EngineDevice.Device(), Layout.second, nullptr);
+	}
+
+	std::shared_ptr<RenderPipeline> PipelineLibrary::GetPipeline(const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram)
+	{
+		std::shared_ptr<ShaderModule> VertexShader = GetShaderModule(VertProgram);
+		std::shared_ptr<ShaderModule> FragmentShader = GetShaderModule(FragProgram);
+
+		uint64_t Key = HashConfig(PipelineConfig);
+		Key = HashCombine(Key, VertexShader->GetHash());
+		Key = HashCombine(Key, FragmentShader->GetHash());
+
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_Stats.PipelineRequestCount++;
+
+			if (std::shared_ptr<RenderPipeline> Existing = m_Pipelines[Key].lock())
+			{
+				m_Stats.PipelineHitCount++;
+				m_Stats.TimeSavedMs += Existing->GetCreationTimeMs();
+				return Existing;
+			}
+		}
+
+		// vkCreateGraphicsPipelines may run on several threads at once, the pipeline cache synchronizes itself
+		auto Pipeline = std::make_shared<RenderPipeline>(m_EngineDevice, PipelineConfig, std::move(VertexShader), std::move(FragmentShader));
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Stats.CreationTimeMs += Pipeline->GetCreationTimeMs();
+
+		// Another thread compiled the same pipeline meanwhile, every user gets the same one
+		std::weak_ptr<RenderPipeline>& Entry = m_Pipelines[Key];
+		if (std::shared_ptr<RenderPipeline> Existing = Entry.lock())
+			return Existing;
+
+		Entry = Pipeline;
+		return Pipeline;
+	}
+
+	PipelineHandle PipelineLibrary::RequestPipeline(const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram)
+	{
+		auto Config = std::make_shared<PipelineConfigInfo>();
+		RenderPipeline::CopyPipelineConfigInfo(PipelineConfig, *Config);
+
+		std::future<std::shared_ptr<RenderPipeline>> Future = m_CompileThreads->Submit([this, Config, VertProgram, FragProgram]()
+		{
+			return m_IsStopping ? nullptr : GetPipeline(*Config, VertProgram, FragProgram);
+		});
+
+		return PipelineHandle(Future.share());
+	}
+
+	std::shared_ptr<ShaderModule> PipelineLibrary::GetShaderModule(const std::string& FilePath)
+	{
+		// Keyed by content rather than path, a rewritten file gets a new module
+		const std::vector<int8_t> Code = RenderPipeline::ReadRile(FilePath);
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Stats.ShaderModuleRequestCount++;
+
+		std::weak_ptr<ShaderModule>& Entry = m_ShaderModules[ShaderModule::HashCode(Code)];
+		if (std::shared_ptr<ShaderModule> Existing = Entry.lock())
+		{
+			m_Stats.ShaderModuleHitCount++;
+			return Existing;
+		}
+
+		auto Module = std::make_shared<ShaderModule>(m_EngineDevice, Code);
+		Entry = Module;
+		return Module;
+	}
+
+	VkPipelineLayout PipelineLibrary::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& SetLayouts, const std::vector<VkPushConstantRange>& PushConstantRanges)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Stats.LayoutRequestCount++;
+
+		uint64_t Key = 0;
+		HashArray(Key, SetLayouts.data(), SetLayouts.size());
+		HashArray(Key, PushConstantRanges.data(), PushConstantRanges.size());
+
+		auto Found = m_PipelineLayouts.find(Key);
+		if (Found != m_PipelineLayouts.end())
+		{
+			m_Stats.LayoutHitCount++;
+			return Found->second;
+		}
+
+		VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
+		PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		PipelineLayoutInfo.setLayoutCount = (uint32_t)SetLayouts.size();
+		PipelineLayoutInfo.pSetLayouts = SetLayouts.data();
+		PipelineLayoutInfo.pushConstantRangeCount = (uint32_t)PushConstantRanges.size();
+		PipelineLayoutInfo.pPushConstantRanges = PushConstantRanges.data();
+
+		VkPipelineLayout PipelineLayout;
+		if (vkCreatePipelineLayout(m_EngineDevice.Device(), &PipelineLayoutInfo, nullptr, &PipelineLayout) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create pipeline layout!");
+
+		m_PipelineLayouts[Key] = PipelineLayout;
+		return PipelineLayout;
+	}
+
+	PipelineLibrary::Stats PipelineLibrary::GetStats() const
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		return m_Stats;
+	}
+
+	uint64_t PipelineLibrary::HashConfig(const PipelineConfigInfo& PipelineConfig)
+	{
+		uint64_t Hash = 0;
+
+		HashValue(Hash, PipelineConfig.ViewportInfo.viewportCount);
+		HashValue(Hash, PipelineConfig.ViewportInfo.scissorCount);
+		if (PipelineConfig.ViewportInfo.pViewports)
+			HashArray(Hash, PipelineConfig.ViewportInfo.pViewports, PipelineConfig.ViewportInfo.viewportCount);
+		if (PipelineConfig.ViewportInfo.pScissors)
+			HashArray(Hash, PipelineConfig.ViewportInfo.pScissors, PipelineConfig.ViewportInfo.scissorCount);
+
+		HashValue(Hash, PipelineConfig.InputAssemblyInfo.topology);
+		HashValue(Hash, PipelineConfig.InputAssemblyInfo.primitiveRestartEnable);
+
+		const VkPipelineRasterizationStateCreateInfo& Rasterization = PipelineConfig.RasterizationInfo;
+		HashValue(Hash, Rasterization.depthClampEnable);
+		HashValue(Hash, Rasterization.rasterizerDiscardEnable);
+		HashValue(Hash, Rasterization.polygonMode);
+		HashValue(Hash, Rasterization.cullMode);
+		HashValue(Hash, Rasterization.frontFace);
+		HashValue(Hash, Rasterization.depthBiasEnable);
+		HashValue(Hash, Rasterization.depthBiasConstantFactor);
+		HashValue(Hash, Rasterization.depthBiasClamp);
+		HashValue(Hash, Rasterization.depthBiasSlopeFactor);
+		HashValue(Hash, Rasterization.lineWidth);
+
+		const VkPipelineMultisampleStateCreateInfo& Multisample = PipelineConfig.MultisampleInfo;
+		HashValue(Hash, Multisample.rasterizationSamples);
+		HashValue(Hash, Multisample.sampleShadingEnable);
+		HashValue(Hash, Multisample.minSampleShading);
+		HashValue(Hash, Multisample.alphaToCoverageEnable);
+		HashValue(Hash, Multisample.alphaToOneEnable);
+		if (Multisample.pSampleMask)
+			HashArray(Hash, Multisample.pSampleMask, (Multisample.rasterizationSamples + 31) / 32);
+
+		const VkPipelineColorBlendStateCreateInfo& ColorBlend = PipelineConfig.ColorBlendInfo;
+		HashValue(Hash, ColorBlend.logicOpEnable);
+		HashValue(Hash, ColorBlend.logicOp);
+		HashValue(Hash, ColorBlend.blendConstants);
+		HashValue(Hash, ColorBlend.attachmentCount);
+		for (uint32_t i = 0; i < ColorBlend.attachmentCount; i++)
+		{
+			const VkPipelineColorBlendAttachmentState& Attachment = ColorBlend.pAttachments[i];
+			HashValue(Hash, Attachment.blendEnable);
+			HashValue(Hash, Attachment.srcColorBlendFactor);
+			HashValue(Hash, Attachment.dstColorBlendFactor);
+			HashValue(Hash, Attachment.colorBlendOp);
+			HashValue(Hash, Attachment.srcAlphaBlendFactor);
+			HashValue(Hash, Attachment.dstAlphaBlendFactor);
+			HashValue(Hash, Attachment.alphaBlendOp);
+			HashValue(Hash, Attachment.colorWriteMask);
+		}
+
+		const VkPipelineDepthStencilStateCreateInfo& DepthStencil = PipelineConfig.DepthStencilInfo;
+		HashValue(Hash, DepthStencil.depthTestEnable);
+		HashValue(Hash, DepthStencil.depthWriteEnable);
+		HashValue(Hash, DepthStencil.depthCompareOp);
+		HashValue(Hash, DepthStencil.depthBoundsTestEnable);
+		HashValue(Hash, DepthStencil.stencilTestEnable);
+		HashStencilOp(Hash, DepthStencil.front);
+		HashStencilOp(Hash, DepthStencil.back);
+		HashValue(Hash, DepthStencil.minDepthBounds);
+		HashValue(Hash, DepthStencil.maxDepthBounds);
+
+		HashArray(Hash, PipelineConfig.DynamicStateInfo.pDynamicStates, PipelineConfig.DynamicStateInfo.dynamicStateCount);
+
+		HashValue(Hash, PipelineConfig.BindingDescriptions.size());
+		for (const VkVertexInputBindingDescription& Binding : PipelineConfig.BindingDescriptions)
+		{
+			HashValue(Hash, Binding.binding);
+			HashValue(Hash, Binding.stride);
+			HashValue(Hash, Binding.inputRate);
+		}
+
+		HashValue(Hash, PipelineConfig.AttributeDescriptions.size());
+		for (const VkVertexInputAttributeDescription& Attribute : PipelineConfig.AttributeDescriptions)
+		{
+			HashValue(Hash, Attribute.location);
+			HashValue(Hash, Attribute.binding);
+			HashValue(Hash, Attribute.format);
+			HashValue(Hash, Attribute.offset);
+		}
+
+		// Every specialization is a pipeline variant of its own
+		HashValue(Hash, PipelineConfig.SpecializationEntries.size());
+		for (const VkSpecializationMapEntry& Entry : PipelineConfig.SpecializationEntries)
+		{
+			HashValue(Hash, Entry.constantID);
+			HashValue(Hash, Entry.offset);
+			HashValue(Hash, Entry.size);
+		}
+		HashArray(Hash, PipelineConfig.SpecializationData.data(), PipelineConfig.SpecializationData.size());
+
+		HashValue(Hash, PipelineConfig.PipelineLayout);
+		HashValue(Hash, PipelineConfig.RenderPass);
+		HashValue(Hash, PipelineConfig.Subpass);
+
+		return Hash;
+	}
+}
\ No newline at end of file
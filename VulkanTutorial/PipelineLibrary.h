@@ -0,0 +1,113 @@
+#ifndef __PipelineLibrary_h__
+#define __PipelineLibrary_h__
+
+#include "EngineDevice.h"
+#include "RenderPipeline.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Pipeline compiled in the background by PipelineLibrary::RequestPipeline
+	class PipelineHandle
+	{
+	public:
+
+		PipelineHandle() = default;
+
+		bool IsValid() const { return m_Future.valid(); }
+		bool IsReady() const { return m_Future.valid() && m_Future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+		// Waits for the compilation and rethrows its error. Null when the library shut down first.
+		std::shared_ptr<RenderPipeline> Get() const { return m_Future.get(); }
+
+	private:
+
+		friend class PipelineLibrary;
+
+		explicit PipelineHandle(std::shared_future<std::shared_ptr<RenderPipeline>> Future) : m_Future(std::move(Future)) {}
+
+		std::shared_future<std::shared_ptr<RenderPipeline>> m_Future;
+	};
+
+	// Deduplicates pipeline objects of a device. Pipelines are keyed by a hash of their full PipelineConfigInfo and
+	// the hashes of their shaders' SPIR-V, shader modules by their SPIR-V hash. Both are shared while any user holds
+	// them and destroyed with the last one. Pipeline layouts are keyed by their set layouts and push constant ranges
+	// and live as long as the library, so render systems built on the same set layouts share them and with them
+	// their pipelines. Every method may be called from any thread.
+	class PipelineLibrary
+	{
+	public:
+
+		struct Stats
+		{
+			uint32_t PipelineRequestCount = 0;
+			uint32_t PipelineHitCount = 0;
+			uint32_t ShaderModuleRequestCount = 0;
+			uint32_t ShaderModuleHitCount = 0;
+			uint32_t LayoutRequestCount = 0;
+			uint32_t LayoutHitCount = 0;
+
+			// vkCreateGraphicsPipelines time of created pipelines, and of the pipelines hits returned instead
+			float CreationTimeMs = 0.0f;
+			float TimeSavedMs = 0.0f;
+		};
+
+		static constexpr uint32_t DEFAULT_COMPILE_THREAD_COUNT = 2;
+
+		PipelineLibrary(EngineDevice& Device, uint32_t CompileThreadCount = DEFAULT_COMPILE_THREAD_COUNT);
+		virtual ~PipelineLibrary();
+
+		PipelineLibrary(const PipelineLibrary&) = delete;
+		PipelineLibrary& operator = (const PipelineLibrary&) = delete;
+
+		PipelineLibrary(PipelineLibrary&&) = delete;
+		PipelineLibrary& operator = (PipelineLibrary&&) = delete;
+
+		// The pipeline of that configuration and those shader files, created if no user holds one
+		std::shared_ptr<RenderPipeline> GetPipeline(const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram);
+
+		// GetPipeline on a compile thread, the config is copied. The pipeline layout and render pass must stay alive
+		// until the handle is ready.
+		PipelineHandle RequestPipeline(const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram);
+
+		// Reads the SPIR-V file, returns the module of identical code if one is alive
+		std::shared_ptr<ShaderModule> GetShaderModule(const std::string& FilePath);
+
+		// Owned by the library, do not destroy. Set layouts are identified by handle, a set layout created in place of
+		// a destroyed one with the same handle must have the same bindings.
+		VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& SetLayouts, const std::vector<VkPushConstantRange>& PushConstantRanges);
+
+		// Every field the pipeline is created from, pointers are followed
+		static uint64_t HashConfig(const PipelineConfigInfo& PipelineConfig);
+
+		Stats GetStats() const;
+
+	private:
+
+		EngineDevice& m_EngineDevice;
+
+		// Guards the maps and the stats, never held while compiling
+		mutable std::mutex m_Mutex;
+		std::unordered_map<uint64_t, std::weak_ptr<RenderPipeline>> m_Pipelines;
+		std::unordered_map<uint64_t, std::weak_ptr<ShaderModule>> m_ShaderModules;
+		std::unordered_map<uint64_t, VkPipelineLayout> m_PipelineLayouts;
+
+		Stats m_Stats;
+
+		// Requests still queued at destruction are skipped
+		std::atomic<bool> m_IsStopping{ false };
+		std::unique_ptr<ThreadPool> m_CompileThreads;
+	};
+}
+
+#endif //__PipelineLibrary_h__
\ No newline at end of file
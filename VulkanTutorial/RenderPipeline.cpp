@@ -2,20 +2,60 @@
 #include <fstream>
 #include <iostream>
 #include <cassert>
+#include <chrono>
+#include "Hash.h"
 #include "Mesh.h"
 
 namespace VulkanTutorial
 {
+	ShaderModule::ShaderModule(EngineDevice& Device, const std::vector<int8_t>& Code)
+		: m_EngineDevice(Device)
+		, m_Hash(HashCode(Code))
+	{
+		VkShaderModuleCreateInfo CreateInfo{};
+		CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		CreateInfo.codeSize = Code.size();
+		CreateInfo.pCode = (const uint32_t*)Code.data();
+
+		if (vkCreateShaderModule(m_EngineDevice.Device(), &CreateInfo, nullptr, &m_ShaderModule) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create shader module");
+	}
+
+	ShaderModule::~ShaderModule()
+	{
+		vkDestroyShaderModule(m_EngineDevice.Device(), m_ShaderModule, nullptr);
+	}
+
+	uint64_t ShaderModule::HashCode(const std::vector<int8_t>& Code)
+	{
+		return HashBytes(Code.data(), Code.size());
+	}
+
 	RenderPipeline::RenderPipeline(EngineDevice& Device, const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram)
 		: m_EngineDevice(Device)
 	{
-		CreateGraphicsPipeline(PipelineConfig, VertProgram, FragProgram);
+		std::vector<int8_t> VertexCode = ReadRile(VertProgram);
+		std::vector<int8_t> FragmentCode = ReadRile(FragProgram);
+
+		std::cout << "Vertex shader code size: " << VertexCode.size() << std::endl;
+		std::cout << "Fragment shader code size: " << FragmentCode.size() << std::endl;
+
+		m_VertexShader = std::make_shared<ShaderModule>(m_EngineDevice, VertexCode);
+		m_FragmentShader = std::make_shared<ShaderModule>(m_EngineDevice, FragmentCode);
+
+		CreateGraphicsPipeline(PipelineConfig);
+	}
+
+	RenderPipeline::RenderPipeline(EngineDevice& Device, const PipelineConfigInfo& PipelineConfig, std::shared_ptr<ShaderModule> VertexShader, std::shared_ptr<ShaderModule> FragmentShader)
+		: m_EngineDevice(Device)
+		, m_VertexShader(std::move(VertexShader))
+		, m_FragmentShader(std::move(FragmentShader))
+	{
+		CreateGraphicsPipeline(PipelineConfig);
 	}
 
 	RenderPipeline::~RenderPipeline()
 	{
-		vkDestroyShaderModule(m_EngineDevice.Device(), m_VertexShaderModule, nullptr);
-		vkDestroyShaderModule(m_EngineDevice.Device(), m_FragmentShaderModule, nullptr);
 		vkDestroyPipeline(m_EngineDevice.Device(), m_VkGraphicsPipeline, nullptr);
 	}
 
@@ -24,39 +64,38 @@ namespace VulkanTutorial
 		vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkGraphicsPipeline);
 	}
 
-	void RenderPipeline::CreateGraphicsPipeline(const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram)
+	void RenderPipeline::CreateGraphicsPipeline(const PipelineConfigInfo& PipelineConfig)
 	{
 		assert(PipelineConfig.PipelineLayout != VK_NULL_HANDLE && "Graphics pipeline can not be created:: no pipeline layout provided");
 		assert(PipelineConfig.RenderPass != VK_NULL_HANDLE && "Graphics pipeline can not be created:: no render pass provided");
 
-		std::vector<int8_t> VertexCode = ReadRile(VertProgram);
-		std::vector<int8_t> FragmentCode = ReadRile(FragProgram);
-
-		std::cout << "Vertex shader code size: " << VertexCode.size() << std::endl;
-		std::cout << "Fragment shader code size: " << FragmentCode.size() << std::endl;
+		VkSpecializationInfo SpecializationInfo;
+		SpecializationInfo.mapEntryCount = (uint32_t)PipelineConfig.SpecializationEntries.size();
+		SpecializationInfo.pMapEntries = PipelineConfig.SpecializationEntries.data();
+		SpecializationInfo.dataSize = PipelineConfig.SpecializationData.size();
+		SpecializationInfo.pData = PipelineConfig.SpecializationData.data();
 
-		CreateShaderModule(VertexCode, &m_VertexShaderModule);
-		CreateShaderModule(FragmentCode, &m_FragmentShaderModule);
+		const VkSpecializationInfo* Specialization = PipelineConfig.SpecializationEntries.empty() ? nullptr : &SpecializationInfo;
 
 		VkPipelineShaderStageCreateInfo ShaderStates[2];
 		ShaderStates[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		ShaderStates[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		ShaderStates[0].module = m_VertexShaderModule;
+		ShaderStates[0].module = m_VertexShader->GetShaderModule();
 		ShaderStates[0].pName = "main";
 		ShaderStates[0].flags = 0;
 		ShaderStates[0].pNext = nullptr;
-		ShaderStates[0].pSpecializationInfo = nullptr;
+		ShaderStates[0].pSpecializationInfo = Specialization;
 
 		ShaderStates[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		ShaderStates[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		ShaderStates[1].module = m_FragmentShaderModule;
+		ShaderStates[1].module = m_FragmentShader->GetShaderModule();
 		ShaderStates[1].pName = "main";
 		ShaderStates[1].flags = 0;
 		ShaderStates[1].pNext = nullptr;
-		ShaderStates[1].pSpecializationInfo = nullptr;
+		ShaderStates[1].pSpecializationInfo = Specialization;
 
-		std::vector<VkVertexInputBindingDescription> BindingDescriptions = Mesh::Vertex::GetBindingDescriptions();
-		std::vector<VkVertexInputAttributeDescription> AttributeDescriptions = Mesh::Vertex::GetAttributeDescriptions();
+		const std::vector<VkVertexInputBindingDescription>& BindingDescriptions = PipelineConfig.BindingDescriptions;
+		const std::vector<VkVertexInputAttributeDescription>& AttributeDescriptions = PipelineConfig.AttributeDescriptions;
 
 		VkPipelineVertexInputStateCreateInfo VertexInputInfo;
 		VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -92,19 +131,12 @@ namespace VulkanTutorial
 
 		PipelineInfo.pTessellationState = nullptr;
 
-		if (vkCreateGraphicsPipelines(m_EngineDevice.Device(), VK_NULL_HANDLE, 1, &PipelineInfo, nullptr, &m_VkGraphicsPipeline) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create graphics pipeline");
-	}
+		const auto Start = std::chrono::high_resolution_clock::now();
 
-	void RenderPipeline::CreateShaderModule(const std::vector<int8_t>& Code, VkShaderModule* ShaderModule)
-	{
-		VkShaderModuleCreateInfo CreateInfo{};
-		CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		CreateInfo.codeSize = Code.size();
-		CreateInfo.pCode = (const uint32_t*)Code.data();
+		if (vkCreateGraphicsPipelines(m_EngineDevice.Device(), m_EngineDevice.GetPipelineCache().GetPipelineCache(), 1, &PipelineInfo, nullptr, &m_VkGraphicsPipeline) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create graphics pipeline");
 
-		if (vkCreateShaderModule(m_EngineDevice.Device(), &CreateInfo, nullptr, ShaderModule) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create shader module");
+		m_CreationTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - Start).count();
 	}
 
 	std::vector<int8_t> RenderPipeline::ReadRile(const std::string& FilePath)
@@ -125,8 +157,37 @@ namespace VulkanTutorial
 		return Buffer;
 	}
 
+	void RenderPipeline::CopyPipelineConfigInfo(const PipelineConfigInfo& Source, PipelineConfigInfo& Destination)
+	{
+		Destination.ViewportInfo = Source.ViewportInfo;
+		Destination.InputAssemblyInfo = Source.InputAssemblyInfo;
+		Destination.RasterizationInfo = Source.RasterizationInfo;
+		Destination.MultisampleInfo = Source.MultisampleInfo;
+		Destination.ColorBlendAttachment = Source.ColorBlendAttachment;
+		Destination.ColorBlendInfo = Source.ColorBlendInfo;
+		Destination.DepthStencilInfo = Source.DepthStencilInfo;
+		Destination.DynamicStateEnables = Source.DynamicStateEnables;
+		Destination.DynamicStateInfo = Source.DynamicStateInfo;
+		Destination.BindingDescriptions = Source.BindingDescriptions;
+		Destination.AttributeDescriptions = Source.AttributeDescriptions;
+		Destination.PipelineLayout = Source.PipelineLayout;
+		Destination.RenderPass = Source.RenderPass;
+		Destination.Subpass = Source.Subpass;
+		Destination.SpecializationEntries = Source.SpecializationEntries;
+		Destination.SpecializationData = Source.SpecializationData;
+
+		if (Source.ColorBlendInfo.pAttachments == &Source.ColorBlendAttachment)
+			Destination.ColorBlendInfo.pAttachments = &Destination.ColorBlendAttachment;
+
+		if (Source.DynamicStateInfo.pDynamicStates == Source.DynamicStateEnables.data())
+			Destination.DynamicStateInfo.pDynamicStates = Destination.DynamicStateEnables.data();
+	}
+
 	void RenderPipeline::DefaultPipelineConfigInfo(PipelineConfigInfo& ConfigInfo)
 	{
+		ConfigInfo.SpecializationEntries.clear();
+		ConfigInfo.SpecializationData.clear();
+
 		ConfigInfo.InputAssemblyInfo.flags = 0;
 		ConfigInfo.InputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 		ConfigInfo.InputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -205,5 +266,8 @@ namespace VulkanTutorial
 		ConfigInfo.DynamicStateInfo.dynamicStateCount = (uint32_t)ConfigInfo.DynamicStateEnables.size();
 		ConfigInfo.DynamicStateInfo.flags = 0;
 		ConfigInfo.DynamicStateInfo.pNext = nullptr;
+
+		ConfigInfo.BindingDescriptions = Mesh::Vertex::GetBindingDescriptions();
+		ConfigInfo.AttributeDescriptions = Mesh::Vertex::GetAttributeDescriptions();
 	}
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #ifndef __RenderPipeline_h__
 #define __RenderPipeline_h__
 
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include "EngineDevice.h"
 
@@ -22,9 +25,68 @@ namespace  VulkanTutorial
 		VkPipelineDepthStencilStateCreateInfo DepthStencilInfo;
 		std::vector<VkDynamicState> DynamicStateEnables;
 		VkPipelineDynamicStateCreateInfo DynamicStateInfo;
+		std::vector<VkVertexInputBindingDescription> BindingDescriptions;
+		std::vector<VkVertexInputAttributeDescription> AttributeDescriptions;
 		VkPipelineLayout PipelineLayout = nullptr;
 		VkRenderPass RenderPass = nullptr;
 		uint32_t Subpass = 0;
+
+		// Specialization constants of both shader stages, a stage ignores the ids it does not declare
+		std::vector<VkSpecializationMapEntry> SpecializationEntries;
+		std::vector<uint8_t> SpecializationData;
+
+		// Use the 32 bit type of the GLSL constant, VkBool32 for bool. Setting an id again replaces its value.
+		template <typename T>
+		void SetSpecializationConstant(uint32_t ConstantId, const T& Value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value && sizeof(T) == 4, "Specialization constants are 32 bit scalars");
+
+			for (const VkSpecializationMapEntry& Entry : SpecializationEntries)
+			{
+				if (Entry.constantID == ConstantId)
+				{
+					std::memcpy(SpecializationData.data() + Entry.offset, &Value, sizeof(T));
+					return;
+				}
+			}
+
+			VkSpecializationMapEntry Entry;
+			Entry.constantID = ConstantId;
+			Entry.offset = (uint32_t)SpecializationData.size();
+			Entry.size = sizeof(T);
+			SpecializationEntries.push_back(Entry);
+
+			SpecializationData.resize(Entry.offset + sizeof(T));
+			std::memcpy(SpecializationData.data() + Entry.offset, &Value, sizeof(T));
+		}
+	};
+
+	// SPIR-V module, shared by every pipeline created from the same code
+	class ShaderModule
+	{
+	public:
+
+		ShaderModule(EngineDevice& Device, const std::vector<int8_t>& Code);
+		virtual ~ShaderModule();
+
+		ShaderModule(const ShaderModule&) = delete;
+		ShaderModule& operator = (const ShaderModule&) = delete;
+
+		ShaderModule(ShaderModule&&) = delete;
+		ShaderModule& operator = (ShaderModule&&) = delete;
+
+		VkShaderModule GetShaderModule() const { return m_ShaderModule; }
+
+		// Hash of the SPIR-V code
+		uint64_t GetHash() const { return m_Hash; }
+
+		static uint64_t HashCode(const std::vector<int8_t>& Code);
+
+	private:
+
+		EngineDevice& m_EngineDevice;
+		VkShaderModule m_ShaderModule = VK_NULL_HANDLE;
+		uint64_t m_Hash = 0;
 	};
 
 	class RenderPipeline
@@ -32,6 +94,7 @@ namespace  VulkanTutorial
 	public:
 
 		RenderPipeline(EngineDevice& Device, const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram);
+		RenderPipeline(EngineDevice& Device, const PipelineConfigInfo& PipelineConfig, std::shared_ptr<ShaderModule> VertexShader, std::shared_ptr<ShaderModule> FragmentShader);
 		virtual ~RenderPipeline();
 
 		RenderPipeline(const RenderPipeline&) = delete;
@@ -44,18 +107,23 @@ namespace  VulkanTutorial
 
 		static void DefaultPipelineConfigInfo(PipelineConfigInfo& ConfigInfo);
 
-	private:
+		// PipelineConfigInfo points into itself, the copy points into Destination
+		static void CopyPipelineConfigInfo(const PipelineConfigInfo& Source, PipelineConfigInfo& Destination);
 
 		static std::vector<int8_t> ReadRile(const std::string& FilePath);
 
-		void CreateGraphicsPipeline(const PipelineConfigInfo& PipelineConfig, const std::string& VertProgram, const std::string& FragProgram);
+		// Time vkCreateGraphicsPipelines took for this pipeline
+		float GetCreationTimeMs() const { return m_CreationTimeMs; }
+
+	private:
 
-		void CreateShaderModule(const std::vector<int8_t>& Code, VkShaderModule* ShaderModule);
+		void CreateGraphicsPipeline(const PipelineConfigInfo& PipelineConfig);
 
 		EngineDevice& m_EngineDevice;
 		VkPipeline m_VkGraphicsPipeline;
-		VkShaderModule m_VertexShaderModule;
-		VkShaderModule m_FragmentShaderModule;
+		std::shared_ptr<ShaderModule> m_VertexShader;
+		std::shared_ptr<ShaderModule> m_FragmentShader;
+		float m_CreationTimeMs = 0.0f;
 	};
 }
 
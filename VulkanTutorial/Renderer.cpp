@@ -4,17 +4,24 @@
 
 namespace VulkanTutorial
 {
-	Renderer::Renderer(MyWindow& MyWindow, EngineDevice& EngineDevice)
+	Renderer::Renderer(MyWindow& MyWindow, EngineDevice& EngineDevice, uint32_t FramesInFlight)
 		: m_MyWindow(MyWindow)
 		, m_EngineDevice(EngineDevice)
+		, m_FramesInFlight(FramesInFlight)
+		, m_FrameInputTimes()
 	{
 		ReCreateSwapChain();
 		CreateCommandBuffers();
+		CreateTimestampQueries();
+		CalibrateTimestamps();
 	}
 
 	Renderer::~Renderer()
 	{
 		FreeCommandBuffers();
+
+		if (m_TimestampQueryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(m_EngineDevice.Device(), m_TimestampQueryPool, nullptr);
 	}
 
 	void Renderer::ReCreateSwapChain()
@@ -30,44 +37,126 @@ namespace VulkanTutorial
 
 		if (m_SwapChain == nullptr)
 		{
-			m_SwapChain = std::make_unique<EngineSwapChain>(m_EngineDevice, Extent);
+			m_SwapChain = std::make_unique<EngineSwapChain>(m_EngineDevice, Extent, m_FramesInFlight);
 		}
 		else
 		{
 			std::shared_ptr<EngineSwapChain> OldSwapChain = std::move(m_SwapChain);
-			m_SwapChain = std::make_unique<EngineSwapChain>(m_EngineDevice, Extent, OldSwapChain);
+			m_SwapChain = std::make_unique<EngineSwapChain>(m_EngineDevice, Extent, OldSwapChain, m_FramesInFlight);
 
 			if (!OldSwapChain->CompareSwapFormats(*m_SwapChain.get()))
 			{
 				throw std::runtime_error("Swap chains are not compatible");
 			}
-
-			if (m_SwapChain->ImageCount() != m_CommandBuffers.size())
-			{
-				FreeCommandBuffers();
-				CreateCommandBuffers();
-			}
 		}
+
+		// The new swap chain starts again at slot zero with fresh fences
+		for (auto& InputTime : m_FrameInputTimes)
+			InputTime = {};
+
+		CalibrateTimestamps();
 	}
 
-	void Renderer::CreateCommandBuffers()
+	void Renderer::SetFramesInFlight(uint32_t FramesInFlight)
+	{
+		assert(!m_IsFrameStarted && "Can not change frames in flight while frame is in progress");
+
+		if (FramesInFlight == m_FramesInFlight)
+			return;
+
+		vkDeviceWaitIdle(m_EngineDevice.Device());
+
+		m_SwapChain->SetFramesInFlight(FramesInFlight);
+		m_FramesInFlight = FramesInFlight;
+
+		FreeCommandBuffers();
+		CreateCommandBuffers();
+
+		for (auto& InputTime : m_FrameInputTimes)
+			InputTime = {};
+
+		CalibrateTimestamps();
+	}
+
+	void Renderer::CreateTimestampQueries()
 	{
-		m_CommandBuffers.resize(m_SwapChain->ImageCount());
+		const uint32_t ValidBits = m_EngineDevice.FindPhysicalQueueFamilies().GraphicsTimestampValidBits;
+		if (ValidBits == 0)
+			return;
+
+		m_TimestampMask = ValidBits >= 64 ? ~0ull : (1ull << ValidBits) - 1;
+		m_TimestampPeriodNs = m_EngineDevice.PhysicalDeviceProperties().limits.timestampPeriod;
 
-		VkCommandBufferAllocateInfo AllocInfo;
-		AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		AllocInfo.commandPool = m_EngineDevice.GetCommandPool();
-		AllocInfo.commandBufferCount = (uint32_t)m_CommandBuffers.size();
-		AllocInfo.pNext = nullptr;
+		VkQueryPoolCreateInfo PoolInfo{};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		PoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		PoolInfo.queryCount = EngineSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
 
-		if (vkAllocateCommandBuffers(m_EngineDevice.Device(), &AllocInfo, m_CommandBuffers.data()) != VK_SUCCESS)
-			throw std::runtime_error("Failed to allocate command buffers");
+		if (vkCreateQueryPool(m_EngineDevice.Device(), &PoolInfo, nullptr, &m_TimestampQueryPool) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create timestamp query pool");
+	}
+
+	void Renderer::CalibrateTimestamps()
+	{
+		if (m_TimestampQueryPool == VK_NULL_HANDLE)
+			return;
+
+		const uint32_t Query = EngineSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+		VkCommandBuffer CommandBuffer = m_EngineDevice.BeginSingleTimeCommands();
+		vkCmdResetQueryPool(CommandBuffer, m_TimestampQueryPool, Query, 1);
+		vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_TimestampQueryPool, Query);
+
+		// The timestamp is written between the submit and the queue going idle, taking the midpoint bounds the error by
+		// half of that round trip
+		const auto SubmitTime = std::chrono::high_resolution_clock::now();
+		m_EngineDevice.EndSingleTimeCommands(CommandBuffer);
+		const auto IdleTime = std::chrono::high_resolution_clock::now();
+
+		if (vkGetQueryPoolResults(m_EngineDevice.Device(), m_TimestampQueryPool, Query, 1, sizeof(m_CalibrationTicks), &m_CalibrationTicks, sizeof(m_CalibrationTicks)
+			, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+			throw std::runtime_error("Failed to read calibration timestamp");
+
+		m_CalibrationTime = SubmitTime + (IdleTime - SubmitTime) / 2;
+	}
+
+	std::chrono::high_resolution_clock::time_point Renderer::TimestampToCpuTime(uint64_t Ticks) const
+	{
+		// Every frame timestamp is written after the calibration, the mask handles counters that wrap
+		const uint64_t ElapsedTicks = (Ticks - m_CalibrationTicks) & m_TimestampMask;
+		const std::chrono::duration<double, std::nano> Elapsed(ElapsedTicks * m_TimestampPeriodNs);
+		return m_CalibrationTime + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(Elapsed);
+	}
+
+	void Renderer::CreateCommandBuffers()
+	{
+		m_CommandPools.resize(m_FramesInFlight);
+		m_CommandBuffers.resize(m_FramesInFlight);
+
+		for (uint32_t i = 0; i < m_FramesInFlight; i++)
+		{
+			// No VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, buffers are only ever reset with their pool
+			m_CommandPools[i] = m_EngineDevice.CreateGraphicsCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+			VkCommandBufferAllocateInfo AllocInfo;
+			AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			AllocInfo.commandPool = m_CommandPools[i];
+			AllocInfo.commandBufferCount = 1;
+			AllocInfo.pNext = nullptr;
+
+			if (vkAllocateCommandBuffers(m_EngineDevice.Device(), &AllocInfo, &m_CommandBuffers[i]) != VK_SUCCESS)
+				throw std::runtime_error("Failed to allocate command buffers");
+		}
 	}
 
 	void Renderer::FreeCommandBuffers()
 	{
-		vkFreeCommandBuffers(m_EngineDevice.Device(), m_EngineDevice.GetCommandPool(), (uint32_t)m_CommandBuffers.size(), m_CommandBuffers.data());
+		// Destroying a pool frees its command buffers
+		for (VkCommandPool CommandPool : m_CommandPools)
+			vkDestroyCommandPool(m_EngineDevice.Device(), CommandPool, nullptr);
+
+		m_CommandPools.clear();
 		m_CommandBuffers.clear();
 	}
 
@@ -75,6 +164,22 @@ namespace VulkanTutorial
 	{
 		assert(!m_IsFrameStarted && "Can not call begin frame while already in progress");
 
+		m_CurrentFrameIndex = (uint32_t)m_SwapChain->GetCurrentFrame();
+
+		// Once the slot's fence is signaled the frame previously recorded into it is complete
+		m_SwapChain->WaitForCurrentFrame();
+
+		if (m_TimestampQueryPool != VK_NULL_HANDLE && m_FrameInputTimes[m_CurrentFrameIndex] != std::chrono::high_resolution_clock::time_point{})
+		{
+			uint64_t FrameEndTicks = 0;
+			if (vkGetQueryPoolResults(m_EngineDevice.Device(), m_TimestampQueryPool, m_CurrentFrameIndex, 1, sizeof(FrameEndTicks), &FrameEndTicks, sizeof(FrameEndTicks)
+				, VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+				m_LatencyMs = std::chrono::duration<float, std::chrono::milliseconds::period>(TimestampToCpuTime(FrameEndTicks) - m_FrameInputTimes[m_CurrentFrameIndex]).count();
+		}
+
+		// Without MarkInputSampled the frame counts from here
+		const auto InputTime = m_InputTime != std::chrono::high_resolution_clock::time_point{} ? m_InputTime : std::chrono::high_resolution_clock::now();
+
 		auto result = m_SwapChain->AcquireNextImage(&m_CurrentImageIndex);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -87,16 +192,26 @@ namespace VulkanTutorial
 			throw std::runtime_error("Failed to acquire swap chain image!");
 
 		m_IsFrameStarted = true;
+		m_FrameInputTimes[m_CurrentFrameIndex] = InputTime;
 		auto CommandBuffer = GetCommandBuffer();
 
+		// The slot's fence was waited on above, so everything allocated from its pool is free to recycle
+		const auto ResetStart = std::chrono::high_resolution_clock::now();
+		vkResetCommandPool(m_EngineDevice.Device(), m_CommandPools[m_CurrentFrameIndex], 0);
+
 		VkCommandBufferBeginInfo BeginInfo;
 		BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;;
 		BeginInfo.pNext = nullptr;
-		BeginInfo.flags = 0;
+		BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		if (vkBeginCommandBuffer(CommandBuffer, &BeginInfo) != VK_SUCCESS)
 			throw std::runtime_error("Failed to allocate command buffer begin info");
 
+		if (m_TimestampQueryPool != VK_NULL_HANDLE)
+			vkCmdResetQueryPool(CommandBuffer, m_TimestampQueryPool, m_CurrentFrameIndex, 1);
+
+		m_CommandOverheadMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - ResetStart).count();
+
 		return CommandBuffer;
 	}
 
@@ -106,9 +221,16 @@ namespace VulkanTutorial
 		
 		auto CommandBuffer = GetCommandBuffer();
 
+		// Written once all of the frame's work is done, presentation waits for the same point
+		if (m_TimestampQueryPool != VK_NULL_HANDLE)
+			vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_TimestampQueryPool, m_CurrentFrameIndex);
+
+		const auto EndStart = std::chrono::high_resolution_clock::now();
 		if (vkEndCommandBuffer(CommandBuffer) != VK_SUCCESS)
 			throw std::runtime_error("Failed to record command");
 
+		m_CommandOverheadMs += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - EndStart).count();
+
 		auto result = m_SwapChain->SubmitCommandBuffers(&CommandBuffer, &m_CurrentImageIndex);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_MyWindow.WasWindowResized())
@@ -124,7 +246,7 @@ namespace VulkanTutorial
 		m_IsFrameStarted = false;
 	}
 
-	void Renderer::BeginSwapChainRenderPass(VkCommandBuffer CommandBuffer)
+	void Renderer::BeginSwapChainRenderPass(VkCommandBuffer CommandBuffer, VkSubpassContents Contents)
 	{
 		assert(m_IsFrameStarted && "Can not call BeginSwapChainRenderPass if frame is not in progress");
 		assert(CommandBuffer == GetCommandBuffer() && "Can not begin render pass on command buffer from a different frame");
@@ -146,7 +268,10 @@ namespace VulkanTutorial
 		RenderPassInfo.pClearValues = ClearValues.data();
 		RenderPassInfo.pNext = nullptr;
 
-		vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, Contents);
+
+		if (Contents != VK_SUBPASS_CONTENTS_INLINE)
+			return;
 
 		VkViewport Viewport;
 		Viewport.x = 0.0f;
@@ -176,6 +301,6 @@ namespace VulkanTutorial
 
 	uint32_t Renderer::GetCurrentFrame() const
 	{
-		return m_SwapChain->GetCurrentFrame();
+		return m_CurrentFrameIndex;
 	}
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <memory>
 #include <vector>
 #include <cassert>
+#include <chrono>
 
 namespace VulkanTutorial
 {
@@ -15,7 +16,7 @@ namespace VulkanTutorial
 	{
 	public:
 
-		Renderer(MyWindow& MyWindow, EngineDevice& EngineDevice);
+		Renderer(MyWindow& MyWindow, EngineDevice& EngineDevice, uint32_t FramesInFlight = EngineSwapChain::DEFAULT_FRAMES_IN_FLIGHT);
 		virtual ~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -25,36 +26,86 @@ namespace VulkanTutorial
 		Renderer& operator = (Renderer&&) = delete;
 
 		VkRenderPass GetSwapChainRenderPass() const { return m_SwapChain->GetRenderPass(); }
+		VkExtent2D GetSwapChainExtent() const { return m_SwapChain->GetSwapChainExtent(); }
 		float GetAspectRatio() const { return m_SwapChain->ExtentAspectRatio(); }
 		bool IsFrameInProgress() const { return m_IsFrameStarted; }
 
 		VkCommandBuffer GetCommandBuffer() const 
 		{
 			assert(m_IsFrameStarted && "Can not get command buffer when frame is not in progress");
-			return m_CommandBuffers[m_CurrentImageIndex]; 
+			return m_CommandBuffers[m_CurrentFrameIndex]; 
 		}
 
 		VkCommandBuffer BeginFrame();
 		void EndFrame();
 
-		void BeginSwapChainRenderPass(VkCommandBuffer CommandBuffer);
+		VkFramebuffer GetCurrentFramebuffer() const
+		{
+			assert(m_IsFrameStarted && "Can not get framebuffer when frame is not in progress");
+			return m_SwapChain->GetFrameBuffer(m_CurrentImageIndex);
+		}
+
+		// With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS only vkCmdExecuteCommands may follow, the secondary
+		// command buffers set their own viewport and scissor
+		void BeginSwapChainRenderPass(VkCommandBuffer CommandBuffer, VkSubpassContents Contents = VK_SUBPASS_CONTENTS_INLINE);
 		void EndSwapChainRenderPass(VkCommandBuffer CommandBuffer);
 
 		uint32_t GetSwapChainImageCount() const;
+
+		// Frame slot of the frame being recorded, per frame resources are indexed by it and sized by
+		// EngineSwapChain::MAX_FRAMES_IN_FLIGHT so the count can change at runtime
 		uint32_t GetCurrentFrame() const;
+		uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+
+		// Waits for the device to go idle, must be called outside of a frame
+		void SetFramesInFlight(uint32_t FramesInFlight);
+
+		// Call right after polling input, the next BeginFrame attributes the sample to its frame
+		void MarkInputSampled() { m_InputTime = std::chrono::high_resolution_clock::now(); }
+
+		// Time from the input sample of the last completed frame until the GPU finished it and it could be presented.
+		// Read back from an end of frame timestamp when the frame's slot comes around again, zero until then or when
+		// the graphics queue has no timestamps.
+		float GetLatencyMs() const { return m_LatencyMs; }
+
+		// CPU time of the last frame spent resetting its pool and beginning and ending its command buffer
+		float GetCommandOverheadMs() const { return m_CommandOverheadMs; }
 
 	private:
 		void CreateCommandBuffers();
 		void FreeCommandBuffers();
 		void ReCreateSwapChain();
+		void CreateTimestampQueries();
+
+		// Pairs a GPU timestamp with the CPU clock, the device has to be idle
+		void CalibrateTimestamps();
+		std::chrono::high_resolution_clock::time_point TimestampToCpuTime(uint64_t Ticks) const;
 
 		MyWindow& m_MyWindow;
 		EngineDevice& m_EngineDevice;
 		std::unique_ptr<EngineSwapChain> m_SwapChain;
+
+		// One transient pool per frame slot, reset as a whole when the slot is reused
+		std::vector<VkCommandPool> m_CommandPools;
 		std::vector<VkCommandBuffer> m_CommandBuffers;
 
-		uint32_t m_CurrentImageIndex;
-		bool m_IsFrameStarted;
+		uint32_t m_FramesInFlight;
+		uint32_t m_CurrentImageIndex = 0;
+		uint32_t m_CurrentFrameIndex = 0;
+		bool m_IsFrameStarted = false;
+
+		// One end of frame timestamp per frame slot plus one for calibration, null without timestamp support
+		VkQueryPool m_TimestampQueryPool = VK_NULL_HANDLE;
+		uint64_t m_TimestampMask = 0;
+		double m_TimestampPeriodNs = 0.0;
+		uint64_t m_CalibrationTicks = 0;
+		std::chrono::high_resolution_clock::time_point m_CalibrationTime;
+
+		std::chrono::high_resolution_clock::time_point m_InputTime;
+		// Input time of the last frame submitted in each slot, zero when the slot holds no frame
+		std::chrono::high_resolution_clock::time_point m_FrameInputTimes[EngineSwapChain::MAX_FRAMES_IN_FLIGHT];
+		float m_LatencyMs = 0.0f;
+		float m_CommandOverheadMs = 0.0f;
 	};
 }
 
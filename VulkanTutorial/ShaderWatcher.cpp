@@ -0,0 +1,353 @@
+#include "ShaderWatcher.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanTutorial
+{
+	namespace
+	{
+		// How often the watcher thread checks for shutdown and settled sources
+		constexpr int POLL_INTERVAL_MS = 20;
+
+		std::string GetFileName(const std::string& Path)
+		{
+			const size_t Separator = Path.find_last_of("/\\");
+			return Separator == std::string::npos ? Path : Path.substr(Separator + 1);
+		}
+
+		// Splits a command line at white space, quoted tokens keep theirs
+		std::vector<std::string> Tokenize(const std::string& Line)
+		{
+			std::vector<std::string> Tokens;
+
+			size_t i = 0;
+			while (i < Line.size())
+			{
+				if (std::isspace((unsigned char)Line[i]))
+				{
+					i++;
+				}
+				else if (Line[i] == '"')
+				{
+					size_t End = Line.find('"', i + 1);
+					if (End == std::string::npos)
+						End = Line.size();
+
+					Tokens.push_back(Line.substr(i + 1, End - i - 1));
+					i = End + 1;
+				}
+				else
+				{
+					size_t End = Line.find_first_of(" \t\r\n", i);
+					if (End == std::string::npos)
+						End = Line.size();
+
+					Tokens.push_back(Line.substr(i, End - i));
+					i = End;
+				}
+			}
+
+			return Tokens;
+		}
+	}
+
+	ShaderWatcher::ShaderWatcher(const std::string& SourceDirectory, const std::string& BuildScript)
+		: m_SourceDirectory(SourceDirectory)
+	{
+		LoadBuildScript(BuildScript);
+
+		if (m_Commands.empty())
+		{
+			std::cout << "Shader watcher : no glslc commands in " << BuildScript << ", shaders are not reloaded" << std::endl;
+			return;
+		}
+
+		m_Thread = std::thread(&ShaderWatcher::Watch, this);
+	}
+
+	ShaderWatcher::~ShaderWatcher()
+	{
+		m_IsStopping = true;
+
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+	std::vector<std::string> ShaderWatcher::TakeChangedFiles()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		std::vector<std::string> ChangedFiles;
+		ChangedFiles.swap(m_ChangedFiles);
+		return ChangedFiles;
+	}
+
+	ShaderWatcher::Stats ShaderWatcher::GetStats() const
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		return m_Stats;
+	}
+
+	void ShaderWatcher::LoadBuildScript(const std::string& BuildScript)
+	{
+		std::ifstream File(BuildScript);
+
+		std::string Line;
+		while (std::getline(File, Line))
+		{
+			const std::vector<std::string> Tokens = Tokenize(Line);
+			if (Tokens.empty() || GetFileName(Tokens[0]).find("glslc") == std::string::npos)
+				continue;
+
+			if (m_Compiler.empty())
+				m_Compiler = Tokens[0];
+
+			// The script's paths point at its author's checkout, only the file names are kept
+			CompileCommand Command;
+			for (size_t i = 1; i < Tokens.size(); i++)
+			{
+				if (Tokens[i] == "-o" && i + 1 < Tokens.size())
+					Command.Output = GetFileName(Tokens[++i]);
+				else if (Tokens[i][0] == '-')
+					Command.Arguments += " " + Tokens[i];
+				else
+					Command.Source = GetFileName(Tokens[i]);
+			}
+
+			if (Command.Source.empty() || Command.Output.empty())
+				continue;
+
+			m_Sources.insert(Command.Source);
+			m_Commands.push_back(std::move(Command));
+		}
+
+		// Another SDK version or platform, glslc has to be on the path then
+		std::error_code Error;
+		if (!m_Compiler.empty() && !std::filesystem::exists(m_Compiler, Error))
+			m_Compiler = "glslc";
+	}
+
+#ifdef _WIN32
+	void ShaderWatcher::Watch()
+	{
+		HANDLE Directory = CreateFileA(m_SourceDirectory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr
+			, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (Directory == INVALID_HANDLE_VALUE)
+		{
+			std::cout << "Shader watcher : failed to watch " << m_SourceDirectory << std::endl;
+			return;
+		}
+
+		OVERLAPPED Overlapped{};
+		Overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+		alignas(DWORD) uint8_t Buffer[16 * 1024];
+		bool Reading = false;
+
+		while (!m_IsStopping)
+		{
+			if (!Reading)
+			{
+				ResetEvent(Overlapped.hEvent);
+				if (!ReadDirectoryChangesW(Directory, Buffer, sizeof(Buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &Overlapped, nullptr))
+				{
+					std::cout << "Shader watcher : failed to read changes of " << m_SourceDirectory << std::endl;
+					break;
+				}
+
+				Reading = true;
+			}
+
+			std::vector<std::string> FileNames;
+
+			DWORD Size = 0;
+			if (WaitForSingleObject(Overlapped.hEvent, POLL_INTERVAL_MS) == WAIT_OBJECT_0)
+			{
+				Reading = false;
+
+				// Zero bytes when the buffer overflowed, those changes are lost
+				if (GetOverlappedResult(Directory, &Overlapped, &Size, FALSE) && Size > 0)
+				{
+					const uint8_t* Entry = Buffer;
+					while (true)
+					{
+						const FILE_NOTIFY_INFORMATION* Info = (const FILE_NOTIFY_INFORMATION*)Entry;
+						if (Info->Action != FILE_ACTION_REMOVED && Info->Action != FILE_ACTION_RENAMED_OLD_NAME)
+						{
+							const int Length = (int)(Info->FileNameLength / sizeof(WCHAR));
+							const int NameSize = WideCharToMultiByte(CP_UTF8, 0, Info->FileName, Length, nullptr, 0, nullptr, nullptr);
+
+							std::string FileName(NameSize, '\0');
+							WideCharToMultiByte(CP_UTF8, 0, Info->FileName, Length, FileName.data(), NameSize, nullptr, nullptr);
+							FileNames.push_back(std::move(FileName));
+						}
+
+						if (Info->NextEntryOffset == 0)
+							break;
+
+						Entry += Info->NextEntryOffset;
+					}
+				}
+			}
+
+			OnFilesChanged(FileNames);
+		}
+
+		if (Reading)
+		{
+			DWORD Size = 0;
+			CancelIoEx(Directory, &Overlapped);
+			GetOverlappedResult(Directory, &Overlapped, &Size, TRUE);
+		}
+
+		CloseHandle(Overlapped.hEvent);
+		CloseHandle(Directory);
+	}
+#else
+	void ShaderWatcher::Watch()
+	{
+		const int Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (Notify < 0)
+		{
+			std::cout << "Shader watcher : failed to initialize inotify" << std::endl;
+			return;
+		}
+
+		// Editors either rewrite a file in place or rename a new one over it
+		if (inotify_add_watch(Notify, m_SourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		{
+			std::cout << "Shader watcher : failed to watch " << m_SourceDirectory << std::endl;
+			close(Notify);
+			return;
+		}
+
+		alignas(inotify_event) char Buffer[16 * 1024];
+
+		while (!m_IsStopping)
+		{
+			std::vector<std::string> FileNames;
+
+			pollfd PollInfo{ Notify, POLLIN, 0 };
+			if (poll(&PollInfo, 1, POLL_INTERVAL_MS) > 0)
+			{
+				ssize_t Size;
+				while ((Size = read(Notify, Buffer, sizeof(Buffer))) > 0)
+				{
+					for (char* Entry = Buffer; Entry < Buffer + Size; )
+					{
+						const inotify_event* Event = (const inotify_event*)Entry;
+						if (Event->len > 0)
+							FileNames.push_back(Event->name);
+
+						Entry += sizeof(inotify_event) + Event->len;
+					}
+				}
+			}
+
+			OnFilesChanged(FileNames);
+		}
+
+		close(Notify);
+	}
+#endif
+
+	void ShaderWatcher::OnFilesChanged(const std::vector<std::string>& FileNames)
+	{
+		const auto Now = std::chrono::high_resolution_clock::now();
+
+		// Written SPIR-V and temporary files are not sources and fall through here
+		for (const std::string& FileName : FileNames)
+		{
+			if (m_Sources.find(FileName) == m_Sources.end())
+				continue;
+
+			if (m_PendingSources.empty())
+				m_FirstChangeTime = Now;
+
+			m_PendingSources.insert(FileName);
+			m_LastChangeTime = Now;
+		}
+
+		if (!m_PendingSources.empty() && Now - m_LastChangeTime >= SETTLE_TIME)
+			CompilePending();
+	}
+
+	void ShaderWatcher::CompilePending()
+	{
+		for (const std::string& Source : m_PendingSources)
+		{
+			std::vector<std::string> Outputs;
+			bool Succeeded = true;
+
+			for (const CompileCommand& Command : m_Commands)
+			{
+				if (Command.Source != Source)
+					continue;
+
+				if (Compile(Command))
+					Outputs.push_back(m_SourceDirectory + "/" + Command.Output);
+				else
+					Succeeded = false;
+			}
+
+			if (Succeeded)
+				std::cout << "Shader watcher : recompiled " << Source << " into " << Outputs.size() << " files" << std::endl;
+			else
+				std::cout << "Shader watcher : failed to compile " << Source << ", the failed variants keep their previous SPIR-V" << std::endl;
+
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_ChangedFiles.insert(m_ChangedFiles.end(), Outputs.begin(), Outputs.end());
+			m_Stats.CompileCount++;
+			if (!Succeeded)
+				m_Stats.FailureCount++;
+		}
+
+		m_PendingSources.clear();
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Stats.LastCompileMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - m_FirstChangeTime).count();
+	}
+
+	bool ShaderWatcher::Compile(const CompileCommand& Command)
+	{
+		const std::string OutputPath = m_SourceDirectory + "/" + Command.Output;
+		const std::string TempPath = OutputPath + ".tmp";
+
+		std::string CommandLine = "\"" + m_Compiler + "\"" + Command.Arguments + " \"" + m_SourceDirectory + "/" + Command.Source + "\" -o \"" + TempPath + "\"";
+#ifdef _WIN32
+		// cmd.exe strips the first and last quote of a command line starting with one
+		CommandLine = "\"" + CommandLine + "\"";
+#endif
+
+		// glslc prints its own errors
+		std::error_code Error;
+		if (std::system(CommandLine.c_str()) != 0)
+		{
+			std::filesystem::remove(TempPath, Error);
+			return false;
+		}
+
+		// Pipelines reading the file meanwhile see either the old or the new SPIR-V
+		std::filesystem::rename(TempPath, OutputPath, Error);
+
+		if (Error)
+		{
+			std::filesystem::remove(TempPath, Error);
+			return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
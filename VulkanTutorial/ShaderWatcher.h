@@ -0,0 +1,92 @@
+#ifndef __ShaderWatcher_h__
+#define __ShaderWatcher_h__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Watches the shader source directory and recompiles a changed GLSL file into every SPIR-V file CompileShader.bat
+	// builds from it, with the same glslc arguments. Changes are picked up on a thread of its own, ReadDirectoryChangesW
+	// on Windows and inotify elsewhere. SPIR-V files are replaced atomically and only when glslc succeeds, so a broken
+	// edit keeps the previous shader.
+	class ShaderWatcher
+	{
+	public:
+
+		static constexpr const char* DEFAULT_SOURCE_DIRECTORY = "./../../Content";
+		static constexpr const char* DEFAULT_BUILD_SCRIPT = "./../../CompileShader.bat";
+
+		// Editors save in several writes, a source is compiled once it was left alone this long
+		static constexpr std::chrono::milliseconds SETTLE_TIME = std::chrono::milliseconds(50);
+
+		struct Stats
+		{
+			uint32_t CompileCount = 0;
+			uint32_t FailureCount = 0;
+			// From the first change of a source to the last of its SPIR-V files being replaced
+			float LastCompileMs = 0.0f;
+		};
+
+		ShaderWatcher(const std::string& SourceDirectory = DEFAULT_SOURCE_DIRECTORY, const std::string& BuildScript = DEFAULT_BUILD_SCRIPT);
+		virtual ~ShaderWatcher();
+
+		ShaderWatcher(const ShaderWatcher&) = delete;
+		ShaderWatcher& operator = (const ShaderWatcher&) = delete;
+
+		ShaderWatcher(ShaderWatcher&&) = delete;
+		ShaderWatcher& operator = (ShaderWatcher&&) = delete;
+
+		// SPIR-V files replaced since the last call, as SourceDirectory + "/" + file name
+		std::vector<std::string> TakeChangedFiles();
+
+		// Number of sources with a compile command, zero when the build script could not be read
+		uint32_t GetSourceCount() const { return (uint32_t)m_Sources.size(); }
+
+		Stats GetStats() const;
+
+	private:
+
+		// One glslc line of the build script, file names without their directory
+		struct CompileCommand
+		{
+			std::string Source;
+			std::string Output;
+			std::string Arguments;
+		};
+
+		void LoadBuildScript(const std::string& BuildScript);
+
+		// Runs on the watcher thread
+		void Watch();
+		void OnFilesChanged(const std::vector<std::string>& FileNames);
+		void CompilePending();
+		bool Compile(const CompileCommand& Command);
+
+		std::string m_SourceDirectory;
+		std::string m_Compiler;
+		std::vector<CompileCommand> m_Commands;
+		std::unordered_set<std::string> m_Sources;
+
+		// Only touched by the watcher thread
+		std::unordered_set<std::string> m_PendingSources;
+		std::chrono::high_resolution_clock::time_point m_FirstChangeTime;
+		std::chrono::high_resolution_clock::time_point m_LastChangeTime;
+
+		mutable std::mutex m_Mutex;
+		std::vector<std::string> m_ChangedFiles;
+		Stats m_Stats;
+
+		std::atomic<bool> m_IsStopping{ false };
+		// Declared last so it starts after everything it uses is constructed
+		std::thread m_Thread;
+	};
+}
+
+#endif //__ShaderWatcher_h__
\ No newline at end of file
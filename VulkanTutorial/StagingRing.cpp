@@ -0,0 +1,63 @@
+#include "StagingRing.h"
+
+#include <cassert>
+
+namespace VulkanTutorial
+{
+	StagingRing::StagingRing(EngineDevice& Device, VkDeviceSize Size)
+		: m_Size(Size)
+	{
+		m_Buffer = std::make_unique<Buffer>(Device, Size, 1
+			, VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+			, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		m_Buffer->Map();
+		m_Mapped = (uint8_t*)m_Buffer->GetMappedMemory();
+	}
+
+	StagingRing::~StagingRing()
+	{
+
+	}
+
+	bool StagingRing::TryAllocate(VkDeviceSize Size, VkDeviceSize Alignment, Allocation& OutAllocation)
+	{
+		assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0 && "Alignment must be a power of two");
+
+		if (Size == 0 || Size > m_Size)
+			return false;
+
+		// An empty ring restarts at offset zero, otherwise a large range could fail behind the skipped tail end
+		if (m_Head == m_Tail)
+		{
+			m_Head = (m_Head + m_Size - 1) / m_Size * m_Size;
+			m_Tail = m_Head;
+		}
+
+		const uint64_t HeadOffset = m_Head % m_Size;
+		uint64_t Start = m_Head + (((HeadOffset + Alignment - 1) & ~(Alignment - 1)) - HeadOffset);
+
+		// Skip the tail end of the buffer when the range would wrap
+		if (Start % m_Size + Size > m_Size)
+			Start += m_Size - Start % m_Size;
+
+		if (Start + Size - m_Tail > m_Size)
+			return false;
+
+		OutAllocation.Buffer = m_Buffer->GetBuffer();
+		OutAllocation.Offset = Start % m_Size;
+		OutAllocation.Mapped = m_Mapped + OutAllocation.Offset;
+
+		m_Head = Start + Size;
+		return true;
+	}
+
+	void StagingRing::Release(Marker BatchEnd)
+	{
+		assert(BatchEnd <= m_Head && "Marker was not taken from this ring");
+
+		// Batches without ring allocations may hand back a marker from before an empty ring restart
+		if (BatchEnd > m_Tail)
+			m_Tail = BatchEnd;
+	}
+}
\ No newline at end of file
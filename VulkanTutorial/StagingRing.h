@@ -0,0 +1,63 @@
+#ifndef __StagingRing_h__
+#define __StagingRing_h__
+
+#include "EngineDevice.h"
+#include "Buffer.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace VulkanTutorial
+{
+	// Persistently mapped host visible buffer handing out staging ranges in FIFO order. Ranges are never freed one by
+	// one: the owner closes a batch with EndBatch once its copies are submitted and calls Release with the returned
+	// marker when that batch's fence has signaled. Not thread safe, the owner serializes access.
+	class StagingRing
+	{
+	public:
+
+		struct Allocation
+		{
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			VkDeviceSize Offset = 0;
+			void* Mapped = nullptr;
+		};
+
+		using Marker = uint64_t;
+
+		// Size has to be a multiple of every alignment passed to TryAllocate
+		StagingRing(EngineDevice& Device, VkDeviceSize Size);
+		virtual ~StagingRing();
+
+		StagingRing(const StagingRing&) = delete;
+		StagingRing& operator = (const StagingRing&) = delete;
+
+		StagingRing(StagingRing&&) = delete;
+		StagingRing& operator = (StagingRing&&) = delete;
+
+		// Fails when the free space can not hold Size bytes at Alignment, the owner has to release a batch and retry.
+		// A range never wraps around the end of the buffer.
+		bool TryAllocate(VkDeviceSize Size, VkDeviceSize Alignment, Allocation& OutAllocation);
+
+		// Position after everything allocated so far
+		Marker EndBatch() const { return m_Head; }
+
+		// Frees everything allocated before the marker was taken
+		void Release(Marker BatchEnd);
+
+		VkDeviceSize GetSize() const { return m_Size; }
+		VkDeviceSize GetUsedSize() const { return m_Head - m_Tail; }
+
+	private:
+
+		std::unique_ptr<Buffer> m_Buffer;
+		uint8_t* m_Mapped = nullptr;
+		VkDeviceSize m_Size;
+
+		// Monotonic byte positions, the buffer offset is the position modulo m_Size
+		uint64_t m_Head = 0;
+		uint64_t m_Tail = 0;
+	};
+}
+
+#endif //__StagingRing_h__
@@ -0,0 +1,153 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace VulkanTutorial
+{
+	ThreadPool::ThreadPool(uint32_t ThreadCount)
+	{
+		if (ThreadCount == 0)
+		{
+			const uint32_t HardwareThreads = std::thread::hardware_concurrency();
+			ThreadCount = HardwareThreads > 1 ? HardwareThreads - 1 : 1;
+		}
+
+		m_Workers.reserve(ThreadCount);
+		for (uint32_t i = 0; i < ThreadCount; i++)
+		{
+			m_Workers.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_IsStopping = true;
+		}
+
+		m_Condition.notify_all();
+
+		for (auto& Worker : m_Workers)
+			Worker.join();
+	}
+
+	ThreadPool& ThreadPool::Shared()
+	{
+		static ThreadPool SharedPool;
+		return SharedPool;
+	}
+
+	void ThreadPool::Enqueue(std::function<void()> Task)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(m_Mutex);
+			m_Tasks.push_back(std::move(Task));
+		}
+
+		m_Condition.notify_one();
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> Task;
+
+			{
+				std::unique_lock<std::mutex> Lock(m_Mutex);
+				m_Condition.wait(Lock, [this]() { return m_IsStopping || !m_Tasks.empty(); });
+
+				// Drain the queue before stopping so no submitted future is left without a value
+				if (m_Tasks.empty())
+					return;
+
+				Task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+
+			Task();
+		}
+	}
+
+	void ThreadPool::ParallelFor(size_t Count, size_t GrainSize, const std::function<void(size_t, size_t)>& Func)
+	{
+		if (Count == 0)
+			return;
+
+		GrainSize = std::max<size_t>(GrainSize, 1);
+		const size_t RangeCount = (Count + GrainSize - 1) / GrainSize;
+
+		if (RangeCount == 1)
+		{
+			Func(0, Count);
+			return;
+		}
+
+		// Helper tasks may still be queued after the last range finished, so they must not reference the stack
+		struct ParallelForState
+		{
+			std::function<void(size_t, size_t)> Func;
+			size_t Count;
+			size_t GrainSize;
+			size_t RangeCount;
+			std::atomic<size_t> NextRange{ 0 };
+			std::atomic<size_t> FinishedRanges{ 0 };
+			std::mutex Mutex;
+			std::condition_variable Finished;
+			std::exception_ptr Error;
+		};
+
+		auto State = std::make_shared<ParallelForState>();
+		State->Func = Func;
+		State->Count = Count;
+		State->GrainSize = GrainSize;
+		State->RangeCount = RangeCount;
+
+		auto RunRanges = [State]()
+		{
+			while (true)
+			{
+				const size_t Range = State->NextRange.fetch_add(1);
+				if (Range >= State->RangeCount)
+					return;
+
+				const size_t Begin = Range * State->GrainSize;
+				const size_t End = std::min(Begin + State->GrainSize, State->Count);
+
+				try
+				{
+					State->Func(Begin, End);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> Lock(State->Mutex);
+					if (!State->Error)
+						State->Error = std::current_exception();
+				}
+
+				if (State->FinishedRanges.fetch_add(1) + 1 == State->RangeCount)
+				{
+					std::lock_guard<std::mutex> Lock(State->Mutex);
+					State->Finished.notify_all();
+				}
+			}
+		};
+
+		const size_t HelperCount = std::min<size_t>(m_Workers.size(), RangeCount - 1);
+		for (size_t i = 0; i < HelperCount; i++)
+			Enqueue(RunRanges);
+
+		RunRanges();
+
+		{
+			std::unique_lock<std::mutex> Lock(State->Mutex);
+			State->Finished.wait(Lock, [&State]() { return State->FinishedRanges.load() == State->RangeCount; });
+		}
+
+		if (State->Error)
+			std::rethrow_exception(State->Error);
+	}
+}
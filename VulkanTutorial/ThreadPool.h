@@ -0,0 +1,66 @@
+#ifndef __ThreadPool_h__
+#define __ThreadPool_h__
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	class ThreadPool
+	{
+	public:
+
+		// ThreadCount of 0 uses one worker per hardware thread minus the calling thread
+		explicit ThreadPool(uint32_t ThreadCount = 0);
+		virtual ~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator = (const ThreadPool&) = delete;
+
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator = (ThreadPool&&) = delete;
+
+		uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size(); }
+
+		template<typename TaskType>
+		auto Submit(TaskType&& Task) -> std::future<decltype(Task())>
+		{
+			using ResultType = decltype(Task());
+
+			auto PackagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<TaskType>(Task));
+			std::future<ResultType> Result = PackagedTask->get_future();
+
+			Enqueue([PackagedTask]() { (*PackagedTask)(); });
+
+			return Result;
+		}
+
+		// Splits [0, Count) into GrainSize sized ranges and runs Func(Begin, End) on the workers and the calling thread.
+		// Returns once every range has finished, rethrowing the first exception thrown by Func.
+		// The calling thread drains the remaining ranges itself, so it is safe to call from inside a task of the same pool.
+		void ParallelFor(size_t Count, size_t GrainSize, const std::function<void(size_t, size_t)>& Func);
+
+		// Process wide pool for CPU bound work such as asset parsing
+		static ThreadPool& Shared();
+
+	private:
+
+		void Enqueue(std::function<void()> Task);
+		void WorkerLoop();
+
+		std::vector<std::thread> m_Workers;
+		std::deque<std::function<void()>> m_Tasks;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_IsStopping = false;
+	};
+}
+
+#endif //__ThreadPool_h__
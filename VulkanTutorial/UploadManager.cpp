@@ -0,0 +1,353 @@
+#include "UploadManager.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace VulkanTutorial
+{
+	UploadManager::UploadManager(EngineDevice& Device, VkDeviceSize StagingRingSize)
+		: m_Device(Device)
+		, m_Queue(Device.TransferQueue())
+		, m_UsesTransferQueue(Device.HasDedicatedTransferQueue())
+	{
+		VkCommandPoolCreateInfo PoolInfo{};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		PoolInfo.queueFamilyIndex = Device.TransferQueueFamily();
+		PoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(m_Device.Device(), &PoolInfo, nullptr, &m_CommandPool) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create upload command pool");
+
+		if (StagingRingSize > 0)
+			m_StagingRing = std::make_unique<StagingRing>(m_Device, StagingRingSize);
+	}
+
+	UploadManager::~UploadManager()
+	{
+		WaitIdle();
+
+		for (VkFence Fence : m_FreeFences)
+			vkDestroyFence(m_Device.Device(), Fence, nullptr);
+
+		vkDestroyCommandPool(m_Device.Device(), m_CommandPool, nullptr);
+	}
+
+	UploadManager::Ticket UploadManager::UploadToBuffer(VkBuffer DstBuffer, const void* Data, VkDeviceSize Size, VkDeviceSize DstOffset)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		m_Stats.BytesUploaded += Size;
+		m_Stats.UploadCount++;
+
+		if (m_StagingRing && Size <= m_StagingRing->GetSize())
+		{
+			StagingRing::Allocation Staging;
+			if (!m_StagingRing->TryAllocate(Size, STAGING_ALIGNMENT, Staging))
+			{
+				m_Stats.RingFullStalls++;
+
+				// Pending copies pin ring space too, submit them so every range belongs to a batch that can retire
+				FlushLocked();
+
+				while (!m_StagingRing->TryAllocate(Size, STAGING_ALIGNMENT, Staging))
+				{
+					if (m_InFlightBatches.empty())
+						throw std::runtime_error("Staging ring can not fit upload");
+
+					RetireLocked(true, m_InFlightBatches.front().LastTicket);
+				}
+			}
+
+			memcpy(Staging.Mapped, Data, (size_t)Size);
+			m_PendingCopies.push_back({ Staging.Buffer, Staging.Offset, DstBuffer, DstOffset, Size });
+		}
+		else
+		{
+			m_Stats.DedicatedStagingCount++;
+
+			auto StagingBuffer = std::make_unique<Buffer>(m_Device, Size, 1
+				, VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+				, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+			StagingBuffer->Map();
+			StagingBuffer->WriteToBuffer(Data, Size);
+			StagingBuffer->Unmap();
+
+			m_PendingCopies.push_back({ StagingBuffer->GetBuffer(), 0, DstBuffer, DstOffset, Size });
+			m_PendingStagingBuffers.push_back(std::move(StagingBuffer));
+		}
+
+		return m_NextTicket++;
+	}
+
+	UploadManager::Stats UploadManager::GetStats() const
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		return m_Stats;
+	}
+
+	UploadManager::Ticket UploadManager::Flush()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		return FlushLocked();
+	}
+
+	void UploadManager::Update()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		FlushLocked();
+		RetireLocked(false, 0);
+	}
+
+	void UploadManager::Wait(Ticket UploadTicket)
+	{
+		if (IsComplete(UploadTicket))
+			return;
+
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		if (UploadTicket > m_FlushedTicket)
+			FlushLocked();
+
+		RetireLocked(true, UploadTicket);
+	}
+
+	void UploadManager::WaitIdle()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+
+		FlushLocked();
+		RetireLocked(true, m_FlushedTicket);
+	}
+
+	UploadManager::Ticket UploadManager::FlushLocked()
+	{
+		if (m_PendingCopies.empty())
+			return m_FlushedTicket;
+
+		Batch NewBatch;
+		NewBatch.LastTicket = m_NextTicket - 1;
+
+		VkCommandBufferAllocateInfo AllocInfo{};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		AllocInfo.commandPool = m_CommandPool;
+		AllocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_Device.Device(), &AllocInfo, &NewBatch.CommandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate upload command buffer");
+
+		VkCommandBufferBeginInfo BeginInfo{};
+		BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(NewBatch.CommandBuffer, &BeginInfo);
+
+		for (const PendingCopy& Copy : m_PendingCopies)
+		{
+			VkBufferCopy CopyRegion{};
+			CopyRegion.srcOffset = Copy.SrcOffset;
+			CopyRegion.dstOffset = Copy.DstOffset;
+			CopyRegion.size = Copy.Size;
+			vkCmdCopyBuffer(NewBatch.CommandBuffer, Copy.SrcBuffer, Copy.DstBuffer, 1, &CopyRegion);
+		}
+
+		m_PendingCopies.clear();
+
+		NewBatch.RingEnd = m_StagingRing ? m_StagingRing->EndBatch() : 0;
+		NewBatch.StagingBuffers = std::move(m_PendingStagingBuffers);
+		m_PendingStagingBuffers.clear();
+
+		// Makes the copies available before the fence signals, consumers only start once it has
+		VkMemoryBarrier Barrier{};
+		Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(NewBatch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &Barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(NewBatch.CommandBuffer);
+
+		NewBatch.Fence = AcquireFence();
+
+		VkSubmitInfo SubmitInfo{};
+		SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		SubmitInfo.commandBufferCount = 1;
+		SubmitInfo.pCommandBuffers = &NewBatch.CommandBuffer;
+
+		if (vkQueueSubmit(m_Queue, 1, &SubmitInfo, NewBatch.Fence) != VK_SUCCESS)
+			throw std::runtime_error("Failed to submit upload batch");
+
+		m_FlushedTicket = NewBatch.LastTicket;
+		m_InFlightBatches.push_back(std::move(NewBatch));
+
+		return m_FlushedTicket;
+	}
+
+	void UploadManager::RetireLocked(bool Wait, Ticket UntilTicket)
+	{
+		while (!m_InFlightBatches.empty())
+		{
+			Batch& Oldest = m_InFlightBatches.front();
+
+			if (Wait && Oldest.LastTicket <= UntilTicket)
+			{
+				vkWaitForFences(m_Device.Device(), 1, &Oldest.Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			}
+			else if (vkGetFenceStatus(m_Device.Device(), Oldest.Fence) != VK_SUCCESS)
+			{
+				return;
+			}
+
+			vkFreeCommandBuffers(m_Device.Device(), m_CommandPool, 1, &Oldest.CommandBuffer);
+
+			if (m_StagingRing)
+				m_StagingRing->Release(Oldest.RingEnd);
+
+			vkResetFences(m_Device.Device(), 1, &Oldest.Fence);
+			m_FreeFences.push_back(Oldest.Fence);
+
+			m_CompletedTicket = Oldest.LastTicket;
+			m_InFlightBatches.pop_front();
+		}
+	}
+
+	VkFence UploadManager::AcquireFence()
+	{
+		if (!m_FreeFences.empty())
+		{
+			VkFence Fence = m_FreeFences.back();
+			m_FreeFences.pop_back();
+			return Fence;
+		}
+
+		VkFenceCreateInfo FenceInfo{};
+		FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VkFence Fence;
+		if (vkCreateFence(m_Device.Device(), &FenceInfo, nullptr, &Fence) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create upload fence");
+
+		return Fence;
+	}
+
+	void UploadManager::RunBenchmark(EngineDevice& Device, uint32_t MeshCount)
+	{
+		// Roughly a small OBJ: 2k vertices of 44 bytes and 3k indices
+		constexpr VkDeviceSize VertexBytes = 2048 * 44;
+		constexpr VkDeviceSize IndexBytes = 3072 * sizeof(uint32_t);
+
+		std::vector<uint8_t> SourceData(VertexBytes, 0x5a);
+
+		auto CreateMeshBuffers = [&Device, MeshCount]()
+		{
+			std::vector<std::unique_ptr<Buffer>> Buffers;
+			Buffers.reserve(MeshCount * 2);
+
+			for (uint32_t i = 0; i < MeshCount; i++)
+			{
+				Buffers.push_back(std::make_unique<Buffer>(Device, VertexBytes, 1, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+				Buffers.push_back(std::make_unique<Buffer>(Device, IndexBytes, 1, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+			}
+
+			return Buffers;
+		};
+
+		const double TotalMegabytes = (double)MeshCount * (double)(VertexBytes + IndexBytes) / (1024.0 * 1024.0);
+
+		// One staging buffer, submit and queue idle per buffer, like the old Mesh upload path
+		{
+			auto Buffers = CreateMeshBuffers();
+
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			for (auto& DstBuffer : Buffers)
+			{
+				Buffer StagingBuffer(Device, DstBuffer->GetBufferSize(), 1
+					, VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+					, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+				StagingBuffer.Map();
+				StagingBuffer.WriteToBuffer(SourceData.data(), DstBuffer->GetBufferSize());
+
+				Device.CopyBuffer(StagingBuffer.GetBuffer(), DstBuffer->GetBuffer(), DstBuffer->GetBufferSize());
+			}
+			auto EndTime = std::chrono::high_resolution_clock::now();
+
+			const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+			std::cout << "CopyBuffer    : " << MeshCount << " meshes in " << Seconds * 1000.0 << " ms, " << MeshCount / Seconds << " meshes/s, "
+				<< TotalMegabytes / Seconds << " MB/s, " << Buffers.size() << " queue idles" << std::endl;
+		}
+
+		// Everything batched into one submission
+		{
+			auto Buffers = CreateMeshBuffers();
+			UploadManager& Uploads = Device.GetUploadManager();
+
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			for (auto& DstBuffer : Buffers)
+				Uploads.UploadToBuffer(DstBuffer->GetBuffer(), SourceData.data(), DstBuffer->GetBufferSize());
+
+			Uploads.WaitIdle();
+			auto EndTime = std::chrono::high_resolution_clock::now();
+
+			const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+			std::cout << "UploadManager : " << MeshCount << " meshes in " << Seconds * 1000.0 << " ms, " << MeshCount / Seconds << " meshes/s, "
+				<< TotalMegabytes / Seconds << " MB/s, 1 fence wait" << (Uploads.UsesTransferQueue() ? " (transfer queue)" : " (graphics queue)") << std::endl;
+		}
+	}
+
+	void UploadManager::RunStreamingBenchmark(EngineDevice& Device, uint32_t FrameCount)
+	{
+		constexpr VkDeviceSize VertexBytes = 2048 * 44;
+		constexpr VkDeviceSize IndexBytes = 3072 * sizeof(uint32_t);
+		constexpr uint32_t MeshesPerFrame = 16;
+		constexpr uint32_t TargetMeshCount = 64;
+
+		std::vector<uint8_t> SourceData(VertexBytes, 0x5a);
+
+		// Streamed meshes overwrite a fixed set of targets round robin, only the staging side is measured
+		std::vector<std::unique_ptr<Buffer>> Targets;
+		for (uint32_t i = 0; i < TargetMeshCount; i++)
+		{
+			Targets.push_back(std::make_unique<Buffer>(Device, VertexBytes, 1, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+			Targets.push_back(std::make_unique<Buffer>(Device, IndexBytes, 1, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+		}
+
+		const VkDeviceSize RingSizes[] = { 0, 4 * 1024 * 1024, 16 * 1024 * 1024, DEFAULT_STAGING_RING_SIZE };
+
+		for (VkDeviceSize RingSize : RingSizes)
+		{
+			UploadManager Uploads(Device, RingSize);
+			size_t NextTarget = 0;
+
+			auto StartTime = std::chrono::high_resolution_clock::now();
+			for (uint32_t Frame = 0; Frame < FrameCount; Frame++)
+			{
+				for (uint32_t i = 0; i < MeshesPerFrame * 2; i++)
+				{
+					Buffer& Target = *Targets[NextTarget];
+					NextTarget = (NextTarget + 1) % Targets.size();
+
+					Uploads.UploadToBuffer(Target.GetBuffer(), SourceData.data(), Target.GetBufferSize());
+				}
+
+				Uploads.Update();
+			}
+
+			Uploads.WaitIdle();
+			auto EndTime = std::chrono::high_resolution_clock::now();
+
+			const Stats UploadStats = Uploads.GetStats();
+			const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+
+			std::cout << "Staging ring " << RingSize / (1024 * 1024) << " MB" << (RingSize == 0 ? " (buffer per upload)" : "") << " : "
+				<< FrameCount << " frames in " << Seconds * 1000.0 << " ms, "
+				<< (double)UploadStats.BytesUploaded / (1024.0 * 1024.0) / Seconds << " MB/s, "
+				<< UploadStats.BytesUploaded / FrameCount << " bytes/frame, "
+				<< UploadStats.RingFullStalls << " ring full stalls" << std::endl;
+		}
+	}
+}
\ No newline at end of file
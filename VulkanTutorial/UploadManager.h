@@ -0,0 +1,125 @@
+#ifndef __UploadManager_h__
+#define __UploadManager_h__
+
+#include "EngineDevice.h"
+#include "Buffer.h"
+#include "StagingRing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	// Batches buffer uploads into one command buffer per Flush and tracks completion with a fence, so loading many
+	// meshes no longer waits for the queue to go idle once per buffer. Runs on the dedicated transfer queue when the
+	// device has one. IsComplete and GetStats may be called from any thread. UploadToBuffer, Flush, Update, Wait and
+	// WaitIdle may all submit, so they belong on the thread that submits frames as the queue may be the graphics queue.
+	class UploadManager
+	{
+	public:
+
+		// Identifies the batch an upload went into, batches complete in order
+		using Ticket = uint64_t;
+
+		static constexpr VkDeviceSize DEFAULT_STAGING_RING_SIZE = 64 * 1024 * 1024;
+		static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+		// Cumulative counters, sample twice and subtract for per frame numbers
+		struct Stats
+		{
+			uint64_t BytesUploaded = 0;
+			uint64_t UploadCount = 0;
+			// Uploads that had to wait for an earlier batch to free ring space
+			uint64_t RingFullStalls = 0;
+			// Uploads larger than the ring, staged through a buffer of their own
+			uint64_t DedicatedStagingCount = 0;
+		};
+
+		// A StagingRingSize of 0 stages every upload through its own buffer
+		UploadManager(EngineDevice& Device, VkDeviceSize StagingRingSize = DEFAULT_STAGING_RING_SIZE);
+		virtual ~UploadManager();
+
+		UploadManager(const UploadManager&) = delete;
+		UploadManager& operator = (const UploadManager&) = delete;
+
+		UploadManager(UploadManager&&) = delete;
+		UploadManager& operator = (UploadManager&&) = delete;
+
+		// Copies Data into staging memory right away, Data may be released on return. The copy into DstBuffer is
+		// recorded by the next Flush, DstBuffer must stay alive until the returned ticket is complete. When the
+		// staging ring is full this flushes and waits for the oldest batches, so only call it on the submitting thread.
+		Ticket UploadToBuffer(VkBuffer DstBuffer, const void* Data, VkDeviceSize Size, VkDeviceSize DstOffset = 0);
+
+		// Submits every pending copy as one batch, returns the ticket of the last upload
+		Ticket Flush();
+
+		// Submits pending copies and retires finished batches, releasing their staging memory. Call once per frame.
+		void Update();
+
+		bool IsComplete(Ticket UploadTicket) const { return UploadTicket <= m_CompletedTicket; }
+
+		// Flushes if needed and blocks until UploadTicket is complete
+		void Wait(Ticket UploadTicket);
+		void WaitIdle();
+
+		bool UsesTransferQueue() const { return m_UsesTransferQueue; }
+
+		Stats GetStats() const;
+
+		// Uploads 2 buffers for each of MeshCount meshes, once through EngineDevice::CopyBuffer and once batched, and
+		// prints the throughput of both
+		static void RunBenchmark(EngineDevice& Device, uint32_t MeshCount);
+
+		// Streams FrameCount frames of mesh uploads through managers with different staging ring sizes and prints
+		// throughput, bytes per frame and ring full stalls for each
+		static void RunStreamingBenchmark(EngineDevice& Device, uint32_t FrameCount);
+
+	private:
+
+		struct PendingCopy
+		{
+			VkBuffer SrcBuffer;
+			VkDeviceSize SrcOffset;
+			VkBuffer DstBuffer;
+			VkDeviceSize DstOffset;
+			VkDeviceSize Size;
+		};
+
+		struct Batch
+		{
+			Ticket LastTicket;
+			VkCommandBuffer CommandBuffer;
+			VkFence Fence;
+			StagingRing::Marker RingEnd;
+			// Only for uploads that did not fit the ring
+			std::vector<std::unique_ptr<Buffer>> StagingBuffers;
+		};
+
+		Ticket FlushLocked();
+		void RetireLocked(bool Wait, Ticket UntilTicket);
+		VkFence AcquireFence();
+
+		EngineDevice& m_Device;
+		VkQueue m_Queue;
+		VkCommandPool m_CommandPool;
+		bool m_UsesTransferQueue;
+
+		mutable std::mutex m_Mutex;
+		std::unique_ptr<StagingRing> m_StagingRing;
+		std::vector<PendingCopy> m_PendingCopies;
+		std::vector<std::unique_ptr<Buffer>> m_PendingStagingBuffers;
+		Stats m_Stats;
+		std::deque<Batch> m_InFlightBatches;
+		std::vector<VkFence> m_FreeFences;
+
+		Ticket m_NextTicket = 1;
+		Ticket m_FlushedTicket = 0;
+		std::atomic<Ticket> m_CompletedTicket{ 0 };
+	};
+}
+
+#endif //__UploadManager_h__
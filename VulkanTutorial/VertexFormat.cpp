@@ -0,0 +1,181 @@
+#include "VertexFormat.h"
+#include "Mesh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace VulkanTutorial
+{
+	static_assert(sizeof(CompactVertex) == 20, "CompactVertex must match the compact attribute descriptions");
+
+	VertexQuantization VertexQuantization::FromBounds(const glm::vec3& Min, const glm::vec3& Max)
+	{
+		VertexQuantization Result;
+		Result.Center = (Min + Max) * 0.5f;
+
+		// Flat meshes still need a non zero scale on their flat axis
+		Result.Extent = glm::max((Max - Min) * 0.5f, glm::vec3(1e-6f));
+		return Result;
+	}
+
+	glm::mat4 VertexQuantization::GetDequantizeMatrix() const
+	{
+		return glm::scale(glm::translate(glm::mat4(1.0f), Center), Extent);
+	}
+
+	VkDeviceSize VertexQuantizer::GetVertexStride(VertexFormat Format)
+	{
+		return Format == VertexFormat::Float32 ? sizeof(Mesh::Vertex) : sizeof(CompactVertex);
+	}
+
+	const char* VertexQuantizer::GetFormatName(VertexFormat Format)
+	{
+		switch (Format)
+		{
+		case VertexFormat::Float32: return "float32";
+		case VertexFormat::Half: return "half";
+		case VertexFormat::Snorm16: return "snorm16";
+		}
+
+		return "unknown";
+	}
+
+	bool VertexQuantizer::ParseFormat(const std::string& Name, VertexFormat& OutFormat)
+	{
+		for (VertexFormat Format : { VertexFormat::Float32, VertexFormat::Half, VertexFormat::Snorm16 })
+		{
+			if (Name == GetFormatName(Format))
+			{
+				OutFormat = Format;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	uint32_t VertexQuantizer::EncodeOctahedral(const glm::vec3& Normal)
+	{
+		const float L1Norm = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+		if (L1Norm == 0.0f)
+			return glm::packSnorm2x16(glm::vec2(0.0f));
+
+		glm::vec2 Octahedral = glm::vec2(Normal.x, Normal.y) / L1Norm;
+
+		// Fold the lower hemisphere over the diagonals
+		if (Normal.z < 0.0f)
+		{
+			const glm::vec2 Sign(Octahedral.x >= 0.0f ? 1.0f : -1.0f, Octahedral.y >= 0.0f ? 1.0f : -1.0f);
+			Octahedral = (1.0f - glm::abs(glm::vec2(Octahedral.y, Octahedral.x))) * Sign;
+		}
+
+		return glm::packSnorm2x16(Octahedral);
+	}
+
+	glm::vec3 VertexQuantizer::DecodeOctahedral(uint32_t Encoded)
+	{
+		// Same steps as DecodeNormal in the compact vertex shaders
+		const glm::vec2 Octahedral = glm::unpackSnorm2x16(Encoded);
+
+		glm::vec3 Normal(Octahedral.x, Octahedral.y, 1.0f - std::abs(Octahedral.x) - std::abs(Octahedral.y));
+		const float Fold = std::max(-Normal.z, 0.0f);
+		Normal.x += Normal.x >= 0.0f ? -Fold : Fold;
+		Normal.y += Normal.y >= 0.0f ? -Fold : Fold;
+
+		return glm::normalize(Normal);
+	}
+
+	void VertexQuantizer::Encode(VertexFormat Format, const VertexQuantization& Quantization
+		, const glm::vec3& Position, const glm::vec3& Color, const glm::vec3& Normal, const glm::vec2& Uv, CompactVertex& OutVertex)
+	{
+		const glm::vec3 Quantized = glm::clamp((Position - Quantization.Center) / Quantization.Extent, glm::vec3(-1.0f), glm::vec3(1.0f));
+
+		for (int i = 0; i < 3; i++)
+			OutVertex.Position[i] = Format == VertexFormat::Half ? glm::packHalf1x16(Quantized[i]) : glm::packSnorm1x16(Quantized[i]);
+		OutVertex.Position[3] = 0;
+
+		OutVertex.Normal = EncodeOctahedral(Normal);
+
+		const uint32_t PackedColor = glm::packUnorm4x8(glm::vec4(Color, 1.0f));
+		memcpy(OutVertex.Color, &PackedColor, sizeof(PackedColor));
+
+		OutVertex.Uv[0] = glm::packHalf1x16(Uv.x);
+		OutVertex.Uv[1] = glm::packHalf1x16(Uv.y);
+	}
+
+	glm::vec3 VertexQuantizer::DecodePosition(VertexFormat Format, const VertexQuantization& Quantization, const CompactVertex& Vertex)
+	{
+		glm::vec3 Quantized;
+		for (int i = 0; i < 3; i++)
+			Quantized[i] = Format == VertexFormat::Half ? glm::unpackHalf1x16(Vertex.Position[i]) : glm::unpackSnorm1x16(Vertex.Position[i]);
+
+		return Quantization.Center + Quantized * Quantization.Extent;
+	}
+
+	glm::vec3 VertexQuantizer::DecodeNormal(const CompactVertex& Vertex)
+	{
+		return DecodeOctahedral(Vertex.Normal);
+	}
+
+	void VertexQuantizer::RunBenchmark(const std::string& FilePath)
+	{
+		Mesh::Builder MeshBuilder;
+		MeshBuilder.LoadModel(FilePath);
+
+		const std::vector<Mesh::Vertex>& Vertices = MeshBuilder.Vertices;
+		const Mesh::BoundingBox Bounds = MeshBuilder.ComputeBounds();
+		const VertexQuantization Quantization = VertexQuantization::FromBounds(Bounds.Min, Bounds.Max);
+		const float Diagonal = glm::length(Bounds.Max - Bounds.Min);
+
+		// A frame of the 5000 object stress scene fetches every vertex of every object at least once
+		const uint64_t StressObjectCount = 5000;
+
+		std::cout << "Vertex formats for " << FilePath << ", " << Vertices.size() << " vertices" << std::endl;
+
+		for (VertexFormat Format : { VertexFormat::Float32, VertexFormat::Half, VertexFormat::Snorm16 })
+		{
+			const VkDeviceSize Stride = GetVertexStride(Format);
+			const uint64_t MeshBytes = Stride * Vertices.size();
+
+			float MaxPositionError = 0.0f;
+			float MaxNormalErrorDegrees = 0.0f;
+			float EncodeTimeMs = 0.0f;
+
+			if (Format != VertexFormat::Float32)
+			{
+				std::vector<CompactVertex> Encoded(Vertices.size());
+
+				auto StartTime = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < Vertices.size(); i++)
+					Encode(Format, Quantization, Vertices[i].position, Vertices[i].color, Vertices[i].normal, Vertices[i].uv, Encoded[i]);
+				auto EndTime = std::chrono::high_resolution_clock::now();
+
+				EncodeTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(EndTime - StartTime).count();
+
+				for (size_t i = 0; i < Vertices.size(); i++)
+				{
+					MaxPositionError = std::max(MaxPositionError, glm::length(DecodePosition(Format, Quantization, Encoded[i]) - Vertices[i].position));
+
+					// OBJ files without normals leave them zero, there is no direction to compare
+					if (glm::length(Vertices[i].normal) > 0.0f)
+					{
+						const float Cosine = glm::clamp(glm::dot(DecodeNormal(Encoded[i]), glm::normalize(Vertices[i].normal)), -1.0f, 1.0f);
+						MaxNormalErrorDegrees = std::max(MaxNormalErrorDegrees, glm::degrees(std::acos(Cosine)));
+					}
+				}
+			}
+
+			std::cout << GetFormatName(Format) << " : " << Stride << " bytes/vertex, " << MeshBytes / 1024.0f << " KB, "
+				<< (float)(sizeof(Mesh::Vertex) * Vertices.size()) / (float)MeshBytes << "x smaller, "
+				<< MeshBytes * StressObjectCount / (1024.0f * 1024.0f) << " MB vertex fetch per " << StressObjectCount << " object frame, "
+				<< EncodeTimeMs << " ms encode, max position error " << MaxPositionError << " (" << (Diagonal > 0.0f ? 100.0f * MaxPositionError / Diagonal : 0.0f)
+				<< "% of bounds), max normal error " << MaxNormalErrorDegrees << " degrees" << std::endl;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef __VertexFormat_h__
+#define __VertexFormat_h__
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace VulkanTutorial
+{
+	// Layout of every vertex in the GeometryPool, chosen once for the whole scene
+	enum class VertexFormat
+	{
+		// Mesh::Vertex as is, 44 bytes
+		Float32,
+		// CompactVertex with half float positions
+		Half,
+		// CompactVertex with snorm16 positions
+		Snorm16,
+	};
+
+	// 20 byte vertex shared by the Half and Snorm16 formats. Positions are stored relative to the mesh bounds in
+	// [-1, 1] and scaled back by the mesh's dequantization matrix, which is folded into the model matrix.
+	struct CompactVertex
+	{
+		// xyz, w is padding
+		uint16_t Position[4];
+		// Octahedral encoding as two snorm16
+		uint32_t Normal;
+		// unorm8 rgba
+		uint8_t Color[4];
+		// Two half floats
+		uint16_t Uv[2];
+	};
+
+	// Maps positions of one mesh into [-1, 1] and back
+	struct VertexQuantization
+	{
+		glm::vec3 Center{ 0.0f };
+		glm::vec3 Extent{ 1.0f };
+
+		static VertexQuantization FromBounds(const glm::vec3& Min, const glm::vec3& Max);
+
+		// Turns quantized positions back into mesh space, multiply the model matrix with it
+		glm::mat4 GetDequantizeMatrix() const;
+	};
+
+	class VertexQuantizer
+	{
+	public:
+
+		static VkDeviceSize GetVertexStride(VertexFormat Format);
+		static const char* GetFormatName(VertexFormat Format);
+
+		// The compact formats store octahedral normals, the vertex shaders are specialized to decode them
+		static bool HasOctahedralNormals(VertexFormat Format) { return Format != VertexFormat::Float32; }
+
+		// Accepts the names printed by GetFormatName, case sensitive
+		static bool ParseFormat(const std::string& Name, VertexFormat& OutFormat);
+
+		static uint32_t EncodeOctahedral(const glm::vec3& Normal);
+		static glm::vec3 DecodeOctahedral(uint32_t Encoded);
+
+		static void Encode(VertexFormat Format, const VertexQuantization& Quantization
+			, const glm::vec3& Position, const glm::vec3& Color, const glm::vec3& Normal, const glm::vec2& Uv, CompactVertex& OutVertex);
+
+		// What the vertex shader sees after dequantization, for error measurements
+		static glm::vec3 DecodePosition(VertexFormat Format, const VertexQuantization& Quantization, const CompactVertex& Vertex);
+		static glm::vec3 DecodeNormal(const CompactVertex& Vertex);
+
+		// Loads FilePath and prints size, encode time and maximum position and normal error of every format
+		static void RunBenchmark(const std::string& FilePath);
+	};
+}
+
+#endif //__VertexFormat_h__
@@ -7,14 +7,374 @@
 #include <iostream>
 */
 
+#include "BasicRenderSystem.h"
 #include "EngineMain.h"
+#include "FrustumCulling.h"
+#include "GpuMemoryAllocator.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ParallelObjLoader.h"
+#include "UploadManager.h"
+#include "VertexFormat.h"
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main() 
+int main(int argc, char** argv) 
 {
-    VulkanTutorial::EngineMain Main;
+    // "cullbench" measures the CPU frustum culling kernels without opening a window
+    if (argc > 1 && std::string(argv[1]) == "cullbench")
+    {
+        VulkanTutorial::FrustumCulling::RunBenchmark(1000000);
+        return EXIT_SUCCESS;
+    }
+
+    // "allocbench" measures the GPU memory sub-allocator against a mocked memory type table, no device needed
+    if (argc > 1 && std::string(argv[1]) == "allocbench")
+    {
+        VulkanTutorial::GpuMemoryAllocator::RunBenchmark();
+        return EXIT_SUCCESS;
+    }
+
+    // "vertexbench [file.obj]" compares the size and precision of the vertex formats, no device needed
+    if (argc > 1 && std::string(argv[1]) == "vertexbench")
+    {
+        try
+        {
+            VulkanTutorial::VertexQuantizer::RunBenchmark(argc > 2 ? argv[2] : "./../../Content/smooth_vase.obj");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "objbench [file.obj] [syntheticMB]" parses a mesh and a generated OBJ with tinyobj and the parallel parser, times
+    // both including vertex deduplication, prints the unique to total vertex ratio and checks they build the same
+    // vertices and indices, no device needed
+    if (argc > 1 && std::string(argv[1]) == "objbench")
+    {
+        try
+        {
+            VulkanTutorial::ParallelObjLoader::RunBenchmark(argc > 2 ? argv[2] : "./../../Content/smooth_vase.obj"
+                , argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : 1024);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "cachebench [file.obj]" compares a cold parse and build against warm loads from the mapped mesh cache, no
+    // device needed. Writes the cache next to the file like a normal load.
+    if (argc > 1 && std::string(argv[1]) == "cachebench")
+    {
+        try
+        {
+            VulkanTutorial::MeshCache::RunBenchmark(argc > 2 ? argv[2] : "./../../Content/smooth_vase.obj");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "meshoptbench [file.obj]" reports ACMR, ATVR and vertex overfetch after every mesh optimization pass with a
+    // simulated vertex cache, no device needed
+    if (argc > 1 && std::string(argv[1]) == "meshoptbench")
+    {
+        try
+        {
+            VulkanTutorial::MeshOptimizer::RunBenchmark(argc > 2 ? argv[2] : "./../../Content/smooth_vase.obj");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "lodbench [file.obj]" builds the LOD chain of a mesh and reports triangles and error of every level, no device needed
+    if (argc > 1 && std::string(argv[1]) == "lodbench")
+    {
+        try
+        {
+            VulkanTutorial::MeshOptimizer::RunLodBenchmark(argc > 2 ? argv[2] : "./../../Content/smooth_vase.obj");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "meshletbench [file.obj]" builds the meshlets of a mesh and reports their fill and back face rejection, no device needed
+    if (argc > 1 && std::string(argv[1]) == "meshletbench")
+    {
+        try
+        {
+            VulkanTutorial::MeshOptimizer::RunMeshletBenchmark(argc > 2 ? argv[2] : "./../../Content/smooth_vase.obj");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "uploadbench" compares blocking and batched mesh uploads, "streambench" streams meshes through staging rings
+    // of different sizes, both only need a device
+    if (argc > 1 && (std::string(argv[1]) == "uploadbench" || std::string(argv[1]) == "streambench"))
+    {
+        try
+        {
+            VulkanTutorial::MyWindow Window("Upload benchmark", 320, 240);
+            VulkanTutorial::EngineDevice Device(Window);
+
+            if (std::string(argv[1]) == "uploadbench")
+                VulkanTutorial::UploadManager::RunBenchmark(Device, 1000);
+            else
+                VulkanTutorial::UploadManager::RunStreamingBenchmark(Device, 1000);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "pipelinebench" times pipeline creation with the pipeline cache from disk, cold and warm
+    if (argc > 1 && std::string(argv[1]) == "pipelinebench")
+    {
+        try
+        {
+            VulkanTutorial::EngineMain Main;
+            Main.RunPipelineBenchmark(5);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "flythrough [objects] [assets] [budgetMB] [frames]" flies the camera down a corridor of streamed meshes and
+    // reports frame time percentiles, once drawn instanced with CPU culling and once indirect with GPU culling
+    if (argc > 1 && std::string(argv[1]) == "flythrough")
+    {
+        const uint32_t ObjectCount = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 20000;
+        const uint32_t AssetCount = argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : VulkanTutorial::EngineMain::DEFAULT_CORRIDOR_ASSET_COUNT;
+        const VkDeviceSize BudgetMB = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 32;
+        const uint32_t FrameCount = argc > 5 ? (uint32_t)std::strtoul(argv[5], nullptr, 10) : 3000;
+
+        try
+        {
+            // A new scene for each run, so both stream the same sequence from nothing resident
+            for (bool Indirect : { false, true })
+            {
+                std::cout << (Indirect ? "Indirect drawing with GPU culling" : "Instanced drawing with CPU culling") << std::endl;
+
+                VulkanTutorial::EngineMain Main(std::max(ObjectCount, 1u), VulkanTutorial::EngineMain::StressLayout::Corridor, VulkanTutorial::EngineSwapChain::DEFAULT_FRAMES_IN_FLIGHT
+                    , false, VulkanTutorial::VertexFormat::Float32, AssetCount, BudgetMB * 1024 * 1024);
+                VulkanTutorial::RunSettings Settings;
+                Settings.FrameCount = std::max(FrameCount, 1u);
+                Settings.Flythrough = true;
+                Settings.FlythroughIndirect = Indirect;
+                Main.Run(Settings);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "pipelinestress [objects] [materials] [sync]" adds materials half way through a fixed run and reports the frame
+    // times around it, "sync" compiles their pipelines on the render thread instead of in the background
+    if (argc > 1 && std::string(argv[1]) == "pipelinestress")
+    {
+        const uint32_t ObjectCount = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 2000;
+        const uint32_t MaterialCount = argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : 100;
+
+        try
+        {
+            VulkanTutorial::EngineMain Main(std::max(ObjectCount, 1u));
+
+            VulkanTutorial::RunSettings Settings;
+            Settings.FrameCount = 600;
+            Settings.MaterialBurstCount = std::max(MaterialCount, 1u);
+            Settings.SynchronousMaterials = argc > 4 && std::string(argv[4]) == "sync";
+            Main.Run(Settings);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "recordbench [objects] [frames]" draws the stress scene per object with every record thread count from one to
+    // BasicRenderSystem::GetMaxRecordThreadCount and reports the average record time of each
+    if (argc > 1 && std::string(argv[1]) == "recordbench")
+    {
+        const uint32_t ObjectCount = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 50000;
+        const uint32_t FrameCount = argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : 500;
+
+        try
+        {
+            VulkanTutorial::EngineMain Main(std::max(ObjectCount, 1u));
+
+            for (uint32_t ThreadCount = 1; ThreadCount <= VulkanTutorial::BasicRenderSystem::GetMaxRecordThreadCount(); ThreadCount++)
+            {
+                std::cout << ThreadCount << " record threads" << std::endl;
+
+                VulkanTutorial::RunSettings Settings;
+                Settings.FrameCount = std::max(FrameCount, 1u);
+                Settings.RecordThreadCount = ThreadCount;
+                Main.Run(Settings);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "latencybench [objects] [frames]" draws the stress scene with every frames in flight count from one to
+    // EngineSwapChain::MAX_FRAMES_IN_FLIGHT and reports the input to present latency and frame rate of each
+    if (argc > 1 && std::string(argv[1]) == "latencybench")
+    {
+        const uint32_t ObjectCount = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 20000;
+        const uint32_t FrameCount = argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : 1000;
+
+        try
+        {
+            VulkanTutorial::EngineMain Main(std::max(ObjectCount, 1u));
+
+            for (uint32_t FramesInFlight = 1; FramesInFlight <= VulkanTutorial::EngineSwapChain::MAX_FRAMES_IN_FLIGHT; FramesInFlight++)
+            {
+                std::cout << FramesInFlight << " frames in flight" << std::endl;
+
+                VulkanTutorial::RunSettings Settings;
+                Settings.FrameCount = std::max(FrameCount, 1u);
+                Settings.FramesInFlight = FramesInFlight;
+                Main.Run(Settings);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // "variantbench [objects] [frames]" draws the stress scene instanced with specialized and with uniform branch lighting,
+    // first with a fixed lighting model, then switching it every 100 frames
+    if (argc > 1 && std::string(argv[1]) == "variantbench")
+    {
+        const uint32_t ObjectCount = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 20000;
+        const uint32_t FrameCount = argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : 1000;
+
+        try
+        {
+            VulkanTutorial::EngineMain Main(std::max(ObjectCount, 1u));
+
+            for (bool Switching : { false, true })
+            {
+                for (bool UniformLighting : { false, true })
+                {
+                    std::cout << (UniformLighting ? "Uniform branch lighting" : "Specialized lighting") << (Switching ? ", switching the model every 100 frames" : "") << std::endl;
+
+                    VulkanTutorial::RunSettings Settings;
+                    Settings.FrameCount = std::max(FrameCount, 1u);
+                    Settings.Instanced = true;
+                    Settings.UniformLighting = UniformLighting;
+                    Settings.LightingSwitchInterval = Switching ? 100 : 0;
+                    Main.Run(Settings);
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Optional arguments: number of objects in the stress scene, then "surround" to spread them around the camera,
+    // "depth" to spread them through the view at every distance, "unique" to give every object its own mesh,
+    // "-frames N" sets the initial number of frames in flight, "-vertex float32|half|snorm16" sets the vertex format
+    // of every mesh
+    uint32_t StressObjectCount = 0;
+    VulkanTutorial::EngineMain::StressLayout Layout = VulkanTutorial::EngineMain::StressLayout::Grid;
+    bool UniqueMeshes = false;
+    uint32_t FramesInFlight = VulkanTutorial::EngineSwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+    VulkanTutorial::VertexFormat MeshVertexFormat = VulkanTutorial::VertexFormat::Float32;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string Argument = argv[i];
+
+        if (Argument == "surround")
+            Layout = VulkanTutorial::EngineMain::StressLayout::Surround;
+        else if (Argument == "depth")
+            Layout = VulkanTutorial::EngineMain::StressLayout::Depth;
+        else if (Argument == "unique")
+            UniqueMeshes = true;
+        else if (Argument == "-frames" && i + 1 < argc)
+            FramesInFlight = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (Argument == "-vertex" && i + 1 < argc)
+        {
+            if (!VulkanTutorial::VertexQuantizer::ParseFormat(argv[++i], MeshVertexFormat))
+            {
+                std::cerr << "-vertex must be float32, half or snorm16\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else
+            StressObjectCount = (uint32_t)std::strtoul(argv[i], nullptr, 10);
+    }
+
+    if (FramesInFlight < 1 || FramesInFlight > VulkanTutorial::EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+    {
+        std::cerr << "-frames must be between 1 and " << VulkanTutorial::EngineSwapChain::MAX_FRAMES_IN_FLIGHT << '\n';
+        return EXIT_FAILURE;
+    }
+
+    VulkanTutorial::EngineMain Main(StressObjectCount, Layout, FramesInFlight, UniqueMeshes, MeshVertexFormat);
 
     try
     {